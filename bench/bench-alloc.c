@@ -0,0 +1,302 @@
+/**
+ * @file    bench-alloc.c
+ * @brief   Counts the memory allocations made by each image selection.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Usage: bench-alloc [--files N] [--cache N] [--rounds N] [--merges FILE]
+    
+    Replays the work of the plugin when the selected image changes: the
+    image cache is looked up and, on a miss, the generation data is read
+    (read_image_info_data), parsed (parse_image_info_data) and inserted in
+    the cache, evicting the least recently used image.
+    
+      --files N      PNG files generated and selected in turn (default: 12)
+      --cache N      capacity of the image cache (default: 4), smaller than
+                     the number of files so every selection is a miss
+      --rounds N     times the files are selected (default: 10)
+      --merges FILE  CLIP merges used to count the tokens of the prompts
+                     (default: clip/clip-merges.txt if it exists)
+    
+    malloc(), calloc() and realloc() are replaced (glibc only) to count the
+    calls made by each selection. The first round fills the arena pool, the
+    PNG block and the caches; after that the selections must not allocate
+    at all, and the exit status is 1 if they do. With the CLIP merges, the
+    files are selected twice: with the CLIP cache of the plugin, and with a
+    cache too small for the prompts, where every token count evicts one. The GFile and the GTask of
+    each request, and the GTK widgets, aren't part of the count.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include "../utils_arena.h"
+#include "../utils_png.h"
+#include "../utils_sdparams.h"
+#include "../utils_json.h"
+#include "../utils_comfyui.h"
+#include "../utils_cache.h"
+#include "../utils_clip.h"
+#include "../utils_imageinfo.h"
+
+#define DEFAULT_MERGES "clip/clip-merges.txt"
+
+/* CLIP cache of the second run, smaller than the number of prompts */
+#define EVICTING_CLIP_CACHE 4
+
+/*--------------------------- ALLOCATION COUNTER --------------------------*/
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static gint     alloc_count;
+static gboolean alloc_counting;
+
+void *
+malloc(size_t size)
+{
+    if( alloc_counting ) { g_atomic_int_inc(&alloc_count); }
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size)
+{
+    if( alloc_counting ) { g_atomic_int_inc(&alloc_count); }
+    return __libc_calloc(count, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    if( alloc_counting ) { g_atomic_int_inc(&alloc_count); }
+    return __libc_realloc(ptr, size);
+}
+
+/*------------------------------- TEST FILES ------------------------------*/
+
+static void
+write_chunk(FILE *file, const gchar *type, const void *data, gsize size)
+{
+    static const guint8 filler_crc[CHUNK_CRC_SIZE];
+    guint8 length[4];
+    length[0] = (guint8)(size >> 24); length[1] = (guint8)(size >> 16);
+    length[2] = (guint8)(size >>  8); length[3] = (guint8)(size      );
+    fwrite(length, 1, 4, file);
+    fwrite(type,   1, 4, file);
+    if( size>0 ) { fwrite(data, 1, size, file); }
+    fwrite(filler_crc, 1, CHUNK_CRC_SIZE, file);
+}
+
+/* Generation data of the file 'index', A1111 text or a ComfyUI graph */
+static gchar *
+make_generation_data(guint index)
+{
+    if( index%4 == 3 ) {
+        return g_strdup_printf(
+            "prompt%c{\"3\": {\"class_type\": \"KSampler\", \"inputs\": {"
+            "\"seed\": %u, \"steps\": 20, \"cfg\": 7, \"sampler_name\": \"euler\", "
+            "\"model\": [\"4\", 0], \"positive\": [\"6\", 0], "
+            "\"negative\": [\"7\", 0], \"latent_image\": [\"5\", 0]}}, "
+            "\"4\": {\"class_type\": \"CheckpointLoaderSimple\", "
+            "\"inputs\": {\"ckpt_name\": \"model-%u.safetensors\"}}, "
+            "\"5\": {\"class_type\": \"EmptyLatentImage\", "
+            "\"inputs\": {\"width\": 512, \"height\": 768, \"batch_size\": 1}}, "
+            "\"6\": {\"class_type\": \"CLIPTextEncode\", \"inputs\": "
+            "{\"text\": \"a castle number %u on a hill, (sunset:1.2), <lora:detail:0.5>\"}}, "
+            "\"7\": {\"class_type\": \"CLIPTextEncode\", \"inputs\": "
+            "{\"text\": \"blurry, lowres\"}}}",
+            '\0', index, index, index);
+    }
+    return g_strdup_printf(
+        "parameters%ca lighthouse number %u on a cliff, (sunset:1.2), "
+        "[stormy sky|calm sea], <lora:detail:0.5>, masterpiece\n"
+        "Negative prompt: blurry, lowres, (bad hands:1.3)\n"
+        "Steps: 30, Sampler: DPM++ 2M Karras, CFG scale: 7, Seed: %u, "
+        "Size: 512x768, Model hash: 6ce0161689, Model: model-%u, "
+        "Denoising strength: 0.5, Hires upscale: 2, Hires upscaler: Latent",
+        '\0', index, 1000+index, index);
+}
+
+static gboolean
+write_test_png(const gchar *path, guint index)
+{
+    static const guint8 ihdr[13] = { 0,0,2,0, 0,0,3,0, 8, 2, 0, 0, 0 };
+    guint8 idat[4096] = { 0 }; gchar *data; gsize size;
+    FILE *file = fopen(path, "wb");
+    if( !file ) { return FALSE; }
+    
+    data = make_generation_data(index);
+    size = strlen(data) + 1 + strlen(data + strlen(data) + 1);
+    fwrite(PNG_SIGNATURE, 1, PNG_SIGNATURE_LENGTH, file);
+    write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+    write_chunk(file, "tEXt", data, size);
+    write_chunk(file, "IDAT", idat, sizeof(idat));
+    write_chunk(file, "IEND", NULL, 0);
+    g_free(data);
+    return fclose(file)==0;
+}
+
+/* Creates a tokenizer from a merges file, caching 'cache_capacity' counts */
+static ClipTokenizer *
+load_clip_tokenizer(const gchar *path, guint cache_capacity)
+{
+    ClipTokenizer *clip; gchar *data; gsize size;
+    if( !g_file_get_contents(path, &data, &size, NULL) ) { return NULL; }
+    clip = clip_tokenizer_new_from_data(data, size, cache_capacity);
+    g_free(data);
+    return clip;
+}
+
+/*------------------------------- BENCHMARK -------------------------------*/
+
+/* Selects an image as the plugin does, returns TRUE if it had parameters */
+static gboolean
+select_image(LRUCache *cache, GFile *file, const gchar *uri, ClipTokenizer *clip)
+{
+    SDImageInfo *info = lru_cache_lookup(cache, uri);
+    if( !info ) {
+        info = new_image_info();
+        read_image_info_data(info, file);
+        parse_image_info_data(info, clip);
+        lru_cache_insert(cache, uri, info);
+    }
+    return info->parameters!=NULL;
+}
+
+/* Selects every file 'rounds' times, returns the steady state allocations */
+static gint
+run_selections(GFile **files, gchar **uris, guint file_count, guint capacity,
+               guint rounds, ClipTokenizer *clip, const gchar *description)
+{
+    LRUCache *cache; guint round, i, with_data;
+    gint first_round = 0, steady = 0; gint64 start, elapsed;
+    
+    cache = lru_cache_new(capacity, (GDestroyNotify)unref_image_info);
+    printf("%u files, image cache of %u, %u rounds, %s\n", file_count, capacity,
+           rounds, description);
+    start = g_get_monotonic_time();
+    for( round=0 ; round<rounds ; ++round ) {
+        with_data = 0;
+        alloc_count    = 0;
+        alloc_counting = TRUE;
+        for( i=0 ; i<file_count ; ++i ) {
+            if( select_image(cache, files[i], uris[i], clip) ) { ++with_data; }
+        }
+        alloc_counting = FALSE;
+        if( round==0 ) { first_round = alloc_count; }
+        else           { steady     += alloc_count; }
+        if( with_data!=file_count ) {
+            printf("warning: %u of %u images without parameters\n",
+                   file_count - with_data, file_count);
+        }
+    }
+    elapsed = g_get_monotonic_time() - start;
+    lru_cache_free(cache);
+    
+    printf("  first round   %8d allocations  %8.2f per selection\n",
+           first_round, (double)first_round / file_count);
+    printf("  steady state  %8d allocations  %8.2f per selection\n",
+           steady, (double)steady / (file_count * (rounds-1)));
+    printf("  %.1f us per selection\n", (double)elapsed / (file_count * rounds));
+    return steady;
+}
+
+int
+main(int argc, char *argv[])
+{
+    guint file_count = 12, capacity = 4, rounds = 10, i;
+    const gchar *merges = NULL; gchar *directory, *path, *description;
+    GFile **files; gchar **uris; ClipTokenizer *clip, *evicting_clip;
+    gint steady;
+    
+    for( i=1 ; i<(guint)argc ; ++i ) {
+        if     ( strcmp(argv[i],"--files")==0  && i+1<(guint)argc ) { file_count = MAX(1, atoi(argv[++i])); }
+        else if( strcmp(argv[i],"--cache")==0  && i+1<(guint)argc ) { capacity   = MAX(1, atoi(argv[++i])); }
+        else if( strcmp(argv[i],"--rounds")==0 && i+1<(guint)argc ) { rounds     = MAX(2, atoi(argv[++i])); }
+        else if( strcmp(argv[i],"--merges")==0 && i+1<(guint)argc ) { merges     = argv[++i]; }
+        else {
+            fprintf(stderr, "Usage: %s [--files N] [--cache N] [--rounds N] "
+                            "[--merges FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    clip          = load_clip_tokenizer(merges ? merges : DEFAULT_MERGES, CLIP_CACHE_CAPACITY);
+    evicting_clip = load_clip_tokenizer(merges ? merges : DEFAULT_MERGES, EVICTING_CLIP_CACHE);
+    if( merges && !clip ) {
+        fprintf(stderr, "Cannot load the CLIP merges from '%s'\n", merges);
+        return 1;
+    }
+    directory = g_dir_make_tmp("bench-alloc-XXXXXX", NULL);
+    if( !directory ) {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return 1;
+    }
+    files = g_new(GFile *, file_count);
+    uris  = g_new(gchar *, file_count);
+    for( i=0 ; i<file_count ; ++i ) {
+        path     = g_strdup_printf("%s/image-%03u.png", directory, i);
+        write_test_png(path, i);
+        files[i] = g_file_new_for_path(path);
+        uris[i]  = g_file_get_uri(files[i]);
+        g_free(path);
+    }
+    
+    if( !clip ) {
+        steady = run_selections(files, uris, file_count, capacity, rounds,
+                                NULL, "without CLIP merges");
+    } else {
+        description = g_strdup_printf("CLIP cache of %d", CLIP_CACHE_CAPACITY);
+        steady  = run_selections(files, uris, file_count, capacity, rounds,
+                                 clip, description);
+        g_free(description);
+        /* the prompts don't fit in the cache, so every count evicts one */
+        description = g_strdup_printf("CLIP cache of %d", EVICTING_CLIP_CACHE);
+        steady += run_selections(files, uris, file_count, capacity, rounds,
+                                 evicting_clip, description);
+        g_free(description);
+    }
+    
+    for( i=0 ; i<file_count ; ++i ) {
+        path = g_file_get_path(files[i]);
+        g_unlink(path);
+        g_free(path);
+        g_object_unref(files[i]);
+        g_free(uris[i]);
+    }
+    g_free(files);
+    g_free(uris);
+    g_rmdir(directory);
+    g_free(directory);
+    return steady==0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file    bench-pngbatch.c
+ * @brief   Benchmarks the bulk PNG text chunk readers.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Usage: bench-pngbatch [--cold] [--threads N] DIRECTORY
+    
+    Reads the generation data of every PNG file in DIRECTORY with each
+    available backend and reports the number of files per second:
+    
+      gio      sdprompt_core_read_text(), one file at a time (the old path)
+      pread    sdprompt_core_read_text_batch_full() with blocking pread()
+      io_uring sdprompt_core_read_text_batch_full() with one ring per
+               thread (libsdprompt-core built with USE_IO_URING=1)
+    
+    Every backend runs in N threads (default: number of cores) that claim
+    batches from a shared cursor, the same scheme used by the indexer.
+    With --cold the files are evicted from the page cache before each run
+    using posix_fadvise(), so the disk is measured instead of the memory.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include "../sdprompt-core.h"
+
+#define BATCH_SIZE SDPROMPT_CORE_BATCH_SIZE
+
+typedef enum Backend { BACKEND_GIO, BACKEND_PREAD, BACKEND_URING } Backend;
+
+typedef struct _Bench Bench;
+struct         _Bench {
+    gchar  **paths;
+    guint    count;
+    Backend  backend;
+    gint     cursor;        /* atomic */
+    gint     with_text;     /* atomic */
+    gint     uring_used;    /* atomic */
+};
+
+static void
+on_text_loaded(guint index, const gchar *text, gpointer user_data)
+{
+    Bench *bench = user_data;
+    if( text ) { g_atomic_int_inc(&bench->with_text); }
+}
+
+static gpointer
+bench_worker(gpointer data)
+{
+    Bench *bench = data; GFile *file; gchar *text; guint first, count, i;
+    SDCoreReader used;
+    
+    while( TRUE ) {
+        first = (guint)g_atomic_int_add(&bench->cursor, BATCH_SIZE);
+        if( first>=bench->count ) { break; }
+        count = MIN(BATCH_SIZE, bench->count - first);
+        if( bench->backend==BACKEND_GIO ) {
+            for( i=first ; i<first+count ; ++i ) {
+                file = g_file_new_for_path(bench->paths[i]);
+                text = sdprompt_core_read_text(file);
+                on_text_loaded(i, text, bench);
+                g_free(text);
+                g_object_unref(file);
+            }
+            continue;
+        }
+        used = sdprompt_core_read_text_batch_full((const gchar * const *)&bench->paths[first],
+                                                  count,
+                                                  bench->backend==BACKEND_URING
+                                                  ? SD_CORE_READER_IO_URING : SD_CORE_READER_PREAD,
+                                                  on_text_loaded, bench);
+        if( used==SD_CORE_READER_IO_URING ) { g_atomic_int_set(&bench->uring_used, TRUE); }
+    }
+    return NULL;
+}
+
+static void
+evict_from_page_cache(gchar **paths, guint count)
+{
+    guint i; int fd;
+    for( i=0 ; i<count ; ++i ) {
+        fd = open(paths[i], O_RDONLY|O_CLOEXEC);
+        if( fd<0 ) { continue; }
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static void
+run_backend(const gchar *name, Backend backend,
+            gchar **paths, guint count, guint threads, gboolean cold)
+{
+    GThread **workers; Bench bench; gint64 start, elapsed; guint i;
+    
+    if( cold ) { evict_from_page_cache(paths, count); }
+    memset(&bench, 0, sizeof(bench));
+    bench.paths   = paths;
+    bench.count   = count;
+    bench.backend = backend;
+    workers = g_new(GThread *, threads);
+    start   = g_get_monotonic_time();
+    for( i=0 ; i<threads ; ++i ) {
+        workers[i] = g_thread_new("bench", bench_worker, &bench);
+    }
+    for( i=0 ; i<threads ; ++i ) { g_thread_join(workers[i]); }
+    elapsed = MAX(1, g_get_monotonic_time() - start);
+    g_free(workers);
+    
+    if( backend==BACKEND_URING && !bench.uring_used ) {
+        printf("%-8s  not available (library built without USE_IO_URING=1,"
+               " or io_uring disabled by the kernel)\n", name);
+        return;
+    }
+    printf("%-8s  %8.0f files/s  %7.3f s  %u files, %d with text\n",
+           name, count / (elapsed / 1e6), elapsed / 1e6, count, bench.with_text);
+}
+
+static gchar **
+list_png_files(const gchar *directory, guint *out_count)
+{
+    GPtrArray *paths; GDir *dir; const gchar *name;
+    
+    paths = g_ptr_array_new();
+    dir   = g_dir_open(directory, 0, NULL);
+    while( dir && (name = g_dir_read_name(dir)) ) {
+        if( g_str_has_suffix(name, ".png") || g_str_has_suffix(name, ".PNG") ) {
+            g_ptr_array_add(paths, g_build_filename(directory, name, NULL));
+        }
+    }
+    if( dir ) { g_dir_close(dir); }
+    (*out_count) = paths->len;
+    g_ptr_array_add(paths, NULL);
+    return (gchar **)g_ptr_array_free(paths, FALSE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const gchar *directory = NULL; gboolean cold = FALSE;
+    guint threads = g_get_num_processors(), count; gchar **paths; int i;
+    
+    for( i=1 ; i<argc ; ++i ) {
+        if     ( strcmp(argv[i],"--cold")==0 ) { cold = TRUE; }
+        else if( strcmp(argv[i],"--threads")==0 && i+1<argc ) {
+            threads = MAX(1, atoi(argv[++i]));
+        }
+        else { directory = argv[i]; }
+    }
+    if( !directory ) {
+        fprintf(stderr, "Usage: %s [--cold] [--threads N] DIRECTORY\n", argv[0]);
+        return 1;
+    }
+    paths = list_png_files(directory, &count);
+    if( count==0 ) {
+        fprintf(stderr, "No PNG files found in '%s'\n", directory);
+        g_strfreev(paths);
+        return 1;
+    }
+    printf("%u PNG files, %u threads, %s cache\n",
+           count, threads, cold ? "cold" : "warm");
+    run_backend("gio",      BACKEND_GIO,   paths, count, threads, cold);
+    run_backend("pread",    BACKEND_PREAD, paths, count, threads, cold);
+    run_backend("io_uring", BACKEND_URING, paths, count, threads, cold);
+    g_strfreev(paths);
+    return 0;
+}
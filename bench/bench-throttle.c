@@ -0,0 +1,370 @@
+/**
+ * @file    bench-throttle.c
+ * @brief   Benchmarks the PNG text reader over simulated slow storage.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Usage: bench-throttle [--latency MS] [--bandwidth MIB] [--no-seek]
+                          [--skip-as-read] [--files N]
+    
+    Measures load_png_text_chunk() end to end, as it runs in the plugin,
+    with every file stream wrapped in a GInputStream that sleeps on each
+    read to simulate a network mount:
+    
+      --latency MS     round trip of every read (default: 2 ms)
+      --bandwidth MIB  transfer rate in MiB/s (default: 50, 0 = unlimited)
+      --no-seek        the stream is not seekable, as a pipe or some
+                       remote streams, so the reader can only go forward
+      --skip-as-read   skips are served by reading and discarding the data,
+                       as some network filesystems do, instead of seeking
+      --files N        files read per layout (default: 10)
+    
+    The PNG files are generated in a temporary directory with different
+    chunk layouts; only the layout matters, so the pixel data and the CRCs
+    are filler. For each layout it reports the reads issued, the skips,
+    the seeks, the bytes read and the wall time per file; seeks only move
+    the file position so they are free, the next read pays the round trip.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+static GInputStream *throttle_stream(GInputStream *base_stream);
+#define PNG_WRAP_INPUT_STREAM(stream) throttle_stream(stream)
+#include "../utils_png.h"
+
+#define KEYS       "parameters|prompt"
+#define SCRATCH_SIZE (64*1024)
+
+/*------------------------- THROTTLED INPUT STREAM ------------------------*/
+
+typedef struct _ThrottleConfig ThrottleConfig;
+struct         _ThrottleConfig {
+    gint64   latency_us;    /* round trip of every read                */
+    double   bandwidth;     /* bytes per second, 0 = unlimited         */
+    gboolean no_seek;       /* the stream is not seekable              */
+    gboolean skip_as_read;  /* skips read and discard the data         */
+};
+
+typedef struct _ThrottleStats ThrottleStats;
+struct         _ThrottleStats {
+    guint64  reads;         /* read requests sent to the storage       */
+    guint64  skips;         /* skips served by seeking                 */
+    guint64  seeks;
+    guint64  bytes;         /* bytes transferred from the storage      */
+};
+
+static ThrottleConfig throttle_config = { 2000, 50.0*1024*1024, FALSE, FALSE };
+static ThrottleStats  throttle_stats;
+
+typedef struct _ThrottledInputStream      ThrottledInputStream;
+typedef struct _ThrottledInputStreamClass ThrottledInputStreamClass;
+struct _ThrottledInputStream      { GFilterInputStream      parent; };
+struct _ThrottledInputStreamClass { GFilterInputStreamClass parent_class; };
+
+static void throttled_seekable_init(GSeekableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(ThrottledInputStream, throttled_input_stream, G_TYPE_FILTER_INPUT_STREAM,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_SEEKABLE, throttled_seekable_init))
+
+/* Waits the time that a request transferring 'bytes' takes */
+static void
+throttle_wait(gsize bytes)
+{
+    gint64 wait = throttle_config.latency_us;
+    if( throttle_config.bandwidth>0 ) {
+        wait += (gint64)(bytes * 1e6 / throttle_config.bandwidth);
+    }
+    throttle_stats.reads++;
+    throttle_stats.bytes += bytes;
+    if( wait>0 ) { g_usleep(wait); }
+}
+
+static gssize
+throttled_read(GInputStream *stream, void *buffer, gsize count,
+               GCancellable *cancellable, GError **error)
+{
+    GInputStream *base = G_FILTER_INPUT_STREAM(stream)->base_stream;
+    gssize bytes_read = g_input_stream_read(base, buffer, count, cancellable, error);
+    if( bytes_read>=0 ) { throttle_wait((gsize)bytes_read); }
+    return bytes_read;
+}
+
+static gssize
+throttled_skip(GInputStream *stream, gsize count,
+               GCancellable *cancellable, GError **error)
+{
+    GInputStream *base = G_FILTER_INPUT_STREAM(stream)->base_stream;
+    guint8 *scratch; gssize bytes_read = 0; gsize skipped = 0;
+    
+    if( !throttle_config.skip_as_read ) {
+        throttle_stats.skips++;
+        return g_input_stream_skip(base, count, cancellable, error);
+    }
+    /* a single request that streams the skipped data */
+    scratch = g_malloc(SCRATCH_SIZE);
+    while( skipped<count ) {
+        bytes_read = g_input_stream_read(base, scratch, MIN(count-skipped, SCRATCH_SIZE),
+                                         cancellable, error);
+        if( bytes_read<=0 ) { break; }
+        skipped += (gsize)bytes_read;
+    }
+    g_free(scratch);
+    throttle_wait(skipped);
+    return bytes_read<0 ? -1 : (gssize)skipped;
+}
+
+#define BASE_SEEKABLE(seekable) \
+    G_SEEKABLE(G_FILTER_INPUT_STREAM(seekable)->base_stream)
+
+static goffset
+throttled_tell(GSeekable *seekable)
+{
+    return g_seekable_tell(BASE_SEEKABLE(seekable));
+}
+
+static gboolean
+throttled_can_seek(GSeekable *seekable)
+{
+    return !throttle_config.no_seek && g_seekable_can_seek(BASE_SEEKABLE(seekable));
+}
+
+static gboolean
+throttled_seek(GSeekable *seekable, goffset offset, GSeekType type,
+               GCancellable *cancellable, GError **error)
+{
+    if( !throttled_can_seek(seekable) ) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                            "Seek not supported on stream");
+        return FALSE;
+    }
+    throttle_stats.seeks++;
+    return g_seekable_seek(BASE_SEEKABLE(seekable), offset, type, cancellable, error);
+}
+
+static gboolean
+throttled_can_truncate(GSeekable *seekable)
+{
+    return FALSE;
+}
+
+static gboolean
+throttled_truncate(GSeekable *seekable, goffset offset,
+                   GCancellable *cancellable, GError **error)
+{
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                        "Truncate not allowed on input stream");
+    return FALSE;
+}
+
+static void
+throttled_seekable_init(GSeekableIface *iface)
+{
+    iface->tell         = throttled_tell;
+    iface->can_seek     = throttled_can_seek;
+    iface->seek         = throttled_seek;
+    iface->can_truncate = throttled_can_truncate;
+    iface->truncate_fn  = throttled_truncate;
+}
+
+static void
+throttled_input_stream_class_init(ThrottledInputStreamClass *klass)
+{
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS(klass);
+    stream_class->read_fn = throttled_read;
+    stream_class->skip    = throttled_skip;
+}
+
+static void
+throttled_input_stream_init(ThrottledInputStream *stream)
+{
+}
+
+/* Wraps the file stream opened by utils_png.h (takes ownership) */
+static GInputStream *
+throttle_stream(GInputStream *base_stream)
+{
+    GInputStream *stream = g_object_new(throttled_input_stream_get_type(),
+                                        "base-stream", base_stream, NULL);
+    g_object_unref(base_stream);
+    /* opening the file is a round trip too */
+    throttle_wait(0);
+    return stream;
+}
+
+/*------------------------------ PNG LAYOUTS ------------------------------*/
+
+typedef struct _Layout Layout;
+struct         _Layout {
+    const gchar *name;
+    gboolean     text_first;    /* tEXt before the image data        */
+    gboolean     with_text;     /* FALSE = the whole file is scanned */
+    guint        idat_count;
+    gsize        idat_size;
+};
+
+static const Layout LAYOUTS[] = {
+    { "text-first",  TRUE,  TRUE,    8, 64*1024 },
+    { "text-last",   FALSE, TRUE,    8, 64*1024 },
+    { "fragmented",  FALSE, TRUE,  256,  2*1024 },
+    { "no-text",     FALSE, FALSE,   8, 64*1024 }
+};
+
+static void
+write_chunk(FILE *file, const gchar *type, const void *data, gsize size)
+{
+    static const guint8 filler_crc[CHUNK_CRC_SIZE];
+    guint8 length[4];
+    length[0] = (guint8)(size >> 24); length[1] = (guint8)(size >> 16);
+    length[2] = (guint8)(size >>  8); length[3] = (guint8)(size      );
+    fwrite(length, 1, 4, file);
+    fwrite(type,   1, 4, file);
+    if( size>0 ) { fwrite(data, 1, size, file); }
+    fwrite(filler_crc, 1, CHUNK_CRC_SIZE, file);
+}
+
+static void
+write_text_chunk(FILE *file)
+{
+    GString *text = g_string_new("parameters");
+    guint i;
+    g_string_append_c(text, '\0');
+    for( i=0 ; i<16 ; ++i ) {
+        g_string_append(text, "a photograph of a lighthouse on a cliff, sunset, ");
+    }
+    g_string_append(text, "\nSteps: 30, Sampler: Euler a, CFG scale: 7, "
+                          "Seed: 1234, Size: 512x512, Model: v1-5");
+    write_chunk(file, "tEXt", text->str, text->len);
+    g_string_free(text, TRUE);
+}
+
+static gboolean
+write_layout_png(const gchar *path, const Layout *layout)
+{
+    static const guint8 ihdr[13] = { 0,0,2,0, 0,0,2,0, 8, 2, 0, 0, 0 };
+    guint8 *idat; guint i;
+    FILE *file = fopen(path, "wb");
+    if( !file ) { return FALSE; }
+    
+    idat = g_malloc0(layout->idat_size);
+    fwrite(PNG_SIGNATURE, 1, PNG_SIGNATURE_LENGTH, file);
+    write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+    if( layout->with_text && layout->text_first ) { write_text_chunk(file); }
+    for( i=0 ; i<layout->idat_count ; ++i ) {
+        write_chunk(file, "IDAT", idat, layout->idat_size);
+    }
+    if( layout->with_text && !layout->text_first ) { write_text_chunk(file); }
+    write_chunk(file, "IEND", NULL, 0);
+    g_free(idat);
+    return fclose(file)==0;
+}
+
+/*------------------------------- BENCHMARK -------------------------------*/
+
+static void
+on_text_loaded(gchar *text, gpointer data_ptr, int data_int)
+{
+    guint *with_text = data_ptr;
+    if( text && text[0] ) { (*with_text)++; }
+}
+
+static void
+run_layout(const gchar *directory, const Layout *layout, guint files)
+{
+    gchar *path; GFile *file; gint64 start, elapsed; guint i, with_text = 0;
+    
+    path = g_build_filename(directory, layout->name, NULL);
+    if( !write_layout_png(path, layout) ) {
+        printf("%-11s  cannot write '%s'\n", layout->name, path);
+        g_free(path);
+        return;
+    }
+    file = g_file_new_for_path(path);
+    memset(&throttle_stats, 0, sizeof(throttle_stats));
+    start = g_get_monotonic_time();
+    for( i=0 ; i<files ; ++i ) {
+        load_png_text_chunk(file, KEYS, on_text_loaded, &with_text, 0);
+    }
+    elapsed = MAX(1, g_get_monotonic_time() - start);
+    printf("%-11s  %6.1f reads  %6.1f skips  %6.1f seeks  %9.0f bytes  %8.2f ms/file  %u/%u with text\n",
+           layout->name,
+           (double)throttle_stats.reads / files,
+           (double)throttle_stats.skips / files,
+           (double)throttle_stats.seeks / files,
+           (double)throttle_stats.bytes / files,
+           elapsed / 1e3 / files, with_text, files);
+    g_object_unref(file);
+    g_unlink(path);
+    g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+    gchar *directory; guint files = 10, i;
+    
+    for( i=1 ; i<(guint)argc ; ++i ) {
+        if     ( strcmp(argv[i],"--skip-as-read")==0 ) { throttle_config.skip_as_read = TRUE; }
+        else if( strcmp(argv[i],"--no-seek")==0      ) { throttle_config.no_seek      = TRUE; }
+        else if( strcmp(argv[i],"--latency")==0 && i+1<(guint)argc ) {
+            throttle_config.latency_us = (gint64)(MAX(0.0, atof(argv[++i])) * 1000);
+        }
+        else if( strcmp(argv[i],"--bandwidth")==0 && i+1<(guint)argc ) {
+            throttle_config.bandwidth = MAX(0.0, atof(argv[++i])) * 1024*1024;
+        }
+        else if( strcmp(argv[i],"--files")==0 && i+1<(guint)argc ) {
+            files = MAX(1, atoi(argv[++i]));
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--latency MS] [--bandwidth MIB] [--no-seek] "
+                            "[--skip-as-read] [--files N]\n", argv[0]);
+            return 1;
+        }
+    }
+    directory = g_dir_make_tmp("bench-throttle-XXXXXX", NULL);
+    if( !directory ) {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return 1;
+    }
+    printf("latency %.2f ms, bandwidth %.1f MiB/s, %s stream, skips %s, %u files per layout\n",
+           throttle_config.latency_us / 1e3,
+           throttle_config.bandwidth / (1024*1024),
+           throttle_config.no_seek ? "forward-only" : "seekable",
+           throttle_config.skip_as_read ? "read" : "seek", files);
+    for( i=0 ; i<G_N_ELEMENTS(LAYOUTS) ; ++i ) {
+        run_layout(directory, &LAYOUTS[i], files);
+    }
+    g_rmdir(directory);
+    g_free(directory);
+    return 0;
+}
@@ -42,10 +42,16 @@
 #define     SETTINGS_VISUAL_STYLE           "visual-style"
 #define     SETTINGS_BORDER_SIZE            "border-size"
 #define     SETTINGS_FONT_SIZE              "font-size"
+#define     SETTINGS_MODELS_DIR             "models-dir"
+#define     SETTINGS_WATCH_FOLDER           "watch-folder"
+#define     SETTINGS_WATCH_SELECT_NEWEST    "watch-select-newest"
+#define     SETTINGS_PERF_STATS             "perf-stats"
 
 /* FILE: resources.xml */
 #define RES_PREFIX   "/dev/martin-rizzo/sdprompt-viewer"
 #define RES_PREFERENCES_UI RES_PREFIX"/sdprompt-viewer-preferences.ui"
 #define RES_PLUGIN_UI      RES_PREFIX"/sdprompt-viewer-plugin.ui"
+#define RES_GROUPS_UI      RES_PREFIX"/sdprompt-viewer-groups.ui"
+#define RES_CLIP_MERGES    RES_PREFIX"/clip/clip-merges.txt"
 
 #define THEMES_RES_DIR RES_PREFIX"/themes"
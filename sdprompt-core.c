@@ -0,0 +1,490 @@
+/**
+ * @file    sdprompt-core.c
+ * @brief   GTK-free API over the parsers, caches and indexes of the plugin.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The readers, parsers, caches and indexes of the plugin are 'static'
+    functions in the 'utils_*.h' headers, compiled into each module that
+    uses them. This file compiles them once more behind the functions of
+    'sdprompt-core.h', so benchmarks, command-line tools and tests can link
+    the exact code of the hot paths without GTK, EOG or a display server.
+    Nothing here may include a GTK or EOG header.
+*/
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "utils_png.h"
+#include "utils_pngbatch.h"
+#include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "utils_cache.h"
+#include "utils_invindex.h"
+#include "utils_query.h"
+#include "utils_sdindex.h"
+#include "sdprompt-core.h"
+
+/* Keys of the PNG text chunks that contain generation data */
+#define CORE_PNG_KEYS "parameters|prompt"
+
+#define IS_EMPTY_STR(str) ((str)==NULL || (str)[0]=='\0')
+
+G_STATIC_ASSERT( SDPROMPT_CORE_BATCH_SIZE==PNG_BATCH_QUEUE_DEPTH );
+
+struct _SDCoreParameters {
+    SDParameters parameters;    /* its strings point into its own buffer */
+};
+
+struct _SDCoreCache {
+    LRUCache *cache;
+};
+
+struct _SDCoreIndex {
+    GArray       *entries;      /* SDIndexEntry, strings in 'pool'    */
+    GStringChunk *pool;
+    InvIndex     *text_index;
+    QueryColumns *columns;
+    SDParameters *parameters;   /* reused by each call to _add()      */
+};
+
+guint
+sdprompt_core_get_api_version( void )
+{
+    return SDPROMPT_CORE_API_VERSION;
+}
+
+
+/*------------------------------- EXTRACTION ------------------------------*/
+
+typedef struct _CoreBatch CoreBatch;
+struct         _CoreBatch {
+    SDCoreTextFunc text_func;
+    gpointer       user_data;
+};
+
+static void
+on_core_text_loaded( gchar *text, gpointer data_ptr, int data_int )
+{
+    gchar **out_text = data_ptr;
+    (*out_text) = IS_EMPTY_STR( text ) ? NULL : g_strdup( text );
+}
+
+static void
+on_core_batch_text_loaded( gchar *text, gpointer data_ptr, int data_int )
+{
+    CoreBatch *batch = data_ptr;
+    batch->text_func( (guint)data_int, IS_EMPTY_STR( text ) ? NULL : text,
+                      batch->user_data );
+}
+
+/**
+ * sdprompt_core_read_text:
+ * @file: a PNG file.
+ *
+ * Returns: (transfer full) (nullable): the generation data embedded in
+ *          @file (A1111 parameters or a ComfyUI graph), or %NULL.
+ */
+gchar *
+sdprompt_core_read_text( GFile *file )
+{
+    gchar *text = NULL;
+    g_return_val_if_fail( file, NULL );
+    load_png_text_chunk( file, CORE_PNG_KEYS, on_core_text_loaded, &text, 0 );
+    return text;
+}
+
+/**
+ * sdprompt_core_read_text_batch:
+ * @paths:     local paths of PNG files; %NULL entries are reported as
+ *             files without generation data.
+ * @count:     number of elements of @paths.
+ * @text_func: called once per file, in completion order.
+ * @user_data: data passed to @text_func.
+ *
+ * Reads the generation data of many files at once (io_uring when the
+ * library was built with it). @text_func runs in the calling thread;
+ * several batches can be read in parallel from different threads.
+ */
+void
+sdprompt_core_read_text_batch( const gchar * const *paths,
+                               guint                count,
+                               SDCoreTextFunc       text_func,
+                               gpointer             user_data )
+{
+    sdprompt_core_read_text_batch_full( paths, count, SD_CORE_READER_AUTO,
+                                        text_func, user_data );
+}
+
+/**
+ * sdprompt_core_read_text_batch_full:
+ * @paths:     local paths of PNG files.
+ * @count:     number of elements of @paths.
+ * @reader:    the backend to use, %SD_CORE_READER_AUTO picks the fastest.
+ * @text_func: called once per file, in completion order.
+ * @user_data: data passed to @text_func.
+ *
+ * Like sdprompt_core_read_text_batch() but with a specific backend, used
+ * by the benchmarks. %SD_CORE_READER_IO_URING falls back to pread() when
+ * the library was built without io_uring or the kernel disables it.
+ *
+ * Returns: the backend that read the files.
+ */
+SDCoreReader
+sdprompt_core_read_text_batch_full( const gchar * const *paths,
+                                    guint                count,
+                                    SDCoreReader         reader,
+                                    SDCoreTextFunc       text_func,
+                                    gpointer             user_data )
+{
+    CoreBatch batch; PNGBatchBackend backend;
+    g_return_val_if_fail( paths || count==0, SD_CORE_READER_PREAD );
+    g_return_val_if_fail( text_func, SD_CORE_READER_PREAD );
+    
+    batch.text_func = text_func;
+    batch.user_data = user_data;
+    backend = reader==SD_CORE_READER_IO_URING ? PNG_BATCH_URING
+            : reader==SD_CORE_READER_PREAD    ? PNG_BATCH_PREAD
+            : PNG_BATCH_AUTO;
+    backend = read_png_text_chunks( paths, (int)count, CORE_PNG_KEYS, backend,
+                                    on_core_batch_text_loaded, &batch );
+    return backend==PNG_BATCH_URING ? SD_CORE_READER_IO_URING
+                                    : SD_CORE_READER_PREAD;
+}
+
+/**
+ * sdprompt_core_is_png_complete:
+ * @file: a PNG file.
+ *
+ * Returns: %TRUE if @file ends with its IEND chunk, %FALSE if it's still
+ *          being written (or isn't a PNG file).
+ */
+gboolean
+sdprompt_core_is_png_complete( GFile *file )
+{
+    g_return_val_if_fail( file, FALSE );
+    return has_png_end( file );
+}
+
+
+/*-------------------------------- PARSING --------------------------------*/
+
+/**
+ * sdprompt_core_parameters_parse:
+ * @data: the generation data of an image.
+ *
+ * Returns: (transfer full): the parsed parameters, release them with
+ *          sdprompt_core_parameters_free().
+ */
+SDCoreParameters *
+sdprompt_core_parameters_parse( const gchar *data )
+{
+    SDCoreParameters *parameters;
+    g_return_val_if_fail( data, NULL );
+    parameters = g_new( SDCoreParameters, 1 );
+    parse_generation_data( &parameters->parameters, data );
+    return parameters;
+}
+
+/**
+ * sdprompt_core_parameters_parse_into:
+ * @parameters: an #SDCoreParameters returned by a previous parse.
+ * @data:       the generation data of another image.
+ *
+ * Replaces the content of @parameters with the parameters of @data, so
+ * a loop over many images doesn't allocate for each one. The strings
+ * returned for the previous image are no longer valid.
+ */
+void
+sdprompt_core_parameters_parse_into( SDCoreParameters *parameters,
+                                     const gchar      *data )
+{
+    g_return_if_fail( parameters && data );
+    parse_generation_data( &parameters->parameters, data );
+}
+
+/**
+ * sdprompt_core_parameters_get:
+ * @parameters: an #SDCoreParameters.
+ * @field:      the parameter to get.
+ *
+ * Returns: (transfer none) (nullable): the value of @field as written in
+ *          the image, or %NULL if the image doesn't have it.
+ */
+const gchar *
+sdprompt_core_parameters_get( const SDCoreParameters *parameters,
+                              SDCoreField             field )
+{
+    const SDParameters *p;
+    g_return_val_if_fail( parameters, NULL );
+    p = &parameters->parameters;
+    switch( field ) {
+        case SD_CORE_PROMPT:            return p->prompt;
+        case SD_CORE_NEGATIVE_PROMPT:   return p->negative_prompt;
+        case SD_CORE_SAMPLER:           return p->sampler;
+        case SD_CORE_STEPS:             return p->steps;
+        case SD_CORE_CFG_SCALE:         return p->cfg_scale;
+        case SD_CORE_SEED:              return p->seed;
+        case SD_CORE_WIDTH:             return p->width;
+        case SD_CORE_HEIGHT:            return p->height;
+        case SD_CORE_DENOISING:         return p->denoising;
+        case SD_CORE_MODEL:             return p->model.name;
+        case SD_CORE_MODEL_HASH:        return p->model.hash;
+        case SD_CORE_HIRES_UPSCALER:    return p->hires.upscaler;
+        case SD_CORE_HIRES_STEPS:       return p->hires.steps;
+        case SD_CORE_HIRES_DENOISING:   return p->hires.denoising;
+        case SD_CORE_HIRES_UPSCALE:     return p->hires.upscale;
+        case SD_CORE_INPAINT_DENOISING: return p->inpaint.denoising;
+        case SD_CORE_INPAINT_MASK_BLUR: return p->inpaint.mask_blur;
+        case SD_CORE_CLIP_SKIP:         return p->settings.clip_skip;
+        case SD_CORE_ETA:               return p->settings.eta;
+        case SD_CORE_ENSD:              return p->settings.ensd;
+        default:                        return NULL;
+    }
+}
+
+guint
+sdprompt_core_parameters_get_network_count( const SDCoreParameters *parameters )
+{
+    g_return_val_if_fail( parameters, 0 );
+    return (guint)parameters->parameters.networks.count;
+}
+
+/**
+ * sdprompt_core_parameters_dup_network_name:
+ * @parameters: an #SDCoreParameters.
+ * @index:      an extra network (LoRA, hypernetwork, ...) of the prompts.
+ *
+ * Returns: (transfer full): the name of the network, free it with g_free().
+ */
+gchar *
+sdprompt_core_parameters_dup_network_name( const SDCoreParameters *parameters,
+                                           guint                   index )
+{
+    const SDPromptNetwork *network;
+    g_return_val_if_fail( parameters, NULL );
+    g_return_val_if_fail( index < (guint)parameters->parameters.networks.count, NULL );
+    network = &parameters->parameters.networks.networks[index];
+    return g_strndup( network->name, network->name_size );
+}
+
+gdouble
+sdprompt_core_parameters_get_network_multiplier( const SDCoreParameters *parameters,
+                                                 guint                   index )
+{
+    g_return_val_if_fail( parameters, 0.0 );
+    g_return_val_if_fail( index < (guint)parameters->parameters.networks.count, 0.0 );
+    return parameters->parameters.networks.networks[index].multiplier;
+}
+
+void
+sdprompt_core_parameters_free( SDCoreParameters *parameters )
+{
+    g_free( parameters );
+}
+
+
+/*-------------------------------- CACHING --------------------------------*/
+
+/**
+ * sdprompt_core_cache_new:
+ * @capacity:   maximum number of values kept.
+ * @free_value: (nullable): releases the values evicted from the cache.
+ *
+ * Creates a least-recently-used cache with string keys. The cache is not
+ * thread-safe.
+ *
+ * Returns: (transfer full): a new #SDCoreCache.
+ */
+SDCoreCache *
+sdprompt_core_cache_new( guint capacity, GDestroyNotify free_value )
+{
+    SDCoreCache *cache;
+    g_return_val_if_fail( capacity>0, NULL );
+    cache = g_new( SDCoreCache, 1 );
+    cache->cache = lru_cache_new( capacity, free_value );
+    return cache;
+}
+
+/**
+ * sdprompt_core_cache_lookup:
+ * @cache: an #SDCoreCache.
+ * @key:   the key of the value.
+ *
+ * Returns: (transfer none) (nullable): the value of @key, which becomes
+ *          the most recently used, or %NULL if it isn't in the cache.
+ */
+gpointer
+sdprompt_core_cache_lookup( SDCoreCache *cache, const gchar *key )
+{
+    g_return_val_if_fail( cache, NULL );
+    return lru_cache_lookup( cache->cache, key );
+}
+
+void
+sdprompt_core_cache_insert( SDCoreCache *cache, const gchar *key, gpointer value )
+{
+    g_return_if_fail( cache );
+    lru_cache_insert( cache->cache, key, value );
+}
+
+void
+sdprompt_core_cache_clear( SDCoreCache *cache )
+{
+    g_return_if_fail( cache );
+    lru_cache_clear( cache->cache );
+}
+
+void
+sdprompt_core_cache_free( SDCoreCache *cache )
+{
+    if( !cache ) { return; }
+    lru_cache_free( cache->cache );
+    g_free( cache );
+}
+
+
+/*-------------------------------- INDEXING -------------------------------*/
+
+/**
+ * sdprompt_core_index_new:
+ *
+ * Creates an empty index built on the same entries, search and sort code
+ * as the index of the open folder in the plugin ('utils_sdindex.h'). The
+ * index is not thread-safe.
+ *
+ * Returns: (transfer full): a new #SDCoreIndex.
+ */
+SDCoreIndex *
+sdprompt_core_index_new( void )
+{
+    SDCoreIndex *index = g_new0( SDCoreIndex, 1 );
+    index->entries    = g_array_new( FALSE, TRUE, sizeof(SDIndexEntry) );
+    index->pool       = g_string_chunk_new( 64 * 1024 );
+    index->text_index = new_inv_index();
+    index->columns    = new_query_columns( 0 );
+    index->parameters = g_new( SDParameters, 1 );
+    return index;
+}
+
+/**
+ * sdprompt_core_index_add:
+ * @index: an #SDCoreIndex.
+ * @data:  (nullable): the generation data of an image, %NULL if it
+ *         doesn't have any.
+ *
+ * Returns: the position of the new entry, used by the search results.
+ */
+guint
+sdprompt_core_index_add( SDCoreIndex *index, const gchar *data )
+{
+    SDIndexEntry *entry; guint doc;
+    
+    g_return_val_if_fail( index, 0 );
+    doc = index->entries->len;
+    g_array_set_size( index->entries, doc+1 );
+    entry = &g_array_index( index->entries, SDIndexEntry, doc );
+    query_grow_columns( index->columns, doc+1 );
+    if( !IS_EMPTY_STR( data ) ) {
+        parse_generation_data( index->parameters, data );
+        fill_index_entry( entry, doc, index->parameters, index->pool, index->columns );
+    }
+    publish_index_entry( entry, doc, index->text_index, index->columns );
+    index->columns->rows = doc+1;
+    return doc;
+}
+
+guint
+sdprompt_core_index_get_count( SDCoreIndex *index )
+{
+    g_return_val_if_fail( index, 0 );
+    return index->entries->len;
+}
+
+/**
+ * sdprompt_core_index_search:
+ * @index: an #SDCoreIndex.
+ * @query: parameter predicates (e.g. "steps>=30 sampler:euler") followed
+ *         by words and quoted phrases of the prompts (e.g. "neg:blurry"),
+ *         the same syntax as the search entry of the plugin.
+ *
+ * Returns: (transfer full) (nullable): a #GArray with the sorted positions
+ *          (guint32) of the matching entries, or %NULL if @query is empty
+ *          and every entry matches.
+ */
+GArray *
+sdprompt_core_index_search( SDCoreIndex *index, const gchar *query )
+{
+    g_return_val_if_fail( index, NULL );
+    return search_index_entries( (const SDIndexEntry *)index->entries->data,
+                                 index->text_index, index->columns, query );
+}
+
+/**
+ * sdprompt_core_index_sort:
+ * @index:      an #SDCoreIndex.
+ * @key:        the parameter to sort by.
+ * @descending: %TRUE to sort from the highest value to the lowest.
+ *
+ * Returns: (transfer full): the rank of each entry once sorted by @key,
+ *          entries without the parameter go last. Free it with g_free().
+ */
+guint32 *
+sdprompt_core_index_sort( SDCoreIndex   *index,
+                          SDCoreSortKey  key,
+                          gboolean       descending )
+{
+    static const QueryField fields[SD_CORE_SORT_KEY_COUNT] = {
+        [SD_CORE_SORT_SEED]      = QUERY_SEED,
+        [SD_CORE_SORT_CFG]       = QUERY_CFG,
+        [SD_CORE_SORT_STEPS]     = QUERY_STEPS,
+        [SD_CORE_SORT_DENOISING] = QUERY_DENOISING,
+        [SD_CORE_SORT_MODEL]     = QUERY_MODEL,
+        [SD_CORE_SORT_SAMPLER]   = QUERY_SAMPLER,
+        [SD_CORE_SORT_WIDTH]     = QUERY_WIDTH,
+        [SD_CORE_SORT_HEIGHT]    = QUERY_HEIGHT
+    };
+    g_return_val_if_fail( index, NULL );
+    g_return_val_if_fail( key<SD_CORE_SORT_KEY_COUNT, NULL );
+    return query_sort_rows( index->columns, fields[key], descending );
+}
+
+void
+sdprompt_core_index_free( SDCoreIndex *index )
+{
+    if( !index ) { return; }
+    g_array_unref( index->entries );
+    g_string_chunk_free( index->pool );
+    free_inv_index( index->text_index );
+    free_query_columns( index->columns );
+    g_free( index->parameters );
+    g_free( index );
+}
@@ -0,0 +1,158 @@
+/**
+ * @file    sdprompt-core.h
+ * @brief   GTK-free API over the parsers, caches and indexes of the plugin.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Public interface of 'libsdprompt-core' (see 'make core'), which only
+    depends on GLib and GIO. The types are opaque and the enums only grow
+    at the end, so programs built against one version of the library keep
+    working with the next ones; SDPROMPT_CORE_API_VERSION is incremented
+    whenever a function is added.
+*/
+#ifndef __SDPROMPT_CORE_H__
+#define __SDPROMPT_CORE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define SDPROMPT_CORE_API_VERSION 2
+
+guint sdprompt_core_get_api_version( void );
+
+/*------------------------------- EXTRACTION ------------------------------*/
+
+/* Files read at once by each batch; bigger batches are read in parts */
+#define SDPROMPT_CORE_BATCH_SIZE 64
+
+/**
+ * Receives the generation data of the file at position 'index' of a batch,
+ * or NULL if it doesn't have any. 'text' is only valid during the call.
+ **/
+typedef void (*SDCoreTextFunc)( guint index, const gchar *text, gpointer user_data );
+
+typedef enum _SDCoreReader {
+    SD_CORE_READER_AUTO,
+    SD_CORE_READER_IO_URING,
+    SD_CORE_READER_PREAD
+} SDCoreReader;
+
+gchar *      sdprompt_core_read_text( GFile *file );
+void         sdprompt_core_read_text_batch( const gchar * const *paths,
+                                            guint                count,
+                                            SDCoreTextFunc       text_func,
+                                            gpointer             user_data );
+SDCoreReader sdprompt_core_read_text_batch_full( const gchar * const *paths,
+                                                 guint                count,
+                                                 SDCoreReader         reader,
+                                                 SDCoreTextFunc       text_func,
+                                                 gpointer             user_data );
+gboolean     sdprompt_core_is_png_complete( GFile *file );
+
+/*-------------------------------- PARSING --------------------------------*/
+
+typedef enum _SDCoreField {
+    SD_CORE_PROMPT,
+    SD_CORE_NEGATIVE_PROMPT,
+    SD_CORE_SAMPLER,
+    SD_CORE_STEPS,
+    SD_CORE_CFG_SCALE,
+    SD_CORE_SEED,
+    SD_CORE_WIDTH,
+    SD_CORE_HEIGHT,
+    SD_CORE_DENOISING,
+    SD_CORE_MODEL,
+    SD_CORE_MODEL_HASH,
+    SD_CORE_HIRES_UPSCALER,
+    SD_CORE_HIRES_STEPS,
+    SD_CORE_HIRES_DENOISING,
+    SD_CORE_HIRES_UPSCALE,
+    SD_CORE_INPAINT_DENOISING,
+    SD_CORE_INPAINT_MASK_BLUR,
+    SD_CORE_CLIP_SKIP,
+    SD_CORE_ETA,
+    SD_CORE_ENSD,
+    SD_CORE_FIELD_COUNT
+} SDCoreField;
+
+typedef struct _SDCoreParameters SDCoreParameters;
+
+SDCoreParameters * sdprompt_core_parameters_parse( const gchar *data );
+void               sdprompt_core_parameters_parse_into( SDCoreParameters *parameters,
+                                                        const gchar      *data );
+const gchar *      sdprompt_core_parameters_get( const SDCoreParameters *parameters,
+                                                 SDCoreField             field );
+guint              sdprompt_core_parameters_get_network_count( const SDCoreParameters *parameters );
+gchar *            sdprompt_core_parameters_dup_network_name( const SDCoreParameters *parameters,
+                                                              guint                   index );
+gdouble            sdprompt_core_parameters_get_network_multiplier( const SDCoreParameters *parameters,
+                                                                    guint                   index );
+void               sdprompt_core_parameters_free( SDCoreParameters *parameters );
+
+/*-------------------------------- CACHING --------------------------------*/
+
+typedef struct _SDCoreCache SDCoreCache;
+
+SDCoreCache * sdprompt_core_cache_new( guint capacity, GDestroyNotify free_value );
+gpointer      sdprompt_core_cache_lookup( SDCoreCache *cache, const gchar *key );
+void          sdprompt_core_cache_insert( SDCoreCache *cache, const gchar *key, gpointer value );
+void          sdprompt_core_cache_clear( SDCoreCache *cache );
+void          sdprompt_core_cache_free( SDCoreCache *cache );
+
+/*-------------------------------- INDEXING -------------------------------*/
+
+typedef enum _SDCoreSortKey {
+    SD_CORE_SORT_SEED,
+    SD_CORE_SORT_CFG,
+    SD_CORE_SORT_STEPS,
+    SD_CORE_SORT_DENOISING,
+    SD_CORE_SORT_MODEL,
+    SD_CORE_SORT_SAMPLER,
+    SD_CORE_SORT_WIDTH,
+    SD_CORE_SORT_HEIGHT,
+    SD_CORE_SORT_KEY_COUNT
+} SDCoreSortKey;
+
+typedef struct _SDCoreIndex SDCoreIndex;
+
+SDCoreIndex * sdprompt_core_index_new( void );
+guint         sdprompt_core_index_add( SDCoreIndex *index, const gchar *data );
+guint         sdprompt_core_index_get_count( SDCoreIndex *index );
+GArray *      sdprompt_core_index_search( SDCoreIndex *index, const gchar *query );
+guint32 *     sdprompt_core_index_sort( SDCoreIndex   *index,
+                                        SDCoreSortKey  key,
+                                        gboolean       descending );
+void          sdprompt_core_index_free( SDCoreIndex *index );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_CORE_H__ */
@@ -0,0 +1,167 @@
+/**
+ * @file    sdprompt-viewer-compare.c
+ * @brief   Background comparison of the parameters of two images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    With exactly two images selected the sidebar compares them. Reading
+    both files and diffing the prompts happens in a worker thread; the
+    result is an immutable, reference-counted SDImageCompare that the
+    plugin caches by pair, so switching back to a pair already compared
+    displays it without any work.
+*/
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "utils_arena.h"
+#include "utils_png.h"
+#include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "utils_cache.h"
+#include "utils_clip.h"
+#include "utils_imageinfo.h"
+#include "sdprompt-viewer-compare.h"
+#include "utils_diff.h"
+
+typedef struct _CompareJob CompareJob;
+struct         _CompareJob {
+    GFile       *files[2];
+    SDImageInfo *infos[2];      /* already loaded by the caller, or NULL */
+};
+
+static void
+free_compare_job( CompareJob *job )
+{
+    int i;
+    for( i=0 ; i<2 ; ++i ) {
+        g_object_unref( job->files[i] );
+        unref_image_info( job->infos[i] );
+    }
+    g_free( job );
+}
+
+static void
+compare_images_thread( GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable )
+{
+    CompareJob *job = task_data; SDImageCompare *compare;
+    const SDParameters *a, *b; int i;
+    
+    compare = g_new0( SDImageCompare, 1 );
+    compare->ref_count = 1;
+    for( i=0 ; i<2 ; ++i ) {
+        /* the token counts are not displayed when comparing, no tokenizer */
+        compare->infos[i] = job->infos[i] ? ref_image_info( job->infos[i] )
+                                          : load_image_info( job->files[i], NULL );
+    }
+    a = compare->infos[0]->parameters;
+    b = compare->infos[1]->parameters;
+    if( (a && a->prompt) || (b && b->prompt) ) {
+        compare->prompt_diff = diff_prompts( a ? a->prompt : NULL,
+                                             b ? b->prompt : NULL );
+    }
+    if( (a && a->negative_prompt) || (b && b->negative_prompt) ) {
+        compare->negative_diff = diff_prompts( a ? a->negative_prompt : NULL,
+                                               b ? b->negative_prompt : NULL );
+    }
+    g_task_return_pointer( task, compare,
+                           (GDestroyNotify)sdprompt_image_compare_unref );
+}
+
+
+/*============================ PUBLIC FUNCTIONS ===========================*/
+
+SDImageCompare *
+sdprompt_image_compare_ref( SDImageCompare *compare )
+{
+    if( compare ) { g_atomic_int_inc( &compare->ref_count ); }
+    return compare;
+}
+
+void
+sdprompt_image_compare_unref( SDImageCompare *compare )
+{
+    if( compare && g_atomic_int_dec_and_test( &compare->ref_count ) ) {
+        unref_image_info( compare->infos[0] );
+        unref_image_info( compare->infos[1] );
+        free_diff_text( compare->prompt_diff );
+        free_diff_text( compare->negative_diff );
+        g_free( compare );
+    }
+}
+
+/**
+ * sdprompt_compare_images_async:
+ * @source_object: the object that owns the task (passed to @callback).
+ * @files:         the two images, the first one is the reference.
+ * @infos:         the information of the images already loaded, the
+ *                 %NULL entries are read from their file.
+ * @callback:      called in the main thread when the comparison is ready.
+ * @user_data:     data passed to @callback.
+ *
+ * Reads and compares two images in a worker thread.
+ */
+void
+sdprompt_compare_images_async( gpointer             source_object,
+                               GFile               *files[2],
+                               SDImageInfo         *infos[2],
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data )
+{
+    CompareJob *job; GTask *task; int i;
+    
+    job = g_new0( CompareJob, 1 );
+    for( i=0 ; i<2 ; ++i ) {
+        job->files[i] = g_object_ref( files[i] );
+        job->infos[i] = ref_image_info( infos[i] );
+    }
+    task = g_task_new( source_object, NULL, callback, user_data );
+    g_task_set_task_data( task, job, (GDestroyNotify)free_compare_job );
+    g_task_run_in_thread( task, compare_images_thread );
+    g_object_unref( task );
+}
+
+/**
+ * sdprompt_compare_images_finish:
+ * @result: the #GAsyncResult passed to the callback.
+ *
+ * Returns: (transfer full): the #SDImageCompare of both images.
+ */
+SDImageCompare *
+sdprompt_compare_images_finish( GAsyncResult *result )
+{
+    return g_task_propagate_pointer( G_TASK( result ), NULL );
+}
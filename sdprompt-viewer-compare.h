@@ -0,0 +1,90 @@
+/**
+ * @file    sdprompt-viewer-compare.h
+ * @brief   Background comparison of the parameters of two images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+*/
+#ifndef __SDPROMPT_VIEWER_COMPARE_H__
+#define __SDPROMPT_VIEWER_COMPARE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The token diff of two prompts, built by diff_prompts() ('utils_diff.h') */
+typedef enum DiffOp {
+    DIFF_EQUAL,
+    DIFF_DELETE,    /* only in the first text  */
+    DIFF_INSERT     /* only in the second text */
+} DiffOp;
+
+typedef struct _DiffSpan DiffSpan;
+struct         _DiffSpan {
+    guint  start;
+    guint  end;
+    DiffOp op;
+};
+
+typedef struct _DiffText DiffText;
+struct         _DiffText {
+    gchar    *text;         /* both texts merged inline          */
+    DiffSpan *spans;        /* consecutive spans covering 'text' */
+    guint     count;
+    guint     deleted;      /* number of tokens deleted          */
+    guint     inserted;     /* number of tokens inserted         */
+};
+
+/**
+ * The comparison of two images: their parsed information and the token
+ * diffs of their prompts. It is immutable once built, so it can be cached
+ * and displayed any number of times.
+ **/
+typedef struct _SDImageCompare SDImageCompare;
+struct         _SDImageCompare {
+    gint                 ref_count;
+    struct _SDImageInfo *infos[2];
+    DiffText            *prompt_diff;    /* NULL if neither has a prompt */
+    DiffText            *negative_diff;
+};
+
+SDImageCompare * sdprompt_image_compare_ref( SDImageCompare *compare );
+void             sdprompt_image_compare_unref( SDImageCompare *compare );
+
+void             sdprompt_compare_images_async( gpointer             source_object,
+                                                GFile               *files[2],
+                                                struct _SDImageInfo *infos[2],
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data );
+SDImageCompare * sdprompt_compare_images_finish( GAsyncResult *result );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_VIEWER_COMPARE_H__ */
@@ -0,0 +1,347 @@
+/**
+ * @file    sdprompt-viewer-filter.c
+ * @brief   Hides the images of the thumbnail view that don't match a search.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    EOG's thumbnail view and window expect the model of the view to be the
+    EogListStore itself, so a GtkTreeModelFilter can't be placed between
+    them. Images are hidden by removing their rows from the store (keeping
+    the EogImage in the folder index) and shown again by appending them,
+    which lets the sorted store put them back in place.
+    
+    Sorting by a generation parameter switches the store to unsorted and
+    moves its rows with gtk_list_store_reorder(), using the ranks cached in
+    the folder index: each row is placed directly at its rank, so applying
+    a sort order is linear and compares no values. While the store is
+    sorted this way, images put back by the filter are moved to their rank
+    as well.
+    
+    eog_list_store_remove_image() looks the image up with a linear search,
+    which is quadratic when thousands of images are hidden; instead rows are
+    removed while iterating the store once, doing the same cleanup.
+*/
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <eog/eog-list-store.h>
+#include <eog/eog-image.h>
+
+#include "sdprompt-viewer-indexer.h"
+#include "sdprompt-viewer-filter.h"
+
+struct _SDStoreFilter {
+    EogListStore  *store;
+    SDFolderIndex *index;
+    GHashTable    *positions;     /* EogImage -> position in the index + 1 */
+    guint8        *hidden;        /* TRUE for the images removed           */
+    guint          hidden_count;
+    guint          count;         /* images of 'index' known by the filter */
+    
+    /* Sort Order */
+    guint32       *ranks;         /* copied from 'index', NULL for EOG's order */
+    guint          ranks_count;
+    gint           store_sort_column;
+    GtkSortType    store_sort_order;
+};
+
+
+/*-------------------------------- HELPERS --------------------------------*/
+
+/* the same as eog_list_store_remove_image() for a row already found */
+static gboolean
+remove_store_row( EogListStore *store, GtkTreeIter *iter, EogImage *image )
+{
+    g_signal_handlers_disconnect_matched( image, G_SIGNAL_MATCH_DATA,
+                                          0, 0, NULL, NULL, store );
+    return gtk_list_store_remove( GTK_LIST_STORE( store ), iter );
+}
+
+/* catches up with the images appended to the index since it was bound */
+static void
+grow_filter( SDStoreFilter *filter )
+{
+    SDFolderIndex *index = filter->index; guint i;
+    if( filter->count>=index->count ) { return; }
+    filter->hidden = g_renew( guint8, filter->hidden, index->count );
+    memset( &filter->hidden[filter->count], FALSE, index->count - filter->count );
+    for( i=filter->count ; i<index->count ; ++i ) {
+        g_hash_table_insert( filter->positions,
+                             g_ptr_array_index( index->images, i ),
+                             GUINT_TO_POINTER( i+1 ) );
+    }
+    filter->count = index->count;
+}
+
+static void
+bind_filter( SDStoreFilter *filter, EogListStore *store, SDFolderIndex *index )
+{
+    guint i;
+    if( filter->store==store && filter->index==index ) {
+        grow_filter( filter );
+        return;
+    }
+    if( filter->store==store ) { sdprompt_store_filter_restore( filter ); }
+    sdprompt_store_filter_reset( filter );
+    filter->store        = g_object_ref( store );
+    filter->index        = sdprompt_folder_index_ref( index );
+    filter->hidden       = g_new0( guint8, MAX( index->count, 1 ) );
+    filter->hidden_count = 0;
+    filter->count        = index->count;
+    filter->positions    = g_hash_table_new( g_direct_hash, g_direct_equal );
+    for( i=0 ; i<index->images->len ; ++i ) {
+        g_hash_table_insert( filter->positions,
+                             g_ptr_array_index( index->images, i ),
+                             GUINT_TO_POINTER( i+1 ) );
+    }
+}
+
+/* moves each row of the store to the rank of its image */
+static void
+reorder_store( SDStoreFilter *filter )
+{
+    GtkTreeModel *model = GTK_TREE_MODEL( filter->store );
+    GtkTreeIter iter; EogImage *image; gint *new_order, *slots;
+    gint row, rows, count = 0; guint i, position;
+    gboolean valid;
+    
+    rows      = gtk_tree_model_iter_n_children( model, NULL );
+    new_order = g_new( gint, MAX( rows, 1 ) );
+    slots     = g_new( gint, MAX( filter->index->count, 1 ) );
+    for( i=0 ; i<filter->index->count ; ++i ) { slots[i] = -1; }
+    
+    /*-- place the ranked images at their rank, the rest go last --*/
+    valid = gtk_tree_model_get_iter_first( model, &iter );
+    for( row=0 ; valid ; ++row ) {
+        image = NULL;
+        gtk_tree_model_get( model, &iter, EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+        position = GPOINTER_TO_UINT( g_hash_table_lookup( filter->positions, image ) );
+        if( position>0 && position<=filter->ranks_count ) {
+            slots[ filter->ranks[position-1] ] = row;
+        }
+        if( image ) { g_object_unref( image ); }
+        valid = gtk_tree_model_iter_next( model, &iter );
+    }
+    for( i=0 ; i<filter->index->count ; ++i ) {
+        if( slots[i]>=0 ) { new_order[count++] = slots[i]; }
+    }
+    valid = gtk_tree_model_get_iter_first( model, &iter );
+    for( row=0 ; valid ; ++row ) {
+        image = NULL;
+        gtk_tree_model_get( model, &iter, EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+        position = GPOINTER_TO_UINT( g_hash_table_lookup( filter->positions, image ) );
+        if( position==0 || position>filter->ranks_count ) { new_order[count++] = row; }
+        if( image ) { g_object_unref( image ); }
+        valid = gtk_tree_model_iter_next( model, &iter );
+    }
+    if( rows>0 ) { gtk_list_store_reorder( GTK_LIST_STORE( filter->store ), new_order ); }
+    g_free( slots );
+    g_free( new_order );
+}
+
+
+/*============================ PUBLIC FUNCTIONS ===========================*/
+
+SDStoreFilter *
+sdprompt_store_filter_new( void )
+{
+    return g_new0( SDStoreFilter, 1 );
+}
+
+/**
+ * sdprompt_store_filter_apply:
+ * @filter:  an #SDStoreFilter.
+ * @store:   the #EogListStore displayed by the thumbnail view.
+ * @index:   the #SDFolderIndex of @store, possibly still being filled.
+ * @matches: (nullable): sorted positions of the images to show, as
+ *           returned by sdprompt_folder_index_search(), or %NULL to show
+ *           all the images.
+ *
+ * Removes from @store the images that are not in @matches and puts back
+ * the hidden images that are. Images added to the store after @index was
+ * built are never hidden. The store is only walked when some image has
+ * to be removed.
+ */
+void
+sdprompt_store_filter_apply( SDStoreFilter *filter,
+                             EogListStore  *store,
+                             SDFolderIndex *index,
+                             GArray        *matches )
+{
+    GtkTreeIter iter; EogImage *image; guint8 *visible; gboolean valid;
+    guint i, position, to_remove = 0, to_append = 0;
+    
+    g_return_if_fail( filter && store && index );
+    bind_filter( filter, store, index );
+    visible = g_new( guint8, MAX( index->count, 1 ) );
+    memset( visible, matches ? FALSE : TRUE, index->count );
+    for( i=0 ; matches && i<matches->len ; ++i ) {
+        visible[ g_array_index( matches, guint32, i ) ] = TRUE;
+    }
+    for( i=0 ; i<index->count ; ++i ) {
+        if( !visible[i] && !filter->hidden[i] ) { ++to_remove; }
+    }
+    
+    /*-- remove the rows of the images that don't match --*/
+    valid = to_remove>0 &&
+            gtk_tree_model_get_iter_first( GTK_TREE_MODEL( store ), &iter );
+    while( valid ) {
+        image = NULL;
+        gtk_tree_model_get( GTK_TREE_MODEL( store ), &iter,
+                            EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+        position = GPOINTER_TO_UINT( g_hash_table_lookup( filter->positions, image ) );
+        if( position>0 && !visible[position-1] ) {
+            filter->hidden[position-1] = TRUE;
+            filter->hidden_count++;
+            valid = remove_store_row( store, &iter, image );
+        } else {
+            valid = gtk_tree_model_iter_next( GTK_TREE_MODEL( store ), &iter );
+        }
+        if( image ) { g_object_unref( image ); }
+    }
+    /*-- put back the hidden images that match now --*/
+    for( i=0 ; filter->hidden_count>0 && i<index->count ; ++i ) {
+        if( visible[i] && filter->hidden[i] ) {
+            eog_list_store_append_image( store, g_ptr_array_index( index->images, i ) );
+            filter->hidden[i] = FALSE;
+            filter->hidden_count--;
+            ++to_append;
+        }
+    }
+    if( to_append>0 && filter->ranks ) { reorder_store( filter ); }
+    g_free( visible );
+}
+
+/**
+ * sdprompt_store_filter_sort:
+ * @filter: an #SDStoreFilter.
+ * @store:  the #EogListStore displayed by the thumbnail view.
+ * @index:  the complete #SDFolderIndex of @store.
+ * @ranks:  (nullable): the rank of each image of @index, as returned by
+ *          sdprompt_folder_index_get_sort_ranks(), or %NULL to go back to
+ *          the order of EOG.
+ *
+ * Sorts the rows of @store by their rank without reading any image. Images
+ * added to the store after @index was built are placed last. The ranks are
+ * copied, so @index may discard them (e.g. when an image is appended).
+ */
+void
+sdprompt_store_filter_sort( SDStoreFilter *filter,
+                            EogListStore  *store,
+                            SDFolderIndex *index,
+                            const guint32 *ranks )
+{
+    GtkTreeSortable *sortable = GTK_TREE_SORTABLE( store );
+    
+    g_return_if_fail( filter && store && index );
+    bind_filter( filter, store, index );
+    if( !ranks ) {
+        if( filter->ranks ) {
+            gtk_tree_sortable_set_sort_column_id( sortable,
+                                                  filter->store_sort_column,
+                                                  filter->store_sort_order );
+            g_clear_pointer( &filter->ranks, g_free );
+            filter->ranks_count = 0;
+        }
+        return;
+    }
+    /* gtk_list_store_reorder() only works with unsorted stores */
+    if( !filter->ranks ) {
+        gtk_tree_sortable_get_sort_column_id( sortable,
+                                              &filter->store_sort_column,
+                                              &filter->store_sort_order );
+        gtk_tree_sortable_set_sort_column_id( sortable,
+                                              GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+                                              GTK_SORT_ASCENDING );
+    }
+    g_free( filter->ranks );
+    filter->ranks       = g_new( guint32, MAX( index->count, 1 ) );
+    filter->ranks_count = index->count;
+    memcpy( filter->ranks, ranks, index->count * sizeof(guint32) );
+    reorder_store( filter );
+}
+
+/**
+ * sdprompt_store_filter_restore:
+ * @filter: an #SDStoreFilter.
+ *
+ * Puts back into the store all the images hidden by the filter and the
+ * order of EOG.
+ */
+void
+sdprompt_store_filter_restore( SDStoreFilter *filter )
+{
+    guint i;
+    g_return_if_fail( filter );
+    if( filter->ranks ) {
+        sdprompt_store_filter_sort( filter, filter->store, filter->index, NULL );
+    }
+    for( i=0 ; filter->hidden_count>0 && i<filter->count ; ++i ) {
+        if( filter->hidden[i] ) {
+            eog_list_store_append_image( filter->store,
+                                         g_ptr_array_index( filter->index->images, i ) );
+            filter->hidden[i] = FALSE;
+            filter->hidden_count--;
+        }
+    }
+}
+
+/**
+ * sdprompt_store_filter_reset:
+ * @filter: an #SDStoreFilter.
+ *
+ * Forgets the hidden images and the sort order without touching the store,
+ * used when the thumbnail view has switched to the store of another folder.
+ */
+void
+sdprompt_store_filter_reset( SDStoreFilter *filter )
+{
+    g_return_if_fail( filter );
+    g_clear_pointer( &filter->positions, g_hash_table_destroy );
+    g_clear_pointer( &filter->hidden, g_free );
+    g_clear_object( &filter->store );
+    sdprompt_folder_index_unref( filter->index );
+    filter->index        = NULL;
+    filter->hidden_count = 0;
+    filter->count        = 0;
+    g_clear_pointer( &filter->ranks, g_free );
+    filter->ranks_count  = 0;
+}
+
+void
+sdprompt_store_filter_free( SDStoreFilter *filter )
+{
+    if( !filter ) { return; }
+    if( filter->store ) { sdprompt_store_filter_restore( filter ); }
+    sdprompt_store_filter_reset( filter );
+    g_free( filter );
+}
@@ -0,0 +1,60 @@
+/**
+ * @file    sdprompt-viewer-filter.h
+ * @brief   Declares the filter that hides images of the thumbnail view.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+*/
+#ifndef __SDPROMPT_VIEWER_FILTER_H__
+#define __SDPROMPT_VIEWER_FILTER_H__
+
+#include <glib.h>
+#include <eog/eog-list-store.h>
+#include "sdprompt-viewer-indexer.h"
+
+G_BEGIN_DECLS
+
+typedef struct _SDStoreFilter SDStoreFilter;
+
+SDStoreFilter * sdprompt_store_filter_new( void );
+void            sdprompt_store_filter_apply( SDStoreFilter *filter,
+                                             EogListStore  *store,
+                                             SDFolderIndex *index,
+                                             GArray        *matches );
+void            sdprompt_store_filter_sort( SDStoreFilter *filter,
+                                            EogListStore  *store,
+                                            SDFolderIndex *index,
+                                            const guint32 *ranks );
+void            sdprompt_store_filter_restore( SDStoreFilter *filter );
+void            sdprompt_store_filter_reset( SDStoreFilter *filter );
+void            sdprompt_store_filter_free( SDStoreFilter *filter );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_VIEWER_FILTER_H__ */
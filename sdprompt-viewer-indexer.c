@@ -0,0 +1,581 @@
+/**
+ * @file    sdprompt-viewer-indexer.c
+ * @brief   Indexes the generation parameters of all the images of a folder.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The rows of the EogListStore are read in the main thread (GTK objects
+    are not thread-safe) and the list of URIs is handed to one worker per
+    core. Workers claim small batches of images from a shared atomic cursor,
+    so a worker that hits slow files simply claims fewer batches while the
+    others take the rest of the work. Each worker reuses its own
+    SDParameters buffer and string pool, so the hot loop doesn't allocate
+    per image and workers never contend on a lock. The files of a batch
+    are read together by 'utils_pngbatch.h' (io_uring when available).
+    
+    The main thread polls the progress a few times per second and receives
+    the finished index in an idle callback; nothing else is posted to the
+    main loop, so the UI stays responsive however big the folder is.
+*/
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+#include <eog/eog-list-store.h>
+#include <eog/eog-image.h>
+
+#include "utils_png.h"
+#include "utils_pngbatch.h"
+#include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "utils_invindex.h"
+#include "utils_query.h"
+#include "utils_sdindex.h"
+#include "sdprompt-viewer-indexer.h"
+
+/* Number of images claimed by a worker at a time */
+#define INDEX_BATCH_SIZE PNG_BATCH_QUEUE_DEPTH
+
+/* Interval between progress notifications, in milliseconds */
+#define INDEX_PROGRESS_INTERVAL 100
+
+/* Keys of the PNG text chunks that contain generation data */
+#define INDEX_PNG_KEYS "parameters|prompt"
+
+#define IS_EMPTY_STR(str) ((str)==NULL || (str)[0]=='\0')
+
+typedef struct _SDIndexJob SDIndexJob;
+struct         _SDIndexJob {
+    gint           ref_count;
+    gint           cursor;      /* next image to be claimed (atomic)    */
+    gint           done;        /* images already indexed (atomic)      */
+    gint           running;     /* workers still running (atomic)       */
+    gint           cancelled;   /* set by the main thread (atomic)      */
+    GMutex         mutex;       /* protects 'index->string_pools'       */
+    SDFolderIndex *index;
+    SDIndexer     *indexer;     /* NULL once cancelled (main thread)    */
+    
+    /* batches finished but not yet in the full-text index; protected  */
+    /* by 'index->text_mutex' because batches are added in order        */
+    guint8        *batch_done;
+    guint          batch_count;
+    guint          next_batch;
+};
+
+struct _SDIndexer {
+    SDIndexJob            *job;
+    SDIndexerProgressFunc  progress_func;
+    SDIndexerReadyFunc     ready_func;
+    gpointer               user_data;
+};
+
+
+/*------------------------------ FOLDER INDEX -----------------------------*/
+
+static SDFolderIndex *
+new_folder_index( gchar **uris, GPtrArray *images, guint count )
+{
+    SDFolderIndex *index = g_new0( SDFolderIndex, 1 );
+    index->ref_count    = 1;
+    index->count        = count;
+    index->uris         = uris;
+    index->images       = images;
+    index->entries      = g_new0( SDIndexEntry, MAX( count, 1 ) );
+    index->string_pools = g_ptr_array_new_with_free_func(
+                              (GDestroyNotify)g_string_chunk_free );
+    index->text_index   = new_inv_index();
+    index->columns      = new_query_columns( count );
+    g_mutex_init( &index->text_mutex );
+    return index;
+}
+
+SDFolderIndex *
+sdprompt_folder_index_ref( SDFolderIndex *index )
+{
+    if( index ) { g_atomic_int_inc( &index->ref_count ); }
+    return index;
+}
+
+void
+sdprompt_folder_index_unref( SDFolderIndex *index )
+{
+    gint key;
+    if( index && g_atomic_int_dec_and_test( &index->ref_count ) ) {
+        free_inv_index( index->text_index );
+        for( key=0 ; key<SD_SORT_KEY_COUNT ; ++key ) {
+            g_free( index->sort_ranks[key][0] );
+            g_free( index->sort_ranks[key][1] );
+        }
+        free_query_columns( index->columns );
+        g_mutex_clear( &index->text_mutex );
+        g_ptr_array_unref( index->string_pools );
+        g_ptr_array_unref( index->images );
+        g_strfreev( index->uris );
+        g_free( index->entries );
+        g_free( index );
+    }
+}
+
+/**
+ * sdprompt_folder_index_search:
+ * @index: an #SDFolderIndex, possibly still being filled.
+ * @query: parameter predicates (e.g. "steps>=30 sampler:euler", see
+ *         'utils_query.h') followed by words and quoted phrases to find
+ *         in the prompts (e.g. "neg:blurry", see 'utils_invindex.h').
+ *
+ * Searches the images indexed so far.
+ *
+ * Returns: a #GArray with the sorted positions (guint32) of the matching
+ *          entries, or %NULL if @query is empty and every image matches.
+ */
+GArray *
+sdprompt_folder_index_search( SDFolderIndex *index, const gchar *query )
+{
+    GArray *result;
+    g_return_val_if_fail( index, NULL );
+    g_mutex_lock( &index->text_mutex );
+    result = search_index_entries( index->entries, index->text_index,
+                                   index->columns, query );
+    g_mutex_unlock( &index->text_mutex );
+    return result;
+}
+
+
+/**
+ * sdprompt_folder_index_get_sort_ranks:
+ * @index:      a complete #SDFolderIndex.
+ * @key:        the parameter to sort by, other than %SD_SORT_NONE.
+ * @descending: %TRUE to sort from the highest value to the lowest.
+ *
+ * Gets the rank of each entry of @index (its position once sorted by @key),
+ * images without the parameter go last. The ranks are computed the first
+ * time they are requested and cached in the index, so switching between
+ * sort keys doesn't sort the folder again.
+ *
+ * Returns: (transfer none): an array of @index->count ranks, or %NULL if
+ *          the folder is still being indexed.
+ */
+const guint32 *
+sdprompt_folder_index_get_sort_ranks( SDFolderIndex *index,
+                                      SDSortKey      key,
+                                      gboolean       descending )
+{
+    static const QueryField fields[SD_SORT_KEY_COUNT] = {
+        [SD_SORT_SEED]      = QUERY_SEED,
+        [SD_SORT_CFG]       = QUERY_CFG,
+        [SD_SORT_STEPS]     = QUERY_STEPS,
+        [SD_SORT_DENOISING] = QUERY_DENOISING,
+        [SD_SORT_MODEL]     = QUERY_MODEL,
+        [SD_SORT_SAMPLER]   = QUERY_SAMPLER
+    };
+    guint32 **ranks; gboolean complete;
+    
+    g_return_val_if_fail( index, NULL );
+    g_return_val_if_fail( key>SD_SORT_NONE && key<SD_SORT_KEY_COUNT, NULL );
+    g_mutex_lock( &index->text_mutex );
+    complete = index->text_count==index->count;
+    ranks    = &index->sort_ranks[key][ descending ? 1 : 0 ];
+    if( complete && !*ranks ) {
+        *ranks = query_sort_rows( index->columns, fields[key], descending );
+    }
+    g_mutex_unlock( &index->text_mutex );
+    return complete ? *ranks : NULL;
+}
+
+
+/*-------------------------------- WORKERS --------------------------------*/
+
+static void
+unref_index_job( SDIndexJob *job )
+{
+    if( g_atomic_int_dec_and_test( &job->ref_count ) ) {
+        sdprompt_folder_index_unref( job->index );
+        g_mutex_clear( &job->mutex );
+        g_free( job->batch_done );
+        g_free( job );
+    }
+}
+
+typedef struct _IndexContext IndexContext;
+struct         _IndexContext {
+    SDParameters *parameters;
+    GStringChunk *pool;
+    QueryColumns *columns;
+    SDIndexEntry *batch;        /* entries of the batch being read */
+    guint         first;        /* position of 'batch[0]' in the index */
+};
+
+static void
+on_index_text_loaded( gchar *text, gpointer data_ptr, int data_int )
+{
+    IndexContext *context = data_ptr;
+    
+    if( IS_EMPTY_STR( text ) ) { return; }
+    parse_generation_data( context->parameters, text );
+    /* each worker writes its own rows, the columns don't need the lock */
+    fill_index_entry( &context->batch[data_int], context->first + data_int,
+                      context->parameters, context->pool, context->columns );
+}
+
+static gboolean
+on_index_job_finished( gpointer data );
+
+/*
+ * Reads a batch of images: local files go through the batch reader (one
+ * io_uring per worker when available) and the rest through GIO.
+ */
+static void
+index_batch( SDIndexJob *job, IndexContext *context, guint first, guint last )
+{
+    SDFolderIndex *index = job->index; gchar *paths[INDEX_BATCH_SIZE];
+    GFile *file; guint i, count = last - first;
+    
+    context->batch = &index->entries[first];
+    context->first = first;
+    for( i=0 ; i<count ; ++i ) {
+        context->batch[i].uri = index->uris[first+i];
+        paths[i] = g_filename_from_uri( index->uris[first+i], NULL, NULL );
+    }
+    read_png_text_chunks( (const gchar * const *)paths, count, INDEX_PNG_KEYS,
+                          PNG_BATCH_AUTO, on_index_text_loaded, context );
+    for( i=0 ; i<count ; ++i ) {
+        if( !paths[i] && !IS_EMPTY_STR( index->uris[first+i] ) ) {
+            file = g_file_new_for_uri( index->uris[first+i] );
+            load_png_text_chunk( file, INDEX_PNG_KEYS,
+                                 on_index_text_loaded, context, i );
+            g_object_unref( file );
+        }
+        g_free( paths[i] );
+    }
+    g_atomic_int_add( &job->done, count );
+}
+
+/*
+ * Makes the finished batches searchable: adds the prompts to the full-text
+ * index and the model and sampler to their dictionaries. The posting lists
+ * only grow by appending, so batches are added in order: a batch that
+ * finishes early waits for the ones before it.
+ */
+static void
+publish_batch( SDIndexJob *job, guint first )
+{
+    SDFolderIndex *index = job->index; guint doc, last;
+    
+    g_mutex_lock( &index->text_mutex );
+    job->batch_done[ first / INDEX_BATCH_SIZE ] = TRUE;
+    while( job->next_batch < job->batch_count &&
+           job->batch_done[ job->next_batch ] ) {
+        doc  = job->next_batch * INDEX_BATCH_SIZE;
+        last = MIN( doc + INDEX_BATCH_SIZE, index->count );
+        for( ; doc<last ; ++doc ) {
+            publish_index_entry( &index->entries[doc], doc,
+                                 index->text_index, index->columns );
+        }
+        index->text_count    = last;
+        index->columns->rows = last;
+        job->next_batch++;
+    }
+    g_mutex_unlock( &index->text_mutex );
+}
+
+static gpointer
+index_worker( gpointer data )
+{
+    SDIndexJob *job = data; SDFolderIndex *index = job->index;
+    IndexContext context; guint first;
+    
+    context.parameters = g_new( SDParameters, 1 );
+    context.pool       = g_string_chunk_new( 64 * 1024 );
+    context.columns    = index->columns;
+    while( !g_atomic_int_get( &job->cancelled ) ) {
+        first = (guint)g_atomic_int_add( &job->cursor, INDEX_BATCH_SIZE );
+        if( first>=index->count ) { break; }
+        index_batch( job, &context, first,
+                     MIN( first + INDEX_BATCH_SIZE, index->count ) );
+        publish_batch( job, first );
+    }
+    g_free( context.parameters );
+    g_mutex_lock( &job->mutex );
+    g_ptr_array_add( index->string_pools, context.pool );
+    g_mutex_unlock( &job->mutex );
+    
+    /* the last worker hands the job back to the main thread */
+    if( g_atomic_int_dec_and_test( &job->running ) ) {
+        g_idle_add( on_index_job_finished, job );
+    } else {
+        unref_index_job( job );
+    }
+    return NULL;
+}
+
+
+/*------------------------------ MAIN THREAD ------------------------------*/
+
+/**
+ * sdprompt_folder_index_append:
+ * @index: a complete #SDFolderIndex.
+ * @image: an #EogImage added to the folder after it was indexed.
+ * @text:  (nullable): the generation data of @image.
+ *
+ * Adds @image after the last entry of @index, where #EogListStore appends
+ * it too, so a folder being watched doesn't have to be indexed again. The
+ * cached sort orders are discarded. An image already in @index is not
+ * added twice. The workers write their rows without the lock, so @index
+ * must have been passed to the ready callback of its #SDIndexer.
+ *
+ * Returns: the position of the entry of @image.
+ */
+guint
+sdprompt_folder_index_append( SDFolderIndex *index,
+                              EogImage      *image,
+                              const gchar   *text )
+{
+    IndexContext context; SDIndexEntry *entry; GFile *file; gchar *uri;
+    guint position; gint key;
+    
+    g_return_val_if_fail( index && index->complete && image, 0 );
+    file = eog_image_get_file( image );
+    uri  = g_file_get_uri( file );
+    g_object_unref( file );
+    for( position=0 ; position<index->count ; ++position ) {
+        if( g_strcmp0( index->uris[position], uri )==0 ) {
+            g_free( uri );
+            return position;
+        }
+    }
+    g_mutex_lock( &index->text_mutex );
+    position = index->count;
+    index->uris = g_renew( gchar *, index->uris, position+2 );
+    index->uris[position]   = uri;
+    index->uris[position+1] = NULL;
+    index->entries = g_renew( SDIndexEntry, index->entries, position+1 );
+    entry = &index->entries[position];
+    memset( entry, 0, sizeof(SDIndexEntry) );
+    entry->uri = uri;
+    g_ptr_array_add( index->images, g_object_ref( image ) );
+    query_grow_columns( index->columns, position+1 );
+    
+    /* the workers are gone, so any of their pools can take the strings */
+    if( index->string_pools->len==0 ) {
+        g_ptr_array_add( index->string_pools, g_string_chunk_new( 4096 ) );
+    }
+    context.parameters = g_new( SDParameters, 1 );
+    context.pool       = g_ptr_array_index( index->string_pools, 0 );
+    context.columns    = index->columns;
+    context.batch      = entry;
+    context.first      = position;
+    on_index_text_loaded( (gchar *)text, &context, 0 );
+    g_free( context.parameters );
+    
+    publish_index_entry( entry, position, index->text_index, index->columns );
+    if( entry->has_parameters ) { index->with_parameters++; }
+    index->count         = position+1;
+    index->text_count    = position+1;
+    index->columns->rows = position+1;
+    for( key=0 ; key<SD_SORT_KEY_COUNT ; ++key ) {
+        g_clear_pointer( &index->sort_ranks[key][0], g_free );
+        g_clear_pointer( &index->sort_ranks[key][1], g_free );
+    }
+    g_mutex_unlock( &index->text_mutex );
+    return position;
+}
+
+
+static gboolean
+on_index_job_finished( gpointer data )
+{
+    SDIndexJob *job = data; SDIndexer *indexer = job->indexer;
+    SDFolderIndex *index = job->index; guint i;
+    
+    if( indexer && indexer->job==job ) {
+        for( i=0 ; i<index->count ; ++i ) {
+            if( index->entries[i].has_parameters ) { index->with_parameters++; }
+        }
+        index->complete = TRUE;
+        indexer->job = NULL;
+        if( indexer->progress_func ) {
+            indexer->progress_func( index->count, index->count, indexer->user_data );
+        }
+        if( indexer->ready_func ) {
+            indexer->ready_func( index, indexer->user_data );
+        }
+        unref_index_job( job );    /* reference of the indexer */
+    }
+    unref_index_job( job );
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+on_index_progress( gpointer data )
+{
+    SDIndexJob *job = data; SDIndexer *indexer = job->indexer;
+    if( !indexer || indexer->job!=job ) { return G_SOURCE_REMOVE; }
+    if( indexer->progress_func ) {
+        indexer->progress_func( (guint)g_atomic_int_get( &job->done ),
+                                job->index->count, indexer->user_data );
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* reads the images of the store and their URIs */
+static gchar **
+get_store_images( GtkTreeModel *store, GPtrArray *images, guint *out_count )
+{
+    GPtrArray *uris; GtkTreeIter iter; EogImage *image; GFile *file;
+    gboolean valid;
+    
+    uris  = g_ptr_array_new();
+    valid = store && gtk_tree_model_get_iter_first( store, &iter );
+    while( valid ) {
+        image = NULL;
+        gtk_tree_model_get( store, &iter, EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+        if( image ) {
+            file = eog_image_get_file( image );
+            g_ptr_array_add( uris, g_file_get_uri( file ) );
+            g_ptr_array_add( images, image );
+            g_object_unref( file );
+        }
+        valid = gtk_tree_model_iter_next( store, &iter );
+    }
+    (*out_count) = uris->len;
+    g_ptr_array_add( uris, NULL );
+    return (gchar **)g_ptr_array_free( uris, FALSE );
+}
+
+/**
+ * sdprompt_indexer_new:
+ * @progress_func: (nullable): called periodically while a folder is indexed.
+ * @ready_func:    (nullable): called when the index of the folder is ready.
+ * @user_data:     data passed to both callbacks.
+ *
+ * Both callbacks are invoked in the main thread. The #SDFolderIndex passed
+ * to @ready_func is borrowed; use sdprompt_folder_index_ref() to keep it.
+ *
+ * Returns: a new #SDIndexer, release it with sdprompt_indexer_free().
+ */
+SDIndexer *
+sdprompt_indexer_new( SDIndexerProgressFunc progress_func,
+                      SDIndexerReadyFunc    ready_func,
+                      gpointer              user_data )
+{
+    SDIndexer *indexer     = g_new0( SDIndexer, 1 );
+    indexer->progress_func = progress_func;
+    indexer->ready_func    = ready_func;
+    indexer->user_data     = user_data;
+    return indexer;
+}
+
+/**
+ * sdprompt_indexer_start:
+ * @indexer: an #SDIndexer.
+ * @store:   the #EogListStore with the images of the folder.
+ *
+ * Starts indexing all the images of @store in background threads. Any
+ * indexing still running is cancelled.
+ */
+void
+sdprompt_indexer_start( SDIndexer *indexer, GtkTreeModel *store )
+{
+    SDIndexJob *job; GThread *thread; GPtrArray *images; gchar **uris;
+    guint count, i, workers;
+    
+    g_return_if_fail( indexer );
+    sdprompt_indexer_cancel( indexer );
+    
+    images  = g_ptr_array_new_with_free_func( g_object_unref );
+    uris    = get_store_images( store, images, &count );
+    workers = CLAMP( (count + INDEX_BATCH_SIZE - 1) / INDEX_BATCH_SIZE,
+                     1, g_get_num_processors() );
+    job              = g_new0( SDIndexJob, 1 );
+    job->ref_count   = 1 + workers + 1;   /* indexer + workers + progress */
+    job->running     = workers;
+    job->index       = new_folder_index( uris, images, count );
+    job->indexer     = indexer;
+    job->batch_count = (count + INDEX_BATCH_SIZE - 1) / INDEX_BATCH_SIZE;
+    job->batch_done  = g_new0( guint8, MAX( job->batch_count, 1 ) );
+    g_mutex_init( &job->mutex );
+    indexer->job     = job;
+    
+    g_timeout_add_full( G_PRIORITY_DEFAULT_IDLE, INDEX_PROGRESS_INTERVAL,
+                        on_index_progress, job,
+                        (GDestroyNotify)unref_index_job );
+    for( i=0 ; i<workers ; ++i ) {
+        thread = g_thread_new( "sdprompt-indexer", index_worker, job );
+        g_thread_unref( thread );
+    }
+}
+
+/**
+ * sdprompt_indexer_cancel:
+ * @indexer: an #SDIndexer.
+ *
+ * Stops the indexing in progress, if any. Workers finish the image they
+ * are reading and exit; their results are discarded.
+ */
+void
+sdprompt_indexer_cancel( SDIndexer *indexer )
+{
+    SDIndexJob *job = indexer ? indexer->job : NULL;
+    if( !job ) { return; }
+    g_atomic_int_set( &job->cancelled, TRUE );
+    job->indexer  = NULL;
+    indexer->job  = NULL;
+    unref_index_job( job );
+}
+
+/**
+ * sdprompt_indexer_get_index:
+ * @indexer: an #SDIndexer.
+ *
+ * Returns: (transfer none) (nullable): the index being filled, which can
+ *          already be searched, or %NULL if no folder is being indexed.
+ */
+SDFolderIndex *
+sdprompt_indexer_get_index( SDIndexer *indexer )
+{
+    return indexer && indexer->job ? indexer->job->index : NULL;
+}
+
+gboolean
+sdprompt_indexer_is_running( SDIndexer *indexer )
+{
+    return indexer && indexer->job;
+}
+
+void
+sdprompt_indexer_free( SDIndexer *indexer )
+{
+    if( !indexer ) { return; }
+    sdprompt_indexer_cancel( indexer );
+    g_free( indexer );
+}
@@ -0,0 +1,123 @@
+/**
+ * @file    sdprompt-viewer-indexer.h
+ * @brief   Declares the background indexer of the images of a folder.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+*/
+#ifndef __SDPROMPT_VIEWER_INDEXER_H__
+#define __SDPROMPT_VIEWER_INDEXER_H__
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/*------------------------------ FOLDER INDEX -----------------------------*/
+
+/**
+ * The generation parameters the thumbnails can be sorted by.
+ * SD_SORT_NONE keeps the order of the folder.
+ **/
+typedef enum _SDSortKey {
+    SD_SORT_NONE,
+    SD_SORT_SEED,
+    SD_SORT_CFG,
+    SD_SORT_STEPS,
+    SD_SORT_DENOISING,
+    SD_SORT_MODEL,
+    SD_SORT_SAMPLER,
+    SD_SORT_KEY_COUNT
+} SDSortKey;
+
+/**
+ * The text parameters of one image of the folder, declared in
+ * 'utils_sdindex.h'. The strings are owned by the #SDFolderIndex.
+ **/
+typedef struct _SDIndexEntry SDIndexEntry;
+
+/**
+ * The parameters of all the images of a folder, in the same order as the
+ * rows of the #EogListStore that was indexed. The entries are immutable
+ * once published, so the index can be shared with worker threads through
+ * references. The search indexes grow while the folder is being indexed
+ * and are protected by 'text_mutex'.
+ **/
+typedef struct _SDFolderIndex SDFolderIndex;
+struct         _SDFolderIndex {
+    gint          ref_count;
+    guint         count;
+    guint         with_parameters;
+    SDIndexEntry *entries;
+    gchar       **uris;          /* owned strings referenced by the entries */
+    GPtrArray    *images;        /* EogImage of each entry                  */
+    GPtrArray    *string_pools;  /* GStringChunk* filled by the workers     */
+    
+    /* Search Indexes (the numbers of 'columns' are written by the    */
+    /* workers, everything else is added in order under 'text_mutex') */
+    GMutex                text_mutex;
+    struct _InvIndex     *text_index;
+    struct _QueryColumns *columns;
+    guint                 text_count;   /* entries already searchable */
+    gboolean              complete;     /* all the workers have exited */
+    
+    /* Sort Orders (computed on demand once the index is complete) */
+    guint32              *sort_ranks[SD_SORT_KEY_COUNT][2];
+};
+
+SDFolderIndex * sdprompt_folder_index_ref( SDFolderIndex *index );
+void            sdprompt_folder_index_unref( SDFolderIndex *index );
+GArray *        sdprompt_folder_index_search( SDFolderIndex *index,
+                                              const gchar   *query );
+const guint32 * sdprompt_folder_index_get_sort_ranks( SDFolderIndex *index,
+                                                      SDSortKey      key,
+                                                      gboolean       descending );
+guint           sdprompt_folder_index_append( SDFolderIndex    *index,
+                                              struct _EogImage *image,
+                                              const gchar      *text );
+
+/*-------------------------------- INDEXER --------------------------------*/
+
+typedef struct _SDIndexer SDIndexer;
+
+typedef void (*SDIndexerProgressFunc)( guint done, guint total, gpointer user_data );
+typedef void (*SDIndexerReadyFunc)( SDFolderIndex *index, gpointer user_data );
+
+SDIndexer * sdprompt_indexer_new( SDIndexerProgressFunc progress_func,
+                                  SDIndexerReadyFunc    ready_func,
+                                  gpointer              user_data );
+void        sdprompt_indexer_start( SDIndexer *indexer, GtkTreeModel *store );
+SDFolderIndex * sdprompt_indexer_get_index( SDIndexer *indexer );
+void        sdprompt_indexer_cancel( SDIndexer *indexer );
+gboolean    sdprompt_indexer_is_running( SDIndexer *indexer );
+void        sdprompt_indexer_free( SDIndexer *indexer );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_VIEWER_INDEXER_H__ */
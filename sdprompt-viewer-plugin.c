@@ -47,14 +47,39 @@
 
 #include "resources.h"
 #include "themes/themes.h"
+#include "utils_trace.h"
+#include "utils_arena.h"
 #include "utils_png.h"
 #include "utils_jpgtx.h"
 #include "utils_widget.h"
 #include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "utils_highlight.h"
+#include "utils_cache.h"
+#include "utils_clip.h"
+#include "utils_imageinfo.h"
+#include "utils_models.h"
+#include "utils_perf.h"
 #include "sdprompt-viewer-plugin.h"
 #include "sdprompt-viewer-preferences.h"
+#include "sdprompt-viewer-indexer.h"
+#include "sdprompt-viewer-filter.h"
+#include "sdprompt-viewer-selection.h"
+#include "sdprompt-viewer-compare.h"
+#include "sdprompt-viewer-watch.h"
 
 #define UNKNOWN_SIZE (-1974)
+
+/* Settings waiting to be applied on the next frame */
+#define SETTINGS_DIRTY_MIN_WIDTH (1<<0)
+#define SETTINGS_DIRTY_THEME     (1<<1)
+#define IMAGE_CACHE_CAPACITY 64
+
+/* Number of image comparisons kept in memory */
+#define COMPARE_CACHE_CAPACITY 32
+/* Maximum number of new images waiting for EOG to add them to the store */
+#define WATCH_PENDING_MAX 64
 #define IS_EMPTY_STR(str) ((str)==NULL || (str)[0]=='\0')
 #define DEBUG_MESSAGE(...) eog_debug_message( DEBUG_PLUGINS, __VA_ARGS__ )
 
@@ -68,6 +93,10 @@ static void
 sdprompt_viewer_plugin_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec);
 static const gchar *
 get_image_generation_data( SDPromptViewerPlugin *plugin );
+static void
+start_model_scan( SDPromptViewerPlugin *plugin );
+static void
+update_folder_watch( SDPromptViewerPlugin *plugin );
 
 enum {
     PROP_O,
@@ -79,6 +108,9 @@ enum {
     PROP_THEME_VISUAL_STYLE,
     PROP_THEME_BORDER_SIZE,
     PROP_THEME_FONT_SIZE,
+    PROP_MODELS_DIR,
+    PROP_WATCH_FOLDER,
+    PROP_WATCH_SELECT_NEWEST,
     NUMBER_OF_PROPS
 };
 
@@ -150,6 +182,18 @@ sdprompt_viewer_plugin_class_init( SDPromptViewerPluginClass *klass )
         object_class, PROP_THEME_FONT_SIZE,
         g_param_spec_int("font-size",0,0, -2,2, 0, flags) );
     
+    g_object_class_install_property(
+        object_class, PROP_MODELS_DIR,
+        g_param_spec_string("models-dir",0,0, "", flags) );
+    
+    g_object_class_install_property(
+        object_class, PROP_WATCH_FOLDER,
+        g_param_spec_boolean("watch-folder",0,0, FALSE, flags) );
+    
+    g_object_class_install_property(
+        object_class, PROP_WATCH_SELECT_NEWEST,
+        g_param_spec_boolean("watch-select-newest",0,0, TRUE, flags) );
+    
     klass->sidebar_min_width = UNKNOWN_SIZE;
     klass->sidebar_original_min_width  = UNKNOWN_SIZE;
     klass->sidebar_original_min_height = UNKNOWN_SIZE;
@@ -159,12 +203,17 @@ static void
 sdprompt_viewer_plugin_class_finalize( SDPromptViewerPluginClass *klass )
 {
     /* needed for G_DEFINE_DYNAMIC_TYPE_EXTENDED */
+    clear_theme_style_cache( &klass->style_cache );
 }
 
 static void
 sdprompt_viewer_plugin_init( SDPromptViewerPlugin *plugin )
 {
     DEBUG_MESSAGE( "SDPromptViewerPlugin initializing" );
+    plugin->sidebar_min_width = UNKNOWN_SIZE;
+    plugin->applied_theme.visual_style = -1;
+    plugin->applied_theme.border_size  = -1;
+    plugin->applied_theme.font_size    = -1;
 }
 
 static void
@@ -177,6 +226,8 @@ sdprompt_viewer_plugin_dispose( GObject *object )
         g_object_unref( plugin->window );
         plugin->window = NULL;
     }
+    g_free( plugin->models_dir );
+    plugin->models_dir = NULL;
 
     G_OBJECT_CLASS( sdprompt_viewer_plugin_parent_class )->dispose( object );
 }
@@ -219,6 +270,23 @@ apply_sidebar_minimum_width( SDPromptViewerPlugin *plugin,
     }
 }
 
+/* swaps the provider of one style type in the widgets of the page */
+static void
+swap_page_style_provider( SDPromptViewerPlugin *plugin,
+                          GtkStyleProvider    **inout_provider,
+                          GtkStyleProvider     *provider )
+{
+    if( *inout_provider == provider ) { return; }
+    if( *inout_provider ) {
+        remove_tree_style_provider( plugin->page, *inout_provider );
+    }
+    if( provider ) {
+        add_tree_style_provider( plugin->page, provider,
+                                 GTK_STYLE_PROVIDER_PRIORITY_APPLICATION );
+    }
+    (*inout_provider) = provider;
+}
+
 /**
  * apply_visual_style - Applies a predefined visual style to the sidebar.
  * @plugin       : A pointer to an #SDPromptViewerPlugin object
@@ -227,81 +295,89 @@ apply_sidebar_minimum_width( SDPromptViewerPlugin *plugin,
  * Applies the specified visual style to all plugin's widgets by updating
  * their CSS. The @visual_style parameter should be an integer corresponding
  * to one of the predefined styles. If @visual_style is -1, any previously
- * applied style is removed and associated resources are freed.
+ * applied style is removed. The style providers are taken from the cache
+ * of the class and added only to the widgets of the page, so a change
+ * doesn't restyle the rest of the EOG windows.
  */ 
 static void
 apply_visual_style( SDPromptViewerPlugin *plugin,
                     SDPromptTheme         theme )
 {
-    SDPromptViewerPluginClass *klass  = SDPROMPT_VIEWER_PLUGIN_GET_CLASS( plugin );
-    GdkScreen                 *screen = gdk_screen_get_default();
-    if( !screen ) { return; }
-    
-    /* if the theme system was locked */
-    /* then do nothing and return     */
-    if( klass->is_theme_locked )
-    { return; }
+    SDPromptViewerPluginClass *klass = SDPROMPT_VIEWER_PLUGIN_GET_CLASS( plugin );
+    GtkStyleProvider *visual_provider, *border_provider, *zoom_provider;
+    if( !plugin->page ) { return; }
     
     /* if the input theme is the same than the current theme */
     /* then do nothing and return                            */
-    if( theme.visual_style == klass->current_theme.visual_style &&
-        theme.border_size  == klass->current_theme.border_size  &&
-        theme.font_size    == klass->current_theme.font_size     )
+    if( theme.visual_style == plugin->applied_theme.visual_style &&
+        theme.border_size  == plugin->applied_theme.border_size  &&
+        theme.font_size    == plugin->applied_theme.font_size     )
     { return; }
+    plugin->applied_theme = theme;
 
     /*
     DEBUG_MESSAGE( "## visual-style = %d", theme.visual_style );
     DEBUG_MESSAGE( "## border-size  = %d", theme.border_size  );
     DEBUG_MESSAGE( "## font-size    = %d", theme.font_size    );
     */
+    
+    /* get the new style providers (the border and font styles */
+    /* only make sense on top of a visual style)               */
+    visual_provider = get_theme_style_provider(
+        &klass->style_cache, THEME_VISUAL_STYLE, theme.visual_style );
+    border_provider = !visual_provider ? NULL : get_theme_style_provider(
+        &klass->style_cache, THEME_BORDER_STYLE, theme.border_size );
+    zoom_provider   = !visual_provider ? NULL : get_theme_style_provider(
+        &klass->style_cache, THEME_ZOOM_STYLE, theme.font_size );
+    
+    /* replace the styles of the page */
+    swap_page_style_provider( plugin, &plugin->visual_style_provider, visual_provider );
+    swap_page_style_provider( plugin, &plugin->border_style_provider, border_provider );
+    swap_page_style_provider( plugin, &plugin->zoom_style_provider,   zoom_provider   );
+}
 
-    /* remove previous visual styles */
-    if( klass->visual_style_provider ) {
-        gtk_style_context_remove_provider_for_screen(
-            screen, klass->visual_style_provider);
-        g_object_unref( klass->visual_style_provider );
-        klass->visual_style_provider = NULL;
-    }
-    if( klass->border_style_provider ) {
-        gtk_style_context_remove_provider_for_screen(
-            screen, klass->border_style_provider);
-        g_object_unref( klass->border_style_provider );
-        klass->border_style_provider = NULL;
-    }
-    if( klass->zoom_style_provider ) {
-        gtk_style_context_remove_provider_for_screen(
-            screen, klass->zoom_style_provider);
-        g_object_unref( klass->zoom_style_provider );
-        klass->zoom_style_provider = NULL;        
-    }
-    /* try to create the new style providers */
-    klass->visual_style_provider = new_theme_style_provider(
-                                        THEME_VISUAL_STYLE, theme.visual_style );
-    if( klass->visual_style_provider==NULL ) { return; }
-    klass->border_style_provider = new_theme_style_provider(
-                                        THEME_BORDER_STYLE, theme.border_size );
-    klass->zoom_style_provider   = new_theme_style_provider(
-                                        THEME_ZOOM_STYLE, theme.font_size );
-    
-    /* add the new visual styles */
-    if( klass->visual_style_provider ) {
-        gtk_style_context_add_provider_for_screen(
-            screen, klass->visual_style_provider,
-            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
-        );
-    }
-    if( klass->border_style_provider ) {
-        gtk_style_context_add_provider_for_screen(
-            screen, klass->border_style_provider,
-            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
-        );
-    }
-    if( klass->zoom_style_provider ) {
-        gtk_style_context_add_provider_for_screen(
-            screen, klass->zoom_style_provider,
-            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
-        );
+/* applies the settings changed during the last frame, once */
+static gboolean
+on_settings_tick( GtkWidget     *widget,
+                  GdkFrameClock *frame_clock,
+                  gpointer       user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    guint dirty = plugin->settings_dirty; gint min_width;
+    plugin->settings_dirty   = 0;
+    plugin->settings_tick_id = 0;
+    
+    if( dirty & SETTINGS_DIRTY_MIN_WIDTH ) {
+        min_width = plugin->force_minimum_width ? (gint)plugin->minimum_width : -1;
+        if( min_width != plugin->sidebar_min_width ) {
+            plugin->sidebar_min_width = min_width;
+            apply_sidebar_minimum_width( plugin, min_width );
+        }
+    }
+    if( dirty & SETTINGS_DIRTY_THEME ) {
+        apply_visual_style( plugin, plugin->theme );
     }
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * schedule_settings_update:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ * @dirty  : The SETTINGS_DIRTY_* flags of the settings that changed.
+ *
+ * Applies the changed settings on the next frame of the window, so that
+ * dragging a control of the preferences dialog relayouts the window once
+ * per frame instead of once per value.
+ */
+static void
+schedule_settings_update( SDPromptViewerPlugin *plugin,
+                          guint                 dirty )
+{
+    plugin->settings_dirty |= dirty;
+    if( plugin->settings_tick_id || !plugin->page ) { return; }
+    plugin->settings_tick_id =
+        gtk_widget_add_tick_callback( GTK_WIDGET( plugin->sidebar ),
+                                      on_settings_tick, plugin, NULL );
 }
 
 /*-------------------- CONTROLLING THE USER INTERFACE ---------------------*/
@@ -310,15 +386,10 @@ static void
 hide_all_widgets( GtkBuilder  *builder )
 {
     GtkWidget *main_container;
-    GList *children, *iter; GtkWidget *child;
-    
     main_container = builder ? get_widget( builder, "main_container" ) : NULL;
     if( main_container ) {
-        children = gtk_container_get_children( GTK_CONTAINER(main_container) );
-        for( iter = children ; iter ; iter = g_list_next(iter) ) {
-            child = GTK_WIDGET( iter->data );
-            gtk_widget_hide( child );
-        }
+        gtk_container_foreach( GTK_CONTAINER(main_container),
+                               (GtkCallback)gtk_widget_hide, NULL );
     }
 }
 
@@ -335,6 +406,93 @@ show_widget( GtkBuilder  *builder,
     }
 }
 
+/* The groups of 'main_container' in display order. The ones that aren't in
+ * RES_PLUGIN_UI (wildcard, hires, inpaint, settings, unknown) are loaded
+ * from RES_GROUPS_UI by build_page_group() the first time they're needed */
+static const gchar *PAGE_GROUPS[] = {
+    "buttons_group", "message_group", "loading_group", "selection_group",
+    "model_group", "prompt_group", "negative_group", "wildcard_group",
+    "parameters_group", "hires_group", "inpaint_group", "settings_group",
+    "unknown_group"
+};
+
+/**
+ * build_page_group:
+ * @plugin     : A pointer to an #SDPromptViewerPlugin object.
+ * @group_name : The name of one of the groups of %PAGE_GROUPS.
+ *
+ * Ensures that a rarely used group of the page exists, building it from
+ * RES_GROUPS_UI and packing it in its place of 'main_container' (with the
+ * theme styles of the page) if it's the first time it's needed.
+ *
+ * Returns: (transfer none) (nullable): The widget of the group.
+ */
+static GtkWidget *
+build_page_group( SDPromptViewerPlugin *plugin,
+                  const gchar          *group_name )
+{
+    GtkBuilder *b = plugin->page_builder; GtkWidget *container, *group;
+    gchar *object_ids[2]; GError *error = NULL; gint position = 0; guint i;
+    if( !b ) { return NULL; }
+    
+    group = get_widget( b, group_name );
+    if( group ) { return group; }
+    
+    object_ids[0] = (gchar *)group_name;
+    object_ids[1] = NULL;
+    if( !gtk_builder_add_objects_from_resource( b, RES_GROUPS_UI,
+                                                object_ids, &error ) ) {
+        g_warning( "Couldn't load UI resource: %s", error->message );
+        g_error_free( error );
+        return NULL;
+    }
+    group     = get_widget( b, group_name );
+    container = get_widget( b, "main_container" );
+    if( !group || !container ) { return NULL; }
+    
+    /* the position of the group is the number of groups before it */
+    for( i=0 ; i<G_N_ELEMENTS( PAGE_GROUPS ) ; ++i ) {
+        if( g_strcmp0( PAGE_GROUPS[i], group_name )==0 ) { break; }
+        if( gtk_builder_get_object( b, PAGE_GROUPS[i] ) ) { ++position; }
+    }
+    gtk_box_pack_start( GTK_BOX( container ), group, FALSE, TRUE, 0 );
+    gtk_box_reorder_child( GTK_BOX( container ), group, position );
+    
+    /* the theme styles are added to each widget (see apply_visual_style) */
+    if( plugin->visual_style_provider ) {
+        add_tree_style_provider( group, plugin->visual_style_provider,
+                                 GTK_STYLE_PROVIDER_PRIORITY_APPLICATION );
+    }
+    if( plugin->border_style_provider ) {
+        add_tree_style_provider( group, plugin->border_style_provider,
+                                 GTK_STYLE_PROVIDER_PRIORITY_APPLICATION );
+    }
+    if( plugin->zoom_style_provider ) {
+        add_tree_style_provider( group, plugin->zoom_style_provider,
+                                 GTK_STYLE_PROVIDER_PRIORITY_APPLICATION );
+    }
+    return group;
+}
+
+/**
+ * is_page_visible:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Returns: %TRUE if the sidebar is open and the page of this plugin is
+ *          its current page, %FALSE if nothing displayed would be seen.
+ */
+static gboolean
+is_page_visible( SDPromptViewerPlugin *plugin )
+{
+    GtkWidget *current_page = NULL; gboolean visible;
+    if( !plugin->sidebar || !plugin->page ) { return FALSE; }
+    if( !gtk_widget_get_visible( GTK_WIDGET( plugin->sidebar ) ) ) { return FALSE; }
+    g_object_get( plugin->sidebar, "current-page", &current_page, NULL );
+    visible = ( current_page == plugin->page );
+    if( current_page ) { g_object_unref( current_page ); }
+    return visible;
+}
+
 static void
 show_spinner( SDPromptViewerPlugin *plugin )
 {
@@ -355,82 +513,126 @@ show_message( SDPromptViewerPlugin *plugin,
     show_widget( builder  , "message_group", TRUE    );
 }
 
+static void
+display_token_count( GtkBuilder      *builder,
+                     const gchar     *widget_name,
+                     const ClipCount *count )
+{
+    gchar text[32] = "";
+    if( count->chunks>0 ) {
+        g_snprintf( text, sizeof(text), "%d/%d",
+                    count->tokens, clip_token_limit( count->tokens ) );
+    }
+    display_text( builder, widget_name, text );
+}
+
+/* displays a text with its model hashes resolved to local file names */
+static void
+display_with_models( GtkBuilder       *builder,
+                     const gchar      *widget_name,
+                     const gchar      *text,
+                     const ModelIndex *index )
+{
+    gchar *resolved = resolve_model_hashes( index, text );
+    display_text( builder, widget_name, resolved ? resolved : text );
+    g_free( resolved );
+}
+
 static void
 show_image_generation_data( SDPromptViewerPlugin *plugin )
 {
-    SDParameters parameters; const gchar *image_generation_data;
-    GtkTextView *text_view; GtkTextBuffer *buffer; int i;
+    const SDImageInfo  *info       = plugin->image_info;
+    const SDParameters *parameters = info ? info->parameters : NULL;
+    const ModelInfo    *model;
+    GtkTextView *text_view; GtkTextBuffer *buffer; gchar *value; int i;
     GtkBuilder *b = plugin->page_builder;
     if( !b ) { return; }
         
     /* If no generation data is present, show a message and return */
-    image_generation_data = get_image_generation_data( plugin );
-    if( IS_EMPTY_STR(image_generation_data) )
+    if( IS_EMPTY_STR( get_image_generation_data( plugin ) ) || !parameters )
     {
         show_message( plugin,
                       "No Stable Diffusion parameters found in the image." );
         return;
     }
     
-    parse_sd_parameters_from_buffer( &parameters,
-                                     image_generation_data, -1 );
+    /* the rarely used groups are only built when an image needs them */
+    if( parameters->wildcard_prompt   ) { build_page_group( plugin, "wildcard_group" ); }
+    if( parameters->hires.has_info    ) { build_page_group( plugin, "hires_group"    ); }
+    if( parameters->inpaint.has_info  ) { build_page_group( plugin, "inpaint_group"  ); }
+    if( parameters->settings.has_info ) { build_page_group( plugin, "settings_group" ); }
+    if( parameters->unknowns_count>0  ) { build_page_group( plugin, "unknown_group"  ); }
     
     hide_all_widgets( b );
-    display_text(b, "prompt_text_view"       , parameters.prompt            );
-    display_text(b, "negative_text_view"     , parameters.negative_prompt   );
-    display_text(b, "wildcard_text_view"     , parameters.wildcard_prompt   );
-    display_text(b, "model_entry"            , parameters.model.name        );
-    display_text(b, "model_hash_entry"       , parameters.model.hash        );
-    display_text(b, "sampler_entry"          , parameters.sampler           );
-    display_text(b, "steps_entry"            , parameters.steps             );
-    display_text(b, "cfg_scale_entry"        , parameters.cfg_scale         );
-    display_text(b, "seed_entry"             , parameters.seed              );
-    display_text(b, "width_entry"            , parameters.width             );
-    display_text(b, "height_entry"           , parameters.height            );
-    display_text(b, "hires_upscaler_entry"   , parameters.hires.upscaler    );
-    display_text(b, "hires_steps_entry"      , parameters.hires.steps       );
-    display_text(b, "hires_denoising_entry"  , parameters.hires.denoising   );    
-    display_text(b, "inpaint_denoising_entry", parameters.inpaint.denoising );
-    display_text(b, "inpaint_mask_blur_entry", parameters.inpaint.mask_blur );
-    
-    display_text_box(b, "eta_box"      , parameters.settings.eta       );
-    display_text_box(b, "ensd_box"     , parameters.settings.ensd      );
-    display_text_box(b, "clip_skip_box", parameters.settings.clip_skip );
+    display_prompt(b, "prompt_text_view"  , parameters->prompt,
+                   info->prompt_spans  , info->prompt_spans_count   );
+    display_prompt(b, "negative_text_view", parameters->negative_prompt,
+                   info->negative_spans, info->negative_spans_count );
+    display_token_count(b, "prompt_tokens_label"  , &info->prompt_clip   );
+    display_token_count(b, "negative_tokens_label", &info->negative_clip );
+    display_text(b, "wildcard_text_view"     , parameters->wildcard_prompt   );
+    display_text(b, "model_entry"            , parameters->model.name        );
+    display_with_models(b, "model_hash_entry", parameters->model.hash,
+                        plugin->model_index );
+    display_text(b, "sampler_entry"          , parameters->sampler           );
+    display_text(b, "steps_entry"            , parameters->steps             );
+    display_text(b, "cfg_scale_entry"        , parameters->cfg_scale         );
+    display_text(b, "seed_entry"             , parameters->seed              );
+    display_text(b, "width_entry"            , parameters->width             );
+    display_text(b, "height_entry"           , parameters->height            );
+    display_text(b, "hires_upscaler_entry"   , parameters->hires.upscaler    );
+    display_text(b, "hires_steps_entry"      , parameters->hires.steps       );
+    display_text(b, "hires_denoising_entry"  , parameters->hires.denoising   );    
+    display_text(b, "inpaint_denoising_entry", parameters->inpaint.denoising );
+    display_text(b, "inpaint_mask_blur_entry", parameters->inpaint.mask_blur );
+    
+    display_text_box(b, "eta_box"      , parameters->settings.eta       );
+    display_text_box(b, "ensd_box"     , parameters->settings.ensd      );
+    display_text_box(b, "clip_skip_box", parameters->settings.clip_skip );
+    
+    /* images without a model name can still be resolved by their hash */
+    model = lookup_model_by_hash( plugin->model_index, parameters->model.hash, -1 );
+    if( model && IS_EMPTY_STR( parameters->model.name ) ) {
+        display_text(b, "model_entry", model->name );
+    }
     
     display_text_or_float(b, "hires_width_entry",
-                      parameters.hires.width,
-                      parameters.hires.calc_width,0);
+                      parameters->hires.width,
+                      parameters->hires.calc_width,0);
     display_text_or_float(b, "hires_height_entry",
-                      parameters.hires.height,
-                      parameters.hires.calc_height,0);
+                      parameters->hires.height,
+                      parameters->hires.calc_height,0);
     display_text_or_float(b, "hires_upscale_entry",
-                      parameters.hires.upscale,
-                      parameters.hires.calc_upscale,2);
+                      parameters->hires.upscale,
+                      parameters->hires.calc_upscale,2);
     
     text_view = GTK_TEXT_VIEW( get_widget(b, "unknown_text_view") );
     buffer    = text_view ? gtk_text_view_get_buffer( text_view ) : NULL;
     if( buffer ) {
-        show_widget( b, "unknown_group", parameters.unknowns_count > 0 );
+        show_widget( b, "unknown_group", parameters->unknowns_count > 0 );
         gtk_text_buffer_set_text( buffer, "", -1 );
-        for( i=0; i<parameters.unknowns_count; ++i ) {
-            const char *key   = parameters.unknowns[i].key;
-            const char *value = parameters.unknowns[i].value;
+        for( i=0; i<parameters->unknowns_count; ++i ) {
+            const char *key   = parameters->unknowns[i].key;
+            value = resolve_model_hashes( plugin->model_index,
+                                          parameters->unknowns[i].value );
             gtk_text_buffer_insert_at_cursor( buffer,  key  , -1 );
             gtk_text_buffer_insert_at_cursor( buffer,  ": " , -1 );
-            gtk_text_buffer_insert_at_cursor( buffer, value , -1 );
+            gtk_text_buffer_insert_at_cursor( buffer,
+                value ? value : parameters->unknowns[i].value , -1 );
             gtk_text_buffer_insert_at_cursor( buffer, "\n"  , -1 );
+            g_free( value );
         }        
     }
     
     show_widget(b, "buttons_group"   , TRUE                             );
-    show_widget(b, "prompt_group"    , parameters.prompt!=NULL          );
-    show_widget(b, "negative_group"  , parameters.negative_prompt!=NULL ); 
-    show_widget(b, "wildcard_group"  , parameters.wildcard_prompt!=NULL );
+    show_widget(b, "prompt_group"    , parameters->prompt!=NULL          );
+    show_widget(b, "negative_group"  , parameters->negative_prompt!=NULL ); 
+    show_widget(b, "wildcard_group"  , parameters->wildcard_prompt!=NULL );
     show_widget(b, "parameters_group", TRUE                             );
-    show_widget(b, "model_group"     , parameters.model.has_info        ); 
-    show_widget(b, "hires_group"     , parameters.hires.has_info        );
-    show_widget(b, "inpaint_group"   , parameters.inpaint.has_info      );
-    show_widget(b, "settings_group"  , parameters.settings.has_info     );
+    show_widget(b, "model_group"     , parameters->model.has_info        ); 
+    show_widget(b, "hires_group"     , parameters->hires.has_info        );
+    show_widget(b, "inpaint_group"   , parameters->inpaint.has_info      );
+    show_widget(b, "settings_group"  , parameters->settings.has_info     );
     
     if( plugin->force_visibility ) {
         if( plugin->sidebar ) {
@@ -439,34 +641,222 @@ show_image_generation_data( SDPromptViewerPlugin *plugin )
     }
 }
 
-/*------------------------------ PROPERTIES -------------------------------*/
+/**
+ * show_selection_summary:
+ * @plugin  : A pointer to an #SDPromptViewerPlugin object.
+ * @summary : The aggregated parameters of the selected images.
+ *
+ * Displays the parameters of several images at once: the values common to
+ * all of them, the distinct values of the fields that differ and the
+ * extra networks used by any of them.
+ */
+static void
+show_selection_summary( SDPromptViewerPlugin     *plugin,
+                        const SDSelectionSummary *summary )
+{
+    gchar **fields = summary->fields; gchar *text;
+    GtkBuilder *b = plugin->page_builder;
+    if( !b ) { return; }
+    
+    if( summary->with_hires>0   ) { build_page_group( plugin, "hires_group"   ); }
+    if( summary->with_inpaint>0 ) { build_page_group( plugin, "inpaint_group" ); }
+    
+    hide_all_widgets( b );
+    if( summary->done < summary->total ) {
+        text = g_strdup_printf( _("%u images selected, reading %u/%u…"),
+                                summary->total, summary->done, summary->total );
+    } else {
+        text = g_strdup_printf( _("%u images selected, %u with parameters"),
+                                summary->total, summary->with_parameters );
+    }
+    display_text(b, "selection_label"        , text                                 );
+    display_text(b, "selection_networks_label", summary->networks                  );
+    display_text(b, "prompt_text_view"       , fields[AGGREGATE_PROMPT]             );
+    display_text(b, "negative_text_view"     , fields[AGGREGATE_NEGATIVE]           );
+    display_text(b, "prompt_tokens_label"    , NULL                                 );
+    display_text(b, "negative_tokens_label"  , NULL                                 );
+    display_text(b, "model_entry"            , fields[AGGREGATE_MODEL]              );
+    display_with_models(b, "model_hash_entry", fields[AGGREGATE_MODEL_HASH],
+                        plugin->model_index );
+    display_text(b, "sampler_entry"          , fields[AGGREGATE_SAMPLER]            );
+    display_text(b, "steps_entry"            , fields[AGGREGATE_STEPS]              );
+    display_text(b, "cfg_scale_entry"        , fields[AGGREGATE_CFG]                );
+    display_text(b, "seed_entry"             , fields[AGGREGATE_SEED]               );
+    display_text(b, "width_entry"            , fields[AGGREGATE_WIDTH]              );
+    display_text(b, "height_entry"           , fields[AGGREGATE_HEIGHT]             );
+    display_text(b, "hires_upscaler_entry"   , fields[AGGREGATE_HIRES_UPSCALER]     );
+    display_text(b, "hires_steps_entry"      , fields[AGGREGATE_HIRES_STEPS]        );
+    display_text(b, "hires_denoising_entry"  , fields[AGGREGATE_HIRES_DENOISING]    );
+    display_text(b, "hires_upscale_entry"    , fields[AGGREGATE_HIRES_UPSCALE]      );
+    display_text(b, "hires_width_entry"      , NULL                                 );
+    display_text(b, "hires_height_entry"     , NULL                                 );
+    display_text(b, "inpaint_denoising_entry", fields[AGGREGATE_INPAINT_DENOISING]  );
+    display_text(b, "inpaint_mask_blur_entry", fields[AGGREGATE_INPAINT_MASK_BLUR]  );
+    g_free( text );
+    
+    show_widget(b, "selection_group" , TRUE                                  );
+    show_widget(b, "prompt_group"    , fields[AGGREGATE_PROMPT]!=NULL         );
+    show_widget(b, "negative_group"  , fields[AGGREGATE_NEGATIVE]!=NULL       );
+    show_widget(b, "parameters_group", summary->with_parameters>0            );
+    show_widget(b, "model_group"     , fields[AGGREGATE_MODEL]!=NULL ||
+                                       fields[AGGREGATE_MODEL_HASH]!=NULL     );
+    show_widget(b, "hires_group"     , summary->with_hires>0                 );
+    show_widget(b, "inpaint_group"   , summary->with_inpaint>0               );
+}
+
+/* displays two prompts merged, marking the tokens removed and added */
+static void
+display_prompt_diff( GtkBuilder     *builder,
+                     const gchar    *widget_name,
+                     const DiffText *diff )
+{
+    GtkWidget *widget; GtkTextBuffer *buffer; GtkTextTagTable *table;
+    GtkTextTag *tag; GtkTextIter start, end; glong chars; guint i;
+    
+    display_text( builder, widget_name, diff ? diff->text : NULL );
+    widget = builder ? get_widget( builder, widget_name ) : NULL;
+    if( !diff || !widget || !GTK_IS_TEXT_VIEW( widget ) ||
+        !g_utf8_validate( diff->text, -1, NULL ) ) { return; }
+    
+    buffer = gtk_text_view_get_buffer( GTK_TEXT_VIEW( widget ) );
+    table  = gtk_text_buffer_get_tag_table( buffer );
+    if( !gtk_text_tag_table_lookup( table, "sdp-diff-delete" ) ) {
+        gtk_text_buffer_create_tag( buffer, "sdp-diff-delete",
+                                    "strikethrough", TRUE,
+                                    "foreground", "#e01b24", NULL );
+        gtk_text_buffer_create_tag( buffer, "sdp-diff-insert",
+                                    "background", "rgba(46,194,126,0.3)", NULL );
+    }
+    /* the spans are in bytes, the iterators in characters */
+    gtk_text_buffer_get_start_iter( buffer, &end );
+    for( i=0 ; i<diff->count ; ++i ) {
+        chars   = g_utf8_pointer_to_offset( diff->text + diff->spans[i].start,
+                                            diff->text + diff->spans[i].end );
+        start   = end;
+        gtk_text_iter_forward_chars( &end, chars );
+        if( diff->spans[i].op==DIFF_EQUAL ) { continue; }
+        tag = gtk_text_tag_table_lookup( table, diff->spans[i].op==DIFF_DELETE
+                                                ? "sdp-diff-delete" : "sdp-diff-insert" );
+        gtk_text_buffer_apply_tag( buffer, tag, &start, &end );
+    }
+}
+
+/* displays a parameter of two images, as "a → b" when they differ */
+static void
+display_compared( GtkBuilder  *builder,
+                  const gchar *widget_name,
+                  const gchar *value_a,
+                  const gchar *value_b )
+{
+    gchar *text;
+    if( g_strcmp0( value_a, value_b )==0 ) {
+        display_text( builder, widget_name, value_a );
+        return;
+    }
+    text = g_strdup_printf( "%s → %s", value_a ? value_a : "—",
+                                       value_b ? value_b : "—" );
+    display_text( builder, widget_name, text );
+    g_free( text );
+}
+
+/* a field of the parameters of an image that may have none */
+#define PARAM(parameters, field) ((parameters) ? (parameters)->field : 0)
 
 /**
- * set_image_generation_data:
- * @plugin    : A pointer to an #SDPromptViewerPlugin object.
- * @data      : A string containing the image generation data.
- * @max_bytes : The maximum number of bytes in @data, or -1 to use the entire string.
+ * show_image_comparison:
+ * @plugin  : A pointer to an #SDPromptViewerPlugin object.
+ * @compare : The comparison of the two selected images.
  *
- * Sets the image generation data to the specified data string, up to a
- * maximum of @max_bytes bytes. If @max_bytes is -1, the entire data string
- * will be used.
- * 
- * If data is empty or NULL, the image generation data will be set to empty
- * and any previously allocated resources will be freed.
+ * Displays the parameters of two images side by side: equal values once,
+ * different values as "first → second", and the prompts merged with the
+ * tokens removed and added by the second image highlighted.
  */
 static void
-set_image_generation_data( SDPromptViewerPlugin *plugin,
-                           const gchar          *data,
-                           int                   max_bytes )
+show_image_comparison( SDPromptViewerPlugin *plugin,
+                       const SDImageCompare *compare )
 {
-    if( plugin->image_generation_data ) {
-        g_free( plugin->image_generation_data );
-        plugin->image_generation_data = NULL;
+    const SDParameters *p1 = compare->infos[0]->parameters;
+    const SDParameters *p2 = compare->infos[1]->parameters;
+    GtkBuilder *b = plugin->page_builder; gchar *text;
+    guint deleted = 0, inserted = 0;
+    if( !b ) { return; }
+    
+    if( !p1 && !p2 ) {
+        show_message( plugin,
+                      "No Stable Diffusion parameters found in the images." );
+        return;
+    }
+    if( compare->prompt_diff ) {
+        deleted  += compare->prompt_diff->deleted;
+        inserted += compare->prompt_diff->inserted;
+    }
+    if( compare->negative_diff ) {
+        deleted  += compare->negative_diff->deleted;
+        inserted += compare->negative_diff->inserted;
     }
-    if( max_bytes!=0 && data!=NULL && data[0]!='\0' ) {
-        if( max_bytes<0 ) { max_bytes = strlen( data ); }
-        plugin->image_generation_data = g_strndup( data, max_bytes );
+    text = g_strdup_printf( _("Comparing 2 images: %u prompt tokens removed, %u added"),
+                            deleted, inserted );
+    if( PARAM(p1,hires.has_info) || PARAM(p2,hires.has_info) ) {
+        build_page_group( plugin, "hires_group" );
     }
+    if( PARAM(p1,inpaint.has_info) || PARAM(p2,inpaint.has_info) ) {
+        build_page_group( plugin, "inpaint_group" );
+    }
+    
+    hide_all_widgets( b );
+    display_text(b, "selection_label"         , text );
+    display_text(b, "selection_networks_label", NULL );
+    display_prompt_diff(b, "prompt_text_view"  , compare->prompt_diff   );
+    display_prompt_diff(b, "negative_text_view", compare->negative_diff );
+    display_text(b, "prompt_tokens_label"     , NULL );
+    display_text(b, "negative_tokens_label"   , NULL );
+    display_compared(b, "model_entry"            , PARAM(p1,model.name)       , PARAM(p2,model.name)        );
+    display_compared(b, "model_hash_entry"       , PARAM(p1,model.hash)       , PARAM(p2,model.hash)        );
+    display_compared(b, "sampler_entry"          , PARAM(p1,sampler)          , PARAM(p2,sampler)           );
+    display_compared(b, "steps_entry"            , PARAM(p1,steps)            , PARAM(p2,steps)             );
+    display_compared(b, "cfg_scale_entry"        , PARAM(p1,cfg_scale)        , PARAM(p2,cfg_scale)         );
+    display_compared(b, "seed_entry"             , PARAM(p1,seed)             , PARAM(p2,seed)              );
+    display_compared(b, "width_entry"            , PARAM(p1,width)            , PARAM(p2,width)             );
+    display_compared(b, "height_entry"           , PARAM(p1,height)           , PARAM(p2,height)            );
+    display_compared(b, "hires_upscaler_entry"   , PARAM(p1,hires.upscaler)   , PARAM(p2,hires.upscaler)    );
+    display_compared(b, "hires_steps_entry"      , PARAM(p1,hires.steps)      , PARAM(p2,hires.steps)       );
+    display_compared(b, "hires_denoising_entry"  , PARAM(p1,hires.denoising)  , PARAM(p2,hires.denoising)   );
+    display_compared(b, "hires_upscale_entry"    , PARAM(p1,hires.upscale)    , PARAM(p2,hires.upscale)     );
+    display_compared(b, "hires_width_entry"      , PARAM(p1,hires.width)      , PARAM(p2,hires.width)       );
+    display_compared(b, "hires_height_entry"     , PARAM(p1,hires.height)     , PARAM(p2,hires.height)      );
+    display_compared(b, "inpaint_denoising_entry", PARAM(p1,inpaint.denoising), PARAM(p2,inpaint.denoising) );
+    display_compared(b, "inpaint_mask_blur_entry", PARAM(p1,inpaint.mask_blur), PARAM(p2,inpaint.mask_blur) );
+    g_free( text );
+    
+    show_widget(b, "selection_group" , TRUE                                        );
+    show_widget(b, "prompt_group"    , compare->prompt_diff!=NULL                  );
+    show_widget(b, "negative_group"  , compare->negative_diff!=NULL                );
+    show_widget(b, "parameters_group", TRUE                                        );
+    show_widget(b, "model_group"     , PARAM(p1,model.has_info)   || PARAM(p2,model.has_info)    );
+    show_widget(b, "hires_group"     , PARAM(p1,hires.has_info)   || PARAM(p2,hires.has_info)    );
+    show_widget(b, "inpaint_group"   , PARAM(p1,inpaint.has_info) || PARAM(p2,inpaint.has_info)  );
+}
+
+/*------------------------------ PROPERTIES -------------------------------*/
+
+/**
+ * set_image_info:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ * @info   : The #SDImageInfo of the selected image, or %NULL.
+ *
+ * Sets the information (generation data, parsed parameters and highlight
+ * spans) of the image displayed by the plugin. The plugin keeps its own
+ * reference to @info; if @info is %NULL, the current one is released.
+ */
+static void
+set_image_info( SDPromptViewerPlugin *plugin,
+                SDImageInfo          *info )
+{
+    ref_image_info( info );
+    if( plugin->image_info ) {
+        unref_image_info( plugin->image_info );
+    }
+    plugin->image_info = info;
 }
 
 /**
@@ -478,7 +868,8 @@ set_image_generation_data( SDPromptViewerPlugin *plugin,
 static const gchar *
 get_image_generation_data( SDPromptViewerPlugin *plugin )
 {
-    return plugin->image_generation_data ? plugin->image_generation_data : "";
+    SDImageInfo *info = plugin->image_info;
+    return info && info->data ? info->data : "";
 }
 
 /**
@@ -513,14 +904,12 @@ sdprompt_viewer_plugin_set_property( GObject       *object,
             
         case PROP_FORCE_MINIMUM_WIDTH:
             plugin->force_minimum_width = g_value_get_boolean(value);
-            apply_sidebar_minimum_width( plugin,
-                plugin->force_minimum_width ? (gint)plugin->minimum_width : -1 );
+            schedule_settings_update( plugin, SETTINGS_DIRTY_MIN_WIDTH );
             break;
             
         case PROP_MINIMUM_WIDTH:
             plugin->minimum_width = g_value_get_double(value);
-            apply_sidebar_minimum_width( plugin,
-                plugin->force_minimum_width ? (gint)plugin->minimum_width : -1 );
+            schedule_settings_update( plugin, SETTINGS_DIRTY_MIN_WIDTH );
             break;
             
         case PROP_FORCE_VISIBILITY:
@@ -529,17 +918,36 @@ sdprompt_viewer_plugin_set_property( GObject       *object,
             
         case PROP_THEME_VISUAL_STYLE:
             plugin->theme.visual_style = g_value_get_int(value);
-            apply_visual_style( plugin, plugin->theme );
+            schedule_settings_update( plugin, SETTINGS_DIRTY_THEME );
             break;
 
         case PROP_THEME_BORDER_SIZE:
             plugin->theme.border_size = g_value_get_int(value);
-            apply_visual_style( plugin, plugin->theme );
+            schedule_settings_update( plugin, SETTINGS_DIRTY_THEME );
             break;
             
         case PROP_THEME_FONT_SIZE:
             plugin->theme.font_size = g_value_get_int(value);
-            apply_visual_style( plugin, plugin->theme );
+            schedule_settings_update( plugin, SETTINGS_DIRTY_THEME );
+            break;
+            
+        case PROP_MODELS_DIR:
+            if( g_strcmp0( plugin->models_dir, g_value_get_string(value) )!=0 ) {
+                g_free( plugin->models_dir );
+                plugin->models_dir = g_value_dup_string(value);
+                start_model_scan( plugin );
+            }
+            break;
+            
+        case PROP_WATCH_FOLDER:
+            if( plugin->watch_folder != g_value_get_boolean(value) ) {
+                plugin->watch_folder = g_value_get_boolean(value);
+                update_folder_watch( plugin );
+            }
+            break;
+            
+        case PROP_WATCH_SELECT_NEWEST:
+            plugin->watch_select_newest = g_value_get_boolean(value);
             break;
                         
         default:
@@ -602,6 +1010,18 @@ sdprompt_viewer_plugin_get_property( GObject    *object,
             g_value_set_int(value, plugin->theme.font_size);
             break;
             
+        case PROP_MODELS_DIR:
+            g_value_set_string(value, plugin->models_dir);
+            break;
+            
+        case PROP_WATCH_FOLDER:
+            g_value_set_boolean(value, plugin->watch_folder);
+            break;
+            
+        case PROP_WATCH_SELECT_NEWEST:
+            g_value_set_boolean(value, plugin->watch_select_newest);
+            break;
+            
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -610,11 +1030,536 @@ sdprompt_viewer_plugin_get_property( GObject    *object,
 
 /*-------------------------------- EVENTS ---------------------------------*/
 
+/* request for the worker thread that loads the selected image */
+typedef struct _ImageRequest ImageRequest;
+struct         _ImageRequest {
+    GFile *file;
+    gchar *uri;
+    guint  serial;
+    gint64 perf_start;  /* selection change, 0 without latency statistics */
+};
+
+static void
+free_image_request( ImageRequest *request )
+{
+    g_object_unref( request->file );
+    g_free( request->uri );
+    g_free( request );
+}
+
+static void
+load_image_info_thread( GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable )
+{
+    ImageRequest *request = task_data;
+    ClipTokenizer *clip   = get_clip_tokenizer( RES_CLIP_MERGES );
+    SDImageInfo *info = new_image_info(); gint64 start, trace;
+    
+    /* same as load_image_info(), measuring each stage */
+    start = perf_start();
+    read_image_info_data( info, request->file );
+    perf_record( PERF_READ, start );
+    start = perf_start();
+    trace = TRACE_BEGIN();
+    parse_image_info_data( info, clip );
+    TRACE_MARK( trace, "parse", NULL );
+    perf_record( PERF_PARSE, start );
+    g_task_return_pointer( task, info, (GDestroyNotify)unref_image_info );
+}
+
+/* records the layout and total latency of the image displayed last */
 static void
-on_png_text_chunk_loaded(gchar *text, gpointer user_ptr, int user_int) {
-    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_ptr );
-    set_image_generation_data( plugin, text, -1 );
+on_perf_after_paint( GdkFrameClock *frame_clock, gpointer user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    if( !plugin->perf_display_end ) { return; }
+    perf_record( PERF_LAYOUT, plugin->perf_display_end );
+    perf_record( PERF_TOTAL , plugin->perf_total_start );
+    plugin->perf_display_end = 0;
+}
+
+/**
+ * show_measured_image:
+ * @plugin     : A pointer to an #SDPromptViewerPlugin object.
+ * @changed_at : When the selection changed, or 0 if not measured.
+ *
+ * Displays the generation data of the selected image, recording the time
+ * spent updating the widgets and, once the next frame is painted, the
+ * layout and total latency of the selection change.
+ */
+static void
+show_measured_image( SDPromptViewerPlugin *plugin,
+                     gint64                changed_at )
+{
+    gint64 start = perf_start(), trace = TRACE_BEGIN();
     show_image_generation_data( plugin );
+    TRACE_MARK( trace, "widget update", NULL );
+    perf_record( PERF_DISPLAY, start );
+    if( !start || !changed_at ) { return; }
+    
+    if( !plugin->perf_clock && plugin->page ) {
+        plugin->perf_clock = gtk_widget_get_frame_clock( plugin->page );
+        if( plugin->perf_clock ) {
+            g_object_ref( plugin->perf_clock );
+            plugin->perf_paint_signal_id =
+                g_signal_connect( plugin->perf_clock, "after-paint",
+                                  G_CALLBACK( on_perf_after_paint ), plugin );
+        }
+    }
+    if( plugin->perf_clock ) {
+        plugin->perf_total_start = changed_at;
+        plugin->perf_display_end = perf_start();
+    } else {
+        perf_record( PERF_TOTAL, changed_at );
+    }
+}
+
+static void
+on_image_info_loaded( GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data )
+{
+    SDPromptViewerPlugin *plugin  = SDPROMPT_VIEWER_PLUGIN( source_object );
+    ImageRequest         *request = g_task_get_task_data( G_TASK( result ) );
+    SDImageInfo          *info;
+    
+    TRACE_COUNTER_ADD( TRACE_QUEUE_DEPTH, -1 );
+    info = g_task_propagate_pointer( G_TASK( result ), NULL );
+    if( !info ) { return; }
+    
+    /* the plugin was deactivated while the image was being loaded */
+    if( !plugin->image_cache ) { unref_image_info( info ); return; }
+    
+    /* the result is cached even if the user has already moved on */
+    lru_cache_insert( plugin->image_cache, request->uri, ref_image_info( info ) );
+    if( request->serial == plugin->image_request ) {
+        set_image_info( plugin, info );
+        show_measured_image( plugin, request->perf_start );
+    }
+    unref_image_info( info );
+}
+
+static void
+scan_model_index_thread( GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable )
+{
+    const gchar *models_dir = task_data; gchar *cache_path;
+    cache_path = get_model_cache_path();
+    g_task_return_pointer( task,
+                           scan_model_index( models_dir, cache_path, cancellable ),
+                           (GDestroyNotify)free_model_index );
+    g_free( cache_path );
+}
+
+static void
+on_model_index_scanned( GObject      *source_object,
+                        GAsyncResult *result,
+                        gpointer      user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( source_object );
+    ModelIndex           *index;
+    
+    /* the scan was cancelled (new directory or plugin deactivated) */
+    index = g_task_propagate_pointer( G_TASK( result ), NULL );
+    if( !index ) { return; }
+    
+    free_model_index( plugin->model_index );
+    plugin->model_index = index;
+    g_clear_object( &plugin->model_scan );
+    if( plugin->image_info ) {
+        if( is_page_visible( plugin ) ) { show_image_generation_data( plugin ); }
+        else                            { plugin->view_dirty = TRUE;          }
+    }
+}
+
+/**
+ * start_model_scan:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Starts building the index of the local models directory in a worker
+ * thread, cancelling any scan still running. Only files that are new or
+ * have changed since the last scan are hashed.
+ */
+static void
+start_model_scan( SDPromptViewerPlugin *plugin )
+{
+    GTask *task;
+    
+    /* the directory can be set before the plugin is activated */
+    if( !plugin->page_builder ) { return; }
+    
+    if( plugin->model_scan ) {
+        g_cancellable_cancel( plugin->model_scan );
+        g_clear_object( &plugin->model_scan );
+    }
+    if( IS_EMPTY_STR( plugin->models_dir ) ) {
+        free_model_index( plugin->model_index );
+        plugin->model_index = NULL;
+        return;
+    }
+    plugin->model_scan = g_cancellable_new();
+    task = g_task_new( plugin, plugin->model_scan, on_model_index_scanned, NULL );
+    g_task_set_task_data( task, g_strdup( plugin->models_dir ), g_free );
+    g_task_run_in_thread( task, scan_model_index_thread );
+    g_object_unref( task );
+}
+
+/**
+ * apply_prompt_search:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Shows in the thumbnail view only the images whose prompts match the
+ * text of the search entry. While the folder is being indexed the search
+ * runs over the images indexed so far and is applied again as more are.
+ */
+static void
+apply_prompt_search( SDPromptViewerPlugin *plugin )
+{
+    SDFolderIndex *index; EogListStore *store; GArray *matches;
+    const gchar *query;
+    
+    index = plugin->folder_index;
+    if( !index ) { index = sdprompt_indexer_get_index( plugin->indexer ); }
+    store = eog_window_get_store( plugin->window );
+    if( !index || !store ) { return; }
+    
+    query   = gtk_entry_get_text( GTK_ENTRY( get_widget( plugin->page_builder, "search_entry" ) ) );
+    matches = sdprompt_folder_index_search( index, query );
+    sdprompt_store_filter_apply( plugin->store_filter, store, index, matches );
+    if( matches ) { g_array_unref( matches ); }
+}
+
+static gboolean
+is_prompt_search_active( SDPromptViewerPlugin *plugin )
+{
+    GtkWidget *search_entry = get_widget( plugin->page_builder, "search_entry" );
+    return !IS_EMPTY_STR( gtk_entry_get_text( GTK_ENTRY( search_entry ) ) );
+}
+
+static void
+on_search_changed( GtkSearchEntry *entry, SDPromptViewerPlugin *plugin )
+{
+    apply_prompt_search( plugin );
+}
+
+/**
+ * apply_thumbnail_sort:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Sorts the thumbnail view by the parameter selected in the sort combo,
+ * using the sort orders cached in the folder index. Sorting by a parameter
+ * waits until the folder has been indexed.
+ */
+static void
+apply_thumbnail_sort( SDPromptViewerPlugin *plugin )
+{
+    EogListStore *store; const guint32 *ranks = NULL;
+    SDSortKey key; gboolean descending;
+    
+    store = eog_window_get_store( plugin->window );
+    if( !plugin->folder_index || !store ) { return; }
+    
+    /* the items of the combo follow the order of SDSortKey */
+    key        = gtk_combo_box_get_active( GTK_COMBO_BOX( get_widget( plugin->page_builder, "sort_combo" ) ) );
+    descending = gtk_toggle_button_get_active( GTK_TOGGLE_BUTTON( get_widget( plugin->page_builder, "sort_descending_button" ) ) );
+    if( key>SD_SORT_NONE && key<SD_SORT_KEY_COUNT ) {
+        ranks = sdprompt_folder_index_get_sort_ranks( plugin->folder_index, key, descending );
+        if( !ranks ) { return; }
+    }
+    sdprompt_store_filter_sort( plugin->store_filter, store, plugin->folder_index, ranks );
+}
+
+static void
+on_sort_changed( GtkWidget *widget, SDPromptViewerPlugin *plugin )
+{
+    apply_thumbnail_sort( plugin );
+}
+
+static void
+on_folder_index_progress( guint done, guint total, gpointer user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    GtkWidget *progress_bar; gchar *text;
+    
+    progress_bar = get_widget( plugin->page_builder, "index_progress_bar" );
+    text = g_strdup_printf( _("Indexing folder… %u/%u"), done, total );
+    gtk_progress_bar_set_fraction( GTK_PROGRESS_BAR( progress_bar ),
+                                   total>0 ? (gdouble)done / total : 1.0 );
+    gtk_progress_bar_set_text( GTK_PROGRESS_BAR( progress_bar ), text );
+    gtk_widget_show( progress_bar );
+    g_free( text );
+    if( is_prompt_search_active( plugin ) ) { apply_prompt_search( plugin ); }
+}
+
+/* adds an image of the watched folder to the complete folder index */
+static void
+append_to_folder_index( SDPromptViewerPlugin *plugin, EogImage *image )
+{
+    SDImageInfo *info; GFile *file; gchar *uri;
+    
+    file = eog_image_get_file( image );
+    uri  = g_file_get_uri( file );
+    info = lru_cache_lookup( plugin->image_cache, uri );
+    sdprompt_folder_index_append( plugin->folder_index, image,
+                                  info ? info->data : NULL );
+    g_object_unref( file );
+    g_free( uri );
+}
+
+static void
+on_folder_index_ready( SDFolderIndex *index, gpointer user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    guint i;
+    
+    sdprompt_folder_index_unref( plugin->folder_index );
+    plugin->folder_index = sdprompt_folder_index_ref( index );
+    
+    /* the images that arrived while indexing weren't in the store listed */
+    if( plugin->index_pending ) {
+        for( i=0 ; i<plugin->index_pending->len ; ++i ) {
+            append_to_folder_index( plugin, g_ptr_array_index( plugin->index_pending, i ) );
+        }
+        g_clear_pointer( &plugin->index_pending, g_ptr_array_unref );
+    }
+    gtk_widget_hide( get_widget( plugin->page_builder, "index_progress_bar" ) );
+    if( is_prompt_search_active( plugin ) ) { apply_prompt_search( plugin ); }
+    apply_thumbnail_sort( plugin );
+    DEBUG_MESSAGE( "Folder indexed: %u images, %u with parameters",
+                   index->count, index->with_parameters );
+}
+
+/**
+ * start_folder_indexing:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Starts indexing the generation parameters of every image of the folder
+ * currently open in the window, discarding the index of the previous one.
+ */
+static void
+start_folder_indexing( SDPromptViewerPlugin *plugin )
+{
+    EogListStore *store = eog_window_get_store( plugin->window );
+    
+    /* the rows hidden by a search belong to the store being replaced */
+    sdprompt_store_filter_reset( plugin->store_filter );
+    sdprompt_folder_index_unref( plugin->folder_index );
+    plugin->folder_index = NULL;
+    g_clear_pointer( &plugin->index_pending, g_ptr_array_unref );
+    sdprompt_indexer_start( plugin->indexer,
+                            store ? GTK_TREE_MODEL( store ) : NULL );
+}
+
+/* returns the image of the store that corresponds to 'file', or NULL */
+static EogImage *
+find_store_image( EogListStore *store, GFile *file )
+{
+    GtkTreeModel *model = GTK_TREE_MODEL( store );
+    GtkTreeIter iter; EogImage *image, *found = NULL; GFile *image_file;
+    gboolean valid;
+    
+    valid = gtk_tree_model_get_iter_first( model, &iter );
+    while( valid && !found ) {
+        image = NULL;
+        gtk_tree_model_get( model, &iter, EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+        if( image ) {
+            image_file = eog_image_get_file( image );
+            if( g_file_equal( image_file, file ) ) { found = g_object_ref( image ); }
+            g_object_unref( image_file );
+            g_object_unref( image );
+        }
+        valid = gtk_tree_model_iter_next( model, &iter );
+    }
+    return found;
+}
+
+/**
+ * show_watched_image:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ * @store  : The store of the window.
+ * @image  : A new image of the watched folder, completely written.
+ *
+ * Adds the image to the folder index, so that the search and the sort
+ * include it, and selects it if the user wants the newest image. While the
+ * folder is being indexed the image waits until the index is ready. Its
+ * parameters are already in the cache, so it's displayed without reading
+ * the file again.
+ */
+static void
+show_watched_image( SDPromptViewerPlugin *plugin,
+                    EogListStore         *store,
+                    EogImage             *image )
+{
+    /* an index still being built listed the store before the image was
+     * added, and its workers are writing it, so the image waits */
+    if( plugin->folder_index ) {
+        append_to_folder_index( plugin, image );
+        apply_thumbnail_sort( plugin );
+        if( is_prompt_search_active( plugin ) ) { apply_prompt_search( plugin ); }
+    }
+    else if( sdprompt_indexer_is_running( plugin->indexer ) ) {
+        if( !plugin->index_pending ) {
+            plugin->index_pending = g_ptr_array_new_with_free_func( g_object_unref );
+        }
+        g_ptr_array_add( plugin->index_pending, g_object_ref( image ) );
+    }
+    /* unless the search has hidden it */
+    if( plugin->watch_select_newest &&
+        eog_list_store_get_pos_by_image( store, image )>=0 ) {
+        eog_thumb_view_set_current_image( plugin->thumbview, image, TRUE );
+    }
+}
+
+/* shows the images that EOG has added to the store, in the order added */
+static gboolean
+on_watch_ready_idle( gpointer user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    EogListStore *store = eog_window_get_store( plugin->window );
+    GPtrArray *images = plugin->watch_ready; guint i;
+    
+    plugin->watch_ready_id = 0;
+    plugin->watch_ready    = NULL;
+    for( i=0 ; store && images && i<images->len ; ++i ) {
+        show_watched_image( plugin, store, g_ptr_array_index( images, i ) );
+    }
+    if( images ) { g_ptr_array_unref( images ); }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * EOG adds the new files of the folder to the store on its own; the rows
+ * of the watched images are picked up here and shown once the store has
+ * been updated, not from inside its signal.
+ */
+static void
+on_watch_store_row_inserted( GtkTreeModel         *model,
+                             GtkTreePath          *path,
+                             GtkTreeIter          *iter,
+                             SDPromptViewerPlugin *plugin )
+{
+    EogImage *image = NULL; GFile *file; GList *link;
+    
+    if( g_queue_is_empty( &plugin->watch_pending ) ) { return; }
+    gtk_tree_model_get( model, iter, EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+    if( !image ) { return; }
+    file = eog_image_get_file( image );
+    for( link = plugin->watch_pending.head ; link ; link = link->next ) {
+        if( g_file_equal( link->data, file ) ) { break; }
+    }
+    if( link ) {
+        g_object_unref( link->data );
+        g_queue_delete_link( &plugin->watch_pending, link );
+        if( !plugin->watch_ready ) {
+            plugin->watch_ready = g_ptr_array_new_with_free_func( g_object_unref );
+        }
+        g_ptr_array_add( plugin->watch_ready, g_object_ref( image ) );
+        if( !plugin->watch_ready_id ) {
+            plugin->watch_ready_id = g_idle_add( on_watch_ready_idle, plugin );
+        }
+    }
+    g_object_unref( file );
+    g_object_unref( image );
+}
+
+static void
+on_watched_image( GFile       *file,
+                  SDImageInfo *info,
+                  gboolean     complete,
+                  gpointer     user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    EogListStore *store; EogImage *image; gchar *uri = g_file_get_uri( file );
+    
+    /* the parameters are read before the image is written completely */
+    lru_cache_insert( plugin->image_cache, uri, ref_image_info( info ) );
+    g_free( uri );
+    if( !complete ) { return; }
+    
+    /* EOG watches the folder too, but may not have added the image yet */
+    store = eog_window_get_store( plugin->window );
+    image = store ? find_store_image( store, file ) : NULL;
+    if( image ) {
+        show_watched_image( plugin, store, image );
+        g_object_unref( image );
+        return;
+    }
+    if( g_queue_get_length( &plugin->watch_pending )>=WATCH_PENDING_MAX ) {
+        g_object_unref( g_queue_pop_head( &plugin->watch_pending ) );
+    }
+    g_queue_push_tail( &plugin->watch_pending, g_object_ref( file ) );
+}
+
+static void
+stop_folder_watch( SDPromptViewerPlugin *plugin )
+{
+    sdprompt_watch_free( plugin->watch );
+    plugin->watch = NULL;
+    if( plugin->watch_store_signal_id ) {
+        g_signal_handler_disconnect( plugin->watch_store,
+                                     plugin->watch_store_signal_id );
+        plugin->watch_store_signal_id = 0;
+    }
+    g_clear_object( &plugin->watch_store );
+    if( plugin->watch_ready_id ) {
+        g_source_remove( plugin->watch_ready_id );
+        plugin->watch_ready_id = 0;
+    }
+    g_clear_pointer( &plugin->watch_ready, g_ptr_array_unref );
+    g_queue_clear_full( &plugin->watch_pending, g_object_unref );
+}
+
+/**
+ * update_folder_watch:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ *
+ * Watches the folder currently open in the window for new images when
+ * the "watch-folder" setting is enabled, or stops watching it otherwise.
+ */
+static void
+update_folder_watch( SDPromptViewerPlugin *plugin )
+{
+    EogListStore *store; EogImage *image; GtkTreeIter iter;
+    GFile *file, *folder;
+    
+    /* the setting can be bound before the plugin is activated */
+    if( !plugin->page_builder ) { return; }
+    
+    stop_folder_watch( plugin );
+    store = eog_window_get_store( plugin->window );
+    if( !plugin->watch_folder || !store ||
+        !gtk_tree_model_get_iter_first( GTK_TREE_MODEL( store ), &iter ) ) {
+        return;
+    }
+    image = NULL;
+    gtk_tree_model_get( GTK_TREE_MODEL( store ), &iter,
+                        EOG_LIST_STORE_EOG_IMAGE, &image, -1 );
+    if( !image ) { return; }
+    file   = eog_image_get_file( image );
+    folder = g_file_get_parent( file );
+    if( folder ) {
+        plugin->watch       = sdprompt_watch_new( folder, on_watched_image, plugin );
+        plugin->watch_store = g_object_ref( GTK_TREE_MODEL( store ) );
+        plugin->watch_store_signal_id =
+            g_signal_connect( plugin->watch_store, "row-inserted",
+                              G_CALLBACK( on_watch_store_row_inserted ), plugin );
+        g_object_unref( folder );
+    }
+    g_object_unref( file );
+    g_object_unref( image );
+}
+
+static void
+on_thumbview_model_changed( GObject              *object,
+                            GParamSpec           *pspec,
+                            SDPromptViewerPlugin *plugin )
+{
+    start_folder_indexing( plugin );
+    update_folder_watch( plugin );
 }
 
 /*
@@ -624,25 +1569,193 @@ on_jpg_text_file_loaded(gchar *text, gpointer user_ptr, int user_int) {
 }
 */
 
+static void
+on_selection_summary( const SDSelectionSummary *summary, gpointer user_data )
+{
+    show_selection_summary( SDPROMPT_VIEWER_PLUGIN( user_data ), summary );
+}
+
+/**
+ * start_selection_summary:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ * @view   : The thumbnail view with several images selected.
+ *
+ * Starts aggregating the parameters of the selected images in background,
+ * the sidebar is updated as the images are read.
+ */
+static void
+start_selection_summary( SDPromptViewerPlugin *plugin, EogThumbView *view )
+{
+    GList *images = eog_thumb_view_get_selected_images( view );
+    set_image_info( plugin, NULL );
+    show_spinner( plugin );
+    plugin->selection_scan = g_cancellable_new();
+    sdprompt_selection_summarize( images, plugin->selection_scan,
+                                  on_selection_summary, plugin );
+    g_list_free_full( images, g_object_unref );
+}
+
+/* request for the worker thread that compares the two selected images */
+typedef struct _CompareRequest CompareRequest;
+struct         _CompareRequest {
+    gchar *key;
+    guint  serial;
+};
+
+static void
+on_images_compared( GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data )
+{
+    SDPromptViewerPlugin *plugin  = SDPROMPT_VIEWER_PLUGIN( source_object );
+    CompareRequest       *request = user_data;
+    SDImageCompare       *compare;
+    
+    compare = sdprompt_compare_images_finish( result );
+    /* the plugin may have been deactivated while comparing */
+    if( compare && plugin->compare_cache ) {
+        lru_cache_insert( plugin->compare_cache, request->key,
+                          sdprompt_image_compare_ref( compare ) );
+        if( request->serial == plugin->image_request ) {
+            show_image_comparison( plugin, compare );
+        }
+    }
+    sdprompt_image_compare_unref( compare );
+    g_free( request->key );
+    g_free( request );
+}
+
+/**
+ * start_image_comparison:
+ * @plugin : A pointer to an #SDPromptViewerPlugin object.
+ * @view   : The thumbnail view with two images selected.
+ *
+ * Compares the two selected images, in background unless the pair was
+ * already compared. Images already displayed are taken from the cache.
+ */
+static void
+start_image_comparison( SDPromptViewerPlugin *plugin, EogThumbView *view )
+{
+    GList *images = eog_thumb_view_get_selected_images( view );
+    GFile *files[2] = { NULL, NULL }; SDImageInfo *infos[2] = { NULL, NULL };
+    gchar *uris[2]; CompareRequest *request; SDImageCompare *compare;
+    GList *item; int i = 0;
+    
+    set_image_info( plugin, NULL );
+    for( item=images ; item && i<2 ; item=item->next, ++i ) {
+        files[i] = eog_image_get_file( EOG_IMAGE( item->data ) );
+    }
+    if( !files[0] || !files[1] ) {
+        show_message( plugin, "No image selected." );
+    } else {
+        uris[0]      = g_file_get_uri( files[0] );
+        uris[1]      = g_file_get_uri( files[1] );
+        request      = g_new( CompareRequest, 1 );
+        request->key = g_strconcat( uris[0], "\n", uris[1], NULL );
+        request->serial = plugin->image_request;
+        
+        compare = lru_cache_lookup( plugin->compare_cache, request->key );
+        if( compare ) {
+            show_image_comparison( plugin, compare );
+            g_free( request->key );
+            g_free( request );
+        } else {
+            show_spinner( plugin );
+            infos[0] = lru_cache_lookup( plugin->image_cache, uris[0] );
+            infos[1] = lru_cache_lookup( plugin->image_cache, uris[1] );
+            sdprompt_compare_images_async( plugin, files, infos,
+                                           on_images_compared, request );
+        }
+        g_free( uris[0] );
+        g_free( uris[1] );
+    }
+    if( files[0] ) { g_object_unref( files[0] ); }
+    if( files[1] ) { g_object_unref( files[1] ); }
+    g_list_free_full( images, g_object_unref );
+}
+
 static void
 on_image_changed( EogThumbView *view, SDPromptViewerPlugin *plugin ) {
-    GFile *file; EogImage *image;
+    GFile *file; EogImage *image; SDImageInfo *info;
+    ImageRequest *request; GTask *task;
+    
+    /* any request still running becomes obsolete */
+    plugin->image_request++;
+    if( plugin->selection_scan ) {
+        g_cancellable_cancel( plugin->selection_scan );
+        g_clear_object( &plugin->selection_scan );
+    }
+    
+    /* nothing is read while the page is hidden, the selection is displayed */
+    /* when it's revealed (unless the page is forced to show itself)        */
+    plugin->view_dirty = !plugin->force_visibility && !is_page_visible( plugin );
+    if( plugin->view_dirty ) { return; }
     
     if( eog_thumb_view_get_n_selected( view ) == 0 ) {
         show_message( plugin, "No image selected." );
         return;
     }
+    if( eog_thumb_view_get_n_selected( view ) == 2 ) {
+        start_image_comparison( plugin, view );
+        return;
+    }
+    if( eog_thumb_view_get_n_selected( view ) > 2 ) {
+        start_selection_summary( plugin, view );
+        return;
+    }
     image = eog_thumb_view_get_first_selected_image( view );
     file  = image ? eog_image_get_file( image ) : NULL;
     if( file ) {
-        show_spinner( plugin );
-        load_png_text_chunk(file, "parameters", 
-                            on_png_text_chunk_loaded, plugin, 0);
+        request         = g_new( ImageRequest, 1 );
+        request->file   = g_object_ref( file );
+        request->uri    = g_file_get_uri( file );
+        request->serial = plugin->image_request;
+        request->perf_start = perf_start();
+        
+        /* revisited images are displayed from the cache */
+        info = lru_cache_lookup( plugin->image_cache, request->uri );
+        if( info ) {
+            TRACE_COUNTER_ADD( TRACE_CACHE_HITS, 1 );
+            set_image_info( plugin, info );
+            show_measured_image( plugin, request->perf_start );
+            free_image_request( request );
+        } else {
+            TRACE_COUNTER_ADD( TRACE_CACHE_MISSES, 1 );
+            TRACE_COUNTER_ADD( TRACE_QUEUE_DEPTH , 1 );
+            show_spinner( plugin );
+            task = g_task_new( plugin, NULL, on_image_info_loaded, NULL );
+            g_task_set_task_data( task, request,
+                                  (GDestroyNotify)free_image_request );
+            g_task_run_in_thread( task, load_image_info_thread );
+            g_object_unref( task );
+        }
     }
     if( file  ) { g_object_unref(file ); }
     if( image ) { g_object_unref(image); }
 }
 
+/* displays the selection that changed while the page was hidden */
+static void
+on_sidebar_changed( GObject    *sidebar,
+                    GParamSpec *pspec,
+                    gpointer    user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    if( plugin->view_dirty && is_page_visible( plugin ) ) {
+        on_image_changed( plugin->thumbview, plugin );
+    }
+}
+
+/* displays the image selected when the window was opened */
+static gboolean
+on_first_load_idle( gpointer user_data )
+{
+    SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( user_data );
+    plugin->first_load_id = 0;
+    on_image_changed( plugin->thumbview, plugin );
+    return G_SOURCE_REMOVE;
+}
+
 static void
 on_copy_data_clicked( GtkWidget *widget, gpointer data ) {
     SDPromptViewerPlugin *plugin = SDPROMPT_VIEWER_PLUGIN( data );    
@@ -689,6 +1802,16 @@ on_activate( EogWindowActivatable *activatable )
     
     klass->instance_count++;
 
+    /*-- latency statistics (disabled unless requested) --*/
+    perf_init( g_settings_get_boolean( settings, SETTINGS_PERF_STATS ) );
+    trace_init();
+
+    /*-- cache of the images already loaded --*/
+    plugin->image_cache = lru_cache_new( IMAGE_CACHE_CAPACITY,
+                                         (GDestroyNotify)unref_image_info );
+    plugin->compare_cache = lru_cache_new( COMPARE_CACHE_CAPACITY,
+                                           (GDestroyNotify)sdprompt_image_compare_unref );
+
     /*-- build the user interface --*/
     plugin->page_builder = gtk_builder_new();
     gtk_builder_set_translation_domain( plugin->page_builder,
@@ -726,6 +1849,12 @@ on_activate( EogWindowActivatable *activatable )
                      plugin, "border-size", G_SETTINGS_BIND_GET);
     g_settings_bind( settings, SETTINGS_FONT_SIZE,
                      plugin, "font-size", G_SETTINGS_BIND_GET);
+    g_settings_bind( settings, SETTINGS_MODELS_DIR,
+                     plugin, "models-dir", G_SETTINGS_BIND_GET);
+    g_settings_bind( settings, SETTINGS_WATCH_SELECT_NEWEST,
+                     plugin, "watch-select-newest", G_SETTINGS_BIND_GET);
+    g_settings_bind( settings, SETTINGS_WATCH_FOLDER,
+                     plugin, "watch-folder", G_SETTINGS_BIND_GET);
     
     /*-- binding events using signals --*/
     plugin->thumbview_sel_changed_signal_id =
@@ -746,8 +1875,50 @@ on_activate( EogWindowActivatable *activatable )
                           G_CALLBACK( on_copy_data_clicked ),
                           plugin );
 
-    /*-- force update image information for first time --*/
-    on_image_changed(plugin->thumbview, plugin);
+    /* the thumbview gets a new model each time a folder is opened */
+    plugin->thumbview_model_signal_id =
+        g_signal_connect( G_OBJECT( plugin->thumbview ),
+                          "notify::model",
+                          G_CALLBACK( on_thumbview_model_changed ),
+                          plugin );
+
+    plugin->search_entry_signal_id =
+        g_signal_connect( get_widget( plugin->page_builder, "search_entry" ),
+                          "search-changed",
+                          G_CALLBACK( on_search_changed ),
+                          plugin );
+    plugin->sort_combo_signal_id =
+        g_signal_connect( get_widget( plugin->page_builder, "sort_combo" ),
+                          "changed",
+                          G_CALLBACK( on_sort_changed ),
+                          plugin );
+    plugin->sort_descending_signal_id =
+        g_signal_connect( get_widget( plugin->page_builder, "sort_descending_button" ),
+                          "toggled",
+                          G_CALLBACK( on_sort_changed ),
+                          plugin );
+
+    /* the page is only updated while it can be seen */
+    plugin->sidebar_page_signal_id =
+        g_signal_connect( G_OBJECT( plugin->sidebar ),
+                          "notify::current-page",
+                          G_CALLBACK( on_sidebar_changed ),
+                          plugin );
+    plugin->sidebar_visible_signal_id =
+        g_signal_connect( G_OBJECT( plugin->sidebar ),
+                          "notify::visible",
+                          G_CALLBACK( on_sidebar_changed ),
+                          plugin );
+
+    /*-- index the images of the folder in background --*/
+    plugin->store_filter = sdprompt_store_filter_new();
+    plugin->indexer = sdprompt_indexer_new( on_folder_index_progress,
+                                            on_folder_index_ready,
+                                            plugin );
+    start_folder_indexing( plugin );
+
+    /*-- show the image information once the window is displayed --*/
+    plugin->first_load_id = g_idle_add( on_first_load_idle, plugin );
 
     /*-- clean up --*/
     if( settings ) { g_object_unref( settings ); }
@@ -760,40 +1931,89 @@ on_deactivate( EogWindowActivatable *activatable )
     SDPromptViewerPlugin      *plugin = SDPROMPT_VIEWER_PLUGIN( activatable );
     SDPromptViewerPluginClass *klass  = SDPROMPT_VIEWER_PLUGIN_GET_CLASS( plugin );
     static const SDPromptTheme NULL_THEME = { -1, -1, -1 };
+    gchar *latency;
 
     /*-- restore sidebar width and release image generation data --*/
-    set_image_generation_data( plugin, NULL, 0 );
+    if( plugin->first_load_id ) {
+        g_source_remove( plugin->first_load_id );
+        plugin->first_load_id = 0;
+    }
+    if( plugin->perf_clock ) {
+        g_signal_handler_disconnect( plugin->perf_clock,
+                                     plugin->perf_paint_signal_id );
+        g_clear_object( &plugin->perf_clock );
+        plugin->perf_display_end = 0;
+    }
+    if( (latency = perf_describe()) ) {
+        DEBUG_MESSAGE( "Latency statistics:\n%s", latency );
+        perf_dump( "latency.txt" );
+        g_free( latency );
+    }
+    set_image_info( plugin, NULL );
+    free_widget_text_arena();
+    lru_cache_free( plugin->image_cache );
+    plugin->image_cache = NULL;
+    lru_cache_free( plugin->compare_cache );
+    plugin->compare_cache = NULL;
+    if( plugin->model_scan ) {
+        g_cancellable_cancel( plugin->model_scan );
+        g_clear_object( &plugin->model_scan );
+    }
+    if( plugin->selection_scan ) {
+        g_cancellable_cancel( plugin->selection_scan );
+        g_clear_object( &plugin->selection_scan );
+    }
+    free_model_index( plugin->model_index );
+    plugin->model_index = NULL;
+    sdprompt_store_filter_free( plugin->store_filter );
+    plugin->store_filter = NULL;
+    stop_folder_watch( plugin );
+    sdprompt_indexer_free( plugin->indexer );
+    plugin->indexer = NULL;
+    sdprompt_folder_index_unref( plugin->folder_index );
+    plugin->folder_index = NULL;
+    g_clear_pointer( &plugin->index_pending, g_ptr_array_unref );
+    if( plugin->settings_tick_id ) {
+        gtk_widget_remove_tick_callback( GTK_WIDGET( plugin->sidebar ),
+                                         plugin->settings_tick_id );
+        plugin->settings_tick_id = 0;
+    }
+    plugin->settings_dirty    = 0;
+    plugin->sidebar_min_width = UNKNOWN_SIZE;
     apply_sidebar_minimum_width( plugin, -1 );
+    apply_visual_style( plugin, NULL_THEME );
 
     /*-- remove the user interface from the sidebar --*/
     eog_sidebar_remove_page( plugin->sidebar,
                              plugin->page );
+    plugin->page = NULL;
 
     /*-- remove signals --*/
     g_signal_handler_disconnect( plugin->thumbview,
                                  plugin->thumbview_sel_changed_signal_id );
+    g_signal_handler_disconnect( plugin->thumbview,
+                                 plugin->thumbview_model_signal_id );
+    g_signal_handler_disconnect( plugin->sidebar,
+                                 plugin->sidebar_page_signal_id );
+    g_signal_handler_disconnect( plugin->sidebar,
+                                 plugin->sidebar_visible_signal_id );
     g_signal_handler_disconnect( get_widget( plugin->page_builder, "preferences_button" ),
                                  plugin->preferences_button_signal_id );
     g_signal_handler_disconnect( get_widget( plugin->page_builder, "copy_button" ),
                                  plugin->copy_button_signal_id );
+    g_signal_handler_disconnect( get_widget( plugin->page_builder, "search_entry" ),
+                                 plugin->search_entry_signal_id );
+    g_signal_handler_disconnect( get_widget( plugin->page_builder, "sort_combo" ),
+                                 plugin->sort_combo_signal_id );
+    g_signal_handler_disconnect( get_widget( plugin->page_builder, "sort_descending_button" ),
+                                 plugin->sort_descending_signal_id );
     
     if( plugin->page_builder ) {
         g_object_unref( plugin->page_builder );
         plugin->page_builder = NULL;
     }
 
-    /* if the current object is the last instance of the class        */
-    /* then it removes any visual styles applied to free up resources */
-    if( --klass->instance_count == 0 ) {
-        apply_visual_style( plugin, NULL_THEME );
-    }
-    
-    /* This line locks the visual styles system due to a bug that crashes */
-    /* the application if any window is closed and a style is applied.    */
-    /* The bug has not been fixed yet, so the visual styles system is     */
-    /* locked immediately after a window is closed to prevent the crash.  */
-    klass->is_theme_locked = TRUE;
-
+    klass->instance_count--;
 }
 
 static void
@@ -42,6 +42,9 @@
 #include <eog/eog-thumb-view.h>
 #include <eog/eog-sidebar.h>
 #include <eog/eog-window.h>
+#if !defined( THEME_MAX_STYLE_ID )
+#  error "sdprompt-viewer-plugin.h requires themes/themes.h"
+#endif
 typedef struct SDPromptTheme_ SDPromptTheme;
 struct         SDPromptTheme_ {
     gint visual_style;
@@ -94,12 +97,8 @@ struct         _SDPromptViewerPluginClass
     
     gint instance_count;
     
-    /* Visual Styles */
-    SDPromptTheme    current_theme;
-    gboolean         is_theme_locked;
-    GtkStyleProvider *visual_style_provider;
-    GtkStyleProvider *border_style_provider;
-    GtkStyleProvider *zoom_style_provider;
+    /* Visual Styles (parsed once, shared by every window) */
+    ThemeStyleCache style_cache;
     
     /* Minimum Sidebar Size */
     gint sidebar_min_width;
@@ -125,17 +124,72 @@ struct         _SDPromptViewerPlugin
     gboolean      force_minimum_width;
     gdouble       minimum_width;
     gboolean      force_visibility;
-    gchar        *image_generation_data;
     SDPromptTheme theme;
+    gchar        *models_dir;
+    gboolean      watch_folder;
+    gboolean      watch_select_newest;
+    
+    /* Visual Styles applied to the page */
+    SDPromptTheme     applied_theme;
+    GtkStyleProvider *visual_style_provider;
+    GtkStyleProvider *border_style_provider;
+    GtkStyleProvider *zoom_style_provider;
+    
+    /* Selected Image */
+    struct _SDImageInfo *image_info;
+    struct _LRUCache    *image_cache;
+    struct _LRUCache    *compare_cache;    /* SDImageCompare by pair of URIs */
+    guint                image_request;
+    GCancellable        *selection_scan;
+    
+    /* Local Models */
+    struct _ModelIndex  *model_index;
+    GCancellable        *model_scan;
+    
+    /* Folder Index */
+    struct _SDIndexer     *indexer;
+    struct _SDFolderIndex *folder_index;
+    struct _SDStoreFilter *store_filter;
+    GPtrArray             *index_pending;   /* watched images added while indexing */
+    
+    /* Folder Watch */
+    struct _SDWatch       *watch;
+    GQueue                 watch_pending;   /* GFile of new images not in the store yet */
+    GPtrArray             *watch_ready;     /* EogImage added to the store, shown when idle */
+    guint                  watch_ready_id;
+    GtkTreeModel          *watch_store;     /* store whose "row-inserted" is connected */
+    gulong                 watch_store_signal_id;
+    
+    /* First image displayed once the window is idle */
+    guint                  first_load_id;
+    
+    /* Selection changed while the page was hidden (nothing was loaded) */
+    gboolean               view_dirty;
+    
+    /* Settings changed since the last frame (SETTINGS_DIRTY_* flags) */
+    guint                  settings_dirty;
+    guint                  settings_tick_id;
+    
+    /* Latency Statistics (see 'utils_perf.h') */
+    GdkFrameClock         *perf_clock;
+    gulong                 perf_paint_signal_id;
+    gint64                 perf_total_start;
+    gint64                 perf_display_end;
 
     /* Signal IDs */
     gulong thumbview_sel_changed_signal_id;
     gulong preferences_button_signal_id;
     gulong copy_button_signal_id;
+    gulong thumbview_model_signal_id;
+    gulong search_entry_signal_id;
+    gulong sort_combo_signal_id;
+    gulong sort_descending_signal_id;
+    gulong sidebar_page_signal_id;
+    gulong sidebar_visible_signal_id;
     
     /* Minimum Sidebar Size */
     gboolean sidebar_min_is_forced;
-    gint     sidebar_min_width;
+    gint     sidebar_min_width;         /* last width applied, -1 = default */
 };
 
 /*---------------------------- PUBLIC FUNCTIONS ---------------------------*/
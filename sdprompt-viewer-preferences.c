@@ -120,9 +120,29 @@ sdprompt_viewer_preferences_dispose( GObject *object )
 
 /*----------------------- GRAPHICAL USER INTERFACE ------------------------*/
 
+/* the models directory is stored when the user has finished typing it,
+ * every change of the setting scans the directory */
+static void
+commit_models_dir( GtkEntry *entry, GSettings *settings )
+{
+    gchar *models_dir = g_settings_get_string( settings, SETTINGS_MODELS_DIR );
+    if( g_strcmp0( models_dir, gtk_entry_get_text( entry ) )!=0 ) {
+        g_settings_set_string( settings, SETTINGS_MODELS_DIR,
+                               gtk_entry_get_text( entry ) );
+    }
+    g_free( models_dir );
+}
+
+static gboolean
+on_models_dir_focus_out( GtkWidget *entry, GdkEvent *event, GSettings *settings )
+{
+    commit_models_dir( GTK_ENTRY( entry ), settings );
+    return FALSE;
+}
+
 static void create_gui( SDPromptViewerPreferences *preferences )
 {
-    GtkBuilder *builder; GSettings *settings; GError *error = NULL;
+    GtkBuilder *builder; GSettings *settings; GObject *entry; GError *error = NULL;
     gchar *objects_to_build[] =
     {
         "main_container",
@@ -166,6 +186,24 @@ static void create_gui( SDPromptViewerPreferences *preferences )
     settings_bind_default( settings, SETTINGS_FONT_SIZE,
                            builder, "font_size_adjust", "value" );
     
+    entry = gtk_builder_get_object( builder, "models_dir_entry" );
+    g_settings_bind( settings, SETTINGS_MODELS_DIR, entry, "text",
+                     G_SETTINGS_BIND_GET );
+    g_signal_connect_data( entry, "activate",
+                           G_CALLBACK( commit_models_dir ),
+                           g_object_ref( settings ),
+                           (GClosureNotify)g_object_unref, 0 );
+    g_signal_connect_data( entry, "focus-out-event",
+                           G_CALLBACK( on_models_dir_focus_out ),
+                           g_object_ref( settings ),
+                           (GClosureNotify)g_object_unref, 0 );
+    
+    settings_bind_default( settings, SETTINGS_WATCH_FOLDER,
+                           builder, "watch_folder_button", "active" );
+    
+    settings_bind_default( settings, SETTINGS_WATCH_SELECT_NEWEST,
+                           builder, "watch_select_newest_button", "active" );
+    
     g_object_unref( settings );
     settings = NULL;
 
@@ -0,0 +1,245 @@
+/**
+ * @file    sdprompt-viewer-selection.c
+ * @brief   Background summary of the parameters of the selected images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    When several thumbnails are selected the sidebar shows what they have
+    in common. The URIs of the selection are collected in the main thread
+    and a single worker reads the files in batches through
+    'utils_pngbatch.h', adding their parameters to an Aggregate. After the
+    first batch, and then every few hundred milliseconds, the worker
+    describes the aggregate as text and posts the summary to the main loop,
+    so a large selection fills in progressively while the UI stays
+    responsive. Summaries are dropped once the cancellable is cancelled,
+    which happens in the main thread as soon as the selection changes.
+*/
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <eog/eog-image.h>
+
+#include "utils_png.h"
+#include "utils_pngbatch.h"
+#include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "sdprompt-viewer-selection.h"
+#include "utils_aggregate.h"
+
+/* Number of images read at a time */
+#define SELECTION_BATCH_SIZE PNG_BATCH_QUEUE_DEPTH
+
+/* Minimum interval between summaries, in milliseconds */
+#define SELECTION_UPDATE_INTERVAL 150
+
+/* Keys of the PNG text chunks that contain generation data */
+#define SELECTION_PNG_KEYS "parameters|prompt"
+
+#define IS_EMPTY_STR(str) ((str)==NULL || (str)[0]=='\0')
+
+typedef struct _SelectionJob SelectionJob;
+struct         _SelectionJob {
+    gchar          **uris;
+    guint            count;
+    GCancellable    *cancellable;
+    SDSelectionFunc  update_func;
+    gpointer         user_data;
+};
+
+typedef struct _SelectionUpdate SelectionUpdate;
+struct         _SelectionUpdate {
+    SDSelectionSummary summary;
+    GCancellable      *cancellable;
+    SDSelectionFunc    update_func;
+    gpointer           user_data;
+};
+
+
+/*------------------------------ MAIN THREAD ------------------------------*/
+
+static void
+free_selection_job( SelectionJob *job )
+{
+    g_strfreev( job->uris );
+    g_object_unref( job->cancellable );
+    g_free( job );
+}
+
+static void
+free_selection_update( SelectionUpdate *update )
+{
+    int field;
+    for( field=0 ; field<AGGREGATE_FIELD_COUNT ; ++field ) {
+        g_free( update->summary.fields[field] );
+    }
+    g_free( update->summary.fields );
+    g_free( update->summary.networks );
+    g_object_unref( update->cancellable );
+    g_free( update );
+}
+
+static gboolean
+on_selection_update( gpointer data )
+{
+    SelectionUpdate *update = data;
+    /* the selection has changed since the summary was posted */
+    if( !g_cancellable_is_cancelled( update->cancellable ) ) {
+        update->update_func( &update->summary, update->user_data );
+    }
+    return G_SOURCE_REMOVE;
+}
+
+
+/*-------------------------------- WORKER ---------------------------------*/
+
+static void
+post_selection_summary( SelectionJob *job, const Aggregate *aggregate, guint done )
+{
+    SelectionUpdate *update = g_new0( SelectionUpdate, 1 ); int field;
+    
+    update->summary.done            = done;
+    update->summary.total           = job->count;
+    update->summary.with_parameters = aggregate->with_parameters;
+    update->summary.with_hires      = aggregate->with_hires;
+    update->summary.with_inpaint    = aggregate->with_inpaint;
+    update->summary.fields          = g_new0( gchar *, AGGREGATE_FIELD_COUNT );
+    update->summary.networks        = aggregate_describe_networks( aggregate );
+    for( field=0 ; field<AGGREGATE_FIELD_COUNT ; ++field ) {
+        /* prompts are too long to be listed, only the count is shown */
+        update->summary.fields[field] = aggregate_describe(
+            aggregate, field,
+            field==AGGREGATE_PROMPT || field==AGGREGATE_NEGATIVE ? 0 : AGGREGATE_MAX_LISTED );
+    }
+    update->cancellable = g_object_ref( job->cancellable );
+    update->update_func = job->update_func;
+    update->user_data   = job->user_data;
+    g_idle_add_full( G_PRIORITY_DEFAULT_IDLE, on_selection_update,
+                     update, (GDestroyNotify)free_selection_update );
+}
+
+static void
+on_selection_text_loaded( gchar *text, gpointer data_ptr, int data_int )
+{
+    gchar **texts = data_ptr;
+    texts[data_int] = IS_EMPTY_STR( text ) ? NULL : g_strdup( text );
+}
+
+static void
+summarize_selection_thread( GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable )
+{
+    SelectionJob *job = task_data; Aggregate *aggregate; SDParameters *parameters;
+    gchar *paths[SELECTION_BATCH_SIZE], *texts[SELECTION_BATCH_SIZE];
+    GFile *file; gint64 next_update = 0; guint first, last, i;
+    
+    aggregate  = new_aggregate();
+    parameters = g_new( SDParameters, 1 );
+    for( first=0 ; first<job->count ; first=last ) {
+        if( g_cancellable_is_cancelled( cancellable ) ) { break; }
+        last = MIN( first + SELECTION_BATCH_SIZE, job->count );
+        for( i=0 ; i<last-first ; ++i ) {
+            paths[i] = g_filename_from_uri( job->uris[first+i], NULL, NULL );
+            texts[i] = NULL;
+        }
+        read_png_text_chunks( (const gchar * const *)paths, last-first,
+                              SELECTION_PNG_KEYS, PNG_BATCH_AUTO,
+                              on_selection_text_loaded, texts );
+        
+        /* images are added in selection order, whatever order they were read in */
+        for( i=0 ; i<last-first ; ++i ) {
+            if( !paths[i] && !IS_EMPTY_STR( job->uris[first+i] ) ) {
+                file = g_file_new_for_uri( job->uris[first+i] );
+                load_png_text_chunk( file, SELECTION_PNG_KEYS,
+                                     on_selection_text_loaded, texts, i );
+                g_object_unref( file );
+            }
+            if( texts[i] ) {
+                parse_generation_data( parameters, texts[i] );
+            }
+            aggregate_add( aggregate, texts[i] ? parameters : NULL );
+            g_free( texts[i] );
+            g_free( paths[i] );
+        }
+        if( last==job->count || g_get_monotonic_time()>=next_update ) {
+            post_selection_summary( job, aggregate, last );
+            next_update = g_get_monotonic_time() + SELECTION_UPDATE_INTERVAL * 1000;
+        }
+    }
+    g_free( parameters );
+    free_aggregate( aggregate );
+    g_task_return_boolean( task, TRUE );
+}
+
+
+/*============================ PUBLIC FUNCTIONS ===========================*/
+
+/**
+ * sdprompt_selection_summarize:
+ * @images:      (element-type EogImage): the selected images.
+ * @cancellable: cancelled by the caller when the selection changes.
+ * @update_func: called in the main thread each time a new summary is
+ *               ready; the last call has 'done' equal to 'total'.
+ * @user_data:   data passed to @update_func.
+ *
+ * Reads the generation parameters of @images in a worker thread and
+ * reports the common and distinct values as they are aggregated. No
+ * summary is delivered after @cancellable has been cancelled, so
+ * @user_data only has to live until then.
+ */
+void
+sdprompt_selection_summarize( GList           *images,
+                              GCancellable    *cancellable,
+                              SDSelectionFunc  update_func,
+                              gpointer         user_data )
+{
+    SelectionJob *job; GTask *task; GFile *file; GList *item; guint i = 0;
+    
+    g_return_if_fail( G_IS_CANCELLABLE( cancellable ) && update_func );
+    job              = g_new0( SelectionJob, 1 );
+    job->count       = g_list_length( images );
+    job->uris        = g_new0( gchar *, job->count + 1 );
+    job->cancellable = g_object_ref( cancellable );
+    job->update_func = update_func;
+    job->user_data   = user_data;
+    for( item=images ; item ; item=item->next ) {
+        file = eog_image_get_file( EOG_IMAGE( item->data ) );
+        job->uris[i++] = file ? g_file_get_uri( file ) : g_strdup( "" );
+        if( file ) { g_object_unref( file ); }
+    }
+    task = g_task_new( NULL, cancellable, NULL, NULL );
+    g_task_set_task_data( task, job, (GDestroyNotify)free_selection_job );
+    g_task_run_in_thread( task, summarize_selection_thread );
+    g_object_unref( task );
+}
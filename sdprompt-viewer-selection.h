@@ -0,0 +1,87 @@
+/**
+ * @file    sdprompt-viewer-selection.h
+ * @brief   Background summary of the parameters of the selected images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+*/
+#ifndef __SDPROMPT_VIEWER_SELECTION_H__
+#define __SDPROMPT_VIEWER_SELECTION_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The parameters described in a #SDSelectionSummary */
+typedef enum AggregateField {
+    AGGREGATE_PROMPT,
+    AGGREGATE_NEGATIVE,
+    AGGREGATE_MODEL,
+    AGGREGATE_MODEL_HASH,
+    AGGREGATE_SAMPLER,
+    AGGREGATE_STEPS,
+    AGGREGATE_CFG,
+    AGGREGATE_SEED,
+    AGGREGATE_WIDTH,
+    AGGREGATE_HEIGHT,
+    AGGREGATE_HIRES_UPSCALER,
+    AGGREGATE_HIRES_STEPS,
+    AGGREGATE_HIRES_DENOISING,
+    AGGREGATE_HIRES_UPSCALE,
+    AGGREGATE_INPAINT_DENOISING,
+    AGGREGATE_INPAINT_MASK_BLUR,
+    AGGREGATE_FIELD_COUNT
+} AggregateField;
+
+/**
+ * The aggregated parameters of the images read so far. 'fields' holds one
+ * description per #AggregateField, NULL for the fields that no image has.
+ **/
+typedef struct _SDSelectionSummary SDSelectionSummary;
+struct         _SDSelectionSummary {
+    guint   done;               /* images read so far      */
+    guint   total;              /* images in the selection */
+    guint   with_parameters;
+    guint   with_hires;
+    guint   with_inpaint;
+    gchar **fields;
+    gchar  *networks;           /* union of the extra networks, or NULL */
+};
+
+typedef void (*SDSelectionFunc)( const SDSelectionSummary *summary, gpointer user_data );
+
+void sdprompt_selection_summarize( GList           *images,
+                                   GCancellable    *cancellable,
+                                   SDSelectionFunc  update_func,
+                                   gpointer         user_data );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_VIEWER_SELECTION_H__ */
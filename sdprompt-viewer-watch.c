@@ -0,0 +1,398 @@
+/**
+ * @file    sdprompt-viewer-watch.c
+ * @brief   Live watch of the folder open in the window.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Generators such as A1111 or ComfyUI write each image into the output
+    folder while the user is looking at it. A GFileMonitor reports the new
+    PNGs and every file is read in a worker thread, where its SDImageInfo
+    is built too, so the main thread only has to display it.
+    
+    A file can be read while it's still being written. The text chunks come
+    before the image data, so the parameters are usually complete long
+    before the file: they are reported right away and reported again once
+    the file ends with its IEND chunk. Once reported complete, a file is
+    forgotten after a few seconds, long enough to ignore the events that
+    arrive after the last read. A file that can't be read yet is
+    retried with an exponential backoff instead of being shown as an image
+    without parameters; the "changes done" event sent when the generator
+    closes the file triggers a read immediately, so the time between the
+    file being closed and the image being displayed is one read.
+*/
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "resources.h"
+#include "utils_arena.h"
+#include "utils_png.h"
+#include "utils_sdparams.h"
+#include "utils_json.h"
+#include "utils_comfyui.h"
+#include "utils_cache.h"
+#include "utils_clip.h"
+#include "utils_imageinfo.h"
+#include "sdprompt-viewer-watch.h"
+
+/* Delay before peeking at a file that is still being written, in ms */
+#define WATCH_FIRST_DELAY 15
+
+/* Backoff between reads of an incomplete file, in milliseconds */
+#define WATCH_RETRY_DELAY 25
+#define WATCH_MAX_DELAY   1000
+
+/* Time after which an incomplete file is reported as it is, in ms */
+#define WATCH_TIMEOUT     10000
+
+/* Minimum interval between "changed" events of the same file, in ms */
+#define WATCH_RATE_LIMIT  50
+
+/* Time a reported file is remembered to ignore its late events, in ms */
+#define WATCH_FORGET_DELAY 2000
+
+struct _SDWatch {
+    GFileMonitor *monitor;
+    GCancellable *cancellable;
+    GHashTable   *files;        /* URI -> WatchFile */
+    SDWatchFunc   image_func;
+    gpointer      user_data;
+};
+
+typedef struct _WatchFile WatchFile;
+struct         _WatchFile {
+    SDWatch     *watch;
+    GFile       *file;
+    gchar       *uri;
+    SDImageInfo *info;          /* NULL until the parameters are read  */
+    gint64       first_read;    /* monotonic time of the first read    */
+    guint        retries;
+    guint        timeout_id;
+    gboolean     reading;
+    gboolean     changed;       /* modified while it was being read    */
+    gboolean     reported;      /* complete and reported, to be forgotten */
+};
+
+/* data of the worker that reads a file */
+typedef struct _WatchRead WatchRead;
+struct         _WatchRead {
+    GFile       *file;
+    gchar       *uri;
+    gboolean     read_text;
+    SDImageInfo *info;          /* result: NULL if the text isn't ready */
+    gboolean     complete;      /* result: the file ends with IEND      */
+};
+
+
+/*-------------------------------- WORKER ---------------------------------*/
+
+static void
+free_watch_read( WatchRead *read )
+{
+    g_object_unref( read->file );
+    g_free( read->uri );
+    unref_image_info( read->info );
+    g_free( read );
+}
+
+static void
+read_watch_file_thread( GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable )
+{
+    WatchRead *read = task_data; SDImageInfo *info;
+    
+    /* IEND is checked first: if the file is complete, so is its text */
+    read->complete = has_png_end( read->file );
+    if( read->read_text ) {
+        info = new_image_info();
+        if( read_image_info_data( info, read->file ) || read->complete ) {
+            parse_image_info_data( info, get_clip_tokenizer( RES_CLIP_MERGES ) );
+            read->info = info;
+        } else {
+            unref_image_info( info );
+        }
+    }
+    g_task_return_boolean( task, TRUE );
+}
+
+
+/*------------------------------ MAIN THREAD ------------------------------*/
+
+static void
+free_watch_file( WatchFile *file )
+{
+    if( file->timeout_id ) { g_source_remove( file->timeout_id ); }
+    g_object_unref( file->file );
+    g_free( file->uri );
+    unref_image_info( file->info );
+    g_free( file );
+}
+
+static void
+on_watch_file_read( GObject *source_object, GAsyncResult *result, gpointer user_data );
+
+static void
+read_watch_file( WatchFile *file )
+{
+    SDWatch *watch = file->watch; WatchRead *read; GTask *task;
+    
+    if( file->timeout_id ) {
+        g_source_remove( file->timeout_id );
+        file->timeout_id = 0;
+    }
+    if( file->first_read==0 ) { file->first_read = g_get_monotonic_time(); }
+    file->reading = TRUE;
+    file->changed = FALSE;
+    
+    read            = g_new0( WatchRead, 1 );
+    read->file      = g_object_ref( file->file );
+    read->uri       = g_strdup( file->uri );
+    read->read_text = file->info==NULL;
+    task = g_task_new( NULL, watch->cancellable, on_watch_file_read, watch );
+    g_task_set_task_data( task, read, (GDestroyNotify)free_watch_read );
+    g_task_run_in_thread( task, read_watch_file_thread );
+    g_object_unref( task );
+}
+
+static gboolean
+on_watch_file_timeout( gpointer data )
+{
+    WatchFile *file  = data;
+    file->timeout_id = 0;
+    if( file->reported ) {
+        g_hash_table_remove( file->watch->files, file->uri );
+    } else {
+        read_watch_file( file );
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_watch_file( WatchFile *file, guint delay )
+{
+    if( file->timeout_id ) { g_source_remove( file->timeout_id ); }
+    file->timeout_id = g_timeout_add( delay, on_watch_file_timeout, file );
+}
+
+static void
+on_watch_file_read( GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data )
+{
+    SDWatch *watch; WatchFile *file; WatchRead *read; gint64 elapsed;
+    
+    /* the watch was freed while the file was being read */
+    if( g_cancellable_is_cancelled( g_task_get_cancellable( G_TASK( result ) ) ) ) {
+        return;
+    }
+    watch = user_data;
+    read  = g_task_get_task_data( G_TASK( result ) );
+    file  = g_hash_table_lookup( watch->files, read->uri );
+    if( !file ) { return; }     /* deleted or moved away meanwhile */
+    file->reading = FALSE;
+    
+    if( read->info ) {
+        file->info = read->info;
+        read->info = NULL;
+        if( !read->complete ) {
+            watch->image_func( file->file, file->info, FALSE, watch->user_data );
+        }
+    }
+    elapsed = (g_get_monotonic_time() - file->first_read) / 1000;
+    if( !read->complete && elapsed>=WATCH_TIMEOUT ) {
+        /* a file left truncated, show what could be read of it */
+        g_warning( "Watched image %s is still incomplete", file->uri );
+        read->complete = TRUE;
+    }
+    if( read->complete ) {
+        if( !file->info ) { file->info = new_image_info(); }
+        file->reported = TRUE;
+        watch->image_func( file->file, file->info, TRUE, watch->user_data );
+        g_clear_pointer( &file->info, unref_image_info );
+        schedule_watch_file( file, WATCH_FORGET_DELAY );
+        return;
+    }
+    if( file->changed ) {
+        read_watch_file( file );
+    } else {
+        schedule_watch_file( file, MIN( WATCH_RETRY_DELAY << MIN( file->retries, 10 ),
+                                        WATCH_MAX_DELAY ) );
+        file->retries++;
+    }
+}
+
+static gboolean
+is_png_file( GFile *file )
+{
+    gchar *name, *lowercase; gboolean is_png;
+    name      = g_file_get_basename( file );
+    lowercase = name ? g_ascii_strdown( name, -1 ) : NULL;
+    is_png    = lowercase && g_str_has_suffix( lowercase, ".png" );
+    g_free( lowercase );
+    g_free( name );
+    return is_png;
+}
+
+/*
+ * Starts watching 'gfile': 'closed' is TRUE when the generator has
+ * finished writing it, which makes it be read immediately.
+ */
+static void
+watch_file( SDWatch *watch, GFile *gfile, gboolean closed )
+{
+    WatchFile *file; gchar *uri;
+    
+    if( !is_png_file( gfile ) ) { return; }
+    uri  = g_file_get_uri( gfile );
+    file = g_hash_table_lookup( watch->files, uri );
+    if( !file ) {
+        file        = g_new0( WatchFile, 1 );
+        file->watch = watch;
+        file->file  = g_object_ref( gfile );
+        file->uri   = uri;
+        g_hash_table_insert( watch->files, file->uri, file );
+    } else {
+        g_free( uri );
+    }
+    if( file->reported ) { return; }
+    if( file->reading ) {
+        file->changed = TRUE;
+    } else if( closed ) {
+        file->retries = 0;
+        read_watch_file( file );
+    } else if( !file->timeout_id ) {
+        schedule_watch_file( file, WATCH_FIRST_DELAY );
+    }
+}
+
+static void
+forget_file( SDWatch *watch, GFile *gfile )
+{
+    gchar *uri = g_file_get_uri( gfile );
+    g_hash_table_remove( watch->files, uri );
+    g_free( uri );
+}
+
+static void
+on_folder_changed( GFileMonitor      *monitor,
+                   GFile             *file,
+                   GFile             *other_file,
+                   GFileMonitorEvent  event,
+                   gpointer           user_data )
+{
+    SDWatch *watch = user_data;
+    switch( event ) {
+        /* the file is still being written */
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_CHANGED:
+            watch_file( watch, file, FALSE );
+            break;
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+            watch_file( watch, file, TRUE );
+            break;
+        /* some generators write to a temporary name and rename it */
+        case G_FILE_MONITOR_EVENT_RENAMED:
+            forget_file( watch, file );
+            if( other_file ) { watch_file( watch, other_file, TRUE ); }
+            break;
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+            forget_file( watch, file );
+            break;
+        default:
+            break;
+    }
+}
+
+
+/*============================ PUBLIC FUNCTIONS ===========================*/
+
+/**
+ * sdprompt_watch_new:
+ * @folder:     the folder to watch.
+ * @image_func: called for each new PNG of @folder (see #SDWatchFunc).
+ * @user_data:  data passed to @image_func.
+ *
+ * Starts watching @folder for new images. Images already in the folder
+ * are not reported.
+ *
+ * Returns: (nullable): a new #SDWatch, release it with sdprompt_watch_free(),
+ *          or %NULL if @folder can't be monitored.
+ */
+SDWatch *
+sdprompt_watch_new( GFile       *folder,
+                    SDWatchFunc  image_func,
+                    gpointer     user_data )
+{
+    SDWatch *watch; GFileMonitor *monitor; GError *error = NULL;
+    
+    g_return_val_if_fail( folder && image_func, NULL );
+    monitor = g_file_monitor_directory( folder, G_FILE_MONITOR_WATCH_MOVES,
+                                        NULL, &error );
+    if( !monitor ) {
+        g_warning( "Couldn't watch the folder: %s", error->message );
+        g_error_free( error );
+        return NULL;
+    }
+    watch              = g_new0( SDWatch, 1 );
+    watch->monitor     = monitor;
+    watch->cancellable = g_cancellable_new();
+    watch->files       = g_hash_table_new_full( g_str_hash, g_str_equal, NULL,
+                                                (GDestroyNotify)free_watch_file );
+    watch->image_func  = image_func;
+    watch->user_data   = user_data;
+    g_file_monitor_set_rate_limit( monitor, WATCH_RATE_LIMIT );
+    g_signal_connect( monitor, "changed", G_CALLBACK( on_folder_changed ), watch );
+    return watch;
+}
+
+/**
+ * sdprompt_watch_free:
+ * @watch: (nullable): an #SDWatch.
+ *
+ * Stops watching the folder. Files still being read are not reported.
+ */
+void
+sdprompt_watch_free( SDWatch *watch )
+{
+    if( !watch ) { return; }
+    g_signal_handlers_disconnect_by_data( watch->monitor, watch );
+    g_file_monitor_cancel( watch->monitor );
+    g_object_unref( watch->monitor );
+    g_cancellable_cancel( watch->cancellable );
+    g_object_unref( watch->cancellable );
+    g_hash_table_destroy( watch->files );
+    g_free( watch );
+}
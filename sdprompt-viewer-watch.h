@@ -0,0 +1,63 @@
+/**
+ * @file    sdprompt-viewer-watch.h
+ * @brief   Live watch of the folder open in the window.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+*/
+#ifndef __SDPROMPT_VIEWER_WATCH_H__
+#define __SDPROMPT_VIEWER_WATCH_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _SDWatch SDWatch;
+
+/**
+ * Called in the main thread for each new PNG of the folder: first with
+ * 'complete' FALSE as soon as its parameters can be read (the file is
+ * still being written), then once with 'complete' TRUE when the file has
+ * been written. 'info' is borrowed (use ref_image_info() to keep it) and
+ * has no data when the image doesn't contain generation parameters.
+ **/
+typedef void (*SDWatchFunc)( GFile               *file,
+                             struct _SDImageInfo *info,
+                             gboolean             complete,
+                             gpointer             user_data );
+
+SDWatch * sdprompt_watch_new( GFile       *folder,
+                              SDWatchFunc  image_func,
+                              gpointer     user_data );
+void      sdprompt_watch_free( SDWatch *watch );
+
+
+G_END_DECLS
+#endif /* __SDPROMPT_VIEWER_WATCH_H__ */
@@ -55,7 +55,26 @@ typedef enum _THEME_STYLE_TYPE THEME_STYLE_TYPE;
 enum         _THEME_STYLE_TYPE {
     THEME_VISUAL_STYLE,
     THEME_BORDER_STYLE,
-    THEME_ZOOM_STYLE
+    THEME_ZOOM_STYLE,
+    THEME_STYLE_TYPE_COUNT
+};
+
+/* Range of style IDs kept by a ThemeStyleCache (the zoom IDs are -2..2) */
+#define THEME_MIN_STYLE_ID  -2
+#define THEME_MAX_STYLE_ID   5
+#define THEME_STYLE_ID_COUNT (THEME_MAX_STYLE_ID - THEME_MIN_STYLE_ID + 1)
+
+/**
+ * ThemeStyleCache:
+ *
+ * The style providers already created for each type and ID, so switching
+ * between styles doesn't parse the CSS resources again. IDs that don't
+ * have a style are remembered too (loaded but %NULL provider).
+ */
+typedef struct _ThemeStyleCache ThemeStyleCache;
+struct         _ThemeStyleCache {
+    GtkStyleProvider *providers[THEME_STYLE_TYPE_COUNT][THEME_STYLE_ID_COUNT];
+    gboolean          loaded   [THEME_STYLE_TYPE_COUNT][THEME_STYLE_ID_COUNT];
 };
 
 /**
@@ -124,3 +143,50 @@ new_theme_style_provider( THEME_STYLE_TYPE style_type,
     return GTK_STYLE_PROVIDER( css_provider );
 }
 
+/**
+ * get_theme_style_provider - Gets the cached GtkStyleProvider of a style.
+ *
+ * @cache: The cache where the providers are kept.
+ * @style_type: The type of style to get.
+ * @style_id: The ID of the style to get.
+ *
+ * Same as new_theme_style_provider(), but the provider is created only the
+ * first time a style is requested and then reused from @cache.
+ *
+ * Returns: (transfer none): The #GtkStyleProvider owned by @cache,
+ *                           or %NULL if the style doesn't exist.
+ */
+static GtkStyleProvider *
+get_theme_style_provider( ThemeStyleCache *cache,
+                          THEME_STYLE_TYPE style_type,
+                          gint             style_id )
+{
+    gint slot = style_id - THEME_MIN_STYLE_ID;
+    if( style_type<0 || style_type>=THEME_STYLE_TYPE_COUNT ||
+        slot<0 || slot>=THEME_STYLE_ID_COUNT )
+    { return NULL; }
+    
+    if( !cache->loaded[style_type][slot] ) {
+        cache->providers[style_type][slot] =
+            new_theme_style_provider( style_type, style_id );
+        cache->loaded[style_type][slot] = TRUE;
+    }
+    return cache->providers[style_type][slot];
+}
+
+/**
+ * clear_theme_style_cache - Releases every provider kept in a cache.
+ *
+ * @cache: The cache to clear.
+ */
+static void
+clear_theme_style_cache( ThemeStyleCache *cache )
+{
+    int type, slot;
+    for( type=0 ; type<THEME_STYLE_TYPE_COUNT ; ++type ) {
+        for( slot=0 ; slot<THEME_STYLE_ID_COUNT ; ++slot ) {
+            g_clear_object( &cache->providers[type][slot] );
+            cache->loaded[type][slot] = FALSE;
+        }
+    }
+}
@@ -0,0 +1,484 @@
+/**
+ * @file    sdprompt-dump.c
+ * @brief   Dumps the generation parameters of folders of images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Usage: sdprompt-dump [--format jsonl|csv|tsv] [--threads N] [--all]
+                         [--stats] PATH...
+    
+    Walks each PATH recursively and writes one record per PNG file with
+    the generation parameters embedded in it, using the same readers and
+    parsers as the plugin but without GTK or EOG, so it can run on servers
+    that audit large archives of generations:
+    
+      jsonl    one JSON object per line, missing parameters are omitted
+      csv      RFC 4180, with a header line
+      tsv      tab separated, with '\t', '\n' and '\\' escaped
+    
+    Images without parameters are skipped unless --all is given. The
+    records are written in the order the files are read, not sorted.
+    
+    N threads (default: number of cores) take directories from a shared
+    queue; each one lists its directory and reads the PNG files in batches
+    through 'libsdprompt-core' (io_uring when available). Records are
+    formatted into a buffer per thread that is written out whenever it
+    grows past DUMP_FLUSH_SIZE, so memory stays bounded by the number of
+    threads however many files are dumped; only the paths of directories
+    waiting to be listed are queued.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include "../sdprompt-core.h"
+
+#define DUMP_BATCH_SIZE SDPROMPT_CORE_BATCH_SIZE
+#define DUMP_FLUSH_SIZE (256*1024)
+
+/* columns that are not a parameter of 'sdprompt-core.h' */
+#define NO_FIELD SD_CORE_FIELD_COUNT
+
+typedef enum DumpFormat { DUMP_JSONL, DUMP_CSV, DUMP_TSV } DumpFormat;
+
+typedef enum DumpColumn {
+    COL_PATH, COL_PROMPT, COL_NEGATIVE, COL_STEPS, COL_SAMPLER, COL_CFG,
+    COL_SEED, COL_WIDTH, COL_HEIGHT, COL_MODEL, COL_MODEL_HASH, COL_DENOISING,
+    COL_HIRES_UPSCALER, COL_HIRES_STEPS, COL_HIRES_DENOISING, COL_HIRES_UPSCALE,
+    COL_CLIP_SKIP, COL_NETWORKS,
+    COLUMN_COUNT
+} DumpColumn;
+
+static const struct {
+    const char  *name;
+    SDCoreField  field;
+    gboolean     is_number; /* written as a JSON number when it's valid */
+} COLUMNS[COLUMN_COUNT] = {
+    { "path",            NO_FIELD,                FALSE },
+    { "prompt",          SD_CORE_PROMPT,          FALSE },
+    { "negative_prompt", SD_CORE_NEGATIVE_PROMPT, FALSE },
+    { "steps",           SD_CORE_STEPS,           TRUE  },
+    { "sampler",         SD_CORE_SAMPLER,         FALSE },
+    { "cfg_scale",       SD_CORE_CFG_SCALE,       TRUE  },
+    { "seed",            SD_CORE_SEED,            TRUE  },
+    { "width",           SD_CORE_WIDTH,           TRUE  },
+    { "height",          SD_CORE_HEIGHT,          TRUE  },
+    { "model",           SD_CORE_MODEL,           FALSE },
+    { "model_hash",      SD_CORE_MODEL_HASH,      FALSE },
+    { "denoising",       SD_CORE_DENOISING,       TRUE  },
+    { "hires_upscaler",  SD_CORE_HIRES_UPSCALER,  FALSE },
+    { "hires_steps",     SD_CORE_HIRES_STEPS,     TRUE  },
+    { "hires_denoising", SD_CORE_HIRES_DENOISING, TRUE  },
+    { "hires_upscale",   SD_CORE_HIRES_UPSCALE,   TRUE  },
+    { "clip_skip",       SD_CORE_CLIP_SKIP,       TRUE  },
+    { "networks",        NO_FIELD,                FALSE }
+};
+
+/* marks the end of the directory queue */
+static gchar DUMP_STOP[] = "";
+
+typedef struct _Dump Dump;
+struct         _Dump {
+    DumpFormat   format;
+    gboolean     include_all;
+    guint        threads;
+    GAsyncQueue *directories;   /* paths still to be listed             */
+    gint         pending;       /* directories queued or being listed   */
+    GMutex       output_mutex;
+    gint         files;         /* atomic */
+    gint         with_parameters;  /* atomic */
+};
+
+typedef struct _DumpWorker DumpWorker;
+struct         _DumpWorker {
+    Dump             *dump;
+    SDCoreParameters *parameters;  /* NULL until the first image is parsed */
+    GString      *output;
+    GString      *networks;
+    gchar        *paths[DUMP_BATCH_SIZE];
+    int           count;
+};
+
+
+/*------------------------------- WRITERS ---------------------------------*/
+
+/* TRUE if 'value' follows the grammar of JSON numbers ("1.", "0x1" don't) */
+static gboolean
+is_json_number(const char *value)
+{
+    const char *ptr = value;
+    if( *ptr=='-' ) { ++ptr; }
+    if( *ptr=='0' ) { ++ptr; }
+    else if( *ptr>='1' && *ptr<='9' ) { while( g_ascii_isdigit(*ptr) ) { ++ptr; } }
+    else { return FALSE; }
+    if( *ptr=='.' ) {
+        if( !g_ascii_isdigit(*++ptr) ) { return FALSE; }
+        while( g_ascii_isdigit(*ptr) ) { ++ptr; }
+    }
+    if( *ptr=='e' || *ptr=='E' ) {
+        ++ptr;
+        if( *ptr=='+' || *ptr=='-' ) { ++ptr; }
+        if( !g_ascii_isdigit(*ptr) ) { return FALSE; }
+        while( g_ascii_isdigit(*ptr) ) { ++ptr; }
+    }
+    return *ptr=='\0';
+}
+
+static void
+append_json_string(GString *output, const char *value)
+{
+    const char *ptr;
+    g_string_append_c(output, '"');
+    for( ptr=value ; *ptr ; ++ptr ) {
+        switch( *ptr ) {
+            case '"':  g_string_append(output, "\\\""); break;
+            case '\\': g_string_append(output, "\\\\"); break;
+            case '\n': g_string_append(output, "\\n");  break;
+            case '\r': g_string_append(output, "\\r");  break;
+            case '\t': g_string_append(output, "\\t");  break;
+            default:
+                if( (guchar)*ptr < 0x20 ) { g_string_append_printf(output, "\\u%04x", (guchar)*ptr); }
+                else                      { g_string_append_c(output, *ptr); }
+                break;
+        }
+    }
+    g_string_append_c(output, '"');
+}
+
+static void
+append_csv_field(GString *output, const char *value)
+{
+    const char *ptr;
+    if( !strpbrk(value, ",\"\r\n") ) { g_string_append(output, value); return; }
+    g_string_append_c(output, '"');
+    for( ptr=value ; *ptr ; ++ptr ) {
+        if( *ptr=='"' ) { g_string_append_c(output, '"'); }
+        g_string_append_c(output, *ptr);
+    }
+    g_string_append_c(output, '"');
+}
+
+static void
+append_tsv_field(GString *output, const char *value)
+{
+    const char *ptr;
+    for( ptr=value ; *ptr ; ++ptr ) {
+        switch( *ptr ) {
+            case '\\': g_string_append(output, "\\\\"); break;
+            case '\t': g_string_append(output, "\\t");  break;
+            case '\n': g_string_append(output, "\\n");  break;
+            case '\r': g_string_append(output, "\\r");  break;
+            default:   g_string_append_c(output, *ptr); break;
+        }
+    }
+}
+
+static void
+append_record(GString *output, DumpFormat format, const char *values[COLUMN_COUNT])
+{
+    int column; gboolean first = TRUE;
+    
+    if( format==DUMP_JSONL ) { g_string_append_c(output, '{'); }
+    for( column=0 ; column<COLUMN_COUNT ; ++column ) {
+        if( format==DUMP_JSONL ) {
+            if( !values[column] ) { continue; }
+            if( !first ) { g_string_append_c(output, ','); }
+            g_string_append_printf(output, "\"%s\":", COLUMNS[column].name);
+            if( COLUMNS[column].is_number && is_json_number(values[column]) ) {
+                g_string_append(output, values[column]);
+            } else {
+                append_json_string(output, values[column]);
+            }
+        } else {
+            if( !first ) { g_string_append_c(output, format==DUMP_CSV ? ',' : '\t'); }
+            if( values[column] ) {
+                if( format==DUMP_CSV ) { append_csv_field(output, values[column]); }
+                else                   { append_tsv_field(output, values[column]); }
+            }
+        }
+        first = FALSE;
+    }
+    if( format==DUMP_JSONL ) { g_string_append_c(output, '}'); }
+    g_string_append_c(output, '\n');
+}
+
+static void
+append_header(GString *output, DumpFormat format)
+{
+    int column;
+    if( format==DUMP_JSONL ) { return; }
+    for( column=0 ; column<COLUMN_COUNT ; ++column ) {
+        if( column>0 ) { g_string_append_c(output, format==DUMP_CSV ? ',' : '\t'); }
+        g_string_append(output, COLUMNS[column].name);
+    }
+    g_string_append_c(output, '\n');
+}
+
+/* writes the records of the worker, records are never split */
+static void
+flush_output(DumpWorker *worker)
+{
+    Dump *dump = worker->dump;
+    if( worker->output->len==0 ) { return; }
+    g_mutex_lock(&dump->output_mutex);
+    fwrite(worker->output->str, 1, worker->output->len, stdout);
+    g_mutex_unlock(&dump->output_mutex);
+    g_string_truncate(worker->output, 0);
+}
+
+
+/*-------------------------------- READERS --------------------------------*/
+
+static void
+on_dump_text_loaded(guint index, const gchar *text, gpointer user_data)
+{
+    DumpWorker *worker = user_data; SDCoreParameters *parameters;
+    const char *values[COLUMN_COUNT] = { NULL }; gchar *valid_text = NULL, *name;
+    guint i, count; int column;
+    
+    g_atomic_int_inc(&worker->dump->files);
+    values[COL_PATH] = worker->paths[index];
+    if( text ) {
+        /* old images can have Latin-1 text chunks */
+        if( !g_utf8_validate(text, -1, NULL) ) { text = valid_text = g_utf8_make_valid(text, -1); }
+        if( worker->parameters ) { sdprompt_core_parameters_parse_into(worker->parameters, text); }
+        else                     { worker->parameters = sdprompt_core_parameters_parse(text); }
+        parameters = worker->parameters;
+        count      = sdprompt_core_parameters_get_network_count(parameters);
+        g_string_truncate(worker->networks, 0);
+        for( i=0 ; i<count ; ++i ) {
+            if( i>0 ) { g_string_append(worker->networks, ", "); }
+            name = sdprompt_core_parameters_dup_network_name(parameters, i);
+            g_string_append(worker->networks, name);
+            g_free(name);
+        }
+        for( column=0 ; column<COLUMN_COUNT ; ++column ) {
+            if( COLUMNS[column].field!=NO_FIELD ) {
+                values[column] = sdprompt_core_parameters_get(parameters, COLUMNS[column].field);
+            }
+        }
+        values[COL_NETWORKS] = count>0 ? worker->networks->str : NULL;
+        g_atomic_int_inc(&worker->dump->with_parameters);
+    }
+    else if( !worker->dump->include_all ) {
+        return;
+    }
+    append_record(worker->output, worker->dump->format, values);
+    g_free(valid_text);
+}
+
+static void
+dump_batch(DumpWorker *worker)
+{
+    int i;
+    if( worker->count==0 ) { return; }
+    sdprompt_core_read_text_batch((const gchar * const *)worker->paths, worker->count,
+                                  on_dump_text_loaded, worker);
+    for( i=0 ; i<worker->count ; ++i ) { g_free(worker->paths[i]); }
+    worker->count = 0;
+    if( worker->output->len >= DUMP_FLUSH_SIZE ) { flush_output(worker); }
+}
+
+static void
+add_file(DumpWorker *worker, gchar *path)
+{
+    worker->paths[worker->count++] = path;
+    if( worker->count==DUMP_BATCH_SIZE ) { dump_batch(worker); }
+}
+
+static gboolean
+is_png_name(const char *name)
+{
+    gsize size = strlen(name);
+    return size>4 && g_ascii_strcasecmp(name+size-4, ".png")==0;
+}
+
+static void
+queue_directory(Dump *dump, gchar *path)
+{
+    g_atomic_int_inc(&dump->pending);
+    g_async_queue_push(dump->directories, path);
+}
+
+/* lists a directory: PNG files are dumped and subdirectories queued */
+static void
+dump_directory(DumpWorker *worker, const gchar *directory)
+{
+    DIR *dir; struct dirent *entry; struct stat st; gchar *path;
+    gboolean is_dir, is_file;
+    
+    dir = opendir(directory);
+    if( !dir ) {
+        fprintf(stderr, "sdprompt-dump: %s: %s\n", directory, g_strerror(errno));
+        return;
+    }
+    while( (entry = readdir(dir)) != NULL ) {
+        if( strcmp(entry->d_name,".")==0 || strcmp(entry->d_name,"..")==0 ) { continue; }
+        is_dir = entry->d_type==DT_DIR || entry->d_type==DT_UNKNOWN;
+        if( !is_dir && !is_png_name(entry->d_name) ) { continue; }
+        path = g_build_filename(directory, entry->d_name, NULL);
+        
+        /* symbolic links to files are followed, to directories they aren't */
+        is_file = entry->d_type==DT_REG;
+        if( entry->d_type==DT_UNKNOWN ) {
+            is_dir  = lstat(path, &st)==0 && S_ISDIR(st.st_mode);
+            is_file = !is_dir && is_png_name(entry->d_name) &&
+                      stat(path, &st)==0 && S_ISREG(st.st_mode);
+        }
+        else if( entry->d_type==DT_LNK ) {
+            is_file = stat(path, &st)==0 && S_ISREG(st.st_mode);
+        }
+        if     ( is_dir  ) { queue_directory(worker->dump, path); }
+        else if( is_file ) { add_file(worker, path); }
+        else               { g_free(path); }
+    }
+    closedir(dir);
+}
+
+static void
+init_worker(DumpWorker *worker, Dump *dump)
+{
+    memset(worker, 0, sizeof(DumpWorker));
+    worker->dump       = dump;
+    worker->output     = g_string_sized_new(DUMP_FLUSH_SIZE + DUMP_FLUSH_SIZE/4);
+    worker->networks   = g_string_new(NULL);
+}
+
+static void
+finish_worker(DumpWorker *worker)
+{
+    dump_batch(worker);
+    flush_output(worker);
+    sdprompt_core_parameters_free(worker->parameters);
+    g_string_free(worker->output, TRUE);
+    g_string_free(worker->networks, TRUE);
+}
+
+static gpointer
+dump_worker(gpointer data)
+{
+    Dump *dump = data; DumpWorker worker; gchar *directory; guint i;
+    
+    init_worker(&worker, dump);
+    while( (directory = g_async_queue_pop(dump->directories)) != DUMP_STOP ) {
+        dump_directory(&worker, directory);
+        g_free(directory);
+        /* the last directory listed stops every worker */
+        if( g_atomic_int_dec_and_test(&dump->pending) ) {
+            for( i=0 ; i<dump->threads ; ++i ) {
+                g_async_queue_push(dump->directories, DUMP_STOP);
+            }
+        }
+    }
+    finish_worker(&worker);
+    return NULL;
+}
+
+
+/*============================ MAIN FUNCTION ==============================*/
+
+int
+main(int argc, char *argv[])
+{
+    Dump dump; DumpWorker worker; GThread **threads; GString *header;
+    gint64 start; gdouble seconds; gboolean stats = FALSE, usage = FALSE;
+    guint i; int arg, paths = 0;
+    
+    memset(&dump, 0, sizeof(Dump));
+    dump.format  = DUMP_JSONL;
+    dump.threads = g_get_num_processors();
+    for( arg=1 ; arg<argc && !usage ; ++arg ) {
+        if     ( strcmp(argv[arg],"--all")==0   ) { dump.include_all = TRUE; }
+        else if( strcmp(argv[arg],"--stats")==0 ) { stats = TRUE; }
+        else if( strcmp(argv[arg],"--threads")==0 && arg+1<argc ) {
+            dump.threads = MAX(1, atoi(argv[++arg]));
+        }
+        else if( strcmp(argv[arg],"--format")==0 && arg+1<argc ) {
+            ++arg;
+            if     ( strcmp(argv[arg],"jsonl")==0 ) { dump.format = DUMP_JSONL; }
+            else if( strcmp(argv[arg],"csv")==0   ) { dump.format = DUMP_CSV;   }
+            else if( strcmp(argv[arg],"tsv")==0   ) { dump.format = DUMP_TSV;   }
+            else { usage = TRUE; }
+        }
+        else if( argv[arg][0]=='-' && argv[arg][1]=='-' ) { usage = TRUE; }
+        else { ++paths; }
+    }
+    if( usage || paths==0 ) {
+        fprintf(stderr, "Usage: %s [--format jsonl|csv|tsv] [--threads N] [--all] [--stats] PATH...\n", argv[0]);
+        return 1;
+    }
+    header = g_string_new(NULL);
+    append_header(header, dump.format);
+    fwrite(header->str, 1, header->len, stdout);
+    g_string_free(header, TRUE);
+    
+    start = g_get_monotonic_time();
+    dump.directories = g_async_queue_new();
+    g_mutex_init(&dump.output_mutex);
+    
+    /*-- directories are listed by the workers, files by the main thread --*/
+    init_worker(&worker, &dump);
+    for( arg=1 ; arg<argc ; ++arg ) {
+        if( strcmp(argv[arg],"--format")==0 || strcmp(argv[arg],"--threads")==0 ) { ++arg; continue; }
+        if( argv[arg][0]=='-' && argv[arg][1]=='-' ) { continue; }
+        if( g_file_test(argv[arg], G_FILE_TEST_IS_DIR) ) {
+            queue_directory(&dump, g_strdup(argv[arg]));
+        } else if( g_file_test(argv[arg], G_FILE_TEST_IS_REGULAR) ) {
+            add_file(&worker, g_strdup(argv[arg]));
+        } else {
+            fprintf(stderr, "sdprompt-dump: %s: No such file or directory\n", argv[arg]);
+        }
+    }
+    if( g_atomic_int_get(&dump.pending)==0 ) {
+        for( i=0 ; i<dump.threads ; ++i ) { g_async_queue_push(dump.directories, DUMP_STOP); }
+    }
+    threads = g_new(GThread *, dump.threads);
+    for( i=0 ; i<dump.threads ; ++i ) {
+        threads[i] = g_thread_new("sdprompt-dump", dump_worker, &dump);
+    }
+    finish_worker(&worker);
+    for( i=0 ; i<dump.threads ; ++i ) { g_thread_join(threads[i]); }
+    fflush(stdout);
+    
+    if( stats ) {
+        seconds = (g_get_monotonic_time() - start) / 1e6;
+        fprintf(stderr, "%d files, %d with parameters, %.3f s, %.0f files/s\n",
+                dump.files, dump.with_parameters, seconds,
+                seconds>0 ? dump.files / seconds : 0.0);
+    }
+    g_free(threads);
+    g_async_queue_unref(dump.directories);
+    g_mutex_clear(&dump.output_mutex);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file    utils_aggregate.h
+ * @brief   Common and distinct generation parameters of a set of images.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    An Aggregate accumulates the parameters of many images: for each field
+    it keeps the distinct values (in the order they were first seen) and
+    how many images have each one, and it keeps the union of the extra
+    networks (LoRAs, embeddings, ...) referenced by the prompts. Fields
+    with a single value are common to all the images; the rest are
+    described by their distinct values, e.g. "40 values: 1234, 1235, ...".
+    
+    An Aggregate is not thread-safe; it is filled by a single thread and
+    described as text, so the strings can be handed to another thread.
+    
+    The fields are listed by the #AggregateField enum, declared in
+    'sdprompt-viewer-selection.h' so the plugin can use the summaries
+    without including this file.
+    
+    NOTE: 'utils_sdparams.h' and 'sdprompt-viewer-selection.h' must be
+          included first.
+*/
+#include <glib.h>
+#if !defined( SD_PARAMETERS_INPUT_SIZE )
+#  error "utils_aggregate.h requires utils_sdparams.h"
+#endif
+#if !defined( __SDPROMPT_VIEWER_SELECTION_H__ )
+#  error "utils_aggregate.h requires sdprompt-viewer-selection.h"
+#endif
+
+/* Maximum number of distinct values listed by aggregate_describe() */
+#define AGGREGATE_MAX_LISTED 8
+
+typedef struct _AggregateValues AggregateValues;
+struct         _AggregateValues {
+    GHashTable *counts;     /* value -> number of images with the value */
+    GPtrArray  *values;     /* distinct values, in order of appearance   */
+    guint       missing;    /* images with parameters but not this field */
+};
+
+typedef struct _Aggregate Aggregate;
+struct         _Aggregate {
+    guint           images;
+    guint           with_parameters;
+    guint           with_hires;
+    guint           with_inpaint;
+    AggregateValues fields[AGGREGATE_FIELD_COUNT];
+    GHashTable     *network_names;  /* set of the names in 'networks' */
+    GPtrArray      *networks;       /* union of the extra networks    */
+};
+
+
+/*------------------------------- BUILDING --------------------------------*/
+
+static Aggregate *
+new_aggregate( void )
+{
+    Aggregate *aggregate = g_new0( Aggregate, 1 ); int field;
+    for( field=0 ; field<AGGREGATE_FIELD_COUNT ; ++field ) {
+        /* the strings are owned by 'values' */
+        aggregate->fields[field].counts = g_hash_table_new( g_str_hash, g_str_equal );
+        aggregate->fields[field].values = g_ptr_array_new_with_free_func( g_free );
+    }
+    aggregate->network_names = g_hash_table_new( g_str_hash, g_str_equal );
+    aggregate->networks      = g_ptr_array_new_with_free_func( g_free );
+    return aggregate;
+}
+
+static void
+free_aggregate( Aggregate *aggregate )
+{
+    int field;
+    if( !aggregate ) { return; }
+    for( field=0 ; field<AGGREGATE_FIELD_COUNT ; ++field ) {
+        g_hash_table_destroy( aggregate->fields[field].counts );
+        g_ptr_array_unref( aggregate->fields[field].values );
+    }
+    g_hash_table_destroy( aggregate->network_names );
+    g_ptr_array_unref( aggregate->networks );
+    g_free( aggregate );
+}
+
+static void
+aggregate_add_value( Aggregate *aggregate, AggregateField field, const char *value )
+{
+    AggregateValues *values = &aggregate->fields[field];
+    gpointer key, count; gchar *copy;
+    
+    if( !value || value[0]=='\0' ) { values->missing++; return; }
+    if( g_hash_table_lookup_extended( values->counts, value, &key, &count ) ) {
+        g_hash_table_insert( values->counts, key,
+                             GUINT_TO_POINTER( GPOINTER_TO_UINT( count ) + 1 ) );
+        return;
+    }
+    copy = g_strdup( value );
+    g_ptr_array_add( values->values, copy );
+    g_hash_table_insert( values->counts, copy, GUINT_TO_POINTER( 1 ) );
+}
+
+static void
+aggregate_add_networks( Aggregate *aggregate, const SDPromptNetworks *networks )
+{
+    gchar *name; int i;
+    for( i=0 ; i<networks->count ; ++i ) {
+        name = g_strndup( networks->networks[i].name, networks->networks[i].name_size );
+        if( g_hash_table_contains( aggregate->network_names, name ) ) { g_free( name ); continue; }
+        g_ptr_array_add( aggregate->networks, name );
+        g_hash_table_add( aggregate->network_names, name );
+    }
+}
+
+/**
+ * Adds the parameters of one image to the aggregate.
+ * @param aggregate   The aggregate to update.
+ * @param parameters  The parsed parameters of the image, or NULL if the
+ *                    image doesn't contain generation parameters.
+ */
+static void
+aggregate_add( Aggregate *aggregate, const SDParameters *parameters )
+{
+    aggregate->images++;
+    if( !parameters ) { return; }
+    aggregate->with_parameters++;
+    if( parameters->hires.has_info   ) { aggregate->with_hires++;   }
+    if( parameters->inpaint.has_info ) { aggregate->with_inpaint++; }
+    aggregate_add_value( aggregate, AGGREGATE_PROMPT           , parameters->prompt            );
+    aggregate_add_value( aggregate, AGGREGATE_NEGATIVE         , parameters->negative_prompt   );
+    aggregate_add_value( aggregate, AGGREGATE_MODEL            , parameters->model.name        );
+    aggregate_add_value( aggregate, AGGREGATE_MODEL_HASH       , parameters->model.hash        );
+    aggregate_add_value( aggregate, AGGREGATE_SAMPLER          , parameters->sampler           );
+    aggregate_add_value( aggregate, AGGREGATE_STEPS            , parameters->steps             );
+    aggregate_add_value( aggregate, AGGREGATE_CFG              , parameters->cfg_scale         );
+    aggregate_add_value( aggregate, AGGREGATE_SEED             , parameters->seed              );
+    aggregate_add_value( aggregate, AGGREGATE_WIDTH            , parameters->width             );
+    aggregate_add_value( aggregate, AGGREGATE_HEIGHT           , parameters->height            );
+    aggregate_add_value( aggregate, AGGREGATE_HIRES_UPSCALER   , parameters->hires.upscaler    );
+    aggregate_add_value( aggregate, AGGREGATE_HIRES_STEPS      , parameters->hires.steps       );
+    aggregate_add_value( aggregate, AGGREGATE_HIRES_DENOISING  , parameters->hires.denoising   );
+    aggregate_add_value( aggregate, AGGREGATE_HIRES_UPSCALE    , parameters->hires.upscale     );
+    aggregate_add_value( aggregate, AGGREGATE_INPAINT_DENOISING, parameters->inpaint.denoising );
+    aggregate_add_value( aggregate, AGGREGATE_INPAINT_MASK_BLUR, parameters->inpaint.mask_blur );
+    aggregate_add_networks( aggregate, &parameters->networks );
+}
+
+
+/*------------------------------ DESCRIBING -------------------------------*/
+
+/**
+ * Describes the values of a field in one line of text.
+ *
+ * A value common to all the images is returned as is; otherwise the text
+ * is the number of distinct values followed by the first 'max_listed' of
+ * them (e.g. "3 values: 7, 7.5, 8"), and by how many images lack the field.
+ * @param aggregate   The aggregate to describe.
+ * @param field       The field to describe.
+ * @param max_listed  Maximum number of values listed, 0 to only count them.
+ * @returns
+ *     A new string to be freed with g_free(), or NULL if no image has
+ *     the field.
+ */
+static gchar *
+aggregate_describe( const Aggregate *aggregate, AggregateField field, guint max_listed )
+{
+    const AggregateValues *values = &aggregate->fields[field];
+    GString *text; guint i, count = values->values->len;
+    
+    if( count==0 ) { return NULL; }
+    if( count==1 && values->missing==0 ) {
+        return g_strdup( g_ptr_array_index( values->values, 0 ) );
+    }
+    text = g_string_new( NULL );
+    g_string_printf( text, count==1 ? "1 value" : "%u values", count );
+    for( i=0 ; i<count && i<max_listed ; ++i ) {
+        g_string_append( text, i==0 ? ": " : ", " );
+        g_string_append( text, g_ptr_array_index( values->values, i ) );
+    }
+    if( count>max_listed && max_listed>0 ) { g_string_append( text, ", …" ); }
+    if( values->missing>0 ) { g_string_append_printf( text, " (%u without it)", values->missing ); }
+    return g_string_free( text, FALSE );
+}
+
+/**
+ * Returns the names of all the extra networks referenced by the images
+ * separated by ", ", or NULL if there aren't any. Free it with g_free().
+ */
+static gchar *
+aggregate_describe_networks( const Aggregate *aggregate )
+{
+    GString *text; guint i;
+    if( aggregate->networks->len==0 ) { return NULL; }
+    text = g_string_new( NULL );
+    for( i=0 ; i<aggregate->networks->len ; ++i ) {
+        if( i>0 ) { g_string_append( text, ", " ); }
+        g_string_append( text, g_ptr_array_index( aggregate->networks, i ) );
+    }
+    return g_string_free( text, FALSE );
+}
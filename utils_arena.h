@@ -0,0 +1,246 @@
+/**
+ * @file    utils_arena.h
+ * @brief   Bump allocators for the data of one image and a pool to recycle them.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Everything parsed from the generation data of an image (the data itself,
+    the parameters, the highlight spans, ...) is allocated from one Arena:
+    a bump allocator that releases all its allocations at once. The arenas
+    are recycled through an ArenaPool, so once the pool is warm loading an
+    image doesn't call malloc() at all.
+    
+    When an arena runs out of space the extra allocations go to overflow
+    blocks; the next reset merges them into a single block big enough for
+    everything, so an arena only grows until it fits the images it holds.
+*/
+#include <string.h>
+#include <glib.h>
+
+#define ARENA_ALIGNMENT     16
+#define ARENA_MIN_CAPACITY  (4*1024)
+#define ARENA_POOL_CAPACITY 32
+#define ARENA_POOL_MAX_KEEP (1024*1024) /* bigger arenas aren't recycled */
+
+typedef struct _ArenaBlock ArenaBlock;
+struct         _ArenaBlock {
+    ArenaBlock *next;
+    gsize       size;
+};
+#define ARENA_BLOCK_HEADER \
+    ((sizeof(ArenaBlock) + ARENA_ALIGNMENT-1) & ~(gsize)(ARENA_ALIGNMENT-1))
+
+typedef struct _Arena Arena;
+struct         _Arena {
+    guint8     *data;           /* main block, kept between resets        */
+    gsize       capacity;
+    gsize       used;
+    ArenaBlock *overflow;       /* blocks allocated when 'data' was full  */
+    gsize       overflow_used;
+};
+
+typedef struct _ArenaPool ArenaPool;
+struct         _ArenaPool {
+    GMutex      mutex;          /* a static pool needs no initialization  */
+    Arena      *arenas[ARENA_POOL_CAPACITY];
+    guint       count;
+};
+
+static gsize
+arena_align( gsize size )
+{
+    return (size + ARENA_ALIGNMENT-1) & ~(gsize)(ARENA_ALIGNMENT-1);
+}
+
+/**
+ * arena_new - Creates an empty arena (its first block is allocated lazily,
+ *             see arena_reserve()).
+ *
+ * Returns: (transfer full): a new #Arena, free it with arena_free().
+ */
+static Arena *
+arena_new( void )
+{
+    return g_new0( Arena, 1 );
+}
+
+static void
+arena_free_overflow( Arena *arena )
+{
+    ArenaBlock *block, *next;
+    for( block = arena->overflow ; block ; block = next ) {
+        next = block->next;
+        g_free( block );
+    }
+    arena->overflow      = NULL;
+    arena->overflow_used = 0;
+}
+
+/**
+ * arena_free - Releases an arena and all the memory allocated from it.
+ */
+static void
+arena_free( Arena *arena )
+{
+    if( !arena ) { return; }
+    arena_free_overflow( arena );
+    g_free( arena->data );
+    g_free( arena );
+}
+
+/**
+ * arena_reset - Releases all the allocations of an arena at once.
+ *
+ * The main block is kept. If overflow blocks were needed, they are freed
+ * and the main block is replaced by one that fits all the allocations.
+ */
+static void
+arena_reset( Arena *arena )
+{
+    gsize needed = arena->used + arena->overflow_used;
+    if( arena->overflow ) {
+        arena_free_overflow( arena );
+        g_free( arena->data );
+        arena->capacity = MAX( needed, ARENA_MIN_CAPACITY );
+        arena->data     = g_malloc( arena->capacity );
+    }
+    arena->used = 0;
+}
+
+/**
+ * arena_reserve - Sizes the first block of an arena.
+ * @arena: the arena.
+ * @size:  the number of bytes expected to be allocated from it.
+ *
+ * Does nothing if the arena already has a block, as a recycled one does.
+ */
+static void
+arena_reserve( Arena *arena, gsize size )
+{
+    if( !arena->data && !arena->overflow ) {
+        arena->capacity = MAX( arena_align( size ), ARENA_MIN_CAPACITY );
+        arena->data     = g_malloc( arena->capacity );
+    }
+}
+
+/**
+ * arena_alloc - Allocates memory from an arena.
+ * @arena: the arena.
+ * @size:  the number of bytes to allocate.
+ *
+ * Returns: memory aligned to %ARENA_ALIGNMENT bytes that is valid until
+ *          the arena is reset or freed; it must not be freed with g_free().
+ */
+static gpointer
+arena_alloc( Arena *arena, gsize size )
+{
+    ArenaBlock *block; guint8 *ptr;
+    size = arena_align( MAX( size, 1 ) );
+    
+    arena_reserve( arena, size );
+    if( arena->used + size <= arena->capacity ) {
+        ptr = arena->data + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+    block = g_malloc( ARENA_BLOCK_HEADER + size );
+    block->next = arena->overflow;
+    block->size = size;
+    arena->overflow       = block;
+    arena->overflow_used += size;
+    return (guint8 *)block + ARENA_BLOCK_HEADER;
+}
+
+static gpointer
+arena_alloc0( Arena *arena, gsize size )
+{
+    return memset( arena_alloc( arena, size ), 0, size );
+}
+
+#define arena_new0(arena, struct_type, n_structs) \
+    ((struct_type *)arena_alloc0( (arena), sizeof(struct_type) * (n_structs) ))
+
+/**
+ * arena_strndup - Copies the first @size bytes of @text to an arena.
+ *
+ * Returns: the copy, always NUL-terminated.
+ */
+static gchar *
+arena_strndup( Arena *arena, const gchar *text, gsize size )
+{
+    gchar *copy = arena_alloc( arena, size+1 );
+    memcpy( copy, text, size );
+    copy[size] = '\0';
+    return copy;
+}
+
+/*------------------------------ ARENA POOL -------------------------------*/
+
+/**
+ * arena_pool_take - Takes a reset arena from the pool.
+ *
+ * Can be called from any thread.
+ *
+ * Returns: (transfer full): an empty arena, a new one if the pool is
+ *          empty. Return it with arena_pool_give().
+ */
+static Arena *
+arena_pool_take( ArenaPool *pool )
+{
+    Arena *arena = NULL;
+    g_mutex_lock( &pool->mutex );
+    if( pool->count>0 ) { arena = pool->arenas[ --pool->count ]; }
+    g_mutex_unlock( &pool->mutex );
+    return arena ? arena : arena_new();
+}
+
+/**
+ * arena_pool_give - Resets an arena and returns it to the pool.
+ *
+ * The arena is freed instead if the pool is full or if it grew over
+ * %ARENA_POOL_MAX_KEEP bytes (a huge ComfyUI workflow, for example).
+ */
+static void
+arena_pool_give( ArenaPool *pool, Arena *arena )
+{
+    if( !arena ) { return; }
+    if( arena->capacity + arena->overflow_used > ARENA_POOL_MAX_KEEP ) {
+        arena_free( arena );
+        return;
+    }
+    arena_reset( arena );
+    g_mutex_lock( &pool->mutex );
+    if( pool->count < ARENA_POOL_CAPACITY ) {
+        pool->arenas[ pool->count++ ] = arena;
+        arena = NULL;
+    }
+    g_mutex_unlock( &pool->mutex );
+    arena_free( arena );
+}
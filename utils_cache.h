@@ -0,0 +1,208 @@
+/**
+ * @file    utils_cache.h
+ * @brief   A small LRU cache of reference-counted values keyed by string.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The cache is not thread-safe. The image cache is only used from the
+    main thread (values are produced by worker threads and inserted when
+    their results arrive); caches shared by worker threads must be protected
+    by a mutex.
+*/
+#include <string.h>
+#include <glib.h>
+
+typedef struct _LRUCacheEntry LRUCacheEntry;
+struct         _LRUCacheEntry {
+    gchar    *key;
+    gsize     key_capacity;
+    gpointer  value;
+    GList     link;        /* position of the entry in 'LRUCache.order' */
+};
+
+typedef struct _LRUCache LRUCache;
+struct         _LRUCache {
+    GHashTable     *table;      /* key -> LRUCacheEntry                */
+    GQueue          order;      /* most recently used entries first    */
+    guint           capacity;
+    GDestroyNotify  free_value; /* releases the reference of the cache */
+    LRUCacheEntry  *spare;      /* last removed entry, reused by insert */
+};
+
+static void
+lru_cache_free_entry( LRUCache *cache, LRUCacheEntry *entry )
+{
+    g_queue_unlink( &cache->order, &entry->link );
+    if( cache->free_value && entry->value ) { cache->free_value( entry->value ); }
+    entry->value = NULL;
+    if( !cache->spare ) { cache->spare = entry; return; }
+    g_free( entry->key );
+    g_free( entry );
+}
+
+/* Returns an entry for 'key', reusing the spare one when there is one, so
+ * a full cache replaces its entries without allocating memory */
+static LRUCacheEntry *
+lru_cache_new_entry( LRUCache *cache, const gchar *key )
+{
+    LRUCacheEntry *entry = cache->spare; gsize size = strlen( key ) + 1;
+    cache->spare = NULL;
+    if( !entry ) { entry = g_new0( LRUCacheEntry, 1 ); }
+    if( entry->key_capacity < size ) {
+        g_free( entry->key );
+        entry->key_capacity = MAX( size, 128 );
+        entry->key          = g_malloc( entry->key_capacity );
+    }
+    memcpy( entry->key, key, size );
+    entry->link.data = entry;
+    entry->link.prev = entry->link.next = NULL;
+    return entry;
+}
+
+/**
+ * lru_cache_new - Creates a new cache.
+ * @capacity:   The maximum number of values kept in the cache.
+ * @free_value: Function used to release a value when it's evicted.
+ *
+ * Returns: (transfer full): a new #LRUCache, free it with lru_cache_free().
+ */
+static LRUCache *
+lru_cache_new( guint capacity, GDestroyNotify free_value )
+{
+    LRUCache *cache   = g_new0( LRUCache, 1 );
+    cache->table      = g_hash_table_new( g_str_hash, g_str_equal );
+    cache->capacity   = MAX( capacity, 1 );
+    cache->free_value = free_value;
+    g_queue_init( &cache->order );
+    return cache;
+}
+
+/**
+ * lru_cache_clear - Removes all the values from the cache.
+ */
+static void
+lru_cache_clear( LRUCache *cache )
+{
+    if( !cache ) { return; }
+    while( cache->order.head ) {
+        LRUCacheEntry *entry = cache->order.head->data;
+        g_hash_table_remove( cache->table, entry->key );
+        lru_cache_free_entry( cache, entry );
+    }
+}
+
+/**
+ * lru_cache_free - Releases the cache and all its values.
+ */
+static void
+lru_cache_free( LRUCache *cache )
+{
+    if( !cache ) { return; }
+    lru_cache_clear( cache );
+    if( cache->spare ) {
+        g_free( cache->spare->key );
+        g_free( cache->spare );
+    }
+    g_hash_table_destroy( cache->table );
+    g_free( cache );
+}
+
+/**
+ * lru_cache_lookup - Returns the value stored with @key.
+ *
+ * The value is marked as the most recently used one.
+ *
+ * Returns: (transfer none): the value, or %NULL if it's not in the cache.
+ */
+static gpointer
+lru_cache_lookup( LRUCache *cache, const gchar *key )
+{
+    LRUCacheEntry *entry;
+    entry = (cache && key) ? g_hash_table_lookup( cache->table, key ) : NULL;
+    if( !entry ) { return NULL; }
+    g_queue_unlink( &cache->order, &entry->link );
+    g_queue_push_head_link( &cache->order, &entry->link );
+    return entry->value;
+}
+
+/**
+ * lru_cache_insert - Stores a value in the cache.
+ * @cache: The cache.
+ * @key:   The key of the value (it's copied).
+ * @value: (transfer full): The value to store.
+ *
+ * If @key is already in the cache, its old value is replaced. If the cache
+ * is full, the least recently used value is evicted.
+ */
+static void
+lru_cache_insert( LRUCache *cache, const gchar *key, gpointer value )
+{
+    LRUCacheEntry *entry;
+    g_return_if_fail( cache && key );
+    
+    entry = g_hash_table_lookup( cache->table, key );
+    if( entry ) {
+        g_hash_table_remove( cache->table, entry->key );
+        lru_cache_free_entry( cache, entry );
+    }
+    while( cache->order.length >= cache->capacity ) {
+        entry = cache->order.tail->data;
+        g_hash_table_remove( cache->table, entry->key );
+        lru_cache_free_entry( cache, entry );
+    }
+    entry        = lru_cache_new_entry( cache, key );
+    entry->value = value;
+    g_queue_push_head_link( &cache->order, &entry->link );
+    g_hash_table_insert( cache->table, entry->key, entry );
+}
+
+/**
+ * lru_cache_evict_value - Makes room for one value when the cache is full.
+ *
+ * Removes the least recently used entry, if the cache is full, without
+ * releasing its value, so that the caller can overwrite and insert it
+ * again instead of allocating a new one.
+ *
+ * Returns: (transfer full) (nullable): the evicted value, or %NULL if the
+ *          cache isn't full.
+ */
+static gpointer
+lru_cache_evict_value( LRUCache *cache )
+{
+    LRUCacheEntry *entry; gpointer value;
+    if( !cache || cache->order.length < cache->capacity ) { return NULL; }
+    entry = cache->order.tail->data;
+    value = entry->value;
+    entry->value = NULL;
+    g_hash_table_remove( cache->table, entry->key );
+    lru_cache_free_entry( cache, entry );
+    return value;
+}
+
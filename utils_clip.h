@@ -0,0 +1,528 @@
+/**
+ * @file    utils_clip.h
+ * @brief   A CLIP BPE tokenizer that counts prompt tokens as A1111 does.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The tokenizer reproduces the byte-level BPE of the CLIP text encoder
+    (lowercase, split into words, byte-encode each word and apply the
+    merges in rank order) and then groups the tokens into the 75-token
+    chunks used by A1111, including BREAK and the comma backtracking.
+    
+    Only the merges are needed to count tokens: the vocabulary of CLIP is
+    the 256 byte symbols, the same 256 symbols ending a word ('</w>') and
+    one symbol per merge, so the id of a merged symbol is 512 + its rank.
+    The merges are read once from the GResource (where they are stored
+    uncompressed, so they are used directly from the mapped library) and
+    kept in an open-addressing hash table keyed by the pair of symbols.
+    
+    Limitations: prompt scheduling ("[a:b:0.5]") counts both alternatives,
+    embeddings count as the text of their name and wildcards are not
+    expanded, so the count is exact only for plain prompts.
+    
+    NOTE: 'utils_sdprompt.h' and 'utils_cache.h' must be included first.
+*/
+#include <glib.h>
+#include <gio/gio.h>
+#if !defined( SD_PROMPT_MAX_TOKENS )
+#  error "utils_clip.h requires utils_sdprompt.h"
+#endif
+
+/* Number of tokens in each chunk (77 minus the start and end tokens) */
+#define CLIP_CHUNK_SIZE 75
+
+/* Number of merges used by CLIP (49408 - 2*256 - 2 special tokens) */
+#define CLIP_MERGES_COUNT 48894
+
+/* Maximum distance to the last comma when splitting a full chunk */
+#define CLIP_COMMA_BACKTRACK 20
+
+/* Maximum number of chunk boundaries reported for a single prompt */
+#define CLIP_MAX_BOUNDARIES 32
+
+/* Words longer than this (in bytes) are tokenized in pieces */
+#define CLIP_MAX_WORD_SIZE 256
+
+/* Number of prompts whose token count is kept in memory */
+#define CLIP_CACHE_CAPACITY 256
+
+#define CLIP_HASH_BITS 17
+#define CLIP_NO_RANK   0xFFFFFFFFu
+#define CLIP_EMPTY_KEY G_MAXUINT64
+#define CLIP_COMMA     (256 + ',')
+
+typedef struct _ClipBoundary ClipBoundary;
+struct         _ClipBoundary {
+    unsigned int start;     /* byte offset of the first token of a chunk */
+    unsigned int end;       /* byte offset where that token ends         */
+};
+
+typedef struct _ClipCount ClipCount;
+struct         _ClipCount {
+    int          tokens;      /* token count as reported by A1111       */
+    int          chunks;      /* number of 75-token chunks              */
+    int          boundaries;  /* number of elements in 'boundary'       */
+    ClipBoundary boundary[CLIP_MAX_BOUNDARIES];
+};
+
+typedef struct _ClipTokenizer ClipTokenizer;
+struct         _ClipTokenizer {
+    guint64  *keys;          /* (left << 32 | right), CLIP_EMPTY_KEY if unused */
+    guint32  *ranks;
+    guint32   mask;
+    GMutex    mutex;         /* protects 'cache'                        */
+    LRUCache *cache;         /* prompt -> ClipCount                     */
+};
+
+
+/*------------------------------- MERGES ----------------------------------*/
+
+static guint32
+clip_hash_slot( const ClipTokenizer *clip, guint64 key )
+{
+    return (guint32)( (key * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15))
+                      >> (64 - CLIP_HASH_BITS) ) & clip->mask;
+}
+
+static guint32
+clip_merge_rank( const ClipTokenizer *clip, guint32 left, guint32 right )
+{
+    guint64 key = ((guint64)left << 32) | right;
+    guint32 slot = clip_hash_slot( clip, key );
+    while( clip->keys[slot]!=CLIP_EMPTY_KEY ) {
+        if( clip->keys[slot]==key ) { return clip->ranks[slot]; }
+        slot = (slot + 1) & clip->mask;
+    }
+    return CLIP_NO_RANK;
+}
+
+static void
+clip_add_merge( ClipTokenizer *clip, guint32 left, guint32 right, guint32 rank )
+{
+    guint64 key = ((guint64)left << 32) | right;
+    guint32 slot = clip_hash_slot( clip, key );
+    while( clip->keys[slot]!=CLIP_EMPTY_KEY && clip->keys[slot]!=key ) {
+        slot = (slot + 1) & clip->mask;
+    }
+    clip->keys[slot]  = key;
+    clip->ranks[slot] = rank;
+}
+
+/* The GPT-2 byte encoder: maps each byte to a printable unicode char */
+static void
+clip_make_byte_encoder( gunichar encoder[256] )
+{
+    int byte, n = 0;
+    for( byte=0 ; byte<256 ; ++byte ) {
+        if( (byte>='!' && byte<='~') || (byte>=0xA1 && byte<=0xAC) ||
+            (byte>=0xAE && byte<=0xFF) )
+        { encoder[byte] = byte; }
+        else
+        { encoder[byte] = 256 + n++; }
+    }
+}
+
+/* Builds the merge table from the text of 'bpe_simple_vocab_16e6.txt' */
+static gboolean
+clip_load_merges( ClipTokenizer *clip, const char *ptr, const char *end )
+{
+    GHashTable *symbols; gunichar encoder[256]; char utf8[8+4];
+    const char *line_end, *space; gchar *left, *right; int byte, len;
+    guint32 rank = 0; gpointer left_id, right_id;
+    
+    symbols = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, NULL );
+    clip_make_byte_encoder( encoder );
+    for( byte=0 ; byte<256 ; ++byte ) {
+        len = g_unichar_to_utf8( encoder[byte], utf8 );
+        utf8[len] = '\0';
+        g_hash_table_insert( symbols, g_strdup( utf8 ), GUINT_TO_POINTER(byte+1) );
+        strcpy( &utf8[len], "</w>" );
+        g_hash_table_insert( symbols, g_strdup( utf8 ), GUINT_TO_POINTER(256+byte+1) );
+    }
+    /* skip the "#version" line and read the merges ("left right") */
+    line_end = memchr( ptr, '\n', end-ptr );
+    ptr = line_end ? line_end+1 : end;
+    while( ptr<end && rank<CLIP_MERGES_COUNT ) {
+        line_end = memchr( ptr, '\n', end-ptr );
+        if( !line_end ) { line_end = end; }
+        space = memchr( ptr, ' ', line_end-ptr );
+        if( space ) {
+            left     = g_strndup( ptr, space-ptr );
+            right    = g_strndup( space+1, line_end-(space+1) );
+            left_id  = g_hash_table_lookup( symbols, left  );
+            right_id = g_hash_table_lookup( symbols, right );
+            if( left_id && right_id ) {
+                clip_add_merge( clip, GPOINTER_TO_UINT(left_id)-1,
+                                GPOINTER_TO_UINT(right_id)-1, rank );
+                g_hash_table_insert( symbols, g_strconcat( left, right, NULL ),
+                                     GUINT_TO_POINTER(512+rank+1) );
+            }
+            g_free( left ); g_free( right );
+            ++rank;
+        }
+        ptr = line_end+1;
+    }
+    g_hash_table_destroy( symbols );
+    return rank==CLIP_MERGES_COUNT;
+}
+
+
+/*------------------------------ TOKENIZER --------------------------------*/
+
+static void
+free_clip_count( gpointer count )
+{
+    g_free( count );
+}
+
+/**
+ * clip_tokenizer_new_from_data - Creates a CLIP tokenizer.
+ * @data:           the content of the merges file.
+ * @size:           the number of bytes in @data.
+ * @cache_capacity: the number of token counts cached.
+ *
+ * Returns: (transfer full): the tokenizer, or %NULL if @data doesn't
+ *          contain valid merges.
+ */
+static ClipTokenizer *
+clip_tokenizer_new_from_data( const char *data, gsize size, guint cache_capacity )
+{
+    ClipTokenizer *clip; guint32 slots = 1u << CLIP_HASH_BITS, i;
+    
+    clip        = g_new0( ClipTokenizer, 1 );
+    clip->keys  = g_new( guint64, slots );
+    clip->ranks = g_new( guint32, slots );
+    clip->mask  = slots - 1;
+    for( i=0 ; i<slots ; ++i ) { clip->keys[i] = CLIP_EMPTY_KEY; }
+    if( !clip_load_merges( clip, data, data+size ) ) {
+        g_free( clip->keys ); g_free( clip->ranks ); g_free( clip );
+        return NULL;
+    }
+    g_mutex_init( &clip->mutex );
+    clip->cache = lru_cache_new( cache_capacity, free_clip_count );
+    return clip;
+}
+
+/**
+ * get_clip_tokenizer - Returns the shared CLIP tokenizer.
+ * @resource_path: path of the merges file inside the GResource.
+ *
+ * The merges are loaded the first time this function is called, which
+ * takes a few milliseconds, so it's better to call it from a worker thread.
+ * It's safe to call it from any thread.
+ *
+ * Returns: (transfer none): the tokenizer, or %NULL if the merges couldn't
+ *          be loaded.
+ */
+static ClipTokenizer *
+get_clip_tokenizer( const gchar *resource_path )
+{
+    static gsize initialized = 0; static ClipTokenizer *tokenizer = NULL;
+    GBytes *bytes; const char *data; gsize size;
+    
+    if( g_once_init_enter( &initialized ) ) {
+        bytes = g_resources_lookup_data( resource_path,
+                                         G_RESOURCE_LOOKUP_FLAGS_NONE, NULL );
+        if( bytes ) {
+            data      = g_bytes_get_data( bytes, &size );
+            tokenizer = clip_tokenizer_new_from_data( data, size, CLIP_CACHE_CAPACITY );
+            g_bytes_unref( bytes );
+        }
+        g_once_init_leave( &initialized, 1 );
+    }
+    return tokenizer;
+}
+
+/* Applies the BPE merges to a word, returns the number of symbols */
+static int
+clip_bpe( const ClipTokenizer *clip,
+          const unsigned char *word, int size,
+          guint32 *symbols, unsigned short *lengths )
+{
+    guint32 best, rank, left, right; int i, j, count = size;
+    
+    for( i=0 ; i<size ; ++i ) { symbols[i] = word[i]; lengths[i] = 1; }
+    symbols[size-1] += 256;
+    while( count>1 ) {
+        best = CLIP_NO_RANK; left = right = 0;
+        for( i=0 ; i<count-1 ; ++i ) {
+            rank = clip_merge_rank( clip, symbols[i], symbols[i+1] );
+            if( rank<best ) { best = rank; left = symbols[i]; right = symbols[i+1]; }
+        }
+        if( best==CLIP_NO_RANK ) { break; }
+        for( i=j=0 ; i<count ; ++j ) {
+            if( i<count-1 && symbols[i]==left && symbols[i+1]==right ) {
+                symbols[j] = 512 + best;
+                lengths[j] = lengths[i] + lengths[i+1];
+                i += 2;
+            } else {
+                symbols[j] = symbols[i];
+                lengths[j] = lengths[i];
+                i += 1;
+            }
+        }
+        count = j;
+    }
+    return count;
+}
+
+typedef enum _ClipCharClass { CLIP_SPACE, CLIP_LETTER, CLIP_NUMBER, CLIP_OTHER } ClipCharClass;
+
+static ClipCharClass
+clip_char_class( const char *ptr, gunichar *out_char )
+{
+    gunichar ch; GUnicodeType type;
+    if( (unsigned char)*ptr < 0x80 ) {
+        ch = (*out_char) = g_ascii_tolower( *ptr );
+        if( g_ascii_isspace( ch ) ) { return CLIP_SPACE;  }
+        if( g_ascii_isalpha( ch ) ) { return CLIP_LETTER; }
+        if( g_ascii_isdigit( ch ) ) { return CLIP_NUMBER; }
+        return CLIP_OTHER;
+    }
+    ch = g_utf8_get_char( ptr );
+    (*out_char) = g_unichar_tolower( ch );
+    if( g_unichar_isspace( ch ) ) { return CLIP_SPACE;  }
+    if( g_unichar_isalpha( ch ) ) { return CLIP_LETTER; }
+    type = g_unichar_type( ch );
+    if( type==G_UNICODE_DECIMAL_NUMBER || type==G_UNICODE_LETTER_NUMBER ||
+        type==G_UNICODE_OTHER_NUMBER ) { return CLIP_NUMBER; }
+    return CLIP_OTHER;
+}
+
+/* Returns the size of a contraction ('s 't 're 've 'm 'll 'd) or 0 */
+static int
+clip_contraction_size( const char *ptr, const char *end )
+{
+    char c1 = (ptr+1<end) ? g_ascii_tolower( ptr[1] ) : 0;
+    char c2 = (ptr+2<end) ? g_ascii_tolower( ptr[2] ) : 0;
+    if( c1=='s' || c1=='t' || c1=='m' || c1=='d' ) { return 2; }
+    if( (c1=='r' && c2=='e') || (c1=='v' && c2=='e') ||
+        (c1=='l' && c2=='l') ) { return 3; }
+    return 0;
+}
+
+/**
+ * Reads the next word of the text as the CLIP pre-tokenizer would split it.
+ * The word is stored lowercased in 'word' and '*inout_ptr' is advanced to
+ * the end of the word. Returns the size of the word, or 0 at the end.
+ */
+static int
+clip_next_word( const char **inout_ptr, const char *end,
+                unsigned char *word, const char **out_start )
+{
+    const char *ptr = (*inout_ptr); ClipCharClass class, first;
+    gunichar ch; int size = 0, len;
+    
+    while( ptr<end && clip_char_class( ptr, &ch )==CLIP_SPACE ) {
+        ptr = g_utf8_next_char( ptr );
+    }
+    (*out_start) = ptr;
+    if( ptr>=end ) { (*inout_ptr) = end; return 0; }
+    
+    if( *ptr=='\'' && (len = clip_contraction_size( ptr, end ))>0 ) {
+        for( ; size<len ; ++size ) { word[size] = g_ascii_tolower( ptr[size] ); }
+        (*inout_ptr) = ptr + len;
+        return size;
+    }
+    first = clip_char_class( ptr, &ch );
+    while( ptr<end ) {
+        class = clip_char_class( ptr, &ch );
+        if( class!=first || class==CLIP_SPACE ) { break; }
+        if( size + 6 > CLIP_MAX_WORD_SIZE ) { break; }
+        size += g_unichar_to_utf8( ch, (char *)&word[size] );
+        ptr = g_utf8_next_char( ptr );
+        if( first==CLIP_NUMBER ) { break; }
+    }
+    (*inout_ptr) = ptr;
+    return size;
+}
+
+
+/*------------------------------- CHUNKS ----------------------------------*/
+
+typedef struct _ClipChunker ClipChunker;
+struct         _ClipChunker {
+    ClipCount   *count;
+    int          length;        /* tokens in the current chunk   */
+    int          last_comma;    /* index of the last comma or -1 */
+    ClipBoundary tokens[CLIP_CHUNK_SIZE];
+};
+
+static void
+clip_add_boundary( ClipChunker *chunker, const ClipBoundary *token )
+{
+    ClipCount *count = chunker->count;
+    if( count->boundaries<CLIP_MAX_BOUNDARIES ) {
+        count->boundary[ count->boundaries++ ] = (*token);
+    }
+}
+
+static void
+clip_next_chunk( ClipChunker *chunker, int is_last )
+{
+    chunker->count->tokens += is_last ? chunker->length : CLIP_CHUNK_SIZE;
+    chunker->count->chunks += 1;
+    chunker->length     = 0;
+    chunker->last_comma = -1;
+}
+
+/* Adds a token to the current chunk following the rules of A1111 */
+static void
+clip_add_token( ClipChunker *chunker, guint32 symbol,
+                unsigned int start, unsigned int end )
+{
+    int split, moved;
+    
+    if( symbol==CLIP_COMMA ) {
+        chunker->last_comma = chunker->length;
+    }
+    else if( chunker->length==CLIP_CHUNK_SIZE && chunker->last_comma!=-1 &&
+             chunker->length - chunker->last_comma <= CLIP_COMMA_BACKTRACK )
+    {
+        /* the chunk is full: move the tokens after the last comma */
+        split = chunker->last_comma + 1;
+        moved = chunker->length - split;
+        chunker->length = split;
+        clip_next_chunk( chunker, FALSE );
+        if( moved>0 ) {
+            memmove( chunker->tokens, &chunker->tokens[split],
+                     moved * sizeof(ClipBoundary) );
+            chunker->length = moved;
+            clip_add_boundary( chunker, &chunker->tokens[0] );
+        }
+    }
+    if( chunker->length==CLIP_CHUNK_SIZE ) {
+        clip_next_chunk( chunker, FALSE );
+    }
+    chunker->tokens[ chunker->length ].start = start;
+    chunker->tokens[ chunker->length ].end   = end;
+    if( chunker->length==0 && chunker->count->chunks>0 ) {
+        clip_add_boundary( chunker, &chunker->tokens[0] );
+    }
+    chunker->length++;
+}
+
+static void
+clip_tokenize_text( const ClipTokenizer *clip, ClipChunker *chunker,
+                    const char *text, int start, int end )
+{
+    unsigned char word[CLIP_MAX_WORD_SIZE]; guint32 symbols[CLIP_MAX_WORD_SIZE];
+    unsigned short lengths[CLIP_MAX_WORD_SIZE];
+    const char *ptr = text+start, *word_start; unsigned int offset, word_end;
+    int size, count, i;
+    
+    while( (size = clip_next_word( &ptr, text+end, word, &word_start ))>0 ) {
+        count    = clip_bpe( clip, word, size, symbols, lengths );
+        offset   = word_start - text;
+        word_end = ptr - text;
+        for( i=0 ; i<count ; ++i ) {
+            /* offsets inside the word are exact for ASCII text only */
+            clip_add_token( chunker, symbols[i], MIN( offset, word_end ),
+                            MIN( offset+lengths[i], word_end ) );
+            offset += lengths[i];
+        }
+    }
+}
+
+/**
+ * count_clip_tokens - Counts the CLIP tokens of a prompt.
+ * @clip:   the tokenizer returned by get_clip_tokenizer().
+ * @count:  the #ClipCount that receives the result.
+ * @tokens: the tokens of @text produced by tokenize_sd_prompt().
+ * @text:   the prompt.
+ *
+ * The attention syntax and the extra networks are removed before counting
+ * and each BREAK starts a new chunk, as A1111 does. Results are cached by
+ * prompt text, so this is only a lookup for prompts already seen. It's
+ * safe to call it from any thread.
+ */
+static void
+count_clip_tokens( ClipTokenizer        *clip,
+                   ClipCount            *count,
+                   const SDPromptTokens *tokens,
+                   const char           *text )
+{
+    ClipChunker chunker; const SDPromptToken *token; ClipCount *cached;
+    int i, pos = 0;
+    
+    memset( count, 0, sizeof(ClipCount) );
+    if( !clip || !text ) { return; }
+    
+    g_mutex_lock( &clip->mutex );
+    cached = lru_cache_lookup( clip->cache, text );
+    if( cached ) { (*count) = (*cached); }
+    g_mutex_unlock( &clip->mutex );
+    if( cached ) { return; }
+    
+    chunker.count      = count;
+    chunker.length     = 0;
+    chunker.last_comma = -1;
+    for( i=0 ; i<tokens->count ; ++i ) {
+        token = &tokens->tokens[i];
+        switch( token->type ) {
+            case SD_TOKEN_OPEN:   case SD_TOKEN_CLOSE:
+            case SD_TOKEN_WEIGHT: case SD_TOKEN_SEPARATOR:
+            case SD_TOKEN_NETWORK:
+                clip_tokenize_text( clip, &chunker, text, pos, token->start );
+                pos = token->start + token->size;
+                break;
+            case SD_TOKEN_BREAK:
+                clip_tokenize_text( clip, &chunker, text, pos, token->start );
+                clip_next_chunk( &chunker, FALSE );
+                pos = token->start + token->size;
+                break;
+        }
+    }
+    clip_tokenize_text( clip, &chunker, text, pos, strlen( text ) );
+    if( chunker.length>0 || count->chunks==0 ) {
+        clip_next_chunk( &chunker, TRUE );
+    }
+    
+    /* a full cache gives back its oldest count to be overwritten */
+    g_mutex_lock( &clip->mutex );
+    cached = lru_cache_evict_value( clip->cache );
+    if( !cached ) { cached = g_new( ClipCount, 1 ); }
+    (*cached) = (*count);
+    lru_cache_insert( clip->cache, text, cached );
+    g_mutex_unlock( &clip->mutex );
+}
+
+/**
+ * clip_token_limit - Returns the limit displayed next to a token count.
+ * @tokens: the number of tokens.
+ *
+ * This is the capacity of the chunks used by the prompt (75, 150, ...),
+ * so a count is shown as "80/150" like A1111 does.
+ */
+static int
+clip_token_limit( int tokens )
+{
+    return ((MAX( tokens, 1 ) + CLIP_CHUNK_SIZE - 1) / CLIP_CHUNK_SIZE) * CLIP_CHUNK_SIZE;
+}
@@ -0,0 +1,657 @@
+/**
+ * @file    utils_comfyui.h
+ * @brief   Extracts SD parameters from the ComfyUI node graph in bare C code.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    ComfyUI stores the executed node graph in the 'prompt' tEXt chunk as a
+    JSON object where each key is a node id:
+    
+      { "3": { "class_type": "KSampler",
+               "inputs": { "seed": 42, "steps": 20, "cfg": 7,
+                           "model": ["4",0], "positive": ["6",0], ... } },
+        "4": { "class_type": "CheckpointLoaderSimple",
+               "inputs": { "ckpt_name": "model.safetensors" } },
+        ... }
+    
+    The graph is walked with the tokenizer in utils_json.h and only the
+    inputs relevant to the sidebar are recorded (as slices of the original
+    text) in a fixed-size table, so the working set is bounded no matter
+    how big the graph is. The table is allocated once per thread and kept
+    until the thread exits, so parsing a graph doesn't allocate. Then the links are followed from the sampler node
+    to its prompts, checkpoint, LoRAs and latent image, and the resulting
+    values are copied into the 'input' buffer of SDParameters.
+    
+    NOTE: 'utils_json.h' and 'utils_sdparams.h' must be included first.
+*/
+#include <glib.h>
+#if !defined( SD_PARAMETERS_INPUT_SIZE ) || !defined( JSON_MAX_DEPTH )
+#  error "utils_comfyui.h requires utils_sdparams.h and utils_json.h"
+#endif
+
+/* Maximum number of nodes recorded from the graph */
+#define COMFYUI_MAX_NODES  512
+
+/* Maximum number of recorded inputs per node */
+#define COMFYUI_MAX_INPUTS 12
+
+/* Maximum number of nodes followed when resolving a link chain */
+#define COMFYUI_MAX_HOPS   32
+
+typedef enum _ComfyUIInputName ComfyUIInputName;
+enum         _ComfyUIInputName {
+    COMFYUI_IN_NONE,
+    COMFYUI_IN_SEED, COMFYUI_IN_NOISE_SEED, COMFYUI_IN_STEPS, COMFYUI_IN_CFG,
+    COMFYUI_IN_SAMPLER_NAME, COMFYUI_IN_SCHEDULER, COMFYUI_IN_DENOISE,
+    COMFYUI_IN_MODEL, COMFYUI_IN_CLIP, COMFYUI_IN_POSITIVE, COMFYUI_IN_NEGATIVE,
+    COMFYUI_IN_LATENT_IMAGE, COMFYUI_IN_SAMPLES, COMFYUI_IN_PIXELS,
+    COMFYUI_IN_TEXT, COMFYUI_IN_TEXT_G, COMFYUI_IN_STRING,
+    COMFYUI_IN_CONDITIONING, COMFYUI_IN_CONDITIONING_1,
+    COMFYUI_IN_CKPT_NAME, COMFYUI_IN_UNET_NAME,
+    COMFYUI_IN_LORA_NAME, COMFYUI_IN_STRENGTH_MODEL,
+    COMFYUI_IN_WIDTH, COMFYUI_IN_HEIGHT, COMFYUI_IN_SCALE_BY,
+    COMFYUI_IN_UPSCALE_METHOD, COMFYUI_IN_STOP_AT_CLIP_LAYER,
+    COMFYUI_IN_COUNT
+};
+
+/* names of the inputs, in the same order as ComfyUIInputName */
+static const char *COMFYUI_INPUT_NAMES[COMFYUI_IN_COUNT] = {
+    "",
+    "seed", "noise_seed", "steps", "cfg",
+    "sampler_name", "scheduler", "denoise",
+    "model", "clip", "positive", "negative",
+    "latent_image", "samples", "pixels",
+    "text", "text_g", "string",
+    "conditioning", "conditioning_1",
+    "ckpt_name", "unet_name",
+    "lora_name", "strength_model",
+    "width", "height", "scale_by",
+    "upscale_method", "stop_at_clip_layer"
+};
+
+typedef enum _ComfyUIValueType ComfyUIValueType;
+enum         _ComfyUIValueType {
+    COMFYUI_VALUE_STRING,
+    COMFYUI_VALUE_NUMBER,
+    COMFYUI_VALUE_LINK     /* 'start/size' is the id of the linked node */
+};
+
+typedef struct _ComfyUIInput ComfyUIInput;
+struct         _ComfyUIInput {
+    unsigned char name;          /* ComfyUIInputName */
+    unsigned char type;          /* ComfyUIValueType */
+    unsigned char has_escapes;
+    int           start;         /* offset of the value in the JSON text */
+    int           size;
+};
+
+typedef struct _ComfyUINode ComfyUINode;
+struct         _ComfyUINode {
+    int          id_start, id_size;
+    int          class_start, class_size;
+    int          inputs_count;
+    ComfyUIInput inputs[COMFYUI_MAX_INPUTS];
+};
+
+typedef struct _ComfyUIGraph ComfyUIGraph;
+struct         _ComfyUIGraph {
+    const char  *text;
+    int          nodes_count;
+    ComfyUINode  nodes[COMFYUI_MAX_NODES];
+    
+    /* string pool (points into SDParameters 'input') */
+    char *pool;
+    int   pool_used;
+};
+
+/* the table of the current thread, too big for its stack */
+static GPrivate comfyui_graph = G_PRIVATE_INIT(g_free);
+
+
+/*---------------------------- READING THE GRAPH ----------------------------*/
+
+static ComfyUIInputName
+comfyui_input_name(const JSONToken *key)
+{
+    int i;
+    for( i=1 ; i<COMFYUI_IN_COUNT ; ++i ) {
+        if( json_token_equals( key, COMFYUI_INPUT_NAMES[i] ) ) {
+            return (ComfyUIInputName)i;
+        }
+    }
+    return COMFYUI_IN_NONE;
+}
+
+static int
+comfyui_read_inputs(ComfyUIGraph  *graph,
+                    ComfyUINode   *node,
+                    JSONTokenizer *tokenizer)
+{
+    JSONToken key, value, link; ComfyUIInput *input; ComfyUIInputName name;
+    const int depth = tokenizer->depth;
+    
+    while( next_json_token( tokenizer, &key ) && key.type==JSON_KEY ) {
+        if( !next_json_token( tokenizer, &value ) ) { return 0; }
+        name = comfyui_input_name( &key );
+        if( name==COMFYUI_IN_NONE || node->inputs_count>=COMFYUI_MAX_INPUTS ) {
+            if( !skip_json_value( tokenizer, &value ) ) { return 0; }
+            continue;
+        }
+        input = &node->inputs[ node->inputs_count ];
+        input->name        = (unsigned char)name;
+        input->has_escapes = (unsigned char)value.has_escapes;
+        input->start       = (int)(value.start - graph->text);
+        input->size        = value.size;
+        
+        if( value.type==JSON_STRING ) {
+            input->type = COMFYUI_VALUE_STRING;
+            node->inputs_count++;
+        }
+        else if( value.type==JSON_NUMBER ) {
+            input->type = COMFYUI_VALUE_NUMBER;
+            node->inputs_count++;
+        }
+        else if( value.type==JSON_ARRAY_BEGIN ) {
+            /* a link is encoded as: [ "<node_id>", <output_slot> ] */
+            if( next_json_token( tokenizer, &link ) && link.type==JSON_STRING ) {
+                input->type  = COMFYUI_VALUE_LINK;
+                input->start = (int)(link.start - graph->text);
+                input->size  = link.size;
+                node->inputs_count++;
+            }
+            while( tokenizer->depth>=value.depth ) {
+                if( !next_json_token( tokenizer, &link ) ) { return 0; }
+                if( !skip_json_value( tokenizer, &link ) ) { return 0; }
+            }
+        }
+        else if( !skip_json_value( tokenizer, &value ) ) { return 0; }
+    }
+    return tokenizer->depth==depth-1;
+}
+
+static int
+comfyui_read_node(ComfyUIGraph  *graph,
+                  const JSONToken *id,
+                  JSONTokenizer *tokenizer)
+{
+    JSONToken key, value; ComfyUINode *node;
+    
+    node = &graph->nodes[ graph->nodes_count ];
+    node->id_start     = (int)(id->start - graph->text);
+    node->id_size      = id->size;
+    node->class_start  = 0;
+    node->class_size   = 0;
+    node->inputs_count = 0;
+    
+    while( next_json_token( tokenizer, &key ) && key.type==JSON_KEY ) {
+        if( !next_json_token( tokenizer, &value ) ) { return 0; }
+        if( json_token_equals( &key, "class_type" ) && value.type==JSON_STRING ) {
+            node->class_start = (int)(value.start - graph->text);
+            node->class_size  = value.size;
+        }
+        else if( json_token_equals( &key, "inputs" ) && value.type==JSON_OBJECT_BEGIN ) {
+            if( !comfyui_read_inputs( graph, node, tokenizer ) ) { return 0; }
+        }
+        else if( !skip_json_value( tokenizer, &value ) ) { return 0; }
+    }
+    /* nodes without any interesting input are not recorded,  */
+    /* the last slot of the table is kept as scratch space     */
+    if( node->class_size>0 && node->inputs_count>0 &&
+        graph->nodes_count < COMFYUI_MAX_NODES-1 ) {
+        graph->nodes_count++;
+    }
+    return 1;
+}
+
+static int
+comfyui_read_graph(ComfyUIGraph *graph, const char *text, int text_size)
+{
+    JSONTokenizer tokenizer; JSONToken token, id;
+    
+    graph->text        = text;
+    graph->nodes_count = 0;
+    init_json_tokenizer( &tokenizer, text, text_size );
+    if( !next_json_token( &tokenizer, &token ) ||
+        token.type!=JSON_OBJECT_BEGIN ) { return 0; }
+    
+    while( next_json_token( &tokenizer, &id ) && id.type==JSON_KEY ) {
+        if( !next_json_token( &tokenizer, &token ) ) { return 0; }
+        if( token.type==JSON_OBJECT_BEGIN ) {
+            if( !comfyui_read_node( graph, &id, &tokenizer ) ) { return 0; }
+        }
+        else if( !skip_json_value( &tokenizer, &token ) ) { return 0; }
+    }
+    return !tokenizer.error && graph->nodes_count>0;
+}
+
+/*--------------------------- WALKING THE GRAPH -----------------------------*/
+
+static int
+comfyui_class_is(const ComfyUIGraph *graph,
+                 const ComfyUINode  *node,
+                 const char         *class_name)
+{
+    int size = strlen( class_name );
+    return node->class_size==size &&
+           memcmp( &graph->text[node->class_start], class_name, size )==0;
+}
+
+static int
+comfyui_class_contains(const ComfyUIGraph *graph,
+                       const ComfyUINode  *node,
+                       const char         *substring)
+{
+    int i, size = strlen( substring );
+    for( i=0 ; i+size<=node->class_size ; ++i ) {
+        if( memcmp( &graph->text[node->class_start+i], substring, size )==0 ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const ComfyUIInput *
+comfyui_input(const ComfyUINode *node, ComfyUIInputName name)
+{
+    int i;
+    if( !node ) { return NULL; }
+    for( i=0 ; i<node->inputs_count ; ++i ) {
+        if( node->inputs[i].name==name ) { return &node->inputs[i]; }
+    }
+    return NULL;
+}
+
+static const ComfyUINode *
+comfyui_linked_node(const ComfyUIGraph *graph, const ComfyUIInput *input)
+{
+    int i; const ComfyUINode *node;
+    if( !input || input->type!=COMFYUI_VALUE_LINK ) { return NULL; }
+    for( i=0 ; i<graph->nodes_count ; ++i ) {
+        node = &graph->nodes[i];
+        if( node->id_size==input->size &&
+            memcmp( &graph->text[node->id_start],
+                    &graph->text[input->start], input->size )==0 ) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static const ComfyUINode *
+comfyui_follow(const ComfyUIGraph *graph,
+               const ComfyUINode  *node,
+               ComfyUIInputName    name)
+{
+    return comfyui_linked_node( graph, comfyui_input( node, name ) );
+}
+
+/**
+ * Resolves the text that feeds a conditioning (or string) input, following
+ * links through text-encode, conditioning and string utility nodes.
+ */
+static const ComfyUIInput *
+comfyui_resolve_text(const ComfyUIGraph *graph, const ComfyUINode *node)
+{
+    static const ComfyUIInputName text_inputs[] = {
+        COMFYUI_IN_TEXT, COMFYUI_IN_TEXT_G, COMFYUI_IN_STRING,
+        COMFYUI_IN_CONDITIONING, COMFYUI_IN_CONDITIONING_1, COMFYUI_IN_NONE
+    };
+    const ComfyUIInput *input; int hops, i;
+    
+    for( hops=0 ; node && hops<COMFYUI_MAX_HOPS ; ++hops ) {
+        for( input=NULL, i=0 ; !input && text_inputs[i]!=COMFYUI_IN_NONE ; ++i ) {
+            input = comfyui_input( node, text_inputs[i] );
+        }
+        if( !input ) { return NULL; }
+        if( input->type==COMFYUI_VALUE_STRING ) { return input; }
+        node = comfyui_linked_node( graph, input );
+    }
+    return NULL;
+}
+
+/*----------------------- STORING THE EXTRACTED DATA ------------------------*/
+
+static const char *
+comfyui_store(ComfyUIGraph *graph, const ComfyUIInput *input)
+{
+    char *out; int len, available;
+    if( !input || input->type==COMFYUI_VALUE_LINK ) { return NULL; }
+    available = SD_PARAMETERS_INPUT_SIZE - graph->pool_used;
+    if( available<=1 ) { return NULL; }
+    out = &graph->pool[ graph->pool_used ];
+    if( input->has_escapes ) {
+        len = copy_json_string( out, available,
+                                &graph->text[input->start], input->size );
+    } else {
+        len = input->size < available-1 ? input->size : available-1;
+        memcpy( out, &graph->text[input->start], len );
+        out[len] = '\0';
+    }
+    graph->pool_used += len+1;
+    return out;
+}
+
+/* stores a model file name the way A1111 shows it (no folder, no extension) */
+static const char *
+comfyui_store_model_name(ComfyUIGraph *graph, const ComfyUIInput *input)
+{
+    char *name, *ptr, *dot;
+    name = (char *)comfyui_store( graph, input );
+    if( !name ) { return NULL; }
+    for( ptr=name ; *ptr ; ++ptr ) {
+        if( *ptr=='/' || *ptr=='\\' ) { name = ptr+1; }
+    }
+    dot = strrchr( name, '.' );
+    if( dot && dot!=name ) { *dot = '\0'; }
+    return name;
+}
+
+static void
+comfyui_store_unknown(SDParameters *sd_parameters,
+                      const char   *key,
+                      const char   *value)
+{
+    const int index = sd_parameters->unknowns_count;
+    if( value && index < (SD_PARAMETERS_ARRAY_SIZE-1) ) {
+        sd_parameters->unknowns[index].key   = key;
+        sd_parameters->unknowns[index].value = value;
+        sd_parameters->unknowns_count++;
+    }
+}
+
+static int
+comfyui_is_sampler(const ComfyUIGraph *graph, const ComfyUINode *node)
+{
+    return comfyui_input( node, COMFYUI_IN_POSITIVE     )!=NULL &&
+           comfyui_input( node, COMFYUI_IN_LATENT_IMAGE )!=NULL &&
+           comfyui_input( node, COMFYUI_IN_STEPS        )!=NULL;
+}
+
+/**
+ * Returns the node at the origin of a latent chain (EmptyLatentImage,
+ * VAEEncode, ...) and, if it passes through another sampler, returns
+ * that sampler in @out_base_sampler.
+ */
+static const ComfyUINode *
+comfyui_latent_source(const ComfyUIGraph  *graph,
+                      const ComfyUINode   *sampler,
+                      const ComfyUINode  **out_base_sampler,
+                      const ComfyUINode  **out_upscale)
+{
+    const ComfyUINode *node, *next; int hops;
+    
+    (*out_base_sampler) = NULL; (*out_upscale) = NULL;
+    node = comfyui_follow( graph, sampler, COMFYUI_IN_LATENT_IMAGE );
+    for( hops=0 ; node && hops<COMFYUI_MAX_HOPS ; ++hops ) {
+        if( comfyui_is_sampler( graph, node ) ) {
+            if( !(*out_base_sampler) ) { (*out_base_sampler) = node; }
+            next = comfyui_follow( graph, node, COMFYUI_IN_LATENT_IMAGE );
+        } else {
+            if( comfyui_class_contains( graph, node, "Upscale" ) && !(*out_upscale) ) {
+                (*out_upscale) = node;
+            }
+            next = comfyui_follow( graph, node, COMFYUI_IN_SAMPLES );
+            if( !next ) { next = comfyui_follow( graph, node, COMFYUI_IN_PIXELS ); }
+        }
+        if( !next ) { return node; }
+        node = next;
+    }
+    return NULL;
+}
+
+/* stores a LoRA as "name: strength", the same way A1111 shows LoRA hashes,
+ * and adds it to the list of extra networks */
+static const char *
+comfyui_store_lora(ComfyUIGraph      *graph,
+                   SDParameters      *sd_parameters,
+                   const ComfyUINode *node)
+{
+    const ComfyUIInput *strength; char *name, *end; int used;
+    float multiplier = 1.0f;
+    
+    name     = (char *)comfyui_store_model_name( graph,
+                    comfyui_input( node, COMFYUI_IN_LORA_NAME ) );
+    strength = comfyui_input( node, COMFYUI_IN_STRENGTH_MODEL );
+    if( !name ) { return NULL; }
+    end = name + strlen( name );
+    if( strength && strength->type==COMFYUI_VALUE_NUMBER ) {
+        multiplier = (float)strtod( &graph->text[strength->start], NULL );
+    }
+    add_sd_prompt_network( &sd_parameters->networks, SD_NETWORK_LORA,
+                           name, (int)(end - name), multiplier, 0 );
+    if( !strength || strength->type!=COMFYUI_VALUE_NUMBER ) { return name; }
+    
+    /* the name can be shorter than what was stored (folder/extension   */
+    /* removed), so the strength is appended right after the final name */
+    used = (int)(end - graph->pool) + 2 + strength->size + 1;
+    if( used <= SD_PARAMETERS_INPUT_SIZE ) {
+        end[0] = ':'; end[1] = ' ';
+        memcpy( end+2, &graph->text[strength->start], strength->size );
+        end[ 2+strength->size ] = '\0';
+        if( used > graph->pool_used ) { graph->pool_used = used; }
+    }
+    return name;
+}
+
+static void
+comfyui_store_model_chain(ComfyUIGraph      *graph,
+                          SDParameters      *sd_parameters,
+                          const ComfyUINode *node)
+{
+    const ComfyUIInput *input; int hops;
+    
+    for( hops=0 ; node && hops<COMFYUI_MAX_HOPS ; ++hops ) {
+        if( comfyui_input( node, COMFYUI_IN_LORA_NAME ) ) {
+            comfyui_store_unknown( sd_parameters, "Lora",
+                comfyui_store_lora( graph, sd_parameters, node ) );
+        }
+        if( (input = comfyui_input( node, COMFYUI_IN_CKPT_NAME )) ||
+            (input = comfyui_input( node, COMFYUI_IN_UNET_NAME )) ) {
+            sd_parameters->model.name = comfyui_store_model_name( graph, input );
+            return;
+        }
+        node = comfyui_follow( graph, node, COMFYUI_IN_MODEL );
+    }
+}
+
+static void
+comfyui_store_clip_skip(ComfyUIGraph      *graph,
+                        SDParameters      *sd_parameters,
+                        const ComfyUINode *encoder)
+{
+    const ComfyUIInput *input; const ComfyUINode *node; int hops;
+    char *clip_skip;
+    
+    node = comfyui_follow( graph, encoder, COMFYUI_IN_CLIP );
+    for( hops=0 ; node && hops<COMFYUI_MAX_HOPS ; ++hops ) {
+        input = comfyui_input( node, COMFYUI_IN_STOP_AT_CLIP_LAYER );
+        if( input && input->type==COMFYUI_VALUE_NUMBER ) {
+            /* ComfyUI uses negative layers: -2 == A1111 "Clip skip: 2" */
+            clip_skip = (char *)comfyui_store( graph, input );
+            if( clip_skip && clip_skip[0]=='-' ) { ++clip_skip; }
+            sd_parameters->settings.clip_skip = clip_skip;
+            return;
+        }
+        node = comfyui_follow( graph, node, COMFYUI_IN_CLIP );
+    }
+}
+
+static void
+comfyui_store_parameters(ComfyUIGraph      *graph,
+                         SDParameters      *sd_parameters,
+                         const ComfyUINode *sampler)
+{
+    const ComfyUINode *base, *upscale, *source, *positive;
+    const ComfyUIInput *seed; const char *denoise;
+    
+    source = comfyui_latent_source( graph, sampler, &base, &upscale );
+    
+    /* a sampler fed by another sampler is a "hires. fix" second pass */
+    if( base ) {
+        sd_parameters->hires.steps    = comfyui_store( graph,
+                            comfyui_input( sampler, COMFYUI_IN_STEPS ) );
+        sd_parameters->hires.denoising = comfyui_store( graph,
+                            comfyui_input( sampler, COMFYUI_IN_DENOISE ) );
+        sd_parameters->hires.upscale  = comfyui_store( graph,
+                            comfyui_input( upscale, COMFYUI_IN_SCALE_BY ) );
+        sd_parameters->hires.upscaler = comfyui_store( graph,
+                            comfyui_input( upscale, COMFYUI_IN_UPSCALE_METHOD ) );
+        sd_parameters->hires.width    = comfyui_store( graph,
+                            comfyui_input( upscale, COMFYUI_IN_WIDTH ) );
+        sd_parameters->hires.height   = comfyui_store( graph,
+                            comfyui_input( upscale, COMFYUI_IN_HEIGHT ) );
+        sampler = base;
+    }
+    
+    positive = comfyui_follow( graph, sampler, COMFYUI_IN_POSITIVE );
+    sd_parameters->prompt          = comfyui_store( graph,
+                        comfyui_resolve_text( graph, positive ) );
+    sd_parameters->negative_prompt = comfyui_store( graph,
+                        comfyui_resolve_text( graph,
+                            comfyui_follow( graph, sampler, COMFYUI_IN_NEGATIVE ) ) );
+    
+    seed = comfyui_input( sampler, COMFYUI_IN_SEED );
+    if( !seed ) { seed = comfyui_input( sampler, COMFYUI_IN_NOISE_SEED ); }
+    sd_parameters->seed      = comfyui_store( graph, seed );
+    sd_parameters->steps     = comfyui_store( graph,
+                        comfyui_input( sampler, COMFYUI_IN_STEPS ) );
+    sd_parameters->cfg_scale = comfyui_store( graph,
+                        comfyui_input( sampler, COMFYUI_IN_CFG ) );
+    sd_parameters->sampler   = comfyui_store( graph,
+                        comfyui_input( sampler, COMFYUI_IN_SAMPLER_NAME ) );
+    
+    /* the denoising strength only matters when starting from an image */
+    if( source && !comfyui_class_is( graph, source, "EmptyLatentImage" ) ) {
+        denoise = comfyui_store( graph,
+                        comfyui_input( sampler, COMFYUI_IN_DENOISE ) );
+        sd_parameters->denoising = denoise;
+    }
+    if( source ) {
+        sd_parameters->width  = comfyui_store( graph,
+                        comfyui_input( source, COMFYUI_IN_WIDTH ) );
+        sd_parameters->height = comfyui_store( graph,
+                        comfyui_input( source, COMFYUI_IN_HEIGHT ) );
+    }
+    comfyui_store_model_chain( graph, sd_parameters,
+                        comfyui_follow( graph, sampler, COMFYUI_IN_MODEL ) );
+    comfyui_store_clip_skip( graph, sd_parameters, positive );
+    comfyui_store_unknown( sd_parameters, "Schedule type",
+                        comfyui_store( graph,
+                            comfyui_input( sampler, COMFYUI_IN_SCHEDULER ) ) );
+}
+
+/*============================ MAIN FUNCTIONS ==============================*/
+
+/**
+ * Returns 1 if the text looks like a JSON object (ComfyUI graph),
+ * without parsing it.
+ */
+static int
+is_comfyui_graph(const char *text)
+{
+    while( text && JSON_IS_SPACE(*text) ) { ++text; }
+    return text && *text=='{';
+}
+
+/**
+ * Parses the ComfyUI node graph stored in @buffer and populates the fields
+ * of the SDParameters struct with the generation parameters of the image.
+ * 
+ * The JSON text is never copied as a whole; only the values that end up in
+ * the SDParameters struct are copied (and unescaped) into its 'input' field.
+ * When the graph contains more than one sampler, a sampler that takes its
+ * latent from another sampler is treated as a "hires. fix" pass and the
+ * sampler at the start of the chain provides the main parameters.
+ * 
+ * @param sd_parameters A pointer to the SDParameters struct that will be
+ *    populated with the identified generation parameters.
+ * @param buffer A pointer to the buffer containing the JSON text.
+ * @param buffer_size The number of bytes in the buffer or -1 if buffer
+ *    contains a null-terminated string.
+ * @returns
+ *    1 if a sampler node was found and the parameters were extracted,
+ *    0 if @buffer is not a ComfyUI graph (SDParameters is left empty).
+ */
+static int
+parse_comfyui_parameters_from_buffer(SDParameters *sd_parameters,
+                                     const char   *buffer,
+                                     int           buffer_size)
+{
+    ComfyUIGraph *graph; int i, found = 0;
+    const ComfyUINode *sampler, *node, *base, *upscale;
+    
+    memset( sd_parameters, 0, sizeof(SDParameters) );
+    if( buffer_size < 0 ) { buffer_size = strlen( buffer ); }
+    
+    graph = g_private_get( &comfyui_graph );
+    if( !graph ) {
+        graph = g_try_new( ComfyUIGraph, 1 );
+        if( !graph ) { return 0; }
+        g_private_set( &comfyui_graph, graph );
+    }
+    graph->pool      = sd_parameters->input;
+    graph->pool_used = 0;
+    
+    if( comfyui_read_graph( graph, buffer, buffer_size ) ) {
+        /* prefer the sampler that is not consumed by another sampler */
+        sampler = NULL;
+        for( i=0 ; i<graph->nodes_count ; ++i ) {
+            node = &graph->nodes[i];
+            if( comfyui_is_sampler( graph, node ) ) {
+                comfyui_latent_source( graph, node, &base, &upscale );
+                if( !sampler || base ) { sampler = node; }
+            }
+        }
+        if( sampler ) {
+            comfyui_store_parameters( graph, sd_parameters, sampler );
+            parse_sd_params_final_fix( sd_parameters );
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * Parses the generation data of an image: the node graph stored by ComfyUI
+ * or the parameters text stored by A1111.
+ *
+ * @param sd_parameters A pointer to the SDParameters struct that will be
+ *    populated with the generation parameters.
+ * @param data The generation data, a null-terminated string.
+ */
+static void
+parse_generation_data(SDParameters *sd_parameters, const char *data)
+{
+    if( !is_comfyui_graph( data ) ||
+        !parse_comfyui_parameters_from_buffer( sd_parameters, data, -1 ) ) {
+        parse_sd_parameters_from_buffer( sd_parameters, data, -1 );
+    }
+}
+
@@ -0,0 +1,255 @@
+/**
+ * @file    utils_diff.h
+ * @brief   Token-level Myers diff of two prompts.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Prompts are split into tokens (words, numbers and single punctuation
+    characters, each with the whitespace that precedes it) and compared
+    ignoring the whitespace, so reformatting a prompt doesn't show up as a
+    change. The edit script is found with Myers' O(ND) algorithm after
+    removing the common prefix and suffix, which for two variations of the
+    same prompt leaves only a few tokens to compare.
+    
+    The result is a single inline text: the tokens of the second prompt,
+    with the tokens removed from the first one interleaved where they were,
+    and a list of spans that mark the deleted and inserted ranges. The
+    #DiffText type is declared in 'sdprompt-viewer-compare.h', so the
+    plugin can display a diff without including this file.
+    
+    NOTE: 'sdprompt-viewer-compare.h' must be included first.
+*/
+#include <string.h>
+#include <glib.h>
+#if !defined( __SDPROMPT_VIEWER_COMPARE_H__ )
+#  error "utils_diff.h requires sdprompt-viewer-compare.h"
+#endif
+
+/* Prompts that differ in more tokens than this are compared as a whole */
+/* (the memory used by the diff grows with the square of the edits)     */
+#define DIFF_MAX_TOKENS 2048
+
+typedef struct _DiffToken DiffToken;
+struct         _DiffToken {
+    guint   start;          /* including the preceding whitespace */
+    guint   end;
+    guint   content;        /* start of the token itself          */
+    guint32 hash;
+};
+
+
+/*------------------------------ TOKENIZING -------------------------------*/
+
+static gboolean
+diff_is_word_char(const char *text, guint i)
+{
+    const guchar ch = (guchar)text[i];
+    if( g_ascii_isalnum(ch) || ch=='_' || ch>=0x80 ) { return TRUE; }
+    /* decimal numbers like "0.75" are a single token */
+    return ch=='.' && i>0 && g_ascii_isdigit(text[i-1]) && g_ascii_isdigit(text[i+1]);
+}
+
+static GArray *
+diff_tokenize(const char *text)
+{
+    GArray *tokens = g_array_new(FALSE, FALSE, sizeof(DiffToken));
+    DiffToken token; guint i = 0, j; guint32 hash;
+    
+    while( text && text[i] ) {
+        token.start = i;
+        while( g_ascii_isspace(text[i]) ) { ++i; }
+        if( !text[i] ) {
+            /* trailing whitespace belongs to the last token */
+            if( tokens->len>0 ) { g_array_index(tokens, DiffToken, tokens->len-1).end = i; }
+            break;
+        }
+        token.content = i;
+        if( diff_is_word_char(text, i) ) { while( text[i] && diff_is_word_char(text, i) ) { ++i; } }
+        else                              { ++i; }
+        token.end = i;
+        hash = 2166136261u;
+        for( j=token.content ; j<token.end ; ++j ) { hash = (hash ^ (guchar)text[j]) * 16777619u; }
+        token.hash = hash;
+        g_array_append_val(tokens, token);
+    }
+    return tokens;
+}
+
+static gboolean
+diff_tokens_equal(const DiffToken *a, const char *text_a,
+                  const DiffToken *b, const char *text_b)
+{
+    guint size = a->end - a->content;
+    return a->hash==b->hash && size==(b->end - b->content) &&
+           memcmp(text_a + a->content, text_b + b->content, size)==0;
+}
+
+
+/*--------------------------------- MYERS ---------------------------------*/
+
+/*
+ * Appends to 'ops' the shortest edit script that turns 'a' into 'b'.
+ * The V array of each step d is saved for k in [-d-1, d+1], which is all
+ * that the backtracking reads; the window of step d starts at d*d + 2*d.
+ */
+static void
+diff_myers(GByteArray      *ops,
+           const DiffToken *a, guint n, const char *text_a,
+           const DiffToken *b, guint m, const char *text_b)
+{
+    const gint max = (gint)(n + m);
+    GArray *trace; gint *v, *vd; gint d, k, x, y, prev_k, prev_x, prev_y;
+    gboolean found = FALSE; guint8 op; guint first = ops->len, i;
+    
+    v     = g_new0(gint, 2*max + 3) + max + 1;
+    trace = g_array_new(FALSE, FALSE, sizeof(gint));
+    for( d=0 ; !found ; ++d ) {
+        g_array_append_vals(trace, v - d - 1, 2*d + 3);
+        for( k=-d ; k<=d && !found ; k+=2 ) {
+            x = (k==-d || (k!=d && v[k-1] < v[k+1])) ? v[k+1] : v[k-1] + 1;
+            y = x - k;
+            while( x<(gint)n && y<(gint)m && diff_tokens_equal(&a[x], text_a, &b[y], text_b) ) { ++x; ++y; }
+            v[k]  = x;
+            found = x>=(gint)n && y>=(gint)m;
+        }
+    }
+    /* the script is built backwards and then reversed */
+    x = n; y = m;
+    for( d=d-1 ; d>=0 ; --d ) {
+        vd     = &g_array_index(trace, gint, d*d + 2*d + d + 1);  /* k in [-d-1,d+1] */
+        k      = x - y;
+        prev_k = (k==-d || (k!=d && vd[k-1] < vd[k+1])) ? k+1 : k-1;
+        prev_x = vd[prev_k];
+        prev_y = prev_x - prev_k;
+        while( x>prev_x && y>prev_y ) { op = DIFF_EQUAL; g_byte_array_append(ops, &op, 1); --x; --y; }
+        if( d>0 ) {
+            op = (x==prev_x) ? DIFF_INSERT : DIFF_DELETE;
+            g_byte_array_append(ops, &op, 1);
+        }
+        x = prev_x; y = prev_y;
+    }
+    for( i=0 ; i<(ops->len - first)/2 ; ++i ) {
+        op = ops->data[first+i];
+        ops->data[first+i] = ops->data[ops->len-1-i];
+        ops->data[ops->len-1-i] = op;
+    }
+    g_free(v - max - 1);
+    g_array_unref(trace);
+}
+
+
+/*------------------------------ INLINE TEXT ------------------------------*/
+
+static void
+diff_append(DiffText *diff, GString *text, GArray *spans,
+            const char *source, const DiffToken *token, DiffOp op)
+{
+    DiffSpan span, *last = spans->len>0 ? &g_array_index(spans, DiffSpan, spans->len-1) : NULL;
+    /* a token without leading space can end up next to a word of the other text */
+    if( token->start==token->content && text->len>0 &&
+        diff_is_word_char(text->str, text->len-1) && diff_is_word_char(source, token->content) ) {
+        g_string_append_c(text, ' ');
+    }
+    g_string_append_len(text, source + token->start, token->end - token->start);
+    if( last && last->op==op ) { last->end = text->len; }
+    else {
+        span.start = last ? last->end : 0;
+        span.end   = text->len;
+        span.op    = op;
+        g_array_append_val(spans, span);
+    }
+    if( op==DIFF_DELETE ) { diff->deleted++;  }
+    if( op==DIFF_INSERT ) { diff->inserted++; }
+}
+
+/**
+ * Compares two prompts token by token.
+ * @param text_a  The first prompt (NULL is an empty prompt).
+ * @param text_b  The second prompt (NULL is an empty prompt).
+ * @returns
+ *     A new DiffText with both prompts merged, to be freed with
+ *     free_diff_text().
+ */
+static DiffText *
+diff_prompts(const char *text_a, const char *text_b)
+{
+    DiffText *diff = g_new0(DiffText, 1); GString *text; GArray *spans;
+    GArray *tokens_a, *tokens_b; GByteArray *ops; const DiffToken *a, *b;
+    guint n, m, prefix = 0, suffix = 0, i, x = 0, y = 0;
+    
+    tokens_a = diff_tokenize(text_a); a = (const DiffToken *)tokens_a->data; n = tokens_a->len;
+    tokens_b = diff_tokenize(text_b); b = (const DiffToken *)tokens_b->data; m = tokens_b->len;
+    ops = g_byte_array_new();
+    
+    while( prefix<n && prefix<m && diff_tokens_equal(&a[prefix], text_a, &b[prefix], text_b) ) {
+        ++prefix;
+    }
+    while( suffix<n-prefix && suffix<m-prefix &&
+           diff_tokens_equal(&a[n-1-suffix], text_a, &b[m-1-suffix], text_b) ) {
+        ++suffix;
+    }
+    g_byte_array_set_size(ops, prefix);
+    memset(ops->data, DIFF_EQUAL, prefix);
+    if( (n - prefix - suffix) + (m - prefix - suffix) <= DIFF_MAX_TOKENS ) {
+        diff_myers(ops, a + prefix, n - prefix - suffix, text_a,
+                        b + prefix, m - prefix - suffix, text_b);
+    } else {
+        for( i=prefix ; i<n-suffix ; ++i ) { guint8 op = DIFF_DELETE; g_byte_array_append(ops, &op, 1); }
+        for( i=prefix ; i<m-suffix ; ++i ) { guint8 op = DIFF_INSERT; g_byte_array_append(ops, &op, 1); }
+    }
+    for( i=0 ; i<suffix ; ++i ) { guint8 op = DIFF_EQUAL; g_byte_array_append(ops, &op, 1); }
+    
+    /*-- merge both texts following the edit script --*/
+    text  = g_string_new(NULL);
+    spans = g_array_new(FALSE, FALSE, sizeof(DiffSpan));
+    for( i=0 ; i<ops->len ; ++i ) {
+        switch( ops->data[i] ) {
+            case DIFF_EQUAL:  diff_append(diff, text, spans, text_b, &b[y], DIFF_EQUAL ); ++x; ++y; break;
+            case DIFF_DELETE: diff_append(diff, text, spans, text_a, &a[x], DIFF_DELETE); ++x; break;
+            case DIFF_INSERT: diff_append(diff, text, spans, text_b, &b[y], DIFF_INSERT); ++y; break;
+        }
+    }
+    diff->text  = g_string_free(text, FALSE);
+    diff->count = spans->len;
+    diff->spans = (DiffSpan *)g_array_free(spans, FALSE);
+    g_byte_array_unref(ops);
+    g_array_unref(tokens_a);
+    g_array_unref(tokens_b);
+    return diff;
+}
+
+static void
+free_diff_text(DiffText *diff)
+{
+    if( !diff ) { return; }
+    g_free(diff->text);
+    g_free(diff->spans);
+    g_free(diff);
+}
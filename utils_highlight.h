@@ -0,0 +1,150 @@
+/**
+ * @file    utils_highlight.h
+ * @brief   Syntax highlighting of prompts in GtkTextView widgets.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    NOTE: 'utils_sdprompt.h' and 'utils_widget.h' must be included first.
+*/
+#include <gtk/gtk.h>
+#if !defined( SD_PROMPT_MAX_TOKENS )
+#  error "utils_highlight.h requires utils_sdprompt.h"
+#endif
+
+/* names of the text tags, indexed by SDPromptSpanType */
+static const gchar *PROMPT_TAG_NAMES[SD_SPAN_TYPE_COUNT] = {
+    "sdp-syntax",      /* SD_SPAN_SYNTAX     */
+    "sdp-weight",      /* SD_SPAN_WEIGHT     */
+    "sdp-network",     /* SD_SPAN_NETWORK    */
+    "sdp-embedding",   /* SD_SPAN_EMBEDDING  */
+    "sdp-wildcard",    /* SD_SPAN_WILDCARD   */
+    "sdp-break",       /* SD_SPAN_BREAK      */
+    "sdp-emphasis",    /* SD_SPAN_EMPHASIS   */
+    "sdp-deemphasis",  /* SD_SPAN_DEEMPHASIS */
+    "sdp-chunk"        /* SD_SPAN_CHUNK      */
+};
+
+/**
+ * ensure_prompt_tags - Creates the text tags used to highlight prompts.
+ * @buffer: the GtkTextBuffer where the tags will be used.
+ *
+ * The tags are created only the first time; the colors were chosen to be
+ * readable with both light and dark themes.
+ */
+static void
+ensure_prompt_tags( GtkTextBuffer *buffer )
+{
+    GtkTextTagTable *table = gtk_text_buffer_get_tag_table( buffer );
+    if( gtk_text_tag_table_lookup( table, "sdp-syntax" ) ) { return; }
+    
+    gtk_text_buffer_create_tag( buffer, "sdp-syntax",
+                                "foreground", "#888a85", NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-weight",
+                                "foreground", "#c061cb", NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-network",
+                                "foreground", "#3584e4",
+                                "weight", PANGO_WEIGHT_BOLD, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-embedding",
+                                "foreground", "#26a269",
+                                "weight", PANGO_WEIGHT_BOLD, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-wildcard",
+                                "foreground", "#e66100",
+                                "style", PANGO_STYLE_ITALIC, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-break",
+                                "foreground", "#e01b24",
+                                "weight", PANGO_WEIGHT_BOLD, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-emphasis",
+                                "weight", PANGO_WEIGHT_SEMIBOLD, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-deemphasis",
+                                "style", PANGO_STYLE_ITALIC, NULL );
+    gtk_text_buffer_create_tag( buffer, "sdp-chunk",
+                                "background", "rgba(53,132,228,0.25)",
+                                "underline", PANGO_UNDERLINE_SINGLE, NULL );
+}
+
+/**
+ * apply_prompt_spans - Applies the highlight spans to a text view.
+ * @text_view: the GtkTextView that already displays the prompt.
+ * @spans:     the spans computed by make_sd_prompt_spans().
+ * @count:     the number of elements in @spans.
+ *
+ * The spans are already in character offsets, so this is a single batched
+ * pass over the buffer: the tags are looked up once and the iterators are
+ * moved forward from one span to the next.
+ */
+static void
+apply_prompt_spans( GtkTextView        *text_view,
+                    const SDPromptSpan *spans,
+                    int                 count )
+{
+    GtkTextBuffer *buffer; GtkTextTagTable *table; GtkTextIter start, end;
+    GtkTextTag *tags[SD_SPAN_TYPE_COUNT]; int i;
+    
+    buffer = text_view ? gtk_text_view_get_buffer( text_view ) : NULL;
+    if( !buffer || !spans || count<=0 ) { return; }
+    ensure_prompt_tags( buffer );
+    
+    table = gtk_text_buffer_get_tag_table( buffer );
+    for( i=0 ; i<SD_SPAN_TYPE_COUNT ; ++i ) {
+        tags[i] = gtk_text_tag_table_lookup( table, PROMPT_TAG_NAMES[i] );
+    }
+    gtk_text_buffer_get_start_iter( buffer, &end );
+    for( i=0 ; i<count ; ++i ) {
+        start = end;
+        gtk_text_iter_set_offset( &start, spans[i].start );
+        end = start;
+        gtk_text_iter_forward_chars( &end, spans[i].end - spans[i].start );
+        gtk_text_buffer_apply_tag( buffer, tags[ spans[i].type ], &start, &end );
+    }
+}
+
+/**
+ * display_prompt - Sets the text of a text view and highlights its syntax.
+ * @builder:     A pointer to the GtkBuilder object that contains the widget.
+ * @widget_name: The name of the GtkTextView.
+ * @text:        The prompt to display (can be NULL).
+ * @spans:       The highlight spans of @text.
+ * @count:       The number of elements in @spans.
+ */
+static void
+display_prompt( GtkBuilder         *builder,
+                const gchar        *widget_name,
+                const gchar        *text,
+                const SDPromptSpan *spans,
+                int                 count )
+{
+    GtkWidget *widget;
+    display_text( builder, widget_name, text );
+    widget = builder ? get_widget( builder, widget_name ) : NULL;
+    if( widget && GTK_IS_TEXT_VIEW(widget) && text ) {
+        apply_prompt_spans( GTK_TEXT_VIEW(widget), spans, count );
+    }
+}
+
@@ -0,0 +1,278 @@
+/**
+ * @file    utils_imageinfo.h
+ * @brief   Loads and parses the generation data of an image in one call.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    An SDImageInfo holds everything the sidebar needs to display an image:
+    the raw generation data, the parsed parameters (with the prompt tokens),
+    the CLIP token count and the highlight spans of both prompts. It is
+    built in one call, so it can be produced by a worker thread and then
+    cached and displayed by the main thread without doing any further work.
+    
+    Everything an info points to lives in one Arena, taken from a pool when
+    the generation data is read and sized from its length; an info without
+    data takes no arena at all. Releasing the info gives the arena back to
+    the pool and the info itself to a list of spares, so once the image
+    cache is full, every image loaded reuses the memory of the image
+    evicted from it.
+    
+    NOTE: 'utils_arena.h', 'utils_png.h', 'utils_sdparams.h', 'utils_json.h',
+          'utils_comfyui.h' and 'utils_clip.h' must be included first.
+*/
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#if !defined( SD_PARAMETERS_INPUT_SIZE ) || !defined( COMFYUI_MAX_NODES )
+#  error "utils_imageinfo.h requires utils_sdparams.h and utils_comfyui.h"
+#endif
+#if !defined( CLIP_CHUNK_SIZE )
+#  error "utils_imageinfo.h requires utils_clip.h"
+#endif
+#if !defined( ARENA_ALIGNMENT )
+#  error "utils_imageinfo.h requires utils_arena.h"
+#endif
+
+/* Keys of the PNG text chunks that contain generation data */
+#define SD_IMAGE_INFO_PNG_KEYS "parameters|prompt"
+
+typedef struct _SDImageInfo SDImageInfo;
+struct         _SDImageInfo {
+    gint          ref_count;
+    Arena        *arena;        /* holds everything below, NULL if no data */
+    gchar        *data;         /* generation data, NULL if there isn't any */
+    SDParameters *parameters;   /* NULL if there isn't any data            */
+    
+    /* CLIP token count of the prompts */
+    ClipCount     prompt_clip;
+    ClipCount     negative_clip;
+    
+    /* highlight spans of the prompts (including the chunk boundaries) */
+    SDPromptSpan *prompt_spans;
+    int           prompt_spans_count;
+    SDPromptSpan *negative_spans;
+    int           negative_spans_count;
+};
+
+/* Maximum number of released infos kept to be reused */
+#define SD_IMAGE_INFO_MAX_SPARES ARENA_POOL_CAPACITY
+
+/* Bytes reserved for the parameters, the data, its prompts and their spans */
+#define sd_image_info_arena_size(size) (sizeof(SDParameters) + 2*(size) + 1024)
+
+/* the arenas and the infos released are reused by the next ones */
+static ArenaPool image_info_arenas;
+static struct {
+    GMutex       mutex;
+    SDImageInfo *infos[SD_IMAGE_INFO_MAX_SPARES];
+    guint        count;
+} image_info_spares;
+
+static SDPromptSpan *
+image_info_make_spans( Arena                *arena,
+                       const SDPromptTokens *tokens,
+                       const ClipCount      *clip_count,
+                       const char           *text,
+                       int                  *out_count )
+{
+    const ClipBoundary *boundary; SDPromptSpan *spans; int i, count;
+    (*out_count) = 0;
+    if( !text || tokens->count==0 || !g_utf8_validate( text, -1, NULL ) ) {
+        return NULL;
+    }
+    spans = arena_alloc( arena, sizeof(SDPromptSpan) *
+                                (tokens->count + clip_count->boundaries) );
+    count = make_sd_prompt_spans( spans, tokens->count, tokens, text );
+    
+    /* boundaries are few, a direct byte->char conversion is enough */
+    for( i=0 ; i<clip_count->boundaries ; ++i ) {
+        boundary = &clip_count->boundary[i];
+        spans[count].start = g_utf8_pointer_to_offset( text, text+boundary->start );
+        spans[count].end   = g_utf8_pointer_to_offset( text, text+boundary->end );
+        spans[count].type  = SD_SPAN_CHUNK;
+        ++count;
+    }
+    if( count==0 ) { return NULL; }
+    (*out_count) = count;
+    return spans;
+}
+
+/**
+ * new_image_info - Creates an SDImageInfo without generation data.
+ *
+ * Use read_image_info_data() and parse_image_info_data() to fill it.
+ *
+ * Returns: (transfer full): a new #SDImageInfo, release it with
+ *          unref_image_info().
+ */
+static SDImageInfo *
+new_image_info( void )
+{
+    SDImageInfo *info = NULL;
+    g_mutex_lock( &image_info_spares.mutex );
+    if( image_info_spares.count>0 ) {
+        info = image_info_spares.infos[ --image_info_spares.count ];
+    }
+    g_mutex_unlock( &image_info_spares.mutex );
+    if( !info ) { info = g_new( SDImageInfo, 1 ); }
+    memset( info, 0, sizeof(SDImageInfo) );
+    info->ref_count = 1;
+    return info;
+}
+
+static void
+on_image_info_data_loaded( gchar *text, gpointer data_ptr, int data_int )
+{
+    SDImageInfo *info = data_ptr; gsize size;
+    if( text && text[0]!='\0' && !info->data ) {
+        size        = strlen( text );
+        info->arena = arena_pool_take( &image_info_arenas );
+        arena_reserve( info->arena, sd_image_info_arena_size( size ) );
+        info->data  = arena_strndup( info->arena, text, size );
+    }
+}
+
+/**
+ * read_image_info_data - Reads the generation data of an image.
+ * @info: a new #SDImageInfo, without data.
+ * @file: the image file.
+ *
+ * This function blocks until the file is read, so it's meant to be called
+ * from a worker thread.
+ *
+ * Returns: %TRUE if the image contains generation data.
+ */
+static gboolean
+read_image_info_data( SDImageInfo *info, GFile *file )
+{
+    load_png_text_chunk( file, SD_IMAGE_INFO_PNG_KEYS,
+                         on_image_info_data_loaded, info, 0 );
+    return info->data!=NULL;
+}
+
+/**
+ * parse_image_info_data - Parses the generation data of an SDImageInfo.
+ * @info: an #SDImageInfo filled by read_image_info_data().
+ * @clip: the tokenizer used to count the CLIP tokens (can be %NULL).
+ *
+ * Parses the data, tokenizes both prompts, counts their CLIP tokens and
+ * computes their highlight spans. It doesn't touch any GTK object and can
+ * be called from any thread.
+ */
+static void
+parse_image_info_data( SDImageInfo *info, ClipTokenizer *clip )
+{
+    SDParameters *parameters; gchar *data = info->data;
+    if( !data || info->parameters ) { return; }
+    
+    info->parameters = parameters = arena_alloc( info->arena, sizeof(SDParameters) );
+    parse_generation_data( parameters, data );
+    count_clip_tokens( clip, &info->prompt_clip,
+                       &parameters->prompt_tokens, parameters->prompt );
+    count_clip_tokens( clip, &info->negative_clip,
+                       &parameters->negative_tokens, parameters->negative_prompt );
+    info->prompt_spans =
+        image_info_make_spans( info->arena,
+                               &parameters->prompt_tokens,
+                               &info->prompt_clip,
+                               parameters->prompt,
+                               &info->prompt_spans_count );
+    info->negative_spans =
+        image_info_make_spans( info->arena,
+                               &parameters->negative_tokens,
+                               &info->negative_clip,
+                               parameters->negative_prompt,
+                               &info->negative_spans_count );
+}
+
+/**
+ * new_image_info_from_data - Creates an SDImageInfo from generation data.
+ * @data: the generation data (A1111 text or ComfyUI graph), or %NULL.
+ * @clip: the tokenizer used to count the CLIP tokens (can be %NULL).
+ *
+ * Parses @data, tokenizes both prompts, counts their CLIP tokens and
+ * computes their highlight spans.
+ * This function doesn't touch any GTK object and can be called from any
+ * thread.
+ *
+ * Returns: (transfer full): a new #SDImageInfo, release it with
+ *          unref_image_info().
+ */
+static SDImageInfo *
+new_image_info_from_data( const gchar *data, ClipTokenizer *clip )
+{
+    SDImageInfo *info = new_image_info();
+    on_image_info_data_loaded( (gchar *)data, info, 0 );
+    parse_image_info_data( info, clip );
+    return info;
+}
+
+/**
+ * load_image_info - Reads the generation data of an image and parses it.
+ * @file: the image file.
+ * @clip: the tokenizer used to count the CLIP tokens (can be %NULL).
+ *
+ * This function blocks until the file is read, so it's meant to be called
+ * from a worker thread.
+ *
+ * Returns: (transfer full): a new #SDImageInfo (without data if the image
+ *          doesn't contain generation parameters).
+ */
+static SDImageInfo *
+load_image_info( GFile *file, ClipTokenizer *clip )
+{
+    SDImageInfo *info = new_image_info();
+    read_image_info_data( info, file );
+    parse_image_info_data( info, clip );
+    return info;
+}
+
+static SDImageInfo *
+ref_image_info( SDImageInfo *info )
+{
+    if( info ) { g_atomic_int_inc( &info->ref_count ); }
+    return info;
+}
+
+static void
+unref_image_info( SDImageInfo *info )
+{
+    if( info && g_atomic_int_dec_and_test( &info->ref_count ) ) {
+        arena_pool_give( &image_info_arenas, info->arena );
+        g_mutex_lock( &image_info_spares.mutex );
+        if( image_info_spares.count < SD_IMAGE_INFO_MAX_SPARES ) {
+            image_info_spares.infos[ image_info_spares.count++ ] = info;
+            info = NULL;
+        }
+        g_mutex_unlock( &image_info_spares.mutex );
+        g_free( info );
+    }
+}
+
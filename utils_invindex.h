@@ -0,0 +1,448 @@
+/**
+ * @file    utils_invindex.h
+ * @brief   Inverted index over the words of the prompts.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Every prompt is split into normalized terms (ASCII lowercase, split on
+    anything that is not a letter, a digit, '_' or a UTF-8 byte, numbers
+    alone are dropped so attention weights like "(sky:1.2)" don't pollute
+    the index) and each term keeps one posting list per field, so a word in
+    the negative prompt never matches a search over the positive one.
+    
+    A posting list is the sorted list of the documents (images) containing
+    the term, stored as LEB128 varints of the gaps between consecutive ids;
+    most gaps fit in a single byte. Every INV_SKIP_INTERVAL documents a skip
+    entry remembers the byte offset of the block, so intersecting a short
+    list with a long one jumps over whole blocks instead of decoding them.
+    
+    Documents must be added in increasing order of id, which lets the lists
+    grow by appending. Quoted phrases are answered by intersecting their
+    terms and then checking the candidates against the original text.
+    
+    Query syntax (all the parts must match):
+        blue sky          both words in the prompt
+        "blue sky"        the phrase in the prompt
+        neg:blurry        the word in the negative prompt
+        neg:"bad hands"   the phrase in the negative prompt
+*/
+#include <string.h>
+#include <glib.h>
+
+#define INV_SKIP_INTERVAL 64
+#define INV_MAX_TERM_SIZE 64
+#define INV_MAX_QUERY_TERMS 32
+#define INV_MAX_QUERY_PHRASES 8
+#define INV_NEGATIVE_PREFIX "neg:"
+
+typedef enum InvField {
+    INV_FIELD_PROMPT,
+    INV_FIELD_NEGATIVE,
+    INV_FIELD_COUNT
+} InvField;
+
+typedef struct _InvSkip InvSkip;
+struct         _InvSkip {
+    guint32 prev_doc;   /* last document before the block */
+    guint32 offset;     /* byte offset where the block starts */
+};
+
+typedef struct _InvPostings InvPostings;
+struct         _InvPostings {
+    GByteArray *bytes;  /* gaps between document ids, as LEB128 varints */
+    GArray     *skips;  /* InvSkip every INV_SKIP_INTERVAL documents    */
+    guint32     count;
+    guint32     last;
+};
+
+typedef struct _InvTerm InvTerm;
+struct         _InvTerm {
+    InvPostings fields[INV_FIELD_COUNT];
+};
+
+typedef struct _InvIndex InvIndex;
+struct         _InvIndex {
+    GHashTable   *terms;    /* term -> InvTerm                 */
+    GStringChunk *strings;  /* storage of the keys of 'terms'  */
+    guint32       doc_count;
+};
+
+/* Returns the text of a document, used to check phrases */
+typedef const char * (*InvTextFunc)(guint32 doc, InvField field, gpointer user_data);
+
+
+/*------------------------------ TOKENIZER --------------------------------*/
+
+#define INV_IS_WORD_CHAR(ch) \
+    (g_ascii_isalnum(ch) || (ch)=='_' || (guchar)(ch)>=0x80)
+
+/**
+ * Reads the next normalized term of the text.
+ * @param inout_ptr Pointer to the text, advanced past the term.
+ * @param term      Buffer of INV_MAX_TERM_SIZE bytes receiving the term.
+ * @returns
+ *    The length of the term, or 0 when the end of the text was reached.
+ */
+static int
+inv_next_term(const char **inout_ptr, char *term)
+{
+    const char *ptr = *inout_ptr; int size, digits;
+    
+    while( *ptr ) {
+        while( *ptr && !INV_IS_WORD_CHAR(*ptr) ) { ++ptr; }
+        size = digits = 0;
+        while( INV_IS_WORD_CHAR(*ptr) ) {
+            if( size < INV_MAX_TERM_SIZE-1 ) {
+                digits += g_ascii_isdigit(*ptr) ? 1 : 0;
+                term[size++] = g_ascii_tolower(*ptr);
+            }
+            ++ptr;
+        }
+        if( size>0 && digits<size ) {
+            term[size] = '\0';
+            (*inout_ptr) = ptr;
+            return size;
+        }
+    }
+    (*inout_ptr) = ptr;
+    return 0;
+}
+
+/**
+ * Returns TRUE if the terms of 'phrase' appear consecutively in 'text'.
+ * The last terms read from the text are kept in a circular buffer and
+ * compared with the phrase after every term.
+ */
+static gboolean
+inv_text_has_phrase(const char *text, const char *phrase)
+{
+    char terms[INV_MAX_QUERY_TERMS][INV_MAX_TERM_SIZE];
+    char window[INV_MAX_QUERY_TERMS][INV_MAX_TERM_SIZE];
+    const char *ptr; int count = 0, read = 0, i;
+    
+    ptr = phrase;
+    while( count<INV_MAX_QUERY_TERMS && inv_next_term(&ptr, terms[count]) ) {
+        ++count;
+    }
+    if( count==0 ) { return TRUE;  }
+    if( !text    ) { return FALSE; }
+    
+    ptr = text;
+    while( inv_next_term(&ptr, window[read % count]) ) {
+        if( ++read < count ) { continue; }
+        for( i=0 ; i<count ; ++i ) {
+            if( strcmp(window[(read+i) % count], terms[i])!=0 ) { break; }
+        }
+        if( i==count ) { return TRUE; }
+    }
+    return FALSE;
+}
+
+
+/*---------------------------- POSTING LISTS ------------------------------*/
+
+static void
+inv_postings_add(InvPostings *postings, guint32 doc)
+{
+    InvSkip skip; guint32 gap; guint8 byte;
+    
+    if( postings->count>0 && postings->last==doc ) { return; }
+    if( !postings->bytes ) { postings->bytes = g_byte_array_new(); }
+    if( postings->count>0 && postings->count % INV_SKIP_INTERVAL==0 ) {
+        if( !postings->skips ) {
+            postings->skips = g_array_new(FALSE, FALSE, sizeof(InvSkip));
+        }
+        skip.prev_doc = postings->last;
+        skip.offset   = postings->bytes->len;
+        g_array_append_val(postings->skips, skip);
+    }
+    gap = postings->count>0 ? doc - postings->last : doc;
+    do {
+        byte = gap & 0x7F; gap >>= 7;
+        if( gap ) { byte |= 0x80; }
+        g_byte_array_append(postings->bytes, &byte, 1);
+    } while( gap );
+    postings->last = doc;
+    postings->count++;
+}
+
+static void
+inv_postings_clear(InvPostings *postings)
+{
+    if( postings->bytes ) { g_byte_array_unref(postings->bytes); }
+    if( postings->skips ) { g_array_unref(postings->skips); }
+    memset(postings, 0, sizeof(InvPostings));
+}
+
+typedef struct _InvCursor InvCursor;
+struct         _InvCursor {
+    const InvPostings *postings;
+    guint32 offset;     /* byte offset of the next gap     */
+    guint32 index;      /* ordinal of the next document    */
+    guint32 skip;       /* next skip entry to consider     */
+    guint32 doc;        /* current document (index>0)      */
+};
+
+static void
+inv_cursor_init(InvCursor *cursor, const InvPostings *postings)
+{
+    memset(cursor, 0, sizeof(InvCursor));
+    cursor->postings = postings;
+}
+
+/* Moves to the next document, returns FALSE at the end of the list */
+static gboolean
+inv_cursor_next(InvCursor *cursor)
+{
+    const guint8 *bytes; guint32 gap = 0; int shift = 0;
+    
+    if( cursor->index >= cursor->postings->count ) { return FALSE; }
+    bytes = cursor->postings->bytes->data;
+    do {
+        gap   |= (guint32)(bytes[cursor->offset] & 0x7F) << shift;
+        shift += 7;
+    } while( bytes[cursor->offset++] & 0x80 );
+    cursor->doc = cursor->index>0 ? cursor->doc + gap : gap;
+    cursor->index++;
+    return TRUE;
+}
+
+/* Moves to the first document >= 'target', returns FALSE if there is none */
+static gboolean
+inv_cursor_seek(InvCursor *cursor, guint32 target)
+{
+    const GArray *skips = cursor->postings->skips; const InvSkip *skip;
+    guint32 block_index;
+    
+    if( cursor->index>0 && cursor->doc>=target ) { return TRUE; }
+    
+    /* jump to the last block that starts before 'target' */
+    while( skips && cursor->skip < skips->len ) {
+        skip = &g_array_index(skips, InvSkip, cursor->skip);
+        if( skip->prev_doc >= target ) { break; }
+        block_index = (cursor->skip+1) * INV_SKIP_INTERVAL;
+        if( block_index > cursor->index ) {
+            cursor->offset = skip->offset;
+            cursor->index  = block_index;
+            cursor->doc    = skip->prev_doc;
+        }
+        cursor->skip++;
+    }
+    while( inv_cursor_next(cursor) ) {
+        if( cursor->doc>=target ) { return TRUE; }
+    }
+    return FALSE;
+}
+
+
+/*------------------------------ INVERTED INDEX ---------------------------*/
+
+static void
+free_inv_term(InvTerm *term)
+{
+    int i;
+    for( i=0 ; i<INV_FIELD_COUNT ; ++i ) { inv_postings_clear(&term->fields[i]); }
+    g_free(term);
+}
+
+static InvIndex *
+new_inv_index(void)
+{
+    InvIndex *index = g_new0(InvIndex, 1);
+    index->terms    = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                            NULL, (GDestroyNotify)free_inv_term);
+    index->strings  = g_string_chunk_new(64*1024);
+    return index;
+}
+
+static void
+free_inv_index(InvIndex *index)
+{
+    if( !index ) { return; }
+    g_hash_table_destroy(index->terms);
+    g_string_chunk_free(index->strings);
+    g_free(index);
+}
+
+/**
+ * Adds the terms of 'text' to the index under document 'doc'.
+ * Documents must be added in increasing order (a document may be added
+ * several times in a row, once per field).
+ */
+static void
+inv_index_add_text(InvIndex *index, guint32 doc, InvField field, const char *text)
+{
+    char term[INV_MAX_TERM_SIZE]; InvTerm *inv_term; gchar *key;
+    
+    if( doc >= index->doc_count ) { index->doc_count = doc+1; }
+    if( !text ) { return; }
+    while( inv_next_term(&text, term) ) {
+        inv_term = g_hash_table_lookup(index->terms, term);
+        if( !inv_term ) {
+            key      = g_string_chunk_insert(index->strings, term);
+            inv_term = g_new0(InvTerm, 1);
+            g_hash_table_insert(index->terms, key, inv_term);
+        }
+        inv_postings_add(&inv_term->fields[field], doc);
+    }
+}
+
+
+/*------------------------------- SEARCH ----------------------------------*/
+
+typedef struct _InvQuery InvQuery;
+struct         _InvQuery {
+    int terms_count;
+    struct { char text[INV_MAX_TERM_SIZE]; InvField field; } terms[INV_MAX_QUERY_TERMS];
+    int phrases_count;
+    struct { char *text; InvField field; } phrases[INV_MAX_QUERY_PHRASES];
+};
+
+static void
+inv_query_add(InvQuery *query, const char *text, int text_size, InvField field)
+{
+    char *copy = g_strndup(text, text_size); const char *ptr = copy;
+    int first = query->terms_count;
+    
+    while( query->terms_count<INV_MAX_QUERY_TERMS &&
+           inv_next_term(&ptr, query->terms[query->terms_count].text) ) {
+        query->terms[query->terms_count++].field = field;
+    }
+    /* only phrases of more than one term need to be checked in the text */
+    if( query->terms_count-first > 1 &&
+        query->phrases_count<INV_MAX_QUERY_PHRASES ) {
+        query->phrases[query->phrases_count].text  = copy;
+        query->phrases[query->phrases_count].field = field;
+        query->phrases_count++;
+        return;
+    }
+    g_free(copy);
+}
+
+static void
+inv_parse_query(InvQuery *query, const char *text)
+{
+    const char *start; InvField field;
+    
+    memset(query, 0, sizeof(InvQuery));
+    while( text && *text ) {
+        while( *text==' ' || *text=='\t' ) { ++text; }
+        field = INV_FIELD_PROMPT;
+        if( g_ascii_strncasecmp(text, INV_NEGATIVE_PREFIX,
+                                strlen(INV_NEGATIVE_PREFIX))==0 ) {
+            field = INV_FIELD_NEGATIVE;
+            text += strlen(INV_NEGATIVE_PREFIX);
+        }
+        if( *text=='"' ) {
+            start = ++text;
+            while( *text && *text!='"' ) { ++text; }
+        } else {
+            start = text;
+            while( *text && *text!=' ' && *text!='\t' ) { ++text; }
+        }
+        inv_query_add(query, start, text-start, field);
+        if( *text ) { ++text; }
+    }
+}
+
+static void
+inv_query_clear(InvQuery *query)
+{
+    int i;
+    for( i=0 ; i<query->phrases_count ; ++i ) { g_free(query->phrases[i].text); }
+    query->phrases_count = 0;
+}
+
+static int
+inv_compare_postings(gconstpointer a, gconstpointer b)
+{
+    const InvPostings *pa = *(InvPostings * const *)a;
+    const InvPostings *pb = *(InvPostings * const *)b;
+    return (pa->count > pb->count) - (pa->count < pb->count);
+}
+
+/**
+ * Searches the documents that match the query.
+ * 
+ * The terms are intersected starting from the shortest posting list, so
+ * the cost depends on the rarest term rather than on the folder size.
+ * 
+ * @param index     The inverted index.
+ * @param text      The query (see the syntax at the top of this file).
+ * @param get_text  Returns the text of a document, used to check phrases.
+ * @param user_data Data passed to 'get_text'.
+ * @returns
+ *    A new GArray with the sorted ids (guint32) of the matching documents,
+ *    or NULL if the query contains no terms (everything matches).
+ */
+static GArray *
+inv_index_search(InvIndex    *index,
+                 const char  *text,
+                 InvTextFunc  get_text,
+                 gpointer     user_data)
+{
+    InvQuery query; InvTerm *inv_term; InvCursor cursors[INV_MAX_QUERY_TERMS];
+    const InvPostings *lists[INV_MAX_QUERY_TERMS];
+    GArray *result; guint32 doc; int i, count; gboolean match, exhausted;
+    
+    inv_parse_query(&query, text);
+    if( query.terms_count==0 ) { inv_query_clear(&query); return NULL; }
+    
+    result = g_array_new(FALSE, FALSE, sizeof(guint32));
+    for( i=0 ; i<query.terms_count ; ++i ) {
+        inv_term = g_hash_table_lookup(index->terms, query.terms[i].text);
+        lists[i] = inv_term ? &inv_term->fields[ query.terms[i].field ] : NULL;
+        if( !lists[i] || lists[i]->count==0 ) {
+            inv_query_clear(&query);
+            return result;
+        }
+    }
+    count = query.terms_count;
+    qsort(lists, count, sizeof(lists[0]), inv_compare_postings);
+    for( i=0 ; i<count ; ++i ) { inv_cursor_init(&cursors[i], lists[i]); }
+    
+    exhausted = FALSE;
+    while( !exhausted && inv_cursor_next(&cursors[0]) ) {
+        doc   = cursors[0].doc;
+        match = TRUE;
+        for( i=1 ; i<count && match ; ++i ) {
+            exhausted = !inv_cursor_seek(&cursors[i], doc);
+            match     = !exhausted && cursors[i].doc==doc;
+        }
+        for( i=0 ; i<query.phrases_count && match ; ++i ) {
+            match = get_text &&
+                    inv_text_has_phrase(get_text(doc, query.phrases[i].field, user_data),
+                                        query.phrases[i].text);
+        }
+        if( match ) { g_array_append_val(result, doc); }
+    }
+    inv_query_clear(&query);
+    return result;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file    utils_json.h
+ * @brief   A small pull tokenizer for JSON text written in bare C code.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The tokenizer never builds a tree and never allocates memory; it only
+    walks the input buffer and returns one token at a time. Strings are
+    returned as slices of the input buffer (without the quotes) and can be
+    decoded later with 'copy_json_string()' if their content is needed.
+
+    USAGE EXAMPLE
+    -------------
+
+      JSONTokenizer tokenizer; JSONToken token;
+      
+      init_json_tokenizer( &tokenizer, text, -1 );
+      while( next_json_token( &tokenizer, &token ) ) {
+          if( token.type == JSON_KEY && token.depth == 1 ) {
+              [ ... a top-level key was found ... ]
+          }
+      }
+*/
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum nesting level accepted by the tokenizer */
+#define JSON_MAX_DEPTH 256
+
+typedef enum _JSONTokenType JSONTokenType;
+enum         _JSONTokenType {
+    JSON_NONE,
+    JSON_OBJECT_BEGIN,
+    JSON_OBJECT_END,
+    JSON_ARRAY_BEGIN,
+    JSON_ARRAY_END,
+    JSON_KEY,
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL
+};
+
+/**
+ * A token extracted from the JSON text. For keys and strings 'start' points
+ * to the first character after the opening quote and 'size' excludes both
+ * quotes; 'has_escapes' indicates that the slice contains '\' sequences
+ * and must be decoded with 'copy_json_string()' before being displayed.
+ * 'depth' is the nesting level where the token lives (1 = top-level object)
+ */
+typedef struct _JSONToken JSONToken;
+struct         _JSONToken {
+    JSONTokenType type;
+    const char   *start;
+    int           size;
+    int           has_escapes;
+    int           depth;
+};
+
+typedef struct _JSONTokenizer JSONTokenizer;
+struct         _JSONTokenizer {
+    const char *ptr;
+    const char *end;
+    int         depth;
+    int         error;
+};
+
+#define JSON_IS_SPACE(x) ((x)==' ' || (x)=='\t' || (x)=='\n' || (x)=='\r')
+
+
+static void
+init_json_tokenizer(JSONTokenizer *tokenizer,
+                    const char    *text,
+                    int            text_size)
+{
+    if( text_size < 0 ) { text_size = strlen( text ); }
+    tokenizer->ptr   = text;
+    tokenizer->end   = text + text_size;
+    tokenizer->depth = 0;
+    tokenizer->error = 0;
+}
+
+static void
+json_skip_spaces_and_separators(JSONTokenizer *tokenizer)
+{
+    const char *ptr = tokenizer->ptr, *end = tokenizer->end;
+    while( ptr<end && (JSON_IS_SPACE(*ptr) || *ptr==',' || *ptr==':') ) {
+        ++ptr;
+    }
+    tokenizer->ptr = ptr;
+}
+
+static int
+json_set_error(JSONTokenizer *tokenizer)
+{
+    tokenizer->error = 1;
+    tokenizer->ptr   = tokenizer->end;
+    return 0;
+}
+
+/**
+ * Reads the next token from the JSON text.
+ * 
+ * The tokenizer is tolerant: commas and colons are treated as whitespace,
+ * a string followed by ':' is reported as JSON_KEY and any other string is
+ * reported as JSON_STRING. Only what is needed to walk the text is checked.
+ * 
+ * @param tokenizer The tokenizer initialized with 'init_json_tokenizer()'.
+ * @param token     Pointer to the struct that receives the token.
+ * @returns
+ *     1 if a token was read, or 0 at the end of the text or on error
+ *     (in which case 'tokenizer->error' is set).
+ */
+static int
+next_json_token(JSONTokenizer *tokenizer, JSONToken *token)
+{
+    const char *ptr, *end, *start; int has_escapes;
+    
+    json_skip_spaces_and_separators( tokenizer );
+    ptr = tokenizer->ptr; end = tokenizer->end;
+    if( ptr>=end || tokenizer->error ) { return 0; }
+    
+    token->start       = ptr;
+    token->size        = 1;
+    token->has_escapes = 0;
+    token->depth       = tokenizer->depth;
+    switch( *ptr )
+    {
+        case '{':
+        case '[':
+            if( tokenizer->depth >= JSON_MAX_DEPTH ) {
+                return json_set_error( tokenizer );
+            }
+            token->type  = (*ptr=='{') ? JSON_OBJECT_BEGIN : JSON_ARRAY_BEGIN;
+            token->depth = ++tokenizer->depth;
+            tokenizer->ptr = ptr+1;
+            return 1;
+            
+        case '}':
+        case ']':
+            if( tokenizer->depth <= 0 ) { return json_set_error( tokenizer ); }
+            token->type = (*ptr=='}') ? JSON_OBJECT_END : JSON_ARRAY_END;
+            --tokenizer->depth;
+            tokenizer->ptr = ptr+1;
+            return 1;
+            
+        case '"':
+            start = ++ptr; has_escapes = 0;
+            while( ptr<end && *ptr!='"' ) {
+                if( *ptr=='\\' ) { has_escapes = 1; ++ptr; }
+                ++ptr;
+            }
+            if( ptr>=end ) { return json_set_error( tokenizer ); }
+            token->start       = start;
+            token->size        = (ptr - start);
+            token->has_escapes = has_escapes;
+            tokenizer->ptr     = ++ptr;
+            while( ptr<end && JSON_IS_SPACE(*ptr) ) { ++ptr; }
+            token->type = (ptr<end && *ptr==':') ? JSON_KEY : JSON_STRING;
+            return 1;
+            
+        case 't': case 'f': case 'n':
+            start = ptr;
+            while( ptr<end && 'a'<=*ptr && *ptr<='z' ) { ++ptr; }
+            token->size = (ptr - start);
+            if     ( token->size==4 && memcmp(start,"true" ,4)==0 ) { token->type = JSON_TRUE;  }
+            else if( token->size==5 && memcmp(start,"false",5)==0 ) { token->type = JSON_FALSE; }
+            else if( token->size==4 && memcmp(start,"null" ,4)==0 ) { token->type = JSON_NULL;  }
+            else { return json_set_error( tokenizer ); }
+            tokenizer->ptr = ptr;
+            return 1;
+            
+        default:
+            start = ptr;
+            while( ptr<end && (('0'<=*ptr && *ptr<='9') || *ptr=='-' ||
+                   *ptr=='+' || *ptr=='.' || *ptr=='e' || *ptr=='E') ) { ++ptr; }
+            if( ptr==start ) { return json_set_error( tokenizer ); }
+            token->type    = JSON_NUMBER;
+            token->size    = (ptr - start);
+            tokenizer->ptr = ptr;
+            return 1;
+    }
+}
+
+/**
+ * Skips the value that begins with the given token.
+ * 
+ * If @token opens an object or an array, the tokenizer is advanced until
+ * the matching closing bracket; for any other token nothing is done.
+ * No memory is needed to skip a value, no matter how big it is.
+ * 
+ * @returns 1 on success, or 0 if the text ended before the value was closed.
+ */
+static int
+skip_json_value(JSONTokenizer *tokenizer, const JSONToken *token)
+{
+    const char *ptr, *end; int depth, in_string;
+    if( token->type!=JSON_OBJECT_BEGIN && token->type!=JSON_ARRAY_BEGIN ) {
+        return 1;
+    }
+    /* fast scan: only brackets and string delimiters are relevant here */
+    ptr = tokenizer->ptr; end = tokenizer->end;
+    depth = 1; in_string = 0;
+    while( ptr<end && depth>0 ) {
+        if( in_string ) {
+            if     ( *ptr=='\\' ) { ++ptr;        }
+            else if( *ptr=='"'  ) { in_string = 0; }
+        }
+        else switch( *ptr ) {
+            case '"': in_string = 1; break;
+            case '{': case '[': ++depth; break;
+            case '}': case ']': --depth; break;
+        }
+        ++ptr;
+    }
+    if( depth>0 ) { return json_set_error( tokenizer ); }
+    tokenizer->ptr = ptr;
+    --tokenizer->depth;
+    return 1;
+}
+
+static int
+json_hex4(const char *ptr, const char *end)
+{
+    int i, value = 0, ch;
+    if( end-ptr < 4 ) { return -1; }
+    for( i=0 ; i<4 ; ++i ) {
+        ch = ptr[i]; value <<= 4;
+        if     ( '0'<=ch && ch<='9' ) { value |= ch-'0';    }
+        else if( 'a'<=ch && ch<='f' ) { value |= ch-'a'+10; }
+        else if( 'A'<=ch && ch<='F' ) { value |= ch-'A'+10; }
+        else { return -1; }
+    }
+    return value;
+}
+
+static int
+json_put_utf8(char *out, unsigned long code)
+{
+    if( code < 0x80 ) {
+        out[0] = (char)code; return 1;
+    } else if( code < 0x800 ) {
+        out[0] = (char)(0xC0 | (code>>6));
+        out[1] = (char)(0x80 | (code & 0x3F)); return 2;
+    } else if( code < 0x10000 ) {
+        out[0] = (char)(0xE0 | (code>>12));
+        out[1] = (char)(0x80 | ((code>>6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F)); return 3;
+    }
+    out[0] = (char)(0xF0 | (code>>18));
+    out[1] = (char)(0x80 | ((code>>12) & 0x3F));
+    out[2] = (char)(0x80 | ((code>>6)  & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F)); return 4;
+}
+
+/**
+ * Decodes a JSON string slice into a NUL-terminated buffer.
+ * 
+ * Escape sequences (including '\uXXXX' and surrogate pairs) are converted
+ * to UTF-8. The output is truncated if it doesn't fit in @out_size bytes.
+ * 
+ * @param out      The buffer that receives the decoded string.
+ * @param out_size The size of @out in bytes (including the NUL character).
+ * @param str      The first character of the slice (a JSONToken 'start').
+ * @param str_size The number of bytes in the slice (a JSONToken 'size').
+ * @returns
+ *     The length of the decoded string, without the NUL character.
+ */
+static int
+copy_json_string(char *out, int out_size, const char *str, int str_size)
+{
+    const char *ptr = str, *end = str+str_size;
+    char utf8[4]; long code, low; int len = 0, n;
+    
+    if( out_size<=0 ) { return 0; }
+    while( ptr<end ) {
+        if( *ptr!='\\' || ptr+1>=end ) {
+            if( len+1 >= out_size ) { break; }
+            out[len++] = *ptr++;
+            continue;
+        }
+        ++ptr;
+        switch( *ptr++ ) {
+            case 'n': utf8[0] = '\n'; n = 1; break;
+            case 't': utf8[0] = '\t'; n = 1; break;
+            case 'r': utf8[0] = '\r'; n = 1; break;
+            case 'b': utf8[0] = '\b'; n = 1; break;
+            case 'f': utf8[0] = '\f'; n = 1; break;
+            case 'u':
+                code = json_hex4( ptr, end );
+                if( code<0 ) { utf8[0] = '?'; n = 1; break; }
+                ptr += 4;
+                if( 0xD800<=code && code<=0xDBFF && end-ptr>=6 &&
+                    ptr[0]=='\\' && ptr[1]=='u' ) {
+                    low = json_hex4( ptr+2, end );
+                    if( 0xDC00<=low && low<=0xDFFF ) {
+                        code = 0x10000 + ((code-0xD800)<<10) + (low-0xDC00);
+                        ptr += 6;
+                    }
+                }
+                n = json_put_utf8( utf8, (unsigned long)code );
+                break;
+            default:
+                utf8[0] = ptr[-1]; n = 1; break;
+        }
+        if( len+n >= out_size ) { break; }
+        memcpy( &out[len], utf8, n ); len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * Compares a JSON key/string token with a NUL-terminated string.
+ * @returns 1 if both are equal, 0 otherwise.
+ */
+static int
+json_token_equals(const JSONToken *token, const char *str)
+{
+    int str_size = strlen( str );
+    return token->size==str_size && memcmp( token->start, str, str_size )==0;
+}
+
@@ -0,0 +1,614 @@
+/**
+ * @file    utils_models.h
+ * @brief   Resolves A1111 model hashes to the files of a local models directory.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    A1111 stores short hashes of the models used to generate an image:
+    
+      "Model hash"   the first 10 hex digits of the SHA-256 of the file
+      "Lora hashes"  the first 12 hex digits of the SHA-256 of the tensors
+                     (a .safetensors file without its JSON header)
+      old images     8 hex digits of the SHA-256 of the 64KB at 0x100000
+    
+    A model index maps those hashes (and the full ones) to the files found
+    in a local models directory. All the hashes of a file are computed in a
+    single pass and files are hashed in parallel by a GThreadPool. Results
+    are kept in a TSV cache keyed by path, size and modification time, so
+    multi-GB files are only hashed once.
+    
+    NOTE: 'utils_json.h' must be included first.
+*/
+#include <glib.h>
+#include <gio/gio.h>
+#if !defined( JSON_MAX_DEPTH )
+#  error "utils_models.h requires utils_json.h"
+#endif
+
+/* Size of the buffer used to read each file while hashing it */
+#define MODEL_READ_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* Largest safetensors header parsed to extract its metadata */
+#define MODEL_MAX_HEADER_SIZE  (64 * 1024 * 1024)
+
+/* Range of the file hashed by the legacy A1111 model hash */
+#define MODEL_LEGACY_OFFSET    0x100000
+#define MODEL_LEGACY_SIZE      0x10000
+
+/* Maximum depth of subdirectories scanned inside the models directory */
+#define MODEL_MAX_SCAN_DEPTH   8
+
+#define MODEL_CACHE_SIGNATURE  "# sdprompt-viewer model hashes v1"
+#define MODEL_SCAN_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+typedef struct _ModelInfo ModelInfo;
+struct         _ModelInfo {
+    gchar  *path;
+    gchar  *name;            /* file name without extension           */
+    gint64  size;
+    gint64  mtime;
+    gchar   sha256[65];      /* whole file                            */
+    gchar   addnet[65];      /* tensors only (empty if not safetensors) */
+    gchar   legacy[9];       /* old A1111 hash                        */
+    gchar  *title;           /* safetensors metadata, or NULL         */
+    gchar  *base_model;      /* safetensors metadata, or NULL         */
+};
+
+typedef struct _ModelIndex ModelIndex;
+struct         _ModelIndex {
+    GPtrArray  *models;      /* ModelInfo*, owned by the index        */
+    GHashTable *by_path;     /* path -> ModelInfo                     */
+    GHashTable *by_hash;     /* lowercase hash or short hash -> ModelInfo */
+};
+
+
+/*---------------------------- MODEL INFO ---------------------------------*/
+
+static ModelInfo *
+new_model_info( const gchar *path, gint64 size, gint64 mtime )
+{
+    ModelInfo *info; gchar *basename, *dot;
+    info        = g_new0( ModelInfo, 1 );
+    info->path  = g_strdup( path );
+    info->size  = size;
+    info->mtime = mtime;
+    basename    = g_path_get_basename( path );
+    dot         = strrchr( basename, '.' );
+    if( dot && dot!=basename ) { *dot = '\0'; }
+    info->name  = basename;
+    return info;
+}
+
+static void
+free_model_info( ModelInfo *info )
+{
+    if( !info ) { return; }
+    g_free( info->path );
+    g_free( info->name );
+    g_free( info->title );
+    g_free( info->base_model );
+    g_free( info );
+}
+
+static gboolean
+is_safetensors_path( const gchar *path )
+{
+    return g_str_has_suffix( path, ".safetensors" );
+}
+
+static gboolean
+is_model_path( const gchar *path )
+{
+    return is_safetensors_path( path ) || g_str_has_suffix( path, ".ckpt" );
+}
+
+/* Reads the title and base model from the '__metadata__' of a header */
+static void
+parse_safetensors_metadata( ModelInfo *info, const char *header, int size )
+{
+    JSONTokenizer tokenizer; JSONToken key, value; gchar **target;
+    gchar buffer[256];
+    
+    init_json_tokenizer( &tokenizer, header, size );
+    while( next_json_token( &tokenizer, &key ) ) {
+        if( key.type!=JSON_KEY || !next_json_token( &tokenizer, &value ) ) {
+            continue;
+        }
+        /* tensor descriptions are skipped without tokenizing them */
+        if( key.depth==1 ) {
+            if( !json_token_equals( &key, "__metadata__" ) ) {
+                skip_json_value( &tokenizer, &value );
+            }
+            continue;
+        }
+        if( key.depth!=2 || value.type!=JSON_STRING ) {
+            skip_json_value( &tokenizer, &value );
+            continue;
+        }
+        target = NULL;
+        if( json_token_equals( &key, "modelspec.title" ) ||
+            (json_token_equals( &key, "ss_output_name" ) && !info->title) )
+        { target = &info->title; }
+        else if( json_token_equals( &key, "modelspec.architecture" ) ||
+                 (json_token_equals( &key, "ss_base_model_version" ) &&
+                  !info->base_model) )
+        { target = &info->base_model; }
+        
+        if( target && value.size>0 ) {
+            copy_json_string( buffer, sizeof(buffer), value.start, value.size );
+            g_free( *target );
+            (*target) = g_strdup( buffer );
+        }
+    }
+}
+
+
+/*------------------------------- HASHING ---------------------------------*/
+
+typedef struct _ModelHasher ModelHasher;
+struct         _ModelHasher {
+    GChecksum *full;
+    GChecksum *addnet;         /* NULL if the file is not safetensors */
+    GChecksum *legacy;
+    goffset    addnet_start;   /* first byte of the tensors           */
+};
+
+/* Feeds the bytes at 'offset' of the file to the three hashes */
+static void
+model_hasher_update( ModelHasher *hasher, const guchar *data, gsize size,
+                     goffset offset )
+{
+    goffset lo, hi, skip;
+    g_checksum_update( hasher->full, data, size );
+    if( hasher->addnet && offset+(goffset)size > hasher->addnet_start ) {
+        skip = MAX( 0, hasher->addnet_start - offset );
+        g_checksum_update( hasher->addnet, data+skip, size-skip );
+    }
+    lo = MAX( offset, MODEL_LEGACY_OFFSET );
+    hi = MIN( offset+(goffset)size, MODEL_LEGACY_OFFSET+MODEL_LEGACY_SIZE );
+    if( lo<hi ) {
+        g_checksum_update( hasher->legacy, data+(lo-offset), hi-lo );
+    }
+}
+
+static gboolean
+model_read( GInputStream *stream, guchar *buffer, gsize size, gsize *out_read,
+            GCancellable *cancellable )
+{
+    return g_input_stream_read_all( stream, buffer, size, out_read,
+                                    cancellable, NULL );
+}
+
+/**
+ * hash_model_file - Computes the A1111 hashes of a model file.
+ * @info:        the model, its 'path' must be set.
+ * @cancellable: (nullable): a #GCancellable to stop hashing.
+ *
+ * Reads the whole file once, computing the full, tensors-only and legacy
+ * SHA-256 at the same time. The metadata of safetensors files is read
+ * from the header that is hashed anyway. This function blocks, so it's
+ * meant to be called from a worker thread.
+ *
+ * Returns: %TRUE if the file was hashed.
+ */
+static gboolean
+hash_model_file( ModelInfo *info, GCancellable *cancellable )
+{
+    ModelHasher hasher; GFile *file; GFileInputStream *stream;
+    guchar *buffer, *header; gsize read = 0; goffset offset = 0;
+    guint64 header_size; gboolean ok = FALSE; int i;
+    
+    file   = g_file_new_for_path( info->path );
+    stream = g_file_read( file, cancellable, NULL );
+    g_object_unref( file );
+    if( !stream ) { return FALSE; }
+    
+    buffer = g_malloc( MODEL_READ_BUFFER_SIZE );
+    hasher.full         = g_checksum_new( G_CHECKSUM_SHA256 );
+    hasher.legacy       = g_checksum_new( G_CHECKSUM_SHA256 );
+    hasher.addnet       = NULL;
+    hasher.addnet_start = 0;
+    
+    /* safetensors: 8-byte little-endian header size + JSON header */
+    if( is_safetensors_path( info->path ) &&
+        model_read( G_INPUT_STREAM(stream), buffer, 8, &read, cancellable ) &&
+        read==8 )
+    {
+        for( i=7, header_size=0 ; i>=0 ; --i ) {
+            header_size = (header_size << 8) | buffer[i];
+        }
+        hasher.addnet       = g_checksum_new( G_CHECKSUM_SHA256 );
+        hasher.addnet_start = 8 + header_size;
+        model_hasher_update( &hasher, buffer, read, offset );
+        offset += read;
+        if( header_size<=MODEL_MAX_HEADER_SIZE ) {
+            header = g_malloc( header_size );
+            if( model_read( G_INPUT_STREAM(stream), header, header_size,
+                            &read, cancellable ) ) {
+                model_hasher_update( &hasher, header, read, offset );
+                offset += read;
+                parse_safetensors_metadata( info, (const char *)header, read );
+            }
+            g_free( header );
+        }
+    }
+    else { model_hasher_update( &hasher, buffer, read, offset ); offset += read; }
+    
+    while( (ok = model_read( G_INPUT_STREAM(stream), buffer,
+                             MODEL_READ_BUFFER_SIZE, &read, cancellable )) &&
+           read>0 )
+    {
+        model_hasher_update( &hasher, buffer, read, offset );
+        offset += read;
+    }
+    if( ok ) {
+        g_strlcpy( info->sha256, g_checksum_get_string( hasher.full ), 65 );
+        g_strlcpy( info->legacy, g_checksum_get_string( hasher.legacy ), 9 );
+        if( hasher.addnet ) {
+            g_strlcpy( info->addnet, g_checksum_get_string( hasher.addnet ), 65 );
+        }
+    }
+    g_checksum_free( hasher.full );
+    g_checksum_free( hasher.legacy );
+    if( hasher.addnet ) { g_checksum_free( hasher.addnet ); }
+    g_free( buffer );
+    g_object_unref( stream );
+    return ok;
+}
+
+
+/*-------------------------------- INDEX ----------------------------------*/
+
+static ModelIndex *
+new_model_index( void )
+{
+    ModelIndex *index = g_new0( ModelIndex, 1 );
+    index->models  = g_ptr_array_new_with_free_func( (GDestroyNotify)free_model_info );
+    index->by_path = g_hash_table_new( g_str_hash, g_str_equal );
+    index->by_hash = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, NULL );
+    return index;
+}
+
+static void
+free_model_index( ModelIndex *index )
+{
+    if( !index ) { return; }
+    g_hash_table_destroy( index->by_hash );
+    g_hash_table_destroy( index->by_path );
+    g_ptr_array_unref( index->models );
+    g_free( index );
+}
+
+static void
+model_index_add_hash( ModelIndex *index, const gchar *hash, int size,
+                      ModelInfo *info )
+{
+    if( hash[0]!='\0' ) {
+        g_hash_table_insert( index->by_hash, g_strndup( hash, size ), info );
+    }
+}
+
+/* Adds a model to the index, the index takes ownership of 'info' */
+static void
+model_index_add( ModelIndex *index, ModelInfo *info )
+{
+    g_ptr_array_add( index->models, info );
+    g_hash_table_insert( index->by_path, info->path, info );
+    model_index_add_hash( index, info->sha256, 64, info );
+    model_index_add_hash( index, info->sha256, 10, info );
+    model_index_add_hash( index, info->addnet, 64, info );
+    model_index_add_hash( index, info->addnet, 12, info );
+    model_index_add_hash( index, info->legacy,  8, info );
+}
+
+/**
+ * lookup_model_by_hash - Finds the model that has the given hash.
+ * @index: (nullable): the model index.
+ * @hash:  a full SHA-256 or one of the short hashes used by A1111.
+ * @size:  the number of characters in @hash, or -1 if NUL-terminated.
+ *
+ * Returns: (transfer none): the model, or %NULL if it's not in the index.
+ */
+static const ModelInfo *
+lookup_model_by_hash( const ModelIndex *index, const gchar *hash, int size )
+{
+    gchar key[65]; int i;
+    if( !index || !hash ) { return NULL; }
+    if( size<0 ) { size = strlen( hash ); }
+    if( size<8 || size>64 ) { return NULL; }
+    for( i=0 ; i<size ; ++i ) { key[i] = g_ascii_tolower( hash[i] ); }
+    key[size] = '\0';
+    return g_hash_table_lookup( index->by_hash, key );
+}
+
+/**
+ * resolve_model_hashes - Appends the model file names to the hashes of a text.
+ * @index: (nullable): the model index.
+ * @text:  a text containing hashes, e.g. "detail: 0123456789ab, style: ...".
+ *
+ * Every hexadecimal word of @text that matches a model of the index is
+ * followed by the model name between parentheses.
+ *
+ * Returns: (transfer full): the new text, or %NULL if no hash was resolved.
+ */
+static gchar *
+resolve_model_hashes( const ModelIndex *index, const gchar *text )
+{
+    const gchar *ptr, *start; const ModelInfo *info;
+    GString *result = NULL; int size;
+    
+    if( !index || !text ) { return NULL; }
+    for( ptr=text ; *ptr ; ) {
+        if( !g_ascii_isxdigit( *ptr ) || (ptr>text && g_ascii_isalnum( ptr[-1] )) ) {
+            ++ptr; continue;
+        }
+        for( start=ptr ; g_ascii_isxdigit( *ptr ) ; ++ptr ) { }
+        size = ptr - start;
+        if( g_ascii_isalnum( *ptr ) ) { continue; }
+        info = lookup_model_by_hash( index, start, size );
+        if( info ) {
+            if( !result ) { result = g_string_new_len( text, ptr-text ); }
+            else          { g_string_append_len( result, text, ptr-text ); }
+            g_string_append_printf( result, " (%s)", info->name );
+            text = ptr;
+        }
+    }
+    if( !result ) { return NULL; }
+    g_string_append( result, text );
+    return g_string_free( result, FALSE );
+}
+
+
+/*-------------------------------- CACHE ----------------------------------*/
+
+/**
+ * get_model_cache_path - Returns the path of the model hashes cache.
+ *
+ * Returns: (transfer full): "$XDG_CACHE_HOME/sdprompt-viewer/model-hashes.tsv"
+ */
+static gchar *
+get_model_cache_path( void )
+{
+    return g_build_filename( g_get_user_cache_dir(), "sdprompt-viewer",
+                             "model-hashes.tsv", NULL );
+}
+
+/* Loads the cache as a table path -> ModelInfo (owned by the table) */
+static GHashTable *
+load_model_cache( const gchar *cache_path )
+{
+    GHashTable *cache; ModelInfo *info;
+    gchar *contents = NULL, **lines, **fields, *path; int i;
+    
+    cache = g_hash_table_new_full( g_str_hash, g_str_equal, NULL,
+                                   (GDestroyNotify)free_model_info );
+    if( !g_file_get_contents( cache_path, &contents, NULL, NULL ) ) {
+        return cache;
+    }
+    lines = g_strsplit( contents, "\n", -1 );
+    if( lines[0] && strcmp( lines[0], MODEL_CACHE_SIGNATURE )==0 ) {
+        for( i=1 ; lines[i] ; ++i ) {
+            fields = g_strsplit( lines[i], "\t", 9 );
+            if( g_strv_length( fields )==8 ) {
+                path = g_strcompress( fields[0] );
+                info = new_model_info( path,
+                                       g_ascii_strtoll( fields[1], NULL, 10 ),
+                                       g_ascii_strtoll( fields[2], NULL, 10 ) );
+                g_strlcpy( info->sha256, fields[3], sizeof(info->sha256) );
+                g_strlcpy( info->addnet, fields[4], sizeof(info->addnet) );
+                g_strlcpy( info->legacy, fields[5], sizeof(info->legacy) );
+                info->title      = fields[6][0] ? g_strcompress( fields[6] ) : NULL;
+                info->base_model = fields[7][0] ? g_strcompress( fields[7] ) : NULL;
+                g_hash_table_replace( cache, info->path, info );
+                g_free( path );
+            }
+            g_strfreev( fields );
+        }
+    }
+    g_strfreev( lines );
+    g_free( contents );
+    return cache;
+}
+
+static void
+append_model_cache_line( GString *contents, const ModelInfo *info )
+{
+    gchar *path, *title, *base;
+    path  = g_strescape( info->path, NULL );
+    title = g_strescape( info->title ? info->title : "", NULL );
+    base  = g_strescape( info->base_model ? info->base_model : "", NULL );
+    g_string_append_printf( contents,
+                            "%s\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT
+                            "\t%s\t%s\t%s\t%s\t%s\n",
+                            path, info->size, info->mtime, info->sha256,
+                            info->addnet, info->legacy, title, base );
+    g_free( path ); g_free( title ); g_free( base );
+}
+
+/* Writes the models of 'index' followed by the entries kept in 'others' */
+static void
+save_model_cache( const ModelIndex *index, GHashTable *others,
+                  const gchar *cache_path )
+{
+    GString *contents; GHashTableIter iter; gpointer info; gchar *dir; guint i;
+    
+    contents = g_string_new( MODEL_CACHE_SIGNATURE "\n" );
+    for( i=0 ; i<index->models->len ; ++i ) {
+        append_model_cache_line( contents, g_ptr_array_index( index->models, i ) );
+    }
+    g_hash_table_iter_init( &iter, others );
+    while( g_hash_table_iter_next( &iter, NULL, &info ) ) {
+        append_model_cache_line( contents, info );
+    }
+    dir = g_path_get_dirname( cache_path );
+    g_mkdir_with_parents( dir, 0755 );
+    g_file_set_contents( cache_path, contents->str, contents->len, NULL );
+    g_free( dir );
+    g_string_free( contents, TRUE );
+}
+
+
+/*--------------------------------- SCAN ----------------------------------*/
+
+/* Returns TRUE if 'path' is inside the directory 'root' */
+static gboolean
+is_path_inside( const gchar *path, const gchar *root, gsize root_length )
+{
+    return strncmp( path, root, root_length )==0 &&
+           (path[root_length]==G_DIR_SEPARATOR ||
+            (root_length>0 && root[root_length-1]==G_DIR_SEPARATOR));
+}
+
+/* Collects the models of a directory, reusing the cached ones */
+static void
+model_scan_directory( GFile *directory, int depth, GHashTable *cache,
+                      GPtrArray *found, GPtrArray *to_hash,
+                      GCancellable *cancellable )
+{
+    GFileEnumerator *enumerator; GFileInfo *file_info; GFile *child;
+    ModelInfo *info; const gchar *name; gchar *path; gint64 size, mtime;
+    
+    enumerator = g_file_enumerate_children( directory, MODEL_SCAN_ATTRIBUTES,
+                                            G_FILE_QUERY_INFO_NONE,
+                                            cancellable, NULL );
+    if( !enumerator ) { return; }
+    while( (file_info = g_file_enumerator_next_file( enumerator, cancellable, NULL )) )
+    {
+        name  = g_file_info_get_name( file_info );
+        child = g_file_get_child( directory, name );
+        path  = g_file_get_path( child );
+        if( !path || name[0]=='.' ) {
+            /* hidden files and directories are ignored */
+        }
+        else if( g_file_info_get_file_type( file_info )==G_FILE_TYPE_DIRECTORY ) {
+            if( depth<MODEL_MAX_SCAN_DEPTH ) {
+                model_scan_directory( child, depth+1, cache, found, to_hash,
+                                      cancellable );
+            }
+        }
+        else if( is_model_path( path ) ) {
+            size  = g_file_info_get_size( file_info );
+            mtime = (gint64)g_file_info_get_attribute_uint64(
+                        file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED );
+            info  = g_hash_table_lookup( cache, path );
+            if( info && info->size==size && info->mtime==mtime ) {
+                /* the cached hashes are still valid */
+                g_hash_table_steal( cache, path );
+            } else {
+                info = new_model_info( path, size, mtime );
+                g_ptr_array_add( to_hash, info );
+            }
+            g_ptr_array_add( found, info );
+        }
+        g_free( path );
+        g_object_unref( child );
+        g_object_unref( file_info );
+    }
+    g_object_unref( enumerator );
+}
+
+static void
+model_hash_worker( gpointer data, gpointer user_data )
+{
+    ModelInfo *info = data; GCancellable *cancellable = user_data;
+    if( !hash_model_file( info, cancellable ) ) { info->sha256[0] = '\0'; }
+}
+
+/**
+ * scan_model_index - Builds the index of the models of a directory.
+ * @models_dir:  the directory that contains the models (recursively).
+ * @cache_path:  the path of the hashes cache.
+ * @cancellable: (nullable): a #GCancellable to stop the scan.
+ *
+ * Files whose size and modification time match the cache are not read
+ * again; the others are hashed in parallel using one thread per core.
+ * The cache is rewritten only when files were hashed or have disappeared
+ * from @models_dir. Cached files outside @models_dir are kept, so going
+ * back to a previous models directory doesn't hash it again.
+ * This function blocks, so it's meant to be called from a worker thread.
+ *
+ * Returns: (transfer full): the new index, release it with
+ *          free_model_index().
+ */
+static ModelIndex *
+scan_model_index( const gchar  *models_dir,
+                  const gchar  *cache_path,
+                  GCancellable *cancellable )
+{
+    GHashTable *cache; ModelIndex *index; GFile *directory; GThreadPool *pool;
+    GHashTableIter iter; gpointer path; GPtrArray *found, *to_hash;
+    ModelInfo *info; gchar *root; gsize root_length; gboolean changed; guint i;
+    
+    cache     = load_model_cache( cache_path );
+    found     = g_ptr_array_new();
+    to_hash   = g_ptr_array_new();
+    directory = g_file_new_for_path( models_dir );
+    root      = g_file_get_path( directory );
+    model_scan_directory( directory, 0, cache, found, to_hash, cancellable );
+    g_object_unref( directory );
+    
+    /* hash the new or modified files using all the cores */
+    if( to_hash->len>0 ) {
+        pool = g_thread_pool_new( model_hash_worker, cancellable,
+                                  g_get_num_processors(), FALSE, NULL );
+        for( i=0 ; i<to_hash->len ; ++i ) {
+            g_thread_pool_push( pool, g_ptr_array_index( to_hash, i ), NULL );
+        }
+        g_thread_pool_free( pool, FALSE, TRUE );
+    }
+    
+    index = new_model_index();
+    for( i=0 ; i<found->len ; ++i ) {
+        info = g_ptr_array_index( found, i );
+        if( info->sha256[0] ) { model_index_add( index, info ); }
+        else                  { free_model_info( info );        }
+    }
+    /* entries left in the cache inside the scanned directory belong to
+     * files that no longer exist, the ones outside it are kept */
+    changed     = to_hash->len>0;
+    root_length = root ? strlen( root ) : 0;
+    g_hash_table_iter_init( &iter, cache );
+    while( root && g_hash_table_iter_next( &iter, &path, NULL ) ) {
+        if( is_path_inside( path, root, root_length ) ) {
+            g_hash_table_iter_remove( &iter );
+            changed = TRUE;
+        }
+    }
+    if( changed && !g_cancellable_is_cancelled( cancellable ) ) {
+        save_model_cache( index, cache, cache_path );
+    }
+    g_hash_table_destroy( cache );
+    g_free( root );
+    g_ptr_array_free( to_hash, TRUE );
+    g_ptr_array_free( found, TRUE );
+    return index;
+}
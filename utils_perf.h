@@ -0,0 +1,238 @@
+/**
+ * @file    utils_perf.h
+ * @brief   Latency histograms for the stages of displaying an image.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    Each stage (reading the PNG, parsing, updating the widgets, ...) records
+    its duration in a log-linear histogram, in the style of HdrHistogram:
+    values are grouped by their power of two and each power of two is split
+    in PERF_SUB_BUCKETS linear buckets, so every percentile is reported with
+    an error below 1/PERF_SUB_BUCKETS whatever its magnitude.
+    
+    The statistics are global and protected by a mutex (the read and parse
+    stages run in worker threads). While they are disabled, perf_start()
+    returns 0 without reading the clock and perf_record() ignores it.
+*/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+/* Linear buckets per power of two (error below 1/16 = 6.25%) */
+#define PERF_SUB_BUCKET_BITS 4
+#define PERF_SUB_BUCKETS     (1<<PERF_SUB_BUCKET_BITS)
+
+/* Highest power of two recorded, larger values are clamped (~18 hours) */
+#define PERF_MAX_EXPONENT    36
+
+#define PERF_BUCKET_COUNT \
+    ((PERF_MAX_EXPONENT - PERF_SUB_BUCKET_BITS + 2) * PERF_SUB_BUCKETS)
+
+typedef enum _PerfStage {
+    PERF_READ,      /* opening the file and scanning its chunks        */
+    PERF_PARSE,     /* parameters, prompt tokens, CLIP count and spans */
+    PERF_DISPLAY,   /* filling the widgets (including UTF-8 repair)    */
+    PERF_LAYOUT,    /* from the widgets filled until the frame painted */
+    PERF_TOTAL,     /* from the selection change until painted         */
+    PERF_STAGE_COUNT
+} PerfStage;
+
+static const char *PERF_STAGE_NAMES[PERF_STAGE_COUNT] = {
+    "read", "parse", "display", "layout", "total"
+};
+
+typedef struct _PerfHistogram PerfHistogram;
+struct         _PerfHistogram {
+    guint64 count;
+    guint64 max;
+    guint32 buckets[PERF_BUCKET_COUNT];
+};
+
+static gboolean       perf_enabled = FALSE;
+static GMutex         perf_mutex;
+static PerfHistogram *perf_histograms; /* [PERF_STAGE_COUNT] */
+
+/*------------------------------ HISTOGRAMS -------------------------------*/
+
+static guint
+perf_bucket_index( guint64 value )
+{
+    guint exponent;
+    if( value < PERF_SUB_BUCKETS ) { return (guint)value; }
+    exponent = g_bit_storage( value ) - 1;
+    if( exponent > PERF_MAX_EXPONENT ) { return PERF_BUCKET_COUNT-1; }
+    return (exponent - PERF_SUB_BUCKET_BITS + 1) * PERF_SUB_BUCKETS +
+           (guint)( (value >> (exponent - PERF_SUB_BUCKET_BITS)) & (PERF_SUB_BUCKETS-1) );
+}
+
+/* the lowest value that falls in the bucket */
+static guint64
+perf_bucket_value( guint index )
+{
+    guint exponent;
+    if( index < PERF_SUB_BUCKETS ) { return index; }
+    exponent = index / PERF_SUB_BUCKETS + PERF_SUB_BUCKET_BITS - 1;
+    return (guint64)( PERF_SUB_BUCKETS + index % PERF_SUB_BUCKETS )
+           << (exponent - PERF_SUB_BUCKET_BITS);
+}
+
+/**
+ * perf_histogram_percentile - Gets a percentile of the recorded values.
+ * @histogram:  the histogram.
+ * @percentile: the percentile, between 0 and 100.
+ *
+ * Returns: the lowest value of the bucket that contains the percentile,
+ *          or 0 if nothing was recorded.
+ */
+static guint64
+perf_histogram_percentile( const PerfHistogram *histogram, double percentile )
+{
+    guint64 rank, seen = 0; guint i;
+    if( histogram->count==0 ) { return 0; }
+    rank = (guint64)( percentile / 100.0 * (double)histogram->count + 0.5 );
+    rank = CLAMP( rank, 1, histogram->count );
+    for( i=0 ; i<PERF_BUCKET_COUNT ; ++i ) {
+        seen += histogram->buckets[i];
+        if( seen >= rank ) { return MIN( perf_bucket_value( i ), histogram->max ); }
+    }
+    return histogram->max;
+}
+
+
+/*-------------------------------- STAGES ---------------------------------*/
+
+/**
+ * perf_init - Enables or disables the latency statistics.
+ * @enabled: TRUE to record the duration of each stage.
+ *
+ * The statistics are also enabled by the SDPROMPT_VIEWER_PERF environment
+ * variable (any value other than "0").
+ */
+static void
+perf_init( gboolean enabled )
+{
+    const gchar *env = g_getenv( "SDPROMPT_VIEWER_PERF" );
+    if( env && g_strcmp0( env, "0" )!=0 ) { enabled = TRUE; }
+    
+    g_mutex_lock( &perf_mutex );
+    if( enabled && !perf_histograms ) {
+        perf_histograms = g_new0( PerfHistogram, PERF_STAGE_COUNT );
+    }
+    g_atomic_int_set( &perf_enabled, enabled );
+    g_mutex_unlock( &perf_mutex );
+}
+
+/**
+ * perf_start - Starts measuring a stage.
+ *
+ * Returns: the current monotonic time (in microseconds) to be passed to
+ *          perf_record(), or 0 if the statistics are disabled.
+ */
+static gint64
+perf_start( void )
+{
+    if( !g_atomic_int_get( &perf_enabled ) ) { return 0; }
+    return g_get_monotonic_time();
+}
+
+/**
+ * perf_record - Records the duration of a stage.
+ * @stage: the stage measured.
+ * @start: the value returned by perf_start() when the stage began;
+ *         nothing is recorded if it's 0.
+ */
+static void
+perf_record( PerfStage stage, gint64 start )
+{
+    PerfHistogram *histogram; guint64 elapsed;
+    if( start==0 || stage>=PERF_STAGE_COUNT ) { return; }
+    elapsed = (guint64)MAX( g_get_monotonic_time() - start, 0 );
+    
+    g_mutex_lock( &perf_mutex );
+    if( perf_histograms ) {
+        histogram = &perf_histograms[stage];
+        histogram->buckets[ perf_bucket_index( elapsed ) ]++;
+        histogram->count++;
+        histogram->max = MAX( histogram->max, elapsed );
+    }
+    g_mutex_unlock( &perf_mutex );
+}
+
+/**
+ * perf_describe - Describes the statistics recorded so far.
+ *
+ * Returns: (transfer full): one line per stage with its p50, p95, p99 and
+ *          maximum latency, or NULL if nothing was recorded.
+ */
+static gchar *
+perf_describe( void )
+{
+    GString *text; const PerfHistogram *histogram; int stage;
+    
+    g_mutex_lock( &perf_mutex );
+    if( !perf_histograms ) { g_mutex_unlock( &perf_mutex ); return NULL; }
+    text = g_string_new( NULL );
+    for( stage=0 ; stage<PERF_STAGE_COUNT ; ++stage ) {
+        histogram = &perf_histograms[stage];
+        g_string_append_printf( text,
+            "%-8s n=%-7" G_GUINT64_FORMAT
+            " p50=%" G_GUINT64_FORMAT "us p95=%" G_GUINT64_FORMAT "us"
+            " p99=%" G_GUINT64_FORMAT "us max=%" G_GUINT64_FORMAT "us\n",
+            PERF_STAGE_NAMES[stage], histogram->count,
+            perf_histogram_percentile( histogram, 50.0 ),
+            perf_histogram_percentile( histogram, 95.0 ),
+            perf_histogram_percentile( histogram, 99.0 ),
+            histogram->max );
+    }
+    g_mutex_unlock( &perf_mutex );
+    return g_string_free( text, FALSE );
+}
+
+/**
+ * perf_dump - Writes the statistics to a file of the user state directory.
+ * @name: the name of the file, created in '$XDG_STATE_HOME/sdprompt-viewer'.
+ *
+ * Returns: TRUE if the statistics were written.
+ */
+static gboolean
+perf_dump( const gchar *name )
+{
+    gchar *text, *dir, *path; gboolean written = FALSE;
+    text = perf_describe();
+    if( !text ) { return FALSE; }
+    dir  = g_build_filename( g_get_user_state_dir(), "sdprompt-viewer", NULL );
+    path = g_build_filename( dir, name, NULL );
+    if( g_mkdir_with_parents( dir, 0700 )==0 ) {
+        written = g_file_set_contents( path, text, -1, NULL );
+    }
+    g_free( path );
+    g_free( dir );
+    g_free( text );
+    return written;
+}
@@ -35,9 +35,29 @@
    - asynchronous implementation
    
 */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <gio/gio.h>
 
+/* profiler marks, no-ops unless 'utils_trace.h' was included before */
+#if !defined( TRACE_MARK )
+#  define TRACE_BEGIN()                   ((gint64)0)
+#  define TRACE_MARK(begin, name, detail) ((void)(begin))
+#endif
+
+/* hook to wrap the file stream before it is read (the benchmarks use it to
+ * simulate slow storage), by default the stream is read directly and the
+ * local files are read with pread() instead of a GFileInputStream */
+#if !defined( PNG_WRAP_INPUT_STREAM )
+#  define PNG_WRAP_INPUT_STREAM(stream) (stream)
+#  define PNG_NATIVE_READS 1
+#else
+#  define PNG_NATIVE_READS 0
+#endif
+
 typedef void (*PNGTextChunkCallback)(gchar   *text,
                                      gpointer data_ptr,
                                      int      data_int);
@@ -54,10 +74,12 @@ struct         _PNGTextChunkMessage {
 
 static const guint8 PNG_SIGNATURE[] = {137, 80, 78, 71, 13, 10, 26, 10};
 #define PNG_SIGNATURE_LENGTH sizeof(PNG_SIGNATURE)
+static const guint8 PNG_END[] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+#define PNG_END_LENGTH sizeof(PNG_END)
 #define CHUNK_HEADER_SIZE 8 /* CHUNK_LENGTH + CHUNK_TYPE */
 #define CHUNK_CRC_SIZE    4
 
-/*-------------------------- READ/SKIP BYTES ----------------------------*/
+/*------------------------------ READ BYTES -----------------------------*/
 
 static gboolean
 read_png_bytes(GInputStream *input_stream, void *buffer, gsize count)
@@ -69,88 +91,300 @@ read_png_bytes(GInputStream *input_stream, void *buffer, gsize count)
     ? (bytes_read==count) : FALSE;
 }
 
-static gboolean
-skip_png_bytes(GInputStream *input_stream, gsize count)
+/* Returns TRUE if the file ends with the IEND chunk, that is, if the PNG
+ * has been completely written (used to tell a file still being written
+ * from a file that simply has no text chunks) */
+static G_GNUC_UNUSED gboolean
+has_png_end(GFile *file)
 {
-    return g_input_stream_skip(input_stream, count, NULL, NULL) == count;
+    guint8 end_buffer[PNG_END_LENGTH]; gboolean is_complete = FALSE;
+    GFileInputStream *input_stream = g_file_read(file, NULL, NULL);
+    if( !input_stream ) { return FALSE; }
+    if( g_seekable_seek(G_SEEKABLE(input_stream), -(goffset)PNG_END_LENGTH,
+                        G_SEEK_END, NULL, NULL) &&
+        read_png_bytes(G_INPUT_STREAM(input_stream), end_buffer, PNG_END_LENGTH) )
+    {
+        is_complete = memcmp(end_buffer, PNG_END, PNG_END_LENGTH)==0;
+    }
+    g_input_stream_close(G_INPUT_STREAM(input_stream), NULL, NULL);
+    g_object_unref(input_stream);
+    return is_complete;
 }
 
+
+/*---------------------------- PROCESS CHUNKS -----------------------------*/
+
+/* Returns TRUE if 'key' is one of the '|' separated keys in 'keys' */
 static gboolean
-has_png_signature(GInputStream *input_stream)
+png_text_key_matches(const gchar *key, const gchar *keys)
 {
-    guint8 signature_buffer[PNG_SIGNATURE_LENGTH];
-    if( !read_png_bytes(input_stream, signature_buffer, PNG_SIGNATURE_LENGTH) ) {
-        return FALSE;
+    const gchar *end; gsize key_size = strlen(key);
+    while( keys && *keys ) {
+        end = strchr(keys, '|');
+        if( !end ) { end = keys + strlen(keys); }
+        if( (gsize)(end-keys)==key_size && memcmp(keys,key,key_size)==0 ) {
+            return TRUE;
+        }
+        keys = (*end=='|') ? end+1 : end;
     }
-    return memcmp(signature_buffer, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH)==0;    
+    return FALSE;
 }
 
-
-/*---------------------------- PROCESS CHUNKS -----------------------------*/
-
 static PNGTextChunkMessage *
 load_png_text_chunk_completed(gchar *text, PNGTextChunkMessage *message);
 #define DISPATCH(value,message) load_png_text_chunk_completed(value,message)
 #define DISPATCH_ERROR(message) load_png_text_chunk_completed("",message)
 
 
-/* Funcion invocada cada vez que se carga un chunk de texto de algun PNG */
+/* Dispatches the tEXt chunk 'data' if its key is one of the message keys,
+ * the byte after the data (the CRC, never read) is overwritten with NUL */
 static PNGTextChunkMessage *
-process_png_text_chunk(GInputStream        *input_stream,
-                       gsize                chunk_size,
-                       PNGTextChunkMessage *message)
+dispatch_png_text_chunk(guint8              *data,
+                        gsize                chunk_size,
+                        PNGTextChunkMessage *message)
 {
-    int i; gchar *chunk_data, *key=NULL, *value=NULL;
+    gchar *chunk_data = (gchar *)data, *value;
     
-    chunk_data = g_new(char, chunk_size+1);
     chunk_data[chunk_size] = '\0';
+    value = memchr(chunk_data, '\0', chunk_size);
+    if( value && value < &chunk_data[chunk_size-1] &&
+        png_text_key_matches(chunk_data, message->key) ) {
+        message = DISPATCH(value+1, message);
+    }
+    return message;
+}
+
+
+/*----------------------------- CHUNK WALKER ------------------------------*/
+/*
+ * Instead of one read for every chunk header plus one read or skip for
+ * every chunk body, the stream is read in large blocks and every chunk
+ * header found in a block is parsed from memory. Seekable streams are read
+ * with positioned reads of aligned blocks (the IDAT data in between is
+ * never transferred); other streams are read forward, keeping the part of
+ * the block that was not parsed yet.
+ *
+ * Tools that write the text after the image data would still need a read
+ * per block of IDAT, so the first time the walk has to leave the block in
+ * the middle of the image data the tail of the file is read and scanned,
+ * and on these files the text is usually found with two reads.
+ *
+ * The block of each thread is kept from one file to the next, and local
+ * files are read with pread() on a plain descriptor, so reading the text
+ * of an image doesn't allocate memory once the block has grown.
+ */
+
+#define PNG_WALK_BLOCK_SIZE     (64*1024)  /* minimum size of every read  */
+#define PNG_WALK_BLOCK_ALIGN    4096       /* alignment of positioned reads */
+#define PNG_MAX_TEXT_CHUNK_SIZE (16*1024*1024)
+#define PNG_WALK_MAX_KEEP       (1024*1024) /* bigger blocks aren't kept */
+
+typedef struct _PNGWalkBuffer PNGWalkBuffer;
+struct         _PNGWalkBuffer {
+    guint8 *data;
+    gsize   capacity;       /* not counting the byte reserved for a NUL */
+};
+
+static void
+free_png_walk_buffer(gpointer buffer)
+{
+    g_free(((PNGWalkBuffer *)buffer)->data);
+    g_free(buffer);
+}
+
+static GPrivate png_walk_buffer = G_PRIVATE_INIT(free_png_walk_buffer);
+
+typedef struct _PNGChunkWalker PNGChunkWalker;
+struct         _PNGChunkWalker {
+    GInputStream  *stream;         /* NULL when 'fd' is read            */
+    int            fd;
+    gboolean       seekable;
+    gboolean       at_end;         /* the block reaches the end of file */
+    gboolean       tail_probed;
+    goffset        stream_offset;  /* current position of the stream    */
+    PNGWalkBuffer *buffer;         /* the block of the current thread   */
+    guint8        *block;
+    gsize          block_size;     /* number of valid bytes in 'block'  */
+    goffset        block_offset;   /* file offset of block[0]           */
+};
+
+static guint32
+png_chunk_uint32(const guint8 *ptr)
+{
+    return ((guint32)ptr[0]<<24) | ((guint32)ptr[1]<<16) |
+           ((guint32)ptr[2]<< 8) |  (guint32)ptr[3];
+}
+
+static gboolean
+is_png_chunk_type(const guint8 *ptr)
+{
+    int i;
+    for( i=0 ; i<4 ; ++i ) {
+        if( !g_ascii_isalpha(ptr[i]) ) { return FALSE; }
+    }
+    return TRUE;
+}
+
+static void
+png_walker_init(PNGChunkWalker *walker, GInputStream *stream, int fd)
+{
+    memset(walker, 0, sizeof(*walker));
+    walker->stream   = stream;
+    walker->fd       = fd;
+    walker->seekable = fd>=0 || (G_IS_SEEKABLE(stream) &&
+                                 g_seekable_can_seek(G_SEEKABLE(stream)));
+    walker->buffer   = g_private_get(&png_walk_buffer);
+    if( !walker->buffer ) {
+        walker->buffer = g_new0(PNGWalkBuffer, 1);
+        g_private_set(&png_walk_buffer, walker->buffer);
+    }
+    walker->block = walker->buffer->data;
+}
+
+static void
+png_walker_clear(PNGChunkWalker *walker)
+{
+    if( walker->buffer->capacity > PNG_WALK_MAX_KEEP ) {
+        g_free(walker->buffer->data);
+        walker->buffer->data     = NULL;
+        walker->buffer->capacity = 0;
+    }
+    walker->block = NULL;
+}
+
+/* Returns TRUE if the bytes [offset, offset+size) are already in the block */
+static gboolean
+png_walker_has(PNGChunkWalker *walker, goffset offset, gsize size)
+{
+    return offset >= walker->block_offset &&
+           offset + (goffset)size <= walker->block_offset + (goffset)walker->block_size;
+}
+
+static gboolean
+png_walker_seek(PNGChunkWalker *walker, goffset offset)
+{
+    if( walker->fd<0 &&
+        !g_seekable_seek(G_SEEKABLE(walker->stream), offset, G_SEEK_SET, NULL, NULL) ) {
+        return FALSE;
+    }
+    walker->stream_offset = offset;
+    return TRUE;
+}
+
+/* Reads up to 'count' bytes at the current position, returns the bytes read */
+static gsize
+png_walker_read(PNGChunkWalker *walker, guint8 *buffer, gsize count)
+{
+    gsize bytes_read = 0, wanted; gssize result;
+    if( walker->fd<0 ) {
+        g_input_stream_read_all(walker->stream, buffer, count, &bytes_read, NULL, NULL);
+        return bytes_read;
+    }
+    while( bytes_read<count ) {
+        wanted = count - bytes_read;
+        result = pread(walker->fd, &buffer[bytes_read], wanted,
+                       walker->stream_offset + (goffset)bytes_read);
+        if( result<0 && errno==EINTR ) { continue; }
+        if( result<=0 ) { break; }
+        bytes_read += (gsize)result;
+        /* a short read of a regular file is its end */
+        if( (gsize)result<wanted ) { break; }
+    }
+    return bytes_read;
+}
+
+/**
+ * Returns a pointer to the bytes [offset, offset+size) of the stream,
+ * reading a new block when they are not in the current one.
+ * @returns
+ *    A pointer into the block, valid until the next fetch, or NULL if the
+ *    stream ends before or cannot go back to 'offset'.
+ */
+static guint8 *
+png_walker_fetch(PNGChunkWalker *walker, goffset offset, gsize size)
+{
+    gsize keep = 0, capacity, bytes_read = 0; goffset start;
     
-    if( message ) {
-        if( !read_png_bytes(input_stream, chunk_data, chunk_size) ) {
-            message = DISPATCH_ERROR(message);
-        }
+    if( png_walker_has(walker, offset, size) ) {
+        return &walker->block[ offset - walker->block_offset ];
     }
-    if( message ) {
-        key = chunk_data;
-        for( i=0 ; (!value) && i<(chunk_size-1) ; ++i ) {
-            if( chunk_data[i] == '\0' ) { value = &chunk_data[i+1]; }
+    if( walker->seekable ) {
+        start = offset & ~(goffset)(PNG_WALK_BLOCK_ALIGN-1);
+        if( start!=walker->stream_offset && !png_walker_seek(walker, start) ) {
+            return NULL;
         }
     }
-    if( message ) {
-        if( key!=NULL && value!=NULL && g_strcmp0(key,message->key)==0 ) {
-            message = DISPATCH(value,message);
+    else {
+        /* forward only: keep the unparsed part of the block or skip up to 'offset' */
+        start = offset;
+        if( offset < walker->stream_offset &&
+            offset >= walker->block_offset ) {
+            keep = (gsize)(walker->stream_offset - offset);
+            memmove(walker->block, &walker->block[ offset - walker->block_offset ], keep);
+        }
+        else if( offset < walker->stream_offset ) {
+            return NULL;
+        }
+        else if( offset > walker->stream_offset &&
+                 g_input_stream_skip(walker->stream, offset - walker->stream_offset,
+                                     NULL, NULL) != offset - walker->stream_offset ) {
+            return NULL;
         }
     }
-    g_free(chunk_data);
-    return message;
+    capacity = MAX((gsize)(offset-start) + size, PNG_WALK_BLOCK_SIZE);
+    if( walker->buffer->capacity < capacity ) {
+        walker->buffer->capacity = capacity;
+        walker->buffer->data     = g_realloc(walker->buffer->data, capacity+1);
+        walker->block            = walker->buffer->data;
+    }
+    walker->block_offset = start;
+    walker->block_size   = keep;
+    bytes_read = png_walker_read(walker, &walker->block[keep], capacity-keep);
+    walker->block_size   += bytes_read;
+    walker->stream_offset = start + walker->block_size;
+    walker->at_end        = walker->block_size < capacity;
+    return png_walker_has(walker, offset, size)
+           ? &walker->block[ offset - walker->block_offset ] : NULL;
 }
 
+/* Reads the tail of the file, from 'min_offset' at least, and dispatches
+ * the first tEXt chunk found there whose key is one of the message keys */
 static PNGTextChunkMessage *
-process_png_chunk(GInputStream        *input_stream,
-                  PNGTextChunkMessage *message) {
-    
-    gsize  chunk_size;
-    char  *chunk_type;
-    guint8 chunk_header[CHUNK_HEADER_SIZE+1];
-    chunk_header[CHUNK_HEADER_SIZE] = '\0';
+probe_png_tail(PNGChunkWalker      *walker,
+               goffset              min_offset,
+               PNGTextChunkMessage *message)
+{
+    guint8 *tail; goffset end, start; gsize tail_size, i, next;
+    guint32 chunk_size; struct stat st;
     
-    if( message ) {
-        if ( !read_png_bytes(input_stream, chunk_header, CHUNK_HEADER_SIZE) ) {
-            message = DISPATCH_ERROR(message);
-        }
+    walker->tail_probed = TRUE;
+    if( walker->fd>=0 ) {
+        if( fstat(walker->fd, &st)!=0 ) { return message; }
+        end = st.st_size;
     }
-    if( message ) {
-        chunk_size = (chunk_header[0] << 24) |
-                     (chunk_header[1] << 16) |
-                     (chunk_header[2] <<  8) |
-                     (chunk_header[3]      );
-        chunk_type = (char *)( &chunk_header[ 4 ] );
-        if( g_strcmp0(chunk_type,"tEXt") == 0 ) {
-            message = process_png_text_chunk(input_stream, chunk_size, message);
+    else {
+        if( !g_seekable_seek(G_SEEKABLE(walker->stream), 0, G_SEEK_END, NULL, NULL) ) {
+            return message;
         }
-        else if( !skip_png_bytes(input_stream, chunk_size+CHUNK_CRC_SIZE) ) {
-            message = DISPATCH_ERROR(message);
+        end = g_seekable_tell(G_SEEKABLE(walker->stream));
+    }
+    start = MAX(min_offset, end - PNG_WALK_BLOCK_SIZE);
+    walker->stream_offset = end;
+    if( start >= end ) { return message; }
+    
+    tail_size = (gsize)(end - start);
+    tail      = png_walker_fetch(walker, start, tail_size);
+    for( i=4 ; tail && message && i+4 <= tail_size ; ++i ) {
+        if( memcmp(&tail[i], "tEXt", 4)!=0 ) { continue; }
+        chunk_size = png_chunk_uint32(&tail[i-4]);
+        next       = i + 4 + (gsize)chunk_size + CHUNK_CRC_SIZE;
+        /* a real chunk is followed by another chunk or by the end of file */
+        if( chunk_size==0 || next > tail_size ) { continue; }
+        if( next < tail_size &&
+            (next + CHUNK_HEADER_SIZE > tail_size || !is_png_chunk_type(&tail[next+4])) ) {
+            continue;
         }
+        message = dispatch_png_text_chunk(&tail[i+4], chunk_size, message);
     }
     return message;
 }
@@ -158,25 +392,60 @@ process_png_chunk(GInputStream        *input_stream,
 static void
 process_text_chunk_message(PNGTextChunkMessage* message)
 {
-    GFileInputStream *input_stream = NULL;
+    GInputStream *input_stream = NULL; PNGChunkWalker walker;
+    const char *path; int fd = -1;
+    guint8 *chunk; goffset offset, next; guint32 chunk_size;
+    gint64 trace_begin;
 
+    trace_begin = TRACE_BEGIN();
     if( message ) {
-        input_stream = g_file_read(message->file, NULL, NULL);
-        if( !input_stream ) { message = DISPATCH_ERROR(message); }
+        path = PNG_NATIVE_READS ? g_file_peek_path(message->file) : NULL;
+        if( path ) {
+            fd = open(path, O_RDONLY|O_CLOEXEC);
+        } else {
+            input_stream = (GInputStream *)g_file_read(message->file, NULL, NULL);
+            if( input_stream ) { input_stream = PNG_WRAP_INPUT_STREAM(input_stream); }
+        }
+        if( fd<0 && !input_stream ) { message = DISPATCH_ERROR(message); }
     }
+    TRACE_MARK(trace_begin, "file open", NULL);
+    trace_begin = TRACE_BEGIN();
+    png_walker_init(&walker, input_stream, fd);
     if( message ) {
-        if( !has_png_signature( G_INPUT_STREAM(input_stream) ) ) {
+        chunk = png_walker_fetch(&walker, 0, PNG_SIGNATURE_LENGTH);
+        if( !chunk || memcmp(chunk, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH)!=0 ) {
             message = DISPATCH_ERROR(message);
         }
     }
+    offset = PNG_SIGNATURE_LENGTH;
     while( message ) {
-        message = process_png_chunk( G_INPUT_STREAM(input_stream), message );
+        chunk = png_walker_fetch(&walker, offset, CHUNK_HEADER_SIZE);
+        if( !chunk || memcmp(&chunk[4], "IEND", 4)==0 ) { break; }
+        chunk_size = png_chunk_uint32(chunk);
+        if( chunk_size > 0x7FFFFFFF ) { break; }
+        next = offset + CHUNK_HEADER_SIZE + chunk_size + CHUNK_CRC_SIZE;
+        
+        if( memcmp(&chunk[4], "tEXt", 4)==0 && chunk_size > 0 ) {
+            if( chunk_size > PNG_MAX_TEXT_CHUNK_SIZE ) { break; }
+            chunk = png_walker_fetch(&walker, offset+CHUNK_HEADER_SIZE, chunk_size);
+            if( !chunk ) { break; }
+            message = dispatch_png_text_chunk(chunk, chunk_size, message);
+        }
+        else if( memcmp(&chunk[4], "IDAT", 4)==0 &&
+                 walker.seekable && !walker.tail_probed && !walker.at_end &&
+                 !png_walker_has(&walker, next, CHUNK_HEADER_SIZE) ) {
+            message = probe_png_tail(&walker, next, message);
+        }
+        offset = next;
     }
+    TRACE_MARK(trace_begin, "chunk scan", NULL);
     /* el mensaje debe ser enviado si o si */
     if( message ) {
         message = DISPATCH_ERROR(message);
     }
     /* cleanup */
+    png_walker_clear(&walker);
+    if( fd>=0 ) { close(fd); }
     if( input_stream ) {
         g_input_stream_close(G_INPUT_STREAM(input_stream), NULL, NULL);
         g_object_unref(input_stream);
@@ -193,22 +462,20 @@ load_png_text_chunk(GFile               *file,
                     gpointer             data_ptr,
                     int                  data_int)
 {
-    PNGTextChunkMessage *message = g_new(PNGTextChunkMessage, 1);
-    message->file     = g_object_ref(file);
-    message->key      = g_strdup(key);
-    message->callback = callback;
-    message->data_ptr = data_ptr;
-    message->data_int = data_int;
-    process_text_chunk_message(message);
+    /* the file is read synchronously, so the message can live in the stack */
+    PNGTextChunkMessage message;
+    message.file     = file;
+    message.key      = key;
+    message.callback = callback;
+    message.data_ptr = data_ptr;
+    message.data_int = data_int;
+    process_text_chunk_message(&message);
 }
 
 static PNGTextChunkMessage *
 load_png_text_chunk_completed(gchar *text, PNGTextChunkMessage *message)
 {
     message->callback( text, message->data_ptr, message->data_int );
-    g_object_unref(message->file);
-    g_free        (message->key);
-    g_free(message);
     return NULL;
 }
 
@@ -0,0 +1,410 @@
+/**
+ * @file    utils_pngbatch.h
+ * @brief   Reads the text chunks of many PNG files at once (io_uring or pread).
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+ 
+ Bulk counterpart of 'utils_png.h' used when a whole folder is indexed.
+ Instead of walking each file through a GInputStream (one open and a chain
+ of blocking block reads per file), the chunks are parsed from plain memory
+ buffers and the reads are driven by a small per-file state machine:
+ 
+   1) read the first PNG_BATCH_HEAD_SIZE bytes of the file,
+   2) scan the chunks found in the buffer,
+   3) if a chunk header or a tEXt chunk continues past the end of the
+      buffer, read again starting at that chunk and go back to (2).
+ 
+ When compiled with HAVE_IO_URING (see 'USE_IO_URING' in the Makefile) the
+ opens, reads and closes of up to PNG_BATCH_QUEUE_DEPTH files are in flight
+ at the same time, which keeps the device queue deep on NVMe and spinning
+ disks alike. Each thread creates its ring the first time it reads a batch
+ and keeps it until the thread exits. Without io_uring, or when the kernel refuses to create a
+ ring, the same state machine runs on blocking pread() calls; the caller
+ is expected to run several batches in parallel from a thread pool.
+    
+    NOTE: 'utils_png.h' must be included first.
+*/
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib.h>
+#ifdef HAVE_IO_URING
+#include <liburing.h>
+#endif
+#if !defined( CHUNK_HEADER_SIZE )
+#  error "utils_pngbatch.h requires utils_png.h"
+#endif
+
+#define PNG_BATCH_HEAD_SIZE     (64*1024)  /* first read of every file     */
+#define PNG_BATCH_READ_SIZE     (16*1024)  /* minimum size of later reads  */
+#define PNG_BATCH_MAX_TEXT_SIZE (16*1024*1024)
+#define PNG_BATCH_QUEUE_DEPTH   64         /* files in flight per ring     */
+
+typedef enum PNGBatchBackend {
+    PNG_BATCH_AUTO,     /* io_uring when available, pread() otherwise */
+    PNG_BATCH_URING,
+    PNG_BATCH_PREAD
+} PNGBatchBackend;
+
+typedef enum PNGScanResult {
+    PNG_SCAN_FOUND,     /* a text chunk with one of the keys was found  */
+    PNG_SCAN_NEED_DATA, /* 'read_offset' and 'read_size' must be read   */
+    PNG_SCAN_END        /* IEND, corrupt data or not a PNG file         */
+} PNGScanResult;
+
+typedef enum PNGBatchOp {
+    PNG_BATCH_OP_OPEN,
+    PNG_BATCH_OP_READ,
+    PNG_BATCH_OP_CLOSE
+} PNGBatchOp;
+
+typedef struct _PNGBatchFile PNGBatchFile;
+struct         _PNGBatchFile {
+    int     index;          /* position in the batch ('data_int')   */
+    int     fd;
+    int     op;             /* PNGBatchOp in flight (io_uring)      */
+    guint8 *buffer;         /* reused from one file to the next     */
+    gsize   buffer_capacity;
+    gsize   buffer_size;    /* number of valid bytes in 'buffer'    */
+    goffset buffer_offset;  /* file offset of buffer[0]             */
+    goffset chunk_offset;   /* file offset of the next chunk header */
+    goffset read_offset;
+    gsize   read_size;
+    gsize   read_needed;    /* a shorter read means truncated file  */
+};
+
+
+/*------------------------------ CHUNK SCANNER ----------------------------*/
+
+static guint32
+png_batch_uint32(const guint8 *ptr)
+{
+    return ((guint32)ptr[0]<<24) | ((guint32)ptr[1]<<16) |
+           ((guint32)ptr[2]<< 8) |  (guint32)ptr[3];
+}
+
+static void
+png_batch_reserve(PNGBatchFile *file, gsize size)
+{
+    /* one extra byte to NUL-terminate a text chunk that ends the buffer */
+    if( file->buffer_capacity < size+1 ) {
+        file->buffer_capacity = size+1;
+        file->buffer = g_realloc(file->buffer, file->buffer_capacity);
+    }
+}
+
+static void
+png_batch_request(PNGBatchFile *file, goffset offset, gsize needed)
+{
+    file->read_offset = offset;
+    file->read_needed = needed;
+    file->read_size   = MAX(needed, PNG_BATCH_READ_SIZE);
+    png_batch_reserve(file, file->read_size);
+}
+
+/**
+ * Scans the chunks of the PNG file that are present in the buffer looking
+ * for a tEXt chunk whose key is one of the '|' separated 'keys'.
+ * 
+ * @param file     The file whose buffer was just filled.
+ * @param keys     The keys to look for, e.g. "parameters|prompt".
+ * @param out_text Receives the NUL-terminated text of the chunk; it points
+ *                 into the buffer and is valid until the next read.
+ * @returns
+ *    PNG_SCAN_FOUND when the chunk was found, PNG_SCAN_NEED_DATA when the
+ *    region described by 'read_offset/read_size' must be read before the
+ *    scan can continue, or PNG_SCAN_END when there is nothing else to find.
+ */
+static PNGScanResult
+png_batch_scan(PNGBatchFile *file, const gchar *keys, gchar **out_text)
+{
+    const goffset buffer_end = file->buffer_offset + file->buffer_size;
+    guint8 *chunk, *data, *value; guint32 chunk_size;
+    
+    if( file->chunk_offset==0 ) {
+        if( file->buffer_size < PNG_SIGNATURE_LENGTH ||
+            memcmp(file->buffer, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH)!=0 ) {
+            return PNG_SCAN_END;
+        }
+        file->chunk_offset = PNG_SIGNATURE_LENGTH;
+    }
+    while( TRUE ) {
+        if( file->chunk_offset < file->buffer_offset ||
+            file->chunk_offset + CHUNK_HEADER_SIZE > buffer_end ) {
+            png_batch_request(file, file->chunk_offset, CHUNK_HEADER_SIZE);
+            return PNG_SCAN_NEED_DATA;
+        }
+        chunk      = &file->buffer[ file->chunk_offset - file->buffer_offset ];
+        chunk_size = png_batch_uint32(chunk);
+        if( chunk_size > 0x7FFFFFFF ) { return PNG_SCAN_END; }
+        if( memcmp(&chunk[4], "IEND", 4)==0 ) { return PNG_SCAN_END; }
+        
+        if( memcmp(&chunk[4], "tEXt", 4)==0 &&
+            chunk_size > 0 && chunk_size <= PNG_BATCH_MAX_TEXT_SIZE ) {
+            if( file->chunk_offset + CHUNK_HEADER_SIZE + chunk_size > buffer_end ) {
+                png_batch_request(file, file->chunk_offset,
+                                  CHUNK_HEADER_SIZE + chunk_size);
+                return PNG_SCAN_NEED_DATA;
+            }
+            /* the byte after the data is the CRC (or spare capacity) */
+            data  = &chunk[CHUNK_HEADER_SIZE];
+            data[chunk_size] = '\0';
+            value = memchr(data, '\0', chunk_size);
+            if( value && value < &data[chunk_size-1] &&
+                png_text_key_matches((const gchar *)data, keys) ) {
+                (*out_text) = (gchar *)(value+1);
+                return PNG_SCAN_FOUND;
+            }
+        }
+        file->chunk_offset += CHUNK_HEADER_SIZE + chunk_size + CHUNK_CRC_SIZE;
+    }
+}
+
+/**
+ * Stores the result of a read into the file and advances the scan.
+ * The callback is invoked exactly once per file, with "" when no text
+ * chunk was found, as load_png_text_chunk() does.
+ * @returns TRUE if another read was requested, FALSE if the file is done.
+ */
+static gboolean
+png_batch_advance(PNGBatchFile        *file,
+                  gssize               bytes_read,
+                  const gchar         *keys,
+                  PNGTextChunkCallback callback,
+                  gpointer             data_ptr)
+{
+    gchar *text = NULL; PNGScanResult result = PNG_SCAN_END;
+    
+    if( bytes_read >= 0 && (gsize)bytes_read >= file->read_needed ) {
+        file->buffer_offset = file->read_offset;
+        file->buffer_size   = (gsize)bytes_read;
+        result = png_batch_scan(file, keys, &text);
+    }
+    if( result==PNG_SCAN_NEED_DATA ) { return TRUE; }
+    callback( result==PNG_SCAN_FOUND ? text : "", data_ptr, file->index );
+    return FALSE;
+}
+
+static void
+png_batch_start(PNGBatchFile *file, int index)
+{
+    file->index         = index;
+    file->fd            = -1;
+    file->buffer_size   = 0;
+    file->buffer_offset = 0;
+    file->chunk_offset  = 0;
+    file->read_offset   = 0;
+    file->read_needed   = 0;
+    file->read_size     = PNG_BATCH_HEAD_SIZE;
+    png_batch_reserve(file, file->read_size);
+}
+
+
+/*------------------------------ PREAD BACKEND ----------------------------*/
+
+static void
+png_batch_read_pread(const gchar * const  *paths,
+                     int                   count,
+                     const gchar          *keys,
+                     PNGTextChunkCallback  callback,
+                     gpointer              data_ptr)
+{
+    PNGBatchFile file; gssize bytes_read; int i;
+    
+    memset(&file, 0, sizeof(file));
+    for( i=0 ; i<count ; ++i ) {
+        png_batch_start(&file, i);
+        file.fd = paths[i] ? open(paths[i], O_RDONLY|O_CLOEXEC) : -1;
+        if( file.fd<0 ) { callback("", data_ptr, i); continue; }
+        do {
+            bytes_read = pread(file.fd, file.buffer, file.read_size,
+                               file.read_offset);
+        } while( png_batch_advance(&file, bytes_read, keys, callback, data_ptr) );
+        close(file.fd);
+    }
+    g_free(file.buffer);
+}
+
+
+/*----------------------------- IO_URING BACKEND --------------------------*/
+#ifdef HAVE_IO_URING
+
+typedef struct _PNGBatchRing PNGBatchRing;
+struct         _PNGBatchRing {
+    struct io_uring ring;
+    gboolean        ready;  /* FALSE if the kernel refused to create it */
+};
+
+static void
+free_png_batch_ring(gpointer data)
+{
+    PNGBatchRing *batch_ring = data;
+    if( batch_ring->ready ) { io_uring_queue_exit(&batch_ring->ring); }
+    g_free(batch_ring);
+}
+
+/* the ring of each thread, created once and released when the thread exits */
+static GPrivate png_batch_ring = G_PRIVATE_INIT(free_png_batch_ring);
+
+static struct io_uring *
+get_png_batch_ring(void)
+{
+    PNGBatchRing *batch_ring = g_private_get(&png_batch_ring);
+    if( !batch_ring ) {
+        batch_ring = g_new0(PNGBatchRing, 1);
+        batch_ring->ready =
+            io_uring_queue_init(PNG_BATCH_QUEUE_DEPTH, &batch_ring->ring, 0) >= 0;
+        g_private_set(&png_batch_ring, batch_ring);
+    }
+    return batch_ring->ready ? &batch_ring->ring : NULL;
+}
+
+static void
+png_batch_submit(struct io_uring *ring, PNGBatchFile *file, const gchar *path)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+    switch( file->op ) {
+        case PNG_BATCH_OP_OPEN:
+            io_uring_prep_openat(sqe, AT_FDCWD, path, O_RDONLY|O_CLOEXEC, 0);
+            break;
+        case PNG_BATCH_OP_READ:
+            io_uring_prep_read(sqe, file->fd, file->buffer,
+                               file->read_size, file->read_offset);
+            break;
+        case PNG_BATCH_OP_CLOSE:
+            io_uring_prep_close(sqe, file->fd);
+            break;
+    }
+    io_uring_sqe_set_data(sqe, file);
+}
+
+/**
+ * Reads the batch keeping up to PNG_BATCH_QUEUE_DEPTH files in flight.
+ * Each slot has at most one operation queued, so the submission queue
+ * never overflows. Returns FALSE if the thread has no ring.
+ */
+static gboolean
+png_batch_read_uring(const gchar * const  *paths,
+                     int                   count,
+                     const gchar          *keys,
+                     PNGTextChunkCallback  callback,
+                     gpointer              data_ptr)
+{
+    struct io_uring *ring = get_png_batch_ring(); struct io_uring_cqe *cqe;
+    PNGBatchFile *slots, *file; int i, next, in_flight, depth, res;
+    
+    if( !ring ) { return FALSE; }
+    depth = MAX(1, MIN(count, PNG_BATCH_QUEUE_DEPTH));
+    
+    slots = g_new0(PNGBatchFile, depth);
+    next  = in_flight = 0;
+    for( i=0 ; i<depth ; ++i ) {
+        while( next<count && !paths[next] ) { callback("", data_ptr, next++); }
+        if( next>=count ) { break; }
+        png_batch_start(&slots[i], next);
+        slots[i].op = PNG_BATCH_OP_OPEN;
+        png_batch_submit(ring, &slots[i], paths[next++]);
+        ++in_flight;
+    }
+    while( in_flight>0 ) {
+        io_uring_submit_and_wait(ring, 1);
+        while( io_uring_peek_cqe(ring, &cqe)==0 ) {
+            file = io_uring_cqe_get_data(cqe);
+            res  = cqe->res;
+            io_uring_cqe_seen(ring, cqe);
+            
+            if( file->op==PNG_BATCH_OP_OPEN ) {
+                if( res>=0 ) { file->fd = res; file->op = PNG_BATCH_OP_READ; }
+                else         { callback("", data_ptr, file->index); }
+            }
+            else if( file->op==PNG_BATCH_OP_READ ) {
+                if( !png_batch_advance(file, res, keys, callback, data_ptr) ) {
+                    file->op = PNG_BATCH_OP_CLOSE;
+                }
+            }
+            else { file->fd = -1; }
+            
+            /* queue the next operation of the file or start a new file */
+            if( file->fd>=0 ) {
+                png_batch_submit(ring, file, NULL);
+                continue;
+            }
+            while( next<count && !paths[next] ) { callback("", data_ptr, next++); }
+            if( next<count ) {
+                png_batch_start(file, next);
+                file->op = PNG_BATCH_OP_OPEN;
+                png_batch_submit(ring, file, paths[next++]);
+            } else {
+                --in_flight;
+            }
+        }
+    }
+    for( i=0 ; i<depth ; ++i ) { g_free(slots[i].buffer); }
+    g_free(slots);
+    return TRUE;
+}
+
+#endif /* HAVE_IO_URING */
+
+/*============================ MAIN FUNCTION ==============================*/
+
+/**
+ * Reads the text chunk identified by 'keys' from each file of a batch.
+ * 
+ * The callback runs in the calling thread, once per file and in completion
+ * order (not necessarily the order of 'paths'); its 'data_int' argument is
+ * the index of the file in 'paths'. The text passed to the callback is
+ * only valid during the call. A NULL entry in 'paths' is reported as a
+ * file without text, so callers can handle non-local files separately.
+ * 
+ * @param paths    Local paths of the PNG files.
+ * @param count    Number of elements in 'paths'.
+ * @param keys     The '|' separated keys of the text chunk to read.
+ * @param backend  PNG_BATCH_AUTO, or a specific backend (benchmarks).
+ * @returns
+ *    The backend that was actually used.
+ */
+static PNGBatchBackend
+read_png_text_chunks(const gchar * const  *paths,
+                     int                   count,
+                     const gchar          *keys,
+                     PNGBatchBackend       backend,
+                     PNGTextChunkCallback  callback,
+                     gpointer              data_ptr)
+{
+#ifdef HAVE_IO_URING
+    if( backend!=PNG_BATCH_PREAD &&
+        png_batch_read_uring(paths, count, keys, callback, data_ptr) ) {
+        return PNG_BATCH_URING;
+    }
+#endif
+    png_batch_read_pread(paths, count, keys, callback, data_ptr);
+    return PNG_BATCH_PREAD;
+}
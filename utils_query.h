@@ -0,0 +1,640 @@
+/**
+ * @file    utils_query.h
+ * @brief   Structured queries over a columnar store of generation parameters.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The parameters of the images are stored column by column (one array
+    per parameter, indexed by image), so a predicate reads one contiguous
+    array of values. Strings that repeat across the folder (model, sampler)
+    are dictionary-encoded: the column stores small integer ids and string
+    predicates are resolved once against the dictionary, then scanned as a
+    table lookup per image.
+    
+    A query is compiled into a program of predicates; each predicate is a
+    tight branch-free loop that ANDs its result into a byte mask, a shape
+    the compiler turns into SIMD code. Unknown values are stored as
+    sentinels (NaN for floats) that fail every comparison.
+    
+    Query syntax (all the predicates must match, '-' negates one):
+        model:juggernaut      the model name contains "juggernaut"
+        sampler="DPM++ 2M"    the sampler is exactly "DPM++ 2M"
+        steps>=30  cfg<7      numeric comparisons (=, !=, <, <=, >, >=)
+        hires:yes             images with a hires. fix pass
+        -sampler:euler        images whose sampler doesn't contain "euler"
+    Words that are not predicates are returned to the caller, so they can
+    be used as a free text search.
+    
+    The same columns sort the images: each value is mapped to an unsigned
+    integer with the same order and the rows are sorted by that integer.
+*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#define QUERY_MAX_PREDICATES 32
+#define QUERY_UNKNOWN_INT    G_MININT32
+#define QUERY_UNKNOWN_INT64  G_MININT64
+#define QUERY_UNKNOWN_ID     0
+#define QUERY_UNKNOWN_BOOL   2
+
+typedef enum QueryType {
+    QUERY_TYPE_STRING,  /* guint32 dictionary ids */
+    QUERY_TYPE_INT,     /* gint32                 */
+    QUERY_TYPE_INT64,   /* gint64                 */
+    QUERY_TYPE_FLOAT,   /* gfloat                 */
+    QUERY_TYPE_BOOL     /* guint8 (0, 1 or 2)     */
+} QueryType;
+
+typedef enum QueryField {
+    QUERY_MODEL,
+    QUERY_SAMPLER,
+    QUERY_STEPS,
+    QUERY_CFG,
+    QUERY_SEED,
+    QUERY_WIDTH,
+    QUERY_HEIGHT,
+    QUERY_DENOISING,
+    QUERY_HIRES,
+    QUERY_FIELD_COUNT
+} QueryField;
+
+typedef enum QueryOp {
+    QUERY_OP_CONTAINS,  /* ':' (equal for numbers and booleans) */
+    QUERY_OP_EQ,
+    QUERY_OP_NE,
+    QUERY_OP_LT,
+    QUERY_OP_LE,
+    QUERY_OP_GT,
+    QUERY_OP_GE
+} QueryOp;
+
+static const struct {
+    const char *name;
+    const char *alias;
+    QueryType   type;
+} QUERY_FIELDS[QUERY_FIELD_COUNT] = {
+    { "model",     NULL,        QUERY_TYPE_STRING },
+    { "sampler",   NULL,        QUERY_TYPE_STRING },
+    { "steps",     NULL,        QUERY_TYPE_INT    },
+    { "cfg",       "cfg_scale", QUERY_TYPE_FLOAT  },
+    { "seed",      NULL,        QUERY_TYPE_INT64  },
+    { "width",     NULL,        QUERY_TYPE_INT    },
+    { "height",    NULL,        QUERY_TYPE_INT    },
+    { "denoise",   "denoising", QUERY_TYPE_FLOAT  },
+    { "hires",     NULL,        QUERY_TYPE_BOOL   }
+};
+
+typedef struct _QueryDict QueryDict;
+struct         _QueryDict {
+    GHashTable *ids;        /* string -> id (id 0 means unknown) */
+    GPtrArray  *strings;    /* id -> string                      */
+};
+
+typedef struct _QueryColumns QueryColumns;
+struct         _QueryColumns {
+    guint     capacity;
+    guint     rows;         /* rows with valid values */
+    gpointer  values[QUERY_FIELD_COUNT];
+    QueryDict dicts[QUERY_FIELD_COUNT];  /* only for QUERY_TYPE_STRING */
+};
+
+typedef struct _QueryPredicate QueryPredicate;
+struct         _QueryPredicate {
+    QueryField field;
+    QueryOp    op;
+    gboolean   negate;
+    gint64     int_value;
+    gfloat     float_value;
+    guint8    *id_matches;  /* string fields: TRUE for each matching id */
+};
+
+typedef struct _QueryProgram QueryProgram;
+struct         _QueryProgram {
+    int            count;
+    QueryPredicate predicates[QUERY_MAX_PREDICATES];
+};
+
+
+/*------------------------------- COLUMNS ---------------------------------*/
+
+static gsize
+query_type_size(QueryType type)
+{
+    switch( type ) {
+        case QUERY_TYPE_STRING: return sizeof(guint32);
+        case QUERY_TYPE_INT:    return sizeof(gint32);
+        case QUERY_TYPE_INT64:  return sizeof(gint64);
+        case QUERY_TYPE_FLOAT:  return sizeof(gfloat);
+        case QUERY_TYPE_BOOL:   return sizeof(guint8);
+    }
+    return 0;
+}
+
+/* sets the values of the rows [first, last) of 'field' to unknown */
+static void
+query_clear_rows(QueryColumns *columns, int field, guint first, guint last)
+{
+    QueryType type = QUERY_FIELDS[field].type; guint i;
+    for( i=first ; i<last ; ++i ) {
+        if     ( type==QUERY_TYPE_STRING ) { ((guint32 *)columns->values[field])[i] = QUERY_UNKNOWN_ID;    }
+        else if( type==QUERY_TYPE_INT    ) { ((gint32  *)columns->values[field])[i] = QUERY_UNKNOWN_INT;   }
+        else if( type==QUERY_TYPE_INT64  ) { ((gint64  *)columns->values[field])[i] = QUERY_UNKNOWN_INT64; }
+        else if( type==QUERY_TYPE_FLOAT  ) { ((gfloat  *)columns->values[field])[i] = NAN; }
+        else if( type==QUERY_TYPE_BOOL   ) { ((guint8  *)columns->values[field])[i] = QUERY_UNKNOWN_BOOL; }
+    }
+}
+
+/**
+ * Creates the columns for 'capacity' rows with all the values unknown.
+ */
+static QueryColumns *
+new_query_columns(guint capacity)
+{
+    QueryColumns *columns = g_new0(QueryColumns, 1); QueryType type;
+    int field;
+    
+    columns->capacity = capacity;
+    for( field=0 ; field<QUERY_FIELD_COUNT ; ++field ) {
+        type = QUERY_FIELDS[field].type;
+        columns->values[field] = g_malloc0(MAX(capacity,1) * query_type_size(type));
+        query_clear_rows(columns, field, 0, capacity);
+        if( type==QUERY_TYPE_STRING ) {
+            columns->dicts[field].ids     = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+            columns->dicts[field].strings = g_ptr_array_new();
+            g_ptr_array_add(columns->dicts[field].strings, NULL);
+        }
+    }
+    return columns;
+}
+
+/**
+ * Makes room for at least 'capacity' rows, the new rows are unknown.
+ * Existing values (and the ids of the dictionaries) are preserved; the
+ * capacity grows geometrically so rows can be appended one at a time.
+ */
+static void
+query_grow_columns(QueryColumns *columns, guint capacity)
+{
+    guint old_capacity = columns->capacity; int field;
+    if( capacity<=old_capacity ) { return; }
+    capacity = MAX(capacity, old_capacity + old_capacity/2);
+    for( field=0 ; field<QUERY_FIELD_COUNT ; ++field ) {
+        columns->values[field] =
+            g_realloc(columns->values[field],
+                      capacity * query_type_size(QUERY_FIELDS[field].type));
+        query_clear_rows(columns, field, old_capacity, capacity);
+    }
+    columns->capacity = capacity;
+}
+
+static void
+free_query_columns(QueryColumns *columns)
+{
+    int field;
+    if( !columns ) { return; }
+    for( field=0 ; field<QUERY_FIELD_COUNT ; ++field ) {
+        g_free(columns->values[field]);
+        if( columns->dicts[field].ids ) {
+            /* the strings are owned by 'ids' */
+            g_ptr_array_unref(columns->dicts[field].strings);
+            g_hash_table_destroy(columns->dicts[field].ids);
+        }
+    }
+    g_free(columns);
+}
+
+static void
+query_set_string(QueryColumns *columns, QueryField field, guint row, const char *value)
+{
+    QueryDict *dict = &columns->dicts[field]; gchar *key; guint32 id;
+    
+    g_return_if_fail( QUERY_FIELDS[field].type==QUERY_TYPE_STRING && row<columns->capacity );
+    if( !value || !*value ) { return; }
+    id = GPOINTER_TO_UINT( g_hash_table_lookup(dict->ids, value) );
+    if( id==QUERY_UNKNOWN_ID ) {
+        key = g_strdup(value);
+        id  = dict->strings->len;
+        g_ptr_array_add(dict->strings, key);
+        g_hash_table_insert(dict->ids, key, GUINT_TO_POINTER(id));
+    }
+    ((guint32 *)columns->values[field])[row] = id;
+}
+
+static void
+query_set_number(QueryColumns *columns, QueryField field, guint row, const char *value)
+{
+    char *end; gdouble number;
+    
+    g_return_if_fail( row<columns->capacity );
+    if( !value || !*value ) { return; }
+    number = g_ascii_strtod(value, &end);
+    if( end==value ) { return; }
+    switch( QUERY_FIELDS[field].type ) {
+        case QUERY_TYPE_INT:   ((gint32 *)columns->values[field])[row] = (gint32)number; break;
+        case QUERY_TYPE_INT64: ((gint64 *)columns->values[field])[row] = g_ascii_strtoll(value, NULL, 10); break;
+        case QUERY_TYPE_FLOAT: ((gfloat *)columns->values[field])[row] = (gfloat)number; break;
+        case QUERY_TYPE_BOOL:  ((guint8 *)columns->values[field])[row] = number!=0; break;
+        default: break;
+    }
+}
+
+static void
+query_set_bool(QueryColumns *columns, QueryField field, guint row, gboolean value)
+{
+    g_return_if_fail( QUERY_FIELDS[field].type==QUERY_TYPE_BOOL && row<columns->capacity );
+    ((guint8 *)columns->values[field])[row] = value ? 1 : 0;
+}
+
+
+/*------------------------------- COMPILER --------------------------------*/
+
+static int
+query_find_field(const char *name, int name_size)
+{
+    int field; const char *alias;
+    for( field=0 ; field<QUERY_FIELD_COUNT ; ++field ) {
+        alias = QUERY_FIELDS[field].alias;
+        if( ((int)strlen(QUERY_FIELDS[field].name)==name_size &&
+             g_ascii_strncasecmp(QUERY_FIELDS[field].name, name, name_size)==0) ||
+            (alias && (int)strlen(alias)==name_size &&
+             g_ascii_strncasecmp(alias, name, name_size)==0) ) {
+            return field;
+        }
+    }
+    return -1;
+}
+
+/* Reads the operator at 'ptr', returns its length or 0 if there is none */
+static int
+query_read_op(const char *ptr, QueryOp *out_op)
+{
+    if( ptr[0]=='!' && ptr[1]=='=' ) { *out_op = QUERY_OP_NE; return 2; }
+    if( ptr[0]=='<' && ptr[1]=='=' ) { *out_op = QUERY_OP_LE; return 2; }
+    if( ptr[0]=='>' && ptr[1]=='=' ) { *out_op = QUERY_OP_GE; return 2; }
+    if( ptr[0]=='<' ) { *out_op = QUERY_OP_LT;       return 1; }
+    if( ptr[0]=='>' ) { *out_op = QUERY_OP_GT;       return 1; }
+    if( ptr[0]=='=' ) { *out_op = QUERY_OP_EQ;       return 1; }
+    if( ptr[0]==':' ) { *out_op = QUERY_OP_CONTAINS; return 1; }
+    return 0;
+}
+
+/* Reads a (possibly quoted) word, returns a pointer past its end */
+static const char *
+query_read_word(const char *ptr, const char **out_start, int *out_size)
+{
+    const char *start;
+    if( *ptr=='"' ) {
+        start = ++ptr;
+        while( *ptr && *ptr!='"' ) { ++ptr; }
+        (*out_start) = start; (*out_size) = ptr-start;
+        return *ptr ? ptr+1 : ptr;
+    }
+    start = ptr;
+    while( *ptr && *ptr!=' ' && *ptr!='\t' ) { ++ptr; }
+    (*out_start) = start; (*out_size) = ptr-start;
+    return ptr;
+}
+
+static gboolean
+query_parse_bool(const char *value, gint64 *out_value)
+{
+    static const char *TRUE_WORDS[]  = { "yes", "true",  "1", "on",  NULL };
+    static const char *FALSE_WORDS[] = { "no",  "false", "0", "off", NULL };
+    int i;
+    for( i=0 ; TRUE_WORDS[i] ; ++i ) {
+        if( g_ascii_strcasecmp(value, TRUE_WORDS[i])==0 ) { *out_value = 1; return TRUE; }
+    }
+    for( i=0 ; FALSE_WORDS[i] ; ++i ) {
+        if( g_ascii_strcasecmp(value, FALSE_WORDS[i])==0 ) { *out_value = 0; return TRUE; }
+    }
+    return FALSE;
+}
+
+/* Resolves a string predicate against the dictionary of the field */
+static void
+query_match_dict(QueryPredicate *predicate, const QueryDict *dict, const char *value)
+{
+    gchar *needle, *haystack; guint id; gboolean match;
+    
+    predicate->id_matches = g_new0(guint8, dict->strings->len);
+    needle = g_utf8_casefold(value, -1);
+    for( id=1 ; id<dict->strings->len ; ++id ) {
+        haystack = g_utf8_casefold(g_ptr_array_index(dict->strings, id), -1);
+        match    = predicate->op==QUERY_OP_CONTAINS
+                 ? strstr(haystack, needle)!=NULL
+                 : strcmp(haystack, needle)==0;
+        if( predicate->op==QUERY_OP_NE ) { match = !match; }
+        predicate->id_matches[id] = match ? 1 : 0;
+        g_free(haystack);
+    }
+    g_free(needle);
+}
+
+/* Fills the predicate from 'value', returns FALSE if it is not valid */
+static gboolean
+query_make_predicate(QueryPredicate *predicate, const QueryColumns *columns, const char *value)
+{
+    QueryType type = QUERY_FIELDS[predicate->field].type; char *end;
+    gdouble number;
+    
+    if( type==QUERY_TYPE_STRING ) {
+        if( predicate->op!=QUERY_OP_CONTAINS &&
+            predicate->op!=QUERY_OP_EQ && predicate->op!=QUERY_OP_NE ) { return FALSE; }
+        query_match_dict(predicate, &columns->dicts[predicate->field], value);
+        return TRUE;
+    }
+    if( predicate->op==QUERY_OP_CONTAINS ) { predicate->op = QUERY_OP_EQ; }
+    if( type==QUERY_TYPE_BOOL ) {
+        return (predicate->op==QUERY_OP_EQ || predicate->op==QUERY_OP_NE) &&
+               query_parse_bool(value, &predicate->int_value);
+    }
+    number = g_ascii_strtod(value, &end);
+    if( end==value || *end!='\0' ) { return FALSE; }
+    predicate->float_value = (gfloat)number;
+    predicate->int_value   = type==QUERY_TYPE_INT64 ? g_ascii_strtoll(value, NULL, 10)
+                                                    : (gint64)number;
+    return TRUE;
+}
+
+static void
+query_clear_program(QueryProgram *program)
+{
+    int i;
+    for( i=0 ; i<program->count ; ++i ) { g_free(program->predicates[i].id_matches); }
+    program->count = 0;
+}
+
+/**
+ * Compiles the predicates of a query into a program.
+ * 
+ * @param program   The program to fill (release it with query_clear_program).
+ * @param columns   The columns the program will run on; string predicates
+ *                  are resolved against their dictionaries.
+ * @param text      The query.
+ * @param rest      Receives the words that are not predicates.
+ */
+static void
+query_compile(QueryProgram       *program,
+              const QueryColumns *columns,
+              const char         *text,
+              GString            *rest)
+{
+    QueryPredicate *predicate; const char *ptr, *start, *name, *value_start;
+    gchar *value; int name_size, value_size, op_size, field; gboolean negate;
+    QueryOp op;
+    
+    memset(program, 0, sizeof(QueryProgram));
+    ptr = text ? text : "";
+    while( *ptr ) {
+        while( *ptr==' ' || *ptr=='\t' ) { ++ptr; }
+        if( !*ptr ) { break; }
+        start  = ptr;
+        negate = (*ptr=='-');
+        name   = negate ? ptr+1 : ptr;
+        for( name_size=0 ; g_ascii_isalnum(name[name_size]) || name[name_size]=='_' ; ++name_size ) { }
+        field   = name_size>0 ? query_find_field(name, name_size) : -1;
+        op_size = field>=0 ? query_read_op(&name[name_size], &op) : 0;
+        if( op_size==0 || program->count>=QUERY_MAX_PREDICATES ) {
+            /* not a predicate, the word (with its quotes) goes to 'rest' */
+            ptr = query_read_word(ptr, &value_start, &value_size);
+            g_string_append_len(rest, start, ptr-start);
+            g_string_append_c(rest, ' ');
+            continue;
+        }
+        ptr   = query_read_word(&name[name_size+op_size], &value_start, &value_size);
+        value = g_strndup(value_start, value_size);
+        predicate = &program->predicates[program->count];
+        memset(predicate, 0, sizeof(QueryPredicate));
+        predicate->field  = field;
+        predicate->op     = op;
+        predicate->negate = negate;
+        if( value_size>0 && query_make_predicate(predicate, columns, value) ) {
+            program->count++;
+        }
+        g_free(value);
+    }
+}
+
+
+/*------------------------------- EXECUTION -------------------------------*/
+
+/* ANDs the result of 'condition' (evaluated for each row) into the mask */
+#define QUERY_SCAN(condition) \
+    for( i=0 ; i<rows ; ++i ) { mask[i] &= (guint8)((condition) ^ negate); }
+
+/* 'known' is FALSE for the rows whose value is unknown */
+#define QUERY_SCAN_COMPARE(values, ref, known)                             \
+    switch( predicate->op ) {                                              \
+        case QUERY_OP_NE: QUERY_SCAN( values[i]!=ref && (known) ); break;  \
+        case QUERY_OP_LT: QUERY_SCAN( values[i]< ref && (known) ); break;  \
+        case QUERY_OP_LE: QUERY_SCAN( values[i]<=ref && (known) ); break;  \
+        case QUERY_OP_GT: QUERY_SCAN( values[i]> ref ); break;             \
+        case QUERY_OP_GE: QUERY_SCAN( values[i]>=ref ); break;             \
+        default:          QUERY_SCAN( values[i]==ref ); break;             \
+    }
+
+static void
+query_run_predicate(const QueryPredicate *predicate,
+                    const QueryColumns   *columns,
+                    guint8 * restrict     mask,
+                    guint                 rows)
+{
+    const gpointer values = columns->values[predicate->field];
+    const guint8 negate   = predicate->negate ? 1 : 0;
+    const guint8 *matches = predicate->id_matches;
+    const guint32 *ids    = values;
+    const gint32  *ints   = values;
+    const gint64  *longs  = values;
+    const gfloat  *floats = values;
+    const guint8  *bools  = values;
+    const gint32  ref32   = (gint32)CLAMP(predicate->int_value, G_MININT32, G_MAXINT32);
+    const gint64  ref64   = predicate->int_value;
+    const gfloat  ref     = predicate->float_value;
+    const guint8  ref8    = predicate->int_value ? 1 : 0;
+    guint i;
+    
+    switch( QUERY_FIELDS[predicate->field].type ) {
+        case QUERY_TYPE_STRING:
+            /* 'matches[QUERY_UNKNOWN_ID]' is always 0 */
+            QUERY_SCAN( matches[ ids[i] ] );
+            break;
+        case QUERY_TYPE_INT:
+            QUERY_SCAN_COMPARE( ints, ref32, ints[i]!=QUERY_UNKNOWN_INT );
+            break;
+        case QUERY_TYPE_INT64:
+            QUERY_SCAN_COMPARE( longs, ref64, longs[i]!=QUERY_UNKNOWN_INT64 );
+            break;
+        case QUERY_TYPE_FLOAT:
+            /* unknown values are NaN, the only value not equal to itself */
+            QUERY_SCAN_COMPARE( floats, ref, floats[i]==floats[i] );
+            break;
+        case QUERY_TYPE_BOOL:
+            if( predicate->op==QUERY_OP_NE ) { QUERY_SCAN( bools[i]!=ref8 && bools[i]!=QUERY_UNKNOWN_BOOL ); }
+            else                             { QUERY_SCAN( bools[i]==ref8 ); }
+            break;
+    }
+}
+
+/**
+ * Runs the program over the first 'rows' rows of the columns.
+ * @param mask  Array of 'rows' bytes, set to 1 for the matching rows.
+ */
+static void
+query_execute(const QueryProgram *program,
+              const QueryColumns *columns,
+              guint8             *mask,
+              guint               rows)
+{
+    int i;
+    memset(mask, 1, rows);
+    for( i=0 ; i<program->count ; ++i ) {
+        query_run_predicate(&program->predicates[i], columns, mask, rows);
+    }
+}
+
+
+/*------------------------------- SORTING ---------------------------------*/
+
+typedef struct _QuerySortItem QuerySortItem;
+struct         _QuerySortItem {
+    guint64 key;
+    guint32 row;
+};
+
+static int
+query_compare_sort_items(const void *a, const void *b)
+{
+    const QuerySortItem *item1 = a, *item2 = b;
+    if( item1->key!=item2->key ) { return item1->key < item2->key ? -1 : 1; }
+    return item1->row < item2->row ? -1 : item1->row > item2->row;
+}
+
+static int
+query_compare_dict_ids(gconstpointer a, gconstpointer b, gpointer strings)
+{
+    const char *string1 = g_ptr_array_index((GPtrArray *)strings, *(const guint32 *)a);
+    const char *string2 = g_ptr_array_index((GPtrArray *)strings, *(const guint32 *)b);
+    return g_utf8_collate(string1, string2);
+}
+
+/*
+ * Returns the position of each string of the dictionary in alphabetical
+ * order, so that rows can be sorted comparing integers.
+ */
+static guint32 *
+query_get_dict_order(const QueryDict *dict)
+{
+    guint count = dict->strings->len; guint32 *ids, *order; guint i;
+    ids   = g_new(guint32, count);
+    order = g_new(guint32, count);
+    for( i=0 ; i<count ; ++i ) { ids[i] = i; }
+    /* id 0 (unknown) is not a string, it is never compared */
+    g_qsort_with_data(ids+1, count-1, sizeof(guint32), query_compare_dict_ids, dict->strings);
+    for( i=0 ; i<count ; ++i ) { order[ ids[i] ] = i; }
+    g_free(ids);
+    return order;
+}
+
+/*
+ * Maps the value of a row to an unsigned integer with the same order,
+ * unknown values are mapped to G_MAXUINT64.
+ */
+static guint64
+query_get_sort_key(const QueryColumns *columns,
+                   QueryField          field,
+                   guint               row,
+                   const guint32      *dict_order)
+{
+    const gpointer values = columns->values[field];
+    guint32 bits; gfloat value;
+    
+    switch( QUERY_FIELDS[field].type ) {
+        case QUERY_TYPE_STRING:
+            if( ((guint32 *)values)[row]==QUERY_UNKNOWN_ID ) { return G_MAXUINT64; }
+            return dict_order[ ((guint32 *)values)[row] ];
+        case QUERY_TYPE_INT:
+            if( ((gint32 *)values)[row]==QUERY_UNKNOWN_INT ) { return G_MAXUINT64; }
+            return (guint32)((gint32 *)values)[row] ^ 0x80000000u;
+        case QUERY_TYPE_INT64:
+            if( ((gint64 *)values)[row]==QUERY_UNKNOWN_INT64 ) { return G_MAXUINT64; }
+            return (guint64)((gint64 *)values)[row] ^ G_GUINT64_CONSTANT(0x8000000000000000);
+        case QUERY_TYPE_FLOAT:
+            value = ((gfloat *)values)[row];
+            if( isnan(value) ) { return G_MAXUINT64; }
+            /* IEEE floats sort as integers once the negatives are flipped */
+            memcpy(&bits, &value, sizeof(bits));
+            return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+        case QUERY_TYPE_BOOL:
+            if( ((guint8 *)values)[row]==QUERY_UNKNOWN_BOOL ) { return G_MAXUINT64; }
+            return ((guint8 *)values)[row];
+    }
+    return G_MAXUINT64;
+}
+
+/**
+ * Sorts the rows of the columns by the values of a field. Only the
+ * 'rows' filled are sorted, not the spare capacity after them.
+ *
+ * Rows with an unknown value go last in both directions and rows with the
+ * same value keep their relative order.
+ * @param columns     The columns with the values.
+ * @param field       The field to sort by.
+ * @param descending  TRUE to sort from the highest value to the lowest.
+ * @returns
+ *     A new array with the rank of each row (the position that the row
+ *     takes once sorted), to be freed with g_free().
+ */
+static guint32 *
+query_sort_rows(const QueryColumns *columns,
+                QueryField          field,
+                gboolean            descending)
+{
+    QuerySortItem *items; guint32 *ranks, *dict_order = NULL;
+    guint64 key; guint i, rows = columns->rows;
+    
+    if( QUERY_FIELDS[field].type==QUERY_TYPE_STRING ) {
+        dict_order = query_get_dict_order(&columns->dicts[field]);
+    }
+    items = g_new(QuerySortItem, MAX(rows,1));
+    for( i=0 ; i<rows ; ++i ) {
+        key = query_get_sort_key(columns, field, i, dict_order);
+        if( descending && key!=G_MAXUINT64 ) { key = (G_MAXUINT64-1) - key; }
+        items[i].key = key;
+        items[i].row = i;
+    }
+    qsort(items, rows, sizeof(QuerySortItem), query_compare_sort_items);
+    ranks = g_new(guint32, MAX(rows,1));
+    for( i=0 ; i<rows ; ++i ) { ranks[ items[i].row ] = i; }
+    g_free(items);
+    g_free(dict_order);
+    return ranks;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file    utils_sdindex.h
+ * @brief   Entries and searches of an index of generation parameters.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+
+    An index of generation parameters keeps one SDIndexEntry per image
+    with its text parameters (the strings live in a GStringChunk), the
+    numbers in the columns of 'utils_query.h' and the prompts in the
+    full-text index of 'utils_invindex.h'. Filling an entry only writes
+    its own row of the numeric columns, so different threads can fill
+    different entries; publishing it adds the prompts and the dictionary
+    strings, which must be done in order and by one thread at a time.
+    
+    The folder indexer of the plugin and the SDCoreIndex of
+    'libsdprompt-core' are both built on these functions.
+    
+    NOTE: 'utils_sdparams.h', 'utils_invindex.h' and 'utils_query.h' must
+          be included first.
+*/
+#include <glib.h>
+#if !defined( SD_PARAMETERS_INPUT_SIZE )
+#  error "utils_sdindex.h requires utils_sdparams.h"
+#endif
+#if !defined( INV_MAX_TERM_SIZE ) || !defined( QUERY_MAX_PREDICATES )
+#  error "utils_sdindex.h requires utils_invindex.h and utils_query.h"
+#endif
+
+/**
+ * The text parameters of one image. Strings are owned by the pool that
+ * filled the entry and are NULL when the image doesn't contain them;
+ * numeric parameters are stored by column in the 'QueryColumns'.
+ **/
+typedef struct _SDIndexEntry SDIndexEntry;
+struct         _SDIndexEntry {
+    const gchar *uri;
+    const gchar *prompt;
+    const gchar *negative_prompt;
+    const gchar *model;
+    const gchar *model_hash;
+    const gchar *sampler;
+    const gchar *networks;      /* names of the LoRAs, ... separated by ", " */
+    gboolean     has_parameters;
+};
+
+
+/*-------------------------------- FILLING --------------------------------*/
+
+static const gchar *
+index_pool_insert( GStringChunk *pool, const char *str )
+{
+    return str ? g_string_chunk_insert( pool, str ) : NULL;
+}
+
+static const gchar *
+index_pool_insert_const( GStringChunk *pool, const char *str )
+{
+    return str ? g_string_chunk_insert_const( pool, str ) : NULL;
+}
+
+/* joins the names of the extra networks, e.g. "detail, style" */
+static const gchar *
+index_pool_insert_networks( GStringChunk *pool, const SDPromptNetworks *networks )
+{
+    GString *names; const gchar *result; int i;
+    if( networks->count==0 ) { return NULL; }
+    names = g_string_new( NULL );
+    for( i=0 ; i<networks->count ; ++i ) {
+        if( i>0 ) { g_string_append( names, ", " ); }
+        g_string_append_len( names, networks->networks[i].name,
+                             networks->networks[i].name_size );
+    }
+    result = g_string_chunk_insert_const( pool, names->str );
+    g_string_free( names, TRUE );
+    return result;
+}
+
+/**
+ * Fills the entry of row 'row' with the parsed 'parameters' of its image.
+ * The strings are copied to 'pool' and the numbers are written to the row
+ * of 'columns', which must already have room for it.
+ */
+static void
+fill_index_entry( SDIndexEntry       *entry,
+                  guint               row,
+                  const SDParameters *parameters,
+                  GStringChunk       *pool,
+                  QueryColumns       *columns )
+{
+    const char *denoising;
+    
+    entry->has_parameters  = TRUE;
+    entry->prompt          = index_pool_insert( pool, parameters->prompt );
+    entry->negative_prompt = index_pool_insert( pool, parameters->negative_prompt );
+    entry->model           = index_pool_insert_const( pool, parameters->model.name );
+    entry->model_hash      = index_pool_insert_const( pool, parameters->model.hash );
+    entry->sampler         = index_pool_insert_const( pool, parameters->sampler );
+    entry->networks        = index_pool_insert_networks( pool, &parameters->networks );
+    
+    denoising = parameters->denoising ? parameters->denoising
+              : parameters->hires.denoising ? parameters->hires.denoising
+              : parameters->inpaint.denoising;
+    query_set_number( columns, QUERY_STEPS,     row, parameters->steps     );
+    query_set_number( columns, QUERY_CFG,       row, parameters->cfg_scale );
+    query_set_number( columns, QUERY_SEED,      row, parameters->seed      );
+    query_set_number( columns, QUERY_WIDTH,     row, parameters->width     );
+    query_set_number( columns, QUERY_HEIGHT,    row, parameters->height    );
+    query_set_number( columns, QUERY_DENOISING, row, denoising             );
+    query_set_bool  ( columns, QUERY_HIRES,     row, parameters->hires.has_info );
+}
+
+/**
+ * Makes a filled entry searchable: adds its prompts to the full-text index
+ * and its model and sampler to the dictionaries of the columns. The posting
+ * lists only grow by appending, so entries must be published in order.
+ */
+static void
+publish_index_entry( const SDIndexEntry *entry,
+                     guint32             doc,
+                     InvIndex           *text_index,
+                     QueryColumns       *columns )
+{
+    inv_index_add_text( text_index, doc, INV_FIELD_PROMPT,   entry->prompt );
+    inv_index_add_text( text_index, doc, INV_FIELD_NEGATIVE, entry->negative_prompt );
+    query_set_string( columns, QUERY_MODEL,   doc, entry->model   );
+    query_set_string( columns, QUERY_SAMPLER, doc, entry->sampler );
+}
+
+
+/*------------------------------- SEARCHING -------------------------------*/
+
+static const char *
+get_index_entry_text( guint32 doc, InvField field, gpointer user_data )
+{
+    const SDIndexEntry *entry = &((const SDIndexEntry *)user_data)[doc];
+    return field==INV_FIELD_NEGATIVE ? entry->negative_prompt : entry->prompt;
+}
+
+/**
+ * Searches the first 'columns->rows' entries (the published ones).
+ * @param query  Parameter predicates (see 'utils_query.h') followed by words
+ *               and quoted phrases of the prompts (see 'utils_invindex.h').
+ * @returns
+ *     A GArray with the sorted positions (guint32) of the matching entries,
+ *     or NULL if 'query' is empty and every entry matches.
+ */
+static GArray *
+search_index_entries( const SDIndexEntry *entries,
+                      InvIndex           *text_index,
+                      QueryColumns       *columns,
+                      const gchar        *query )
+{
+    QueryProgram program; GString *words; GArray *text_matches, *result;
+    guint8 *mask; guint32 doc; guint i, rows;
+    
+    words = g_string_new( NULL );
+    query_compile( &program, columns, query ? query : "", words );
+    text_matches = inv_index_search( text_index, words->str,
+                                     get_index_entry_text, (gpointer)entries );
+    result = text_matches;
+    if( program.count>0 ) {
+        rows = columns->rows;
+        mask = g_new( guint8, MAX( rows, 1 ) );
+        query_execute( &program, columns, mask, rows );
+        result = g_array_new( FALSE, FALSE, sizeof(guint32) );
+        if( text_matches ) {
+            for( i=0 ; i<text_matches->len ; ++i ) {
+                doc = g_array_index( text_matches, guint32, i );
+                if( mask[doc] ) { g_array_append_val( result, doc ); }
+            }
+            g_array_unref( text_matches );
+        } else {
+            for( doc=0 ; doc<rows ; ++doc ) {
+                if( mask[doc] ) { g_array_append_val( result, doc ); }
+            }
+        }
+        g_free( mask );
+    }
+    query_clear_program( &program );
+    g_string_free( words, TRUE );
+    return result;
+}
@@ -59,6 +59,7 @@
 */
 #include <stdlib.h>
 #include <string.h>
+#include "utils_sdprompt.h"
 
 /* Maximum size in bytes of the 'input' field in the SDParameters struct. */
 #define SD_PARAMETERS_INPUT_SIZE (32*1024)
@@ -126,6 +127,11 @@ struct         _SDParameters {
         const char *value;
     } unknowns[SD_PARAMETERS_ARRAY_SIZE];
     int unknowns_count;
+    
+    /* prompt tokens & extra networks (LoRAs, embeddings, ...) */
+    SDPromptTokens   prompt_tokens;
+    SDPromptTokens   negative_tokens;
+    SDPromptNetworks networks;
 };
 
 typedef void (*SDParametersCallback)(SDParameters *sd_parameters,
@@ -364,6 +370,35 @@ parse_sd_params_from_lastline(SDParameters *sd_parameters,
     }
 }
 
+static void
+parse_sd_params_tokenize(SDParameters *sd_parameters)
+{
+    const char *embedding_names = NULL; int i;
+    
+    for( i=0 ; i<sd_parameters->unknowns_count &&
+               i<(SD_PARAMETERS_ARRAY_SIZE-1) ; ++i ) {
+        if( 0==strcmp( sd_parameters->unknowns[i].key, "TI hashes" ) ) {
+            embedding_names = sd_parameters->unknowns[i].value;
+        }
+    }
+    tokenize_sd_prompt( &sd_parameters->prompt_tokens,
+                        sd_parameters->prompt );
+    tokenize_sd_prompt( &sd_parameters->negative_tokens,
+                        sd_parameters->negative_prompt );
+    if( embedding_names ) {
+        mark_sd_prompt_embeddings( &sd_parameters->prompt_tokens,
+                                   sd_parameters->prompt, embedding_names );
+        mark_sd_prompt_embeddings( &sd_parameters->negative_tokens,
+                                   sd_parameters->negative_prompt, embedding_names );
+    }
+    collect_sd_prompt_networks( &sd_parameters->networks,
+                                &sd_parameters->prompt_tokens,
+                                sd_parameters->prompt, 0 );
+    collect_sd_prompt_networks( &sd_parameters->networks,
+                                &sd_parameters->negative_tokens,
+                                sd_parameters->negative_prompt, 1 );
+}
+
 static void
 parse_sd_params_final_fix(SDParameters *sd_parameters)
 {
@@ -428,6 +463,9 @@ parse_sd_params_final_fix(SDParameters *sd_parameters)
             sd_parameters->hires.calc_upscale = hr_upscale / (float)n;
         }
     }
+    
+    /* 4) tokenize the prompts and collect the extra networks */
+    parse_sd_params_tokenize( sd_parameters );
 }
 
 /**
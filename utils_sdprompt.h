@@ -0,0 +1,544 @@
+/**
+ * @file    utils_sdprompt.h
+ * @brief   Tokenizer for the A1111 prompt syntax in bare C code.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    The tokenizer splits a prompt into a compact array of tokens in a single
+    pass. Each token is a slice of the prompt text (offset + size) together
+    with its type and the attention weight that A1111 would apply to it.
+    For example, "a (red:1.2) car, <lora:detail:0.8> BREAK __colors__"
+    produces the following tokens:
+    
+      TEXT      "a"                  weight 1.0
+      OPEN      "("
+      TEXT      "red"                weight 1.2
+      WEIGHT    ":1.2"
+      CLOSE     ")"
+      TEXT      "car"                weight 1.0
+      NETWORK   "<lora:detail:0.8>"
+      BREAK     "BREAK"
+      WILDCARD  "__colors__"
+    
+    Text tokens are the comma-separated phrases of the prompt, trimmed, so
+    they can be used directly for highlighting, indexing and filtering.
+*/
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum number of tokens stored for a single prompt */
+#define SD_PROMPT_MAX_TOKENS 512
+
+/* Maximum nesting level of '(' and '[' tracked by the tokenizer */
+#define SD_PROMPT_MAX_DEPTH 32
+
+/* Maximum number of extra networks (LoRAs, embeddings, ...) per image */
+#define SD_PROMPT_MAX_NETWORKS 64
+
+typedef enum _SDPromptTokenType SDPromptTokenType;
+enum         _SDPromptTokenType {
+    SD_TOKEN_TEXT,       /* a phrase of the prompt                        */
+    SD_TOKEN_OPEN,       /* '(' or '['                                    */
+    SD_TOKEN_CLOSE,      /* ')' or ']'                                    */
+    SD_TOKEN_SEPARATOR,  /* ':' or '|' inside '[...]' (scheduling/alternation) */
+    SD_TOKEN_WEIGHT,     /* ':1.2' inside '(...)' or the step of '[a:b:0.5]'  */
+    SD_TOKEN_NETWORK,    /* '<lora:name:0.8>', '<hypernet:name:1>', ...    */
+    SD_TOKEN_EMBEDDING,  /* textual inversion embedding                   */
+    SD_TOKEN_WILDCARD,   /* '__name__'                                    */
+    SD_TOKEN_BREAK       /* 'BREAK'                                       */
+};
+
+typedef struct _SDPromptToken SDPromptToken;
+struct         _SDPromptToken {
+    unsigned short start;   /* offset of the token in the prompt text  */
+    unsigned short size;    /* number of bytes of the token            */
+    unsigned char  type;    /* SDPromptTokenType                        */
+    unsigned char  depth;   /* number of enclosing brackets            */
+    float          weight;  /* attention weight (1.0 = no emphasis)     */
+};
+
+typedef struct _SDPromptTokens SDPromptTokens;
+struct         _SDPromptTokens {
+    int           count;
+    int           truncated;
+    SDPromptToken tokens[SD_PROMPT_MAX_TOKENS];
+};
+
+typedef enum _SDPromptSpanType SDPromptSpanType;
+enum         _SDPromptSpanType {
+    SD_SPAN_SYNTAX,
+    SD_SPAN_WEIGHT,
+    SD_SPAN_NETWORK,
+    SD_SPAN_EMBEDDING,
+    SD_SPAN_WILDCARD,
+    SD_SPAN_BREAK,
+    SD_SPAN_EMPHASIS,
+    SD_SPAN_DEEMPHASIS,
+    SD_SPAN_CHUNK,          /* first CLIP token of a 75-token chunk */
+    SD_SPAN_TYPE_COUNT
+};
+
+/* A highlighted range of the prompt, in characters (not bytes) */
+typedef struct _SDPromptSpan SDPromptSpan;
+struct         _SDPromptSpan {
+    unsigned int  start;
+    unsigned int  end;
+    unsigned char type;     /* SDPromptSpanType */
+};
+
+typedef enum _SDNetworkType SDNetworkType;
+enum         _SDNetworkType {
+    SD_NETWORK_LORA,
+    SD_NETWORK_HYPERNET,
+    SD_NETWORK_EMBEDDING
+};
+
+typedef struct _SDPromptNetwork SDPromptNetwork;
+struct         _SDPromptNetwork {
+    unsigned char type;        /* SDNetworkType                    */
+    unsigned char negative;    /* 1 if found in the negative prompt */
+    int           name_size;
+    const char   *name;        /* not NUL-terminated               */
+    float         multiplier;
+};
+
+typedef struct _SDPromptNetworks SDPromptNetworks;
+struct         _SDPromptNetworks {
+    int             count;
+    SDPromptNetwork networks[SD_PROMPT_MAX_NETWORKS];
+};
+
+
+/*------------------------------- HELPERS ---------------------------------*/
+
+#define SD_PROMPT_IS_SPACE(x) ((x)==' ' || (x)=='\t' || (x)=='\n' || (x)=='\r')
+#define SD_PROMPT_EMPHASIS 1.1f
+
+typedef struct _SDPromptBracket SDPromptBracket;
+struct         _SDPromptBracket {
+    char  open_char;
+    char  is_schedule;
+    int   token_index;    /* index of the SD_TOKEN_OPEN token */
+    float multiplier;
+};
+
+typedef struct _SDPromptTokenizer SDPromptTokenizer;
+struct         _SDPromptTokenizer {
+    SDPromptTokens *out;
+    const char     *text;
+    int             depth;
+    float           weight;
+    SDPromptBracket stack[SD_PROMPT_MAX_DEPTH];
+};
+
+static void
+sd_prompt_add_token(SDPromptTokenizer *t, int type, int start, int size)
+{
+    SDPromptToken *token;
+    if( size<=0 ) { return; }
+    if( t->out->count >= SD_PROMPT_MAX_TOKENS ) { t->out->truncated = 1; return; }
+    token = &t->out->tokens[ t->out->count++ ];
+    token->start  = (unsigned short)start;
+    token->size   = (unsigned short)size;
+    token->type   = (unsigned char)type;
+    token->depth  = (unsigned char)t->depth;
+    token->weight = t->weight;
+}
+
+/* adds the pending phrase [start,end) as a text (or embedding) token */
+static void
+sd_prompt_flush_text(SDPromptTokenizer *t, int *inout_start, int end)
+{
+    int start = (*inout_start);
+    if( start<0 ) { return; }
+    while( start<end && SD_PROMPT_IS_SPACE(t->text[start])   ) { ++start; }
+    while( end>start && SD_PROMPT_IS_SPACE(t->text[end-1])   ) { --end;   }
+    if( end-start > 10 && memcmp( &t->text[start], "embedding:", 10 )==0 ) {
+        sd_prompt_add_token( t, SD_TOKEN_EMBEDDING, start, end-start );
+    } else {
+        sd_prompt_add_token( t, SD_TOKEN_TEXT, start, end-start );
+    }
+    (*inout_start) = -1;
+}
+
+/* multiplies the weight of every token added after 'token_index' */
+static void
+sd_prompt_scale_weights(SDPromptTokenizer *t, int token_index, float factor)
+{
+    int i;
+    for( i=token_index+1 ; i<t->out->count ; ++i ) {
+        t->out->tokens[i].weight *= factor;
+    }
+    t->weight *= factor;
+}
+
+/* returns the size of a number starting at 'ptr' that is followed by
+ * (optional spaces and) 'close_char', or 0 if there is no such number */
+static int
+sd_prompt_number_before(const char *ptr, char close_char, float *out_value)
+{
+    const char *start = ptr; char *endptr; double value;
+    while( SD_PROMPT_IS_SPACE(*ptr) ) { ++ptr; }
+    if( !(('0'<=*ptr && *ptr<='9') || *ptr=='.' || *ptr=='-') ) { return 0; }
+    value = strtod( ptr, &endptr );
+    if( endptr==ptr ) { return 0; }
+    ptr = endptr;
+    while( SD_PROMPT_IS_SPACE(*ptr) ) { ++ptr; }
+    if( *ptr!=close_char ) { return 0; }
+    (*out_value) = (float)value;
+    return (int)(ptr - start);
+}
+
+/* returns the size of '<type:name...>' starting at 'ptr', or 0 */
+static int
+sd_prompt_network_size(const char *ptr)
+{
+    const char *start = ptr; int has_colon = 0;
+    ++ptr;
+    while( ('a'<=*ptr && *ptr<='z') || ('A'<=*ptr && *ptr<='Z') ) { ++ptr; }
+    if( ptr==start+1 || *ptr!=':' ) { return 0; }
+    while( *ptr && *ptr!='>' && *ptr!='<' && *ptr!='\n' ) {
+        if( *ptr==':' ) { has_colon = 1; }
+        ++ptr;
+    }
+    return (*ptr=='>' && has_colon) ? (int)(ptr - start) + 1 : 0;
+}
+
+/* returns the size of '__name__' starting at 'ptr', or 0 */
+static int
+sd_prompt_wildcard_size(const char *ptr)
+{
+    const char *start = ptr;
+    if( ptr[0]!='_' || ptr[1]!='_' ) { return 0; }
+    ptr += 2;
+    while( ('a'<=*ptr && *ptr<='z') || ('A'<=*ptr && *ptr<='Z') ||
+           ('0'<=*ptr && *ptr<='9') || *ptr=='-' || *ptr=='/' ||
+           *ptr=='.' || *ptr=='*' || (*ptr=='_' && ptr[1]!='_') ) { ++ptr; }
+    if( ptr==start+2 || ptr[0]!='_' || ptr[1]!='_' ) { return 0; }
+    return (int)(ptr - start) + 2;
+}
+
+static int
+sd_prompt_is_break(const char *text, int i)
+{
+    const char prev = (i>0) ? text[i-1] : ' ';
+    char next;
+    if( strncmp( &text[i], "BREAK", 5 )!=0 ) { return 0; }
+    next = text[i+5];
+    return (SD_PROMPT_IS_SPACE(prev) || prev==',') &&
+           (SD_PROMPT_IS_SPACE(next) || next==',' || next=='\0');
+}
+
+/*============================ MAIN FUNCTIONS ==============================*/
+
+/**
+ * Splits a prompt written with the A1111 syntax into tokens.
+ * 
+ * The prompt is scanned once. The attention weight of each token is
+ * calculated as A1111 does: '(' multiplies by 1.1, '[' divides by 1.1,
+ * '(text:1.2)' multiplies by 1.2 and '[a:b:0.5]' / '[a|b]' do not change
+ * the weight. When the meaning of a bracket is only known at its end, the
+ * weights of the tokens already emitted inside it are corrected in place.
+ * 
+ * @param tokens  Pointer to the struct that receives the tokens.
+ * @param text    The NUL-terminated prompt (must be shorter than 64KB).
+ */
+static void
+tokenize_sd_prompt(SDPromptTokens *tokens, const char *text)
+{
+    SDPromptTokenizer t; SDPromptBracket *top; float value;
+    int i, size, text_start = -1; char ch;
+    
+    tokens->count     = 0;
+    tokens->truncated = 0;
+    if( !text ) { return; }
+    t.out = tokens; t.text = text; t.depth = 0; t.weight = 1.0f;
+    
+    for( i=0 ; (ch=text[i])!='\0' ; ++i ) {
+        top = t.depth>0 ? &t.stack[ t.depth-1 ] : NULL;
+        switch( ch )
+        {
+            case '\\':
+                if( text_start<0 ) { text_start = i; }
+                if( text[i+1] ) { ++i; }
+                continue;
+                
+            case ',':
+            case '\n':
+                sd_prompt_flush_text( &t, &text_start, i );
+                continue;
+                
+            case '(':
+            case '[':
+                sd_prompt_flush_text( &t, &text_start, i );
+                sd_prompt_add_token( &t, SD_TOKEN_OPEN, i, 1 );
+                if( t.depth >= SD_PROMPT_MAX_DEPTH ) { continue; }
+                top = &t.stack[ t.depth++ ];
+                top->open_char   = ch;
+                top->is_schedule = 0;
+                top->token_index = t.out->count-1;
+                top->multiplier  = (ch=='(') ? SD_PROMPT_EMPHASIS
+                                             : 1.0f/SD_PROMPT_EMPHASIS;
+                t.weight *= top->multiplier;
+                continue;
+                
+            case ')':
+            case ']':
+                if( top && top->open_char==(ch==')' ? '(' : '[') ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    t.weight /= top->multiplier;
+                    --t.depth;
+                    sd_prompt_add_token( &t, SD_TOKEN_CLOSE, i, 1 );
+                    continue;
+                }
+                break;
+                
+            case ':':
+                if( top && top->open_char=='(' &&
+                    (size = sd_prompt_number_before( &text[i+1], ')', &value )) ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    sd_prompt_scale_weights( &t, top->token_index,
+                                             value / top->multiplier );
+                    top->multiplier = value;
+                    sd_prompt_add_token( &t, SD_TOKEN_WEIGHT, i, size+1 );
+                    i += size;
+                    continue;
+                }
+                /* fall through */
+            case '|':
+                if( top && top->open_char=='[' ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    if( !top->is_schedule ) {
+                        top->is_schedule = 1;
+                        sd_prompt_scale_weights( &t, top->token_index,
+                                                 1.0f / top->multiplier );
+                        top->multiplier = 1.0f;
+                    }
+                    sd_prompt_add_token( &t, SD_TOKEN_SEPARATOR, i, 1 );
+                    if( ch==':' &&
+                        (size = sd_prompt_number_before( &text[i+1], ']', &value )) ) {
+                        sd_prompt_add_token( &t, SD_TOKEN_WEIGHT, i+1, size );
+                        i += size;
+                    }
+                    continue;
+                }
+                break;
+                
+            case '<':
+                if( (size = sd_prompt_network_size( &text[i] )) ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    sd_prompt_add_token( &t, SD_TOKEN_NETWORK, i, size );
+                    i += size-1;
+                    continue;
+                }
+                break;
+                
+            case '_':
+                if( (size = sd_prompt_wildcard_size( &text[i] )) ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    sd_prompt_add_token( &t, SD_TOKEN_WILDCARD, i, size );
+                    i += size-1;
+                    continue;
+                }
+                break;
+                
+            case 'B':
+                if( sd_prompt_is_break( text, i ) ) {
+                    sd_prompt_flush_text( &t, &text_start, i );
+                    sd_prompt_add_token( &t, SD_TOKEN_BREAK, i, 5 );
+                    i += 4;
+                    continue;
+                }
+                break;
+        }
+        if( text_start<0 && !SD_PROMPT_IS_SPACE(ch) ) { text_start = i; }
+    }
+    sd_prompt_flush_text( &t, &text_start, i );
+}
+
+/**
+ * Marks as embeddings the text tokens that are equal to one of the names
+ * in @names, a list with the A1111 "TI hashes" format: "name: hash, ...".
+ */
+static void
+mark_sd_prompt_embeddings(SDPromptTokens *tokens,
+                          const char     *text,
+                          const char     *names)
+{
+    const char *name, *ptr; int i, name_size; SDPromptToken *token;
+    
+    for( ptr=names ; ptr && *ptr ; ) {
+        while( *ptr=='"' || *ptr==',' || SD_PROMPT_IS_SPACE(*ptr) ) { ++ptr; }
+        name = ptr;
+        while( *ptr && *ptr!=':' && *ptr!=',' && *ptr!='"' ) { ++ptr; }
+        name_size = (int)(ptr - name);
+        while( *ptr && *ptr!=',' ) { ++ptr; }
+        for( i=0 ; name_size>0 && i<tokens->count ; ++i ) {
+            token = &tokens->tokens[i];
+            if( token->type==SD_TOKEN_TEXT && token->size==name_size &&
+                memcmp( &text[token->start], name, name_size )==0 ) {
+                token->type = SD_TOKEN_EMBEDDING;
+            }
+        }
+    }
+}
+
+/**
+ * Adds an extra network to the list, unless the same network (same type
+ * and name, ignoring case) is already there.
+ */
+static void
+add_sd_prompt_network(SDPromptNetworks *networks,
+                      SDNetworkType     type,
+                      const char       *name,
+                      int               name_size,
+                      float             multiplier,
+                      int               negative)
+{
+    SDPromptNetwork *network; int i, j;
+    
+    while( name_size>0 && SD_PROMPT_IS_SPACE(*name) ) { ++name; --name_size; }
+    while( name_size>0 && SD_PROMPT_IS_SPACE(name[name_size-1]) ) { --name_size; }
+    if( name_size<=0 ) { return; }
+    for( i=0 ; i<networks->count ; ++i ) {
+        network = &networks->networks[i];
+        if( network->type!=type || network->name_size!=name_size ) { continue; }
+        for( j=0 ; j<name_size ; ++j ) {
+            if( (network->name[j]|0x20) != (name[j]|0x20) ) { break; }
+        }
+        if( j==name_size ) { return; }
+    }
+    if( networks->count >= SD_PROMPT_MAX_NETWORKS ) { return; }
+    network = &networks->networks[ networks->count++ ];
+    network->type       = (unsigned char)type;
+    network->negative   = (unsigned char)negative;
+    network->name       = name;
+    network->name_size  = name_size;
+    network->multiplier = multiplier;
+}
+
+/**
+ * Adds to @networks the LoRAs, hypernetworks and embeddings referenced
+ * by the tokens of a prompt.
+ */
+static void
+collect_sd_prompt_networks(SDPromptNetworks     *networks,
+                           const SDPromptTokens *tokens,
+                           const char           *text,
+                           int                   negative)
+{
+    const SDPromptToken *token; const char *ptr, *end, *name;
+    SDNetworkType type; float multiplier; int i;
+    
+    for( i=0 ; i<tokens->count ; ++i ) {
+        token = &tokens->tokens[i];
+        ptr   = &text[ token->start ];
+        end   = ptr + token->size;
+        if( token->type==SD_TOKEN_EMBEDDING ) {
+            if( token->size>10 && memcmp( ptr, "embedding:", 10 )==0 ) { ptr += 10; }
+            add_sd_prompt_network( networks, SD_NETWORK_EMBEDDING, ptr,
+                                   (int)(end-ptr), token->weight, negative );
+        }
+        else if( token->type==SD_TOKEN_NETWORK ) {
+            /* <type:name[:multiplier[:...]]> */
+            type = (ptr[1]=='h' || ptr[1]=='H') ? SD_NETWORK_HYPERNET
+                                                 : SD_NETWORK_LORA;
+            while( ptr<end && *ptr!=':' ) { ++ptr; }
+            name = ++ptr;
+            while( ptr<end && *ptr!=':' && *ptr!='>' ) { ++ptr; }
+            multiplier = (*ptr==':') ? (float)strtod( ptr+1, NULL ) : 1.0f;
+            add_sd_prompt_network( networks, type, name, (int)(ptr-name),
+                                   multiplier, negative );
+        }
+    }
+}
+
+/**
+ * Converts the tokens of a prompt into the list of ranges to highlight.
+ * 
+ * Offsets are converted from bytes to characters (the text must be valid
+ * UTF-8), plain text with neutral weight produces no span, and consecutive
+ * spans of the same type are merged, so the list is ready to be applied
+ * to a text widget without any further processing.
+ * 
+ * @param spans     The array that receives the spans.
+ * @param max_spans The number of elements in @spans.
+ * @param tokens    The tokens produced by tokenize_sd_prompt().
+ * @param text      The prompt that was tokenized.
+ * @returns
+ *     The number of spans stored in @spans.
+ */
+static int
+make_sd_prompt_spans(SDPromptSpan         *spans,
+                     int                   max_spans,
+                     const SDPromptTokens *tokens,
+                     const char           *text)
+{
+    static const signed char SPAN_TYPES[] = {
+        -1,                 /* SD_TOKEN_TEXT (depends on the weight) */
+        SD_SPAN_SYNTAX,     /* SD_TOKEN_OPEN      */
+        SD_SPAN_SYNTAX,     /* SD_TOKEN_CLOSE     */
+        SD_SPAN_SYNTAX,     /* SD_TOKEN_SEPARATOR */
+        SD_SPAN_WEIGHT,     /* SD_TOKEN_WEIGHT    */
+        SD_SPAN_NETWORK,    /* SD_TOKEN_NETWORK   */
+        SD_SPAN_EMBEDDING,  /* SD_TOKEN_EMBEDDING */
+        SD_SPAN_WILDCARD,   /* SD_TOKEN_WILDCARD  */
+        SD_SPAN_BREAK       /* SD_TOKEN_BREAK     */
+    };
+    const SDPromptToken *token; SDPromptSpan *last = NULL;
+    int i, type, byte = 0, count = 0; unsigned int chars = 0, start;
+    
+    for( i=0 ; text && i<tokens->count ; ++i ) {
+        token = &tokens->tokens[i];
+        type  = SPAN_TYPES[ token->type ];
+        if( type<0 ) {
+            if     ( token->weight > 1.001f ) { type = SD_SPAN_EMPHASIS;   }
+            else if( token->weight < 0.999f ) { type = SD_SPAN_DEEMPHASIS; }
+            else { continue; }
+        }
+        /* tokens are sorted, so the byte->char conversion is incremental */
+        for( ; byte<token->start ; ++byte ) {
+            if( (text[byte] & 0xC0)!=0x80 ) { ++chars; }
+        }
+        start = chars;
+        for( ; byte<token->start+token->size ; ++byte ) {
+            if( (text[byte] & 0xC0)!=0x80 ) { ++chars; }
+        }
+        if( last && last->type==type && last->end==start ) {
+            last->end = chars;
+        } else if( count<max_spans ) {
+            last = &spans[ count++ ];
+            last->start = start;
+            last->end   = chars;
+            last->type  = (unsigned char)type;
+        }
+    }
+    return count;
+}
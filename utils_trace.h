@@ -0,0 +1,118 @@
+/**
+ * @file    utils_trace.h
+ * @brief   Optional sysprof marks and counters for the extraction pipeline.
+ * @author  Martin Rizzo | <martinrizzo@gmail.com>
+ * @date    Oct 18, 2026
+ * @repo    https://github.com/martin-rizzo/SDPromptViewer
+ * @license MIT
+ *//*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+                      Stable Diffusion Prompt Viewer
+      A plugin for "Eye of GNOME" that displays SD embedded prompts.
+  
+     Copyright (c) 2023 Martin Rizzo
+  
+     Permission is hereby granted, free of charge, to any person obtaining
+     a copy of this software and associated documentation files (the
+     "Software"), to deal in the Software without restriction, including
+     without limitation the rights to use, copy, modify, merge, publish,
+     distribute, sublicense, and/or sell copies of the Software, and to
+     permit persons to whom the Software is furnished to do so, subject to
+     the following conditions:
+  
+     The above copyright notice and this permission notice shall be
+     included in all copies or substantial portions of the Software.
+  
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+     EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+     TORT OR OTHERWISE, ARISING FROM,OUT OF OR IN CONNECTION WITH THE
+     SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
+
+    When the plugin is built with 'make USE_SYSPROF=1', HAVE_SYSPROF is
+    defined and these macros send marks (named spans of time) and counters
+    to libsysprof-capture, so a sysprof recording of EOG shows where the time
+    of the plugin goes next to the frames and the disk activity. Otherwise
+    every macro expands to nothing.
+    
+    'utils_png.h' and 'utils_widget.h' fall back to no-op marks, so this
+    file must be included before them to get their marks.
+*/
+#include <glib.h>
+#if defined( TRACE_MARK )
+#  error "utils_trace.h must be included before utils_png.h and utils_widget.h"
+#endif
+
+/* Group of the marks in the sysprof timeline */
+#define TRACE_GROUP "sdprompt-viewer"
+
+typedef enum _TraceCounter {
+    TRACE_CACHE_HITS,       /* selections displayed from the image cache */
+    TRACE_CACHE_MISSES,     /* selections that had to read the file      */
+    TRACE_QUEUE_DEPTH,      /* images being loaded by worker threads     */
+    TRACE_COUNTER_COUNT
+} TraceCounter;
+
+#ifdef HAVE_SYSPROF
+#include <string.h>
+#include <sysprof-capture.h>
+
+static const char *TRACE_COUNTER_NAMES[TRACE_COUNTER_COUNT][2] = {
+    { "Cache hits"  , "Selections displayed from the image cache"  },
+    { "Cache misses", "Selections that had to read the image file" },
+    { "Queue depth" , "Images being loaded by worker threads"      }
+};
+
+static guint  trace_counter_base;
+static gint64 trace_counter_values[TRACE_COUNTER_COUNT];
+
+/**
+ * trace_init - Registers the counters of the plugin in the capture.
+ *
+ * Must be called before any TRACE_COUNTER_ADD(); the counters are only
+ * updated from the main thread.
+ */
+static void
+trace_init( void )
+{
+    SysprofCaptureCounter counters[TRACE_COUNTER_COUNT]; int i;
+    if( trace_counter_base ) { return; }
+    
+    memset( counters, 0, sizeof(counters) );
+    trace_counter_base = sysprof_collector_request_counters( TRACE_COUNTER_COUNT );
+    for( i=0 ; i<TRACE_COUNTER_COUNT ; ++i ) {
+        counters[i].id   = trace_counter_base + i;
+        counters[i].type = SYSPROF_CAPTURE_COUNTER_INT64;
+        g_strlcpy( counters[i].category   , "SD Prompt Viewer"        , sizeof(counters[i].category)    );
+        g_strlcpy( counters[i].name       , TRACE_COUNTER_NAMES[i][0], sizeof(counters[i].name)        );
+        g_strlcpy( counters[i].description, TRACE_COUNTER_NAMES[i][1], sizeof(counters[i].description) );
+    }
+    sysprof_collector_define_counters( counters, TRACE_COUNTER_COUNT );
+}
+
+static void
+trace_add_counter( TraceCounter counter, gint64 delta )
+{
+    unsigned int id; SysprofCaptureCounterValue value;
+    if( !trace_counter_base ) { return; }
+    id        = trace_counter_base + counter;
+    value.v64 = ( trace_counter_values[counter] += delta );
+    sysprof_collector_set_counters( &id, &value, 1 );
+}
+
+#  define TRACE_BEGIN() SYSPROF_CAPTURE_CURRENT_TIME
+#  define TRACE_MARK(begin, name, detail)                                 \
+    sysprof_collector_mark( (begin), SYSPROF_CAPTURE_CURRENT_TIME-(begin), \
+                            TRACE_GROUP, (name), "%s", (detail) ? (detail) : "" )
+#  define TRACE_COUNTER_ADD(counter, delta) trace_add_counter( (counter), (delta) )
+
+#else /* !HAVE_SYSPROF */
+
+#  define trace_init()                      ((void)0)
+#  define TRACE_BEGIN()                     ((gint64)0)
+#  define TRACE_MARK(begin, name, detail)   ((void)(begin))
+#  define TRACE_COUNTER_ADD(counter, delta) ((void)0)
+
+#endif
@@ -31,7 +31,17 @@
      SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
 */
+#include <string.h>
 #include <gtk/gtk.h>
+#if !defined( ARENA_ALIGNMENT )
+#  error "utils_widget.h requires utils_arena.h"
+#endif
+
+/* profiler marks, no-ops unless 'utils_trace.h' was included before */
+#if !defined( TRACE_MARK )
+#  define TRACE_BEGIN()                   ((gint64)0)
+#  define TRACE_MARK(begin, name, detail) ((void)(begin))
+#endif
 
 /**
  * get_widget - Retrieves a widget with the specified name.
@@ -43,60 +53,76 @@
 #define get_widget(builder, widget_name) \
     GTK_WIDGET( gtk_builder_get_object( builder, widget_name ) )
 
+/* scratch memory of the text being set, reset once GTK has copied it */
+static Arena *widget_text_arena;
+
 /**
  * ensure_valid_utf8 - Converts a string to valid UTF-8 format.
+ * @arena:     the arena where the converted text is allocated.
  * @text:      a string of possibly invalid utf8 text.
  * @max_bytes: the max bytes to convert, or -1 to go until NUL.
  *
  * This function verifies whether the string is a valid UTF8 string.
- * If it is not valid, it attempts to convert the string to UTF8 using
- * the most appropriate method.
+ * If it is not valid, the string is converted from ISO-8859-1, the most
+ * common encoding of the text written by other tools.
  * 
  * This is useful for ensuring that text is properly encoded before
  * being processed or displayed in a GTK-based application.
  *
- * Returns: a pointer to the string in valid UTF-8 format.
- *    The caller of the function takes ownership of the data,
- *    and is responsible for freeing it.
+ * Returns: a pointer to the string in valid UTF-8 format. It's @text
+ *    itself when no copy is needed, otherwise a copy allocated in @arena.
  */
-static gchar *
-ensure_valid_utf8( const char *text, int max_bytes ) {
-    gchar *utf8_text = NULL;
-    if( !g_utf8_validate(text, max_bytes, NULL) ) {
-        utf8_text = g_convert( text, max_bytes, "UTF-8", "ISO-8859-1",
-                               NULL,NULL,NULL );
+static const gchar *
+ensure_valid_utf8( Arena *arena, const char *text, int max_bytes ) {
+    gchar *utf8_text, *dest; const guchar *src, *end; gint64 trace_begin;
+    gsize size;
+    
+    if( g_utf8_validate(text, max_bytes, NULL) ) {
+        return max_bytes<0 ? text : arena_strndup( arena, text, max_bytes );
+    }
+    trace_begin = TRACE_BEGIN();
+    size = max_bytes>=0 ? strnlen( text, max_bytes ) : strlen( text );
+    utf8_text = dest = arena_alloc( arena, size*2 + 1 );
+    for( src = (const guchar *)text, end = src+size ; src<end ; ++src ) {
+        if( *src<0x80 ) { *dest++ = (gchar)*src; continue; }
+        *dest++ = (gchar)(0xC0 | (*src >> 6));
+        *dest++ = (gchar)(0x80 | (*src & 0x3F));
     }
-    return utf8_text    ? utf8_text :
-           max_bytes>=0 ? g_strndup( text, max_bytes ) : g_strdup( text );
+    *dest = '\0';
+    TRACE_MARK(trace_begin, "utf-8 repair", NULL);
+    return utf8_text;
 }
 
+typedef struct _WidgetText WidgetText;
+struct         _WidgetText {
+    const char *text;
+    int         max_bytes;
+    int         depth;
+};
+
 static void
-set_widget_text_(GtkWidget *widget, const char *text, int max_bytes, int depth) {
-    GtkTextBuffer *buffer; gchar *utf8_text;
+set_widget_text_(GtkWidget *widget, gpointer data) {
+    const WidgetText *widget_text = data; WidgetText child_text;
+    GtkTextBuffer *buffer; const gchar *utf8_text;
+    const char *text = widget_text->text; int max_bytes = widget_text->max_bytes;
     
-    if( GTK_IS_LABEL(widget) && depth==0 ) {
-        utf8_text = ensure_valid_utf8( text, max_bytes );
+    if( GTK_IS_LABEL(widget) && widget_text->depth==0 ) {
+        utf8_text = ensure_valid_utf8( widget_text_arena, text, max_bytes );
         gtk_label_set_text( GTK_LABEL(widget), utf8_text );
-        g_free( utf8_text );
     }
     else if( GTK_IS_ENTRY(widget) ) {
-        utf8_text = ensure_valid_utf8( text, max_bytes );
+        utf8_text = ensure_valid_utf8( widget_text_arena, text, max_bytes );
         gtk_entry_set_text( GTK_ENTRY(widget), utf8_text );
-        g_free( utf8_text );
     }
     else if( GTK_IS_TEXT_VIEW(widget) ) {
-        utf8_text = ensure_valid_utf8( text, max_bytes );
+        utf8_text = ensure_valid_utf8( widget_text_arena, text, max_bytes );
         buffer = gtk_text_view_get_buffer( GTK_TEXT_VIEW(widget) );
         if( buffer ) { gtk_text_buffer_set_text( buffer, utf8_text, -1 ); }
-        g_free( utf8_text );
     }    
     else if( GTK_IS_CONTAINER(widget) ) {
-        GList *children, *iter; GtkWidget *child;
-        children = gtk_container_get_children( GTK_CONTAINER(widget) );
-        for( iter = children ; iter ; iter = g_list_next(iter) ) {
-            child = GTK_WIDGET( iter->data );
-            set_widget_text_( child, text, max_bytes, depth+1 );
-        }
+        child_text = (*widget_text);
+        child_text.depth++;
+        gtk_container_foreach( GTK_CONTAINER(widget), set_widget_text_, &child_text );
     }
 }
 
@@ -113,7 +139,22 @@ set_widget_text_(GtkWidget *widget, const char *text, int max_bytes, int depth)
  */
 static void
 set_widget_text(GtkWidget *widget, const char *text, int max_bytes) {
-    set_widget_text_( widget, text, max_bytes, 0 );
+    WidgetText widget_text = { text, max_bytes, 0 };
+    if( !widget_text_arena ) { widget_text_arena = arena_new(); }
+    set_widget_text_( widget, &widget_text );
+    arena_reset( widget_text_arena );
+}
+
+/**
+ * free_widget_text_arena - Releases the scratch memory of set_widget_text().
+ *
+ * Must be called when the plugin is deactivated, otherwise the arena
+ * outlives it. The next call to set_widget_text() creates it again.
+ */
+static void
+free_widget_text_arena( void ) {
+    arena_free( widget_text_arena );
+    widget_text_arena = NULL;
 }
 
 /*---------------------------- DISPLAYING TEXT ----------------------------*/
@@ -194,16 +235,66 @@ display_text_or_float( GtkBuilder  *builder,
     if( text ) {
         display_text( builder, widget_name, text );
     } else {
-        gchar *str_value = NULL;
-        switch( num_decimals ) {
-            case 0:  str_value = g_strdup_printf("%.0f", float_value); break;
-            case 1:  str_value = g_strdup_printf("%.1f", float_value); break;
-            case 2:  str_value = g_strdup_printf("%.2f", float_value); break;
-            default: str_value = g_strdup_printf("%.3f", float_value); break;
-        }
-        if( str_value ) {
-            display_text( builder, widget_name, str_value );
-            g_free( str_value );
-        }
+        gchar str_value[64];
+        if( num_decimals<0 || num_decimals>2 ) { num_decimals = 3; }
+        g_snprintf( str_value, sizeof(str_value), "%.*f", num_decimals, float_value );
+        display_text( builder, widget_name, str_value );
     }
 }
+
+typedef struct _WidgetTreeProvider WidgetTreeProvider;
+struct         _WidgetTreeProvider {
+    GtkStyleProvider *provider;
+    guint             priority;
+    gboolean          add;
+};
+
+static void
+apply_tree_style_provider_( GtkWidget *widget, gpointer data ) {
+    WidgetTreeProvider *tree = data;
+    GtkStyleContext *context = gtk_widget_get_style_context( widget );
+    if( tree->add ) {
+        gtk_style_context_add_provider( context, tree->provider, tree->priority );
+    } else {
+        gtk_style_context_remove_provider( context, tree->provider );
+    }
+    if( GTK_IS_CONTAINER(widget) ) {
+        gtk_container_forall( GTK_CONTAINER(widget),
+                              apply_tree_style_provider_, tree );
+    }
+}
+
+/**
+ * add_tree_style_provider - Adds a style provider to a widget subtree.
+ * @widget:   the root of the subtree.
+ * @provider: the #GtkStyleProvider to add.
+ * @priority: the priority of the provider (GTK_STYLE_PROVIDER_PRIORITY_*).
+ *
+ * GTK 3 style contexts don't pass their providers to the children, so the
+ * provider is added to @widget and to each of its descendants (internal
+ * children included). Unlike a provider added for the screen, changing it
+ * only restyles the widgets of the subtree.
+ */
+static void
+add_tree_style_provider( GtkWidget        *widget,
+                         GtkStyleProvider *provider,
+                         guint             priority )
+{
+    WidgetTreeProvider tree = { provider, priority, TRUE };
+    g_return_if_fail( GTK_IS_WIDGET(widget) && provider );
+    apply_tree_style_provider_( widget, &tree );
+}
+
+/**
+ * remove_tree_style_provider - Removes a style provider from a subtree.
+ * @widget:   the root of the subtree.
+ * @provider: a #GtkStyleProvider added with add_tree_style_provider().
+ */
+static void
+remove_tree_style_provider( GtkWidget        *widget,
+                            GtkStyleProvider *provider )
+{
+    WidgetTreeProvider tree = { provider, 0, FALSE };
+    g_return_if_fail( GTK_IS_WIDGET(widget) && provider );
+    apply_tree_style_provider_( widget, &tree );
+}